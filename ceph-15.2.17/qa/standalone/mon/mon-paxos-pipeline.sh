@@ -0,0 +1,153 @@
+#!/usr/bin/env bash
+#
+# Drive a three monitor cluster with concurrent config-key writes and
+# compare paxos proposals per second with and without pipelining
+# (paxos_pipeline_depth).  Also check that killing the leader while
+# proposals are pipelined loses none of the writes that were acknowledged.
+#
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export MONA=127.0.0.1:7155 # git grep '\<7155\>' : there must be only one
+    export MONB=127.0.0.1:7156 # git grep '\<7156\>' : there must be only one
+    export MONC=127.0.0.1:7157 # git grep '\<7157\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-initial-members=a,b,c --mon-host=$MONA,$MONB,$MONC "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+function run_mons() {
+    local dir=$1
+
+    run_mon $dir a --public-addr $MONA || return 1
+    run_mon $dir b --public-addr $MONB || return 1
+    run_mon $dir c --public-addr $MONC || return 1
+    wait_for_quorum 300 3 || return 1
+}
+
+function get_leader() {
+    ceph quorum_status --format=json | jq -r .quorum_leader_name
+}
+
+function set_depth() {
+    local depth=$1
+
+    for id in a b c ; do
+        CEPH_ARGS='' ceph --admin-daemon $(get_asok_path mon.$id) \
+            config set paxos_pipeline_depth $depth > /dev/null || return 1
+    done
+}
+
+function paxos_counter() {
+    local id=$1
+    local counter=$2
+
+    CEPH_ARGS='' ceph --admin-daemon $(get_asok_path mon.$id) perf dump paxos | \
+        jq ".paxos.$counter"
+}
+
+# run $writers parallel writers, $count keys each; keys that were
+# acknowledged are appended to $dir/acked
+function write_keys() {
+    local dir=$1
+    local prefix=$2
+    local writers=$3
+    local count=$4
+
+    local pids=""
+    for w in $(seq $writers) ; do
+        (
+            for i in $(seq $count) ; do
+                if ceph config-key set $prefix/$w/$i $w.$i > /dev/null 2>&1 ; then
+                    echo "$prefix/$w/$i $w.$i" >> $dir/acked
+                fi
+            done
+        ) &
+        pids+=" $!"
+    done
+    wait $pids
+}
+
+function check_keys() {
+    local dir=$1
+
+    local key
+    local value
+    while read key value ; do
+        test "$(ceph config-key get $key)" = "$value" || return 1
+    done < $dir/acked
+}
+
+# prints the proposals per second the leader committed while writing
+function measure() {
+    local dir=$1
+    local depth=$2
+
+    set_depth $depth || return 1
+    local leader=$(get_leader)
+    local commits=$(paxos_counter $leader commit)
+    local start=$(date +%s.%N)
+    write_keys $dir depth$depth 16 25
+    local end=$(date +%s.%N)
+    commits=$(( $(paxos_counter $leader commit) - commits ))
+    echo "depth $depth: $commits proposals in $(echo "$end - $start" | bc)s," \
+        "$(echo "scale=1; $commits / ($end - $start)" | bc) proposals/s" >&2
+}
+
+function TEST_paxos_pipeline_throughput() {
+    local dir=$1
+
+    run_mons $dir || return 1
+    touch $dir/acked
+
+    local leader=$(get_leader)
+    local pipelined=$(paxos_counter $leader pipelined)
+    measure $dir 1 || return 1
+    # nothing is pipelined by default
+    test $(paxos_counter $leader pipelined) = $pipelined || return 1
+
+    measure $dir 4 || return 1
+    test $(paxos_counter $leader pipelined) -gt $pipelined || return 1
+
+    # every write made it, once, in order
+    test $(wc -l < $dir/acked) = 800 || return 1
+    check_keys $dir || return 1
+}
+
+function TEST_paxos_pipeline_leader_failure() {
+    local dir=$1
+
+    run_mons $dir || return 1
+    touch $dir/acked
+    set_depth 4 || return 1
+
+    local leader=$(get_leader)
+    write_keys $dir before 16 10 &
+    local writer=$!
+    sleep 2
+    kill_daemons $dir TERM mon.$leader || return 1
+    wait $writer
+
+    wait_for_quorum 300 2 || return 1
+    check_keys $dir || return 1
+
+    # the survivors keep pipelining
+    write_keys $dir after 16 10
+    check_keys $dir || return 1
+}
+
+main mon-paxos-pipeline "$@"
+
+# Local Variables:
+# compile-command: "cd ../../../build ; make -j4 ceph-mon && ../qa/run-standalone.sh mon-paxos-pipeline.sh"
+# End:
@@ -187,7 +187,7 @@ int Client::CommandHook::call(
 dir_result_t::dir_result_t(Inode *in, const UserPerm& perms)
   : inode(in), offset(0), next_offset(2),
     release_count(0), ordered_count(0), cache_index(0), start_shared_gen(0),
-    perms(perms)
+    getattr_batch_end(0), perms(perms)
   { }
 
 void Client::_reset_faked_inos()
@@ -8114,6 +8114,64 @@ int Client::_readdir_get_frag(dir_result_t *dirp)
   return res;
 }
 
+/*
+ * Refetch attributes and caps of the entries following @after_name with a
+ * single readdir request.  This is used when readdir with stat finds entries
+ * whose caps have been revoked, so that we don't send one getattr per entry.
+ * The results go into a private dir_result_t; only the inodes, dentries and
+ * caps are updated, the caller's buffer and the readdir cache are untouched.
+ * The last refreshed entry is recorded in @dirp so that entries a batch
+ * already covered fall back to a plain getattr instead of batching again;
+ * if the batch fails, batching stops for the rest of this readdir.
+ */
+int Client::_readdir_getattr_batch(dir_result_t *dirp, int64_t after_offset,
+				   const string& after_name)
+{
+  unsigned max = cct->_conf.get_val<uint64_t>("client_readdir_getattr_batch");
+  InodeRef& diri = dirp->inode;
+  if (!max || after_name.empty() || diri->snapid == CEPH_SNAPDIR) {
+    dirp->getattr_batch_end = dir_result_t::END;
+    return -EINVAL;
+  }
+
+  auto batch = std::make_unique<dir_result_t>(diri.get(), dirp->perms);
+  batch->offset = after_offset + 1;
+  batch->next_offset = dir_result_t::fpos_low(after_offset) + 1;
+  batch->last_name = after_name;
+
+  frag_t fg;
+  if (batch->hash_order())
+    fg = diri->dirfragtree[batch->offset_high()];
+  else
+    fg = frag_t(batch->offset_high());
+
+  ldout(cct, 10) << __func__ << " " << dirp << " on " << diri->ino << " fg " << fg
+		 << " after '" << after_name << "' max " << max << dendl;
+
+  MetaRequest *req = new MetaRequest(CEPH_MDS_OP_READDIR);
+  filepath path;
+  diri->make_nosnap_relative_path(path);
+  req->set_filepath(path);
+  req->set_inode(diri.get());
+  req->head.args.readdir.frag = fg;
+  req->head.args.readdir.flags = CEPH_READDIR_REPLY_BITFLAGS |
+				 CEPH_READDIR_GETATTR_BATCH;
+  req->head.args.readdir.max_entries = max;
+  req->path2.set_path(after_name);
+  req->dirp = batch.get();
+
+  bufferlist dirbl;
+  int res = make_request(req, dirp->perms, NULL, NULL, -1, &dirbl);
+  ldout(cct, 10) << __func__ << " refreshed " << batch->buffer.size()
+		 << " entries, result=" << res << dendl;
+  if (res < 0 || batch->buffer.empty()) {
+    dirp->getattr_batch_end = dir_result_t::END;
+    return res < 0 ? res : -ENOENT;
+  }
+  dirp->getattr_batch_end = batch->buffer.back().offset;
+  return 0;
+}
+
 struct dentry_off_lt {
   bool operator()(const Dentry* dn, int64_t off) const {
     return dir_result_t::fpos_cmp(dn->offset, off) < 0;
@@ -8162,6 +8220,12 @@ int Client::_readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p,
     if (dn->inode->is_dir()) {
       mask |= CEPH_STAT_RSTAT;
     }
+    if (idx > 0 && !dirp->getattr_batch_covers(dn->offset) &&
+	!dn->inode->caps_issued_mask(mask, true)) {
+      Dentry *prev = *(pd - 1);
+      // on failure the plain getattr below still refreshes this entry
+      _readdir_getattr_batch(dirp, prev->offset, prev->name);
+    }
     int r = _getattr(dn->inode, mask, dirp->perms);
     if (r < 0)
       return r;
@@ -8349,6 +8413,13 @@ int Client::readdir_r_cb(dir_result_t *d, add_dirent_cb_t cb, void *p,
 	if(entry.inode->is_dir()){
           mask |= CEPH_STAT_RSTAT;
 	}
+	if (it != dirp->buffer.begin() &&
+	    !dirp->getattr_batch_covers(entry.offset) &&
+	    !entry.inode->caps_issued_mask(mask, true)) {
+	  auto prev = std::prev(it);
+	  // on failure the plain getattr below still refreshes this entry
+	  _readdir_getattr_batch(dirp, prev->offset, prev->name);
+	}
 	r = _getattr(entry.inode, mask, dirp->perms);
 	if (r < 0)
 	  return r;
@@ -199,9 +199,17 @@ struct dir_result_t {
     offset = 0;
     ordered_count = 0;
     cache_index = 0;
+    getattr_batch_end = 0;
     buffer.clear();
   }
 
+  // true if a getattr batch already refreshed (or gave up on) entry @off
+  bool getattr_batch_covers(int64_t off) {
+    if (getattr_batch_end == END)
+      return true;
+    return getattr_batch_end && fpos_cmp(off, getattr_batch_end) <= 0;
+  }
+
   InodeRef inode;
   int64_t offset;        // hash order:
 			 //   (0xff << 52) | ((24 bits hash) << 28) |
@@ -216,6 +224,7 @@ struct dir_result_t {
   uint64_t ordered_count;
   unsigned cache_index;
   int start_shared_gen;  // dir shared_gen at start of readdir
+  int64_t getattr_batch_end; // last entry refreshed by a getattr batch
   UserPerm perms;
 
   frag_t buffer_frag;
@@ -1024,6 +1033,8 @@ private:
   void _readdir_next_frag(dir_result_t *dirp);
   void _readdir_rechoose_frag(dir_result_t *dirp);
   int _readdir_get_frag(dir_result_t *dirp);
+  int _readdir_getattr_batch(dir_result_t *dirp, int64_t after_offset,
+			     const string& after_name);
   int _readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p, int caps, bool getref);
   void _closedir(dir_result_t *dirp);
 
@@ -24,6 +24,19 @@ void cls_chunk_refcount_put(librados::ObjectWriteOperation& op, const hobject_t&
   op.exec("cas", "chunk_put", in);
 }
 
+void cls_chunk_create_or_get_ref(librados::ObjectWriteOperation& op, const hobject_t& soid,
+				 const bufferlist& data)
+{
+  bufferlist in;
+  ceph_osd_op osd_op = {};
+  osd_op.extent.offset = 0;
+  osd_op.extent.length = data.length();
+  encode(osd_op, in);
+  encode(soid, in);
+  in.append(data);
+  op.exec("cas", "cas_write_or_get", in);
+}
+
 void cls_chunk_refcount_set(librados::ObjectWriteOperation& op, set<hobject_t>& refs)
 {
   bufferlist in;
@@ -8,6 +8,8 @@
 void cls_chunk_refcount_get(librados::ObjectWriteOperation& op, const hobject_t& soid);
 void cls_chunk_refcount_put(librados::ObjectWriteOperation& op, const hobject_t& soid);
 void cls_chunk_refcount_set(librados::ObjectWriteOperation& op, set<hobject_t>& refs);
+void cls_chunk_create_or_get_ref(librados::ObjectWriteOperation& op, const hobject_t& soid,
+				 const bufferlist& data);
 int cls_chunk_refcount_read(librados::IoCtx& io_ctx, string& oid, set<hobject_t> *refs);
 int cls_chunk_has_chunk(librados::IoCtx& io_ctx, string& oid, string& fp_oid);
 #endif
@@ -31,13 +31,17 @@ CLS_NAME(rgw)
 #define BI_BUCKET_LOG_INDEX           1
 #define BI_BUCKET_OBJ_INSTANCE_INDEX  2
 #define BI_BUCKET_OLH_DATA_INDEX      3
+#define BI_BUCKET_RESHARD_LOG_INDEX   4
+#define BI_BUCKET_DICT_INDEX          5
 
-#define BI_BUCKET_LAST_INDEX          4
+#define BI_BUCKET_LAST_INDEX          6
 
 static std::string bucket_index_prefixes[] = { "", /* special handling for the objs list index */
 					       "0_",     /* bucket log index */
 					       "1000_",  /* obj instance index */
 					       "1001_",  /* olh data index */
+					       "2001_",  /* reshard log index */
+					       "2002_",  /* compact entry dictionary */
 
 					       /* this must be the last index */
 					       "9999_",};
@@ -123,6 +127,44 @@ static void bi_log_index_key(cls_method_context_t hctx, string& key, string& id,
   key.append(id);
 }
 
+/*
+ * While a bucket index shard is resharded online, writes are still
+ * accepted; each of them records the name of the object it touched so
+ * that the reshard process can copy that object's entries again before
+ * it switches over to the new index.  The value is the version of the
+ * index object at the time of the change.
+ */
+static int reshard_log_add(cls_method_context_t hctx,
+			   const rgw_bucket_dir_header& header,
+			   const string& name)
+{
+  if (!header.new_instance.recording_reshard_log()) {
+    return 0;
+  }
+
+  string key(1, BI_PREFIX_CHAR);
+  key.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+  key.append(name);
+
+  bufferlist bl;
+  encode(cls_current_version(hctx), bl);
+  return cls_cxx_map_set_val(hctx, key, &bl);
+}
+
+static int read_bucket_header(cls_method_context_t hctx,
+			      rgw_bucket_dir_header *header);
+
+static int reshard_log_add(cls_method_context_t hctx, const string& name)
+{
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: %s(): failed to read header\n", __func__);
+    return rc;
+  }
+  return reshard_log_add(hctx, header, name);
+}
+
 static int log_index_operation(cls_method_context_t hctx, cls_rgw_obj_key& obj_key, RGWModifyOp op,
                                string& tag, real_time& timestamp,
                                rgw_bucket_entry_ver& ver, RGWPendingState state, uint64_t index_ver,
@@ -453,6 +495,129 @@ static int read_bucket_header(cls_method_context_t hctx,
   return 0;
 }
 
+/*
+ * Entries of shards with header.compact_entries set are stored in the
+ * compact encoding (see rgw_bucket_dir_entry::encode_compact()). The
+ * strings they share are kept in the shard's dictionary, under a key of
+ * its own rather than in the header, so that neither the header reads of
+ * every index op nor the listing replies carry it. It is read on the
+ * first compact entry decoded or encoded, once.
+ *
+ * Only a codec given the header can encode entries, in the encoding the
+ * header asks for; strings new to the dictionary are added to it and the
+ * dictionary written along with the entry.
+ */
+class DirEntryCodec {
+  cls_method_context_t hctx;
+  const rgw_bucket_dir_header *header;
+  rgw_bucket_index_dict dict;
+  bool dict_loaded = false;
+
+  static string dict_key() {
+    string key(1, BI_PREFIX_CHAR);
+    key.append(bucket_index_prefixes[BI_BUCKET_DICT_INDEX]);
+    return key;
+  }
+
+  int load_dict() {
+    if (dict_loaded) {
+      return 0;
+    }
+    bufferlist bl;
+    int r = cls_cxx_map_get_val(hctx, dict_key(), &bl);
+    if (r < 0 && r != -ENOENT) {
+      return r;
+    }
+    if (r == 0) {
+      try {
+	auto iter = bl.cbegin();
+	decode(dict, iter);
+      } catch (buffer::error& err) {
+	CLS_LOG(1, "ERROR: %s(): failed to decode dictionary\n", __func__);
+	return -EIO;
+      }
+    }
+    dict_loaded = true;
+    return 0;
+  }
+
+public:
+  explicit DirEntryCodec(cls_method_context_t hctx,
+			 const rgw_bucket_dir_header *header = nullptr)
+    : hctx(hctx), header(header) {}
+
+  // throws buffer::error
+  void decode_entry(const string& idx, const bufferlist& bl,
+		    rgw_bucket_dir_entry *entry) {
+    auto iter = bl.cbegin();
+    if (!rgw_bucket_dir_entry::is_compact(bl)) {
+      decode(*entry, iter);
+      return;
+    }
+    if (load_dict() < 0) {
+      throw buffer::malformed_input("failed to read bucket index dictionary");
+    }
+    entry->decode_compact(iter, idx, dict);
+  }
+
+  // convert a compact entry to the regular encoding, for callers outside
+  // of this class
+  void expand_entry(const string& idx, bufferlist& bl) {
+    if (rgw_bucket_dir_entry::is_compact(bl)) {
+      rgw_bucket_dir_entry entry;
+      decode_entry(idx, bl, &entry);
+      bl.clear();
+      encode(entry, bl);
+    }
+  }
+
+  int encode_entry(const string& idx, const rgw_bucket_dir_entry& entry,
+		   bufferlist& bl) {
+    ceph_assert(header);
+    if (!header->compact_entries) {
+      encode(entry, bl);
+      return 0;
+    }
+    int r = load_dict();
+    if (r < 0) {
+      return r;
+    }
+    const size_t dict_size = dict.strings.size();
+    const bool new_dict = (dict.mtime_base == 0);
+    if (new_dict) {
+      dict.mtime_base = real_clock::to_time_t(real_clock::now());
+    }
+    entry.encode_compact(bl, idx, dict, true);
+    if (new_dict || dict.strings.size() != dict_size) {
+      bufferlist dict_bl;
+      encode(dict, dict_bl);
+      r = cls_cxx_map_set_val(hctx, dict_key(), &dict_bl);
+      if (r < 0) {
+	return r;
+      }
+    }
+    return 0;
+  }
+
+  int write_entry(const string& idx, const rgw_bucket_dir_entry& entry) {
+    bufferlist bl;
+    int r = encode_entry(idx, entry, bl);
+    if (r < 0) {
+      return r;
+    }
+    return cls_cxx_map_set_val(hctx, idx, &bl);
+  }
+
+  int get_dict_size(size_t *size) {
+    int r = load_dict();
+    if (r < 0) {
+      return r;
+    }
+    *size = dict.strings.size();
+    return 0;
+  }
+};
+
 int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   // maximum number of calls to get_obj_vals we'll try; compromise
@@ -540,12 +705,11 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 
     done = keys.empty();
 
+    DirEntryCodec decoder(hctx);
     for (auto kiter = keys.cbegin(); kiter != keys.cend(); ++kiter) {
       rgw_bucket_dir_entry entry;
       try {
-	const bufferlist& entrybl = kiter->second;
-	auto eiter = entrybl.cbegin();
-        decode(entry, eiter);
+        decoder.decode_entry(kiter->first, kiter->second, &entry);
       } catch (buffer::error& err) {
         CLS_LOG(1, "ERROR: %s: failed to decode entry, key=%s\n",
 		__func__, kiter->first.c_str());
@@ -665,6 +829,8 @@ static int check_index(cls_method_context_t hctx,
   calc_header->tag_timeout = existing_header->tag_timeout;
   calc_header->ver = existing_header->ver;
   calc_header->syncstopped = existing_header->syncstopped;
+  calc_header->compact_entries = existing_header->compact_entries;
+  DirEntryCodec decoder(hctx);
 
   map<string, bufferlist> keys;
   string start_obj;
@@ -687,9 +853,8 @@ static int check_index(cls_method_context_t hctx,
       }
 
       rgw_bucket_dir_entry entry;
-      auto eiter = kiter->second.cbegin();
       try {
-        decode(entry, eiter);
+        decoder.decode_entry(kiter->first, kiter->second, &entry);
       } catch (buffer::error& err) {
         CLS_LOG(1, "ERROR: rgw_bucket_list(): failed to decode entry, key=%s\n", kiter->first.c_str());
         return -EIO;
@@ -825,7 +990,8 @@ int rgw_bucket_set_tag_timeout(cls_method_context_t hctx, bufferlist *in, buffer
 
 static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key,
 			  string *idx, rgw_bucket_dir_entry *entry,
-                          bool special_delete_marker_name = false);
+                          bool special_delete_marker_name = false,
+                          DirEntryCodec *codec = nullptr);
 
 int rgw_bucket_prepare_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
@@ -847,6 +1013,12 @@ int rgw_bucket_prepare_op(cls_method_context_t hctx, bufferlist *in, bufferlist
   CLS_LOG(1, "rgw_bucket_prepare_op(): request: op=%d name=%s instance=%s tag=%s\n",
           op.op, op.key.name.c_str(), op.key.instance.c_str(), op.tag.c_str());
 
+  /* A prepare is not recorded in the reshard log: it only adds a pending
+   * tag, and the complete or the cancel that follows it is recorded (or
+   * goes to the new index). That spares reading the header here; it is
+   * only read to decode an existing compact entry.
+   */
+
   // get on-disk state
   string idx;
 
@@ -873,7 +1045,8 @@ int rgw_bucket_prepare_op(cls_method_context_t hctx, bufferlist *in, bufferlist
   info.op = op.op;
   entry.pending_map.insert(pair<string, rgw_bucket_pending_info>(op.tag, info));
 
-  // write out new key to disk
+  // write out new key to disk; complete_op writes it back in the
+  // encoding the header asks for
   bufferlist info_bl;
   encode(entry, info_bl);
   return cls_cxx_map_set_val(hctx, idx, &info_bl);
@@ -903,6 +1076,29 @@ static void log_entry(const char *func, const char *str, rgw_bucket_olh_entry *e
           entry->tag.c_str());
 }
 
+static int read_omap_entry(cls_method_context_t hctx, const std::string& name,
+                           rgw_bucket_dir_entry* entry,
+                           DirEntryCodec *codec = nullptr)
+{
+  bufferlist current_entry;
+  int rc = cls_cxx_map_get_val(hctx, name, &current_entry);
+  if (rc < 0) {
+    return rc;
+  }
+
+  try {
+    if (codec) {
+      codec->decode_entry(name, current_entry, entry);
+    } else {
+      DirEntryCodec(hctx).decode_entry(name, current_entry, entry);
+    }
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode entry\n", __func__);
+    return -EIO;
+  }
+  return 0;
+}
+
 template <class T>
 static int read_omap_entry(cls_method_context_t hctx, const std::string& name,
                            T* entry)
@@ -935,12 +1131,26 @@ static int read_index_entry(cls_method_context_t hctx, string& name, T* entry)
   return 0;
 }
 
+static int read_index_entry(cls_method_context_t hctx, string& name,
+                            rgw_bucket_dir_entry* entry,
+                            DirEntryCodec *codec)
+{
+  int ret = read_omap_entry(hctx, name, entry, codec);
+  if (ret < 0) {
+    return ret;
+  }
+
+  log_entry(__func__, "existing entry", entry);
+  return 0;
+}
+
 static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key,
 			  string *idx, rgw_bucket_dir_entry *entry,
-                          bool special_delete_marker_name)
+                          bool special_delete_marker_name,
+                          DirEntryCodec *codec)
 {
   encode_obj_index_key(key, idx);
-  int rc = read_index_entry(hctx, *idx, entry);
+  int rc = read_index_entry(hctx, *idx, entry, codec);
   if (rc < 0) {
     return rc;
   }
@@ -953,13 +1163,13 @@ static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key,
      */
     if (special_delete_marker_name) {
       encode_obj_versioned_data_key(key, idx, true);
-      rc = read_index_entry(hctx, *idx, entry);
+      rc = read_index_entry(hctx, *idx, entry, codec);
       if (rc == 0) {
         return 0;
       }
     }
     encode_obj_versioned_data_key(key, idx);
-    rc = read_index_entry(hctx, *idx, entry);
+    rc = read_index_entry(hctx, *idx, entry, codec);
     if (rc < 0) {
       *entry = rgw_bucket_dir_entry(); /* need to reset entry because we initialized it earlier */
       return rc;
@@ -992,11 +1202,22 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     return -EINVAL;
   }
 
+  DirEntryCodec codec(hctx, &header);
+
+  rc = reshard_log_add(hctx, header, op.key.name);
+  if (rc < 0)
+    return rc;
+  for (auto& remove_key : op.remove_objs) {
+    rc = reshard_log_add(hctx, header, remove_key.name);
+    if (rc < 0)
+      return rc;
+  }
+
   rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
   string idx;
-  rc = read_key_entry(hctx, op.key, &idx, &entry);
+  rc = read_key_entry(hctx, op.key, &idx, &entry, false, &codec);
   if (rc == -ENOENT) {
     entry.key = op.key;
     entry.ver = op.ver;
@@ -1036,9 +1257,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
   bufferlist op_bl;
   if (cancel) {
     if (op.tag.size()) {
-      bufferlist new_key_bl;
-      encode(entry, new_key_bl);
-      return cls_cxx_map_set_val(hctx, idx, &new_key_bl);
+      return codec.write_entry(idx, entry);
     }
     return 0;
   }
@@ -1058,9 +1277,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 	  return ret;
       } else {
         entry.exists = false;
-        bufferlist new_key_bl;
-        encode(entry, new_key_bl);
-	int ret = cls_cxx_map_set_val(hctx, idx, &new_key_bl);
+	int ret = codec.write_entry(idx, entry);
 	if (ret < 0)
 	  return ret;
       }
@@ -1080,9 +1297,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
       stats.total_size += meta.accounted_size;
       stats.total_size_rounded += cls_rgw_get_rounded_size(meta.accounted_size);
       stats.actual_size += meta.size;
-      bufferlist new_key_bl;
-      encode(entry, new_key_bl);
-      int ret = cls_cxx_map_set_val(hctx, idx, &new_key_bl);
+      int ret = codec.write_entry(idx, entry);
       if (ret < 0)
 	return ret;
     }
@@ -1104,7 +1319,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
             remove_key.name.c_str(), remove_key.instance.c_str());
     rgw_bucket_dir_entry remove_entry;
     string k;
-    int ret = read_key_entry(hctx, remove_key, &k, &remove_entry);
+    int ret = read_key_entry(hctx, remove_key, &k, &remove_entry, false, &codec);
     if (ret < 0) {
       CLS_LOG(1, "rgw_bucket_complete_op(): removing entries, read_index_entry name=%s instance=%s ret=%d\n",
             remove_key.name.c_str(), remove_key.instance.c_str(), ret);
@@ -1173,11 +1388,11 @@ static void update_olh_log(rgw_bucket_olh_entry& olh_data_entry, OLHLogOp op, co
   log.push_back(log_entry);
 }
 
-static int write_obj_instance_entry(cls_method_context_t hctx, rgw_bucket_dir_entry& instance_entry, const string& instance_idx)
+static int write_obj_instance_entry(DirEntryCodec& codec, rgw_bucket_dir_entry& instance_entry, const string& instance_idx)
 {
   CLS_LOG(20, "write_entry() instance=%s idx=%s flags=%d", escape_str(instance_entry.key.instance).c_str(), instance_idx.c_str(), instance_entry.flags);
   /* write the instance entry */
-  int ret = write_entry(hctx, instance_entry, instance_idx);
+  int ret = codec.write_entry(instance_idx, instance_entry);
   if (ret < 0) {
     CLS_LOG(0, "ERROR: write_entry() instance_key=%s ret=%d", escape_str(instance_idx).c_str(), ret);
     return ret;
@@ -1188,9 +1403,9 @@ static int write_obj_instance_entry(cls_method_context_t hctx, rgw_bucket_dir_en
 /*
  * write object instance entry, and if needed also the list entry
  */
-static int write_obj_entries(cls_method_context_t hctx, rgw_bucket_dir_entry& instance_entry, const string& instance_idx)
+static int write_obj_entries(DirEntryCodec& codec, rgw_bucket_dir_entry& instance_entry, const string& instance_idx)
 {
-  int ret = write_obj_instance_entry(hctx, instance_entry, instance_idx);
+  int ret = write_obj_instance_entry(codec, instance_entry, instance_idx);
   if (ret < 0) {
     return ret;
   }
@@ -1200,7 +1415,7 @@ static int write_obj_entries(cls_method_context_t hctx, rgw_bucket_dir_entry& in
   if (instance_idx != instance_list_idx) {
     CLS_LOG(20, "write_entry() idx=%s flags=%d", escape_str(instance_list_idx).c_str(), instance_entry.flags);
     /* write a new list entry for the object instance */
-    ret = write_entry(hctx, instance_entry, instance_list_idx);
+    ret = codec.write_entry(instance_list_idx, instance_entry);
     if (ret < 0) {
       CLS_LOG(0, "ERROR: write_entry() instance=%s instance_list_idx=%s ret=%d", instance_entry.key.instance.c_str(), instance_list_idx.c_str(), ret);
       return ret;
@@ -1212,6 +1427,7 @@ static int write_obj_entries(cls_method_context_t hctx, rgw_bucket_dir_entry& in
 
 class BIVerObjEntry {
   cls_method_context_t hctx;
+  DirEntryCodec& codec;
   cls_rgw_obj_key key;
   string instance_idx;
 
@@ -1220,14 +1436,17 @@ class BIVerObjEntry {
   bool initialized;
 
 public:
-  BIVerObjEntry(cls_method_context_t& _hctx, const cls_rgw_obj_key& _key) : hctx(_hctx), key(_key), initialized(false) {
+  BIVerObjEntry(cls_method_context_t& _hctx, DirEntryCodec& _codec,
+		const cls_rgw_obj_key& _key)
+    : hctx(_hctx), codec(_codec), key(_key), initialized(false) {
     // empty
   }
 
   int init(bool check_delete_marker = true) {
     int ret = read_key_entry(hctx, key, &instance_idx, &instance_entry,
-                             check_delete_marker && key.instance.empty()); /* this is potentially a delete marker, for null objects we
-                                                                              keep separate instance entry for the delete markers */
+                             check_delete_marker && key.instance.empty(), /* this is potentially a delete marker, for null objects we
+                                                                             keep separate instance entry for the delete markers */
+                             &codec);
 
     if (ret < 0) {
       CLS_LOG(0, "ERROR: read_key_entry() idx=%s ret=%d", instance_idx.c_str(), ret);
@@ -1293,7 +1512,7 @@ public:
     /* write the instance and list entries */
     bool special_delete_marker_key = (instance_entry.is_delete_marker() && instance_entry.key.instance.empty());
     encode_obj_versioned_data_key(key, &instance_idx, special_delete_marker_key);
-    int ret = write_obj_entries(hctx, instance_entry, instance_idx);
+    int ret = write_obj_entries(codec, instance_entry, instance_idx);
     if (ret < 0) {
       CLS_LOG(0, "ERROR: write_obj_entries() instance_idx=%s ret=%d", instance_idx.c_str(), ret);
       return ret;
@@ -1352,8 +1571,7 @@ public:
 
     map<string, bufferlist>::reverse_iterator last = keys.rbegin();
     try {
-      auto iter = last->second.cbegin();
-      decode(next_entry, iter);
+      codec.decode_entry(last->first, last->second, &next_entry);
     } catch (buffer::error& err) {
       CLS_LOG(0, "ERROR; failed to decode entry: %s", last->first.c_str());
       return -EIO;
@@ -1460,12 +1678,12 @@ public:
   }
 };
 
-static int write_version_marker(cls_method_context_t hctx, cls_rgw_obj_key& key)
+static int write_version_marker(DirEntryCodec& codec, cls_rgw_obj_key& key)
 {
   rgw_bucket_dir_entry entry;
   entry.key = key;
   entry.flags = rgw_bucket_dir_entry::FLAG_VER_MARKER;
-  int ret = write_entry(hctx, entry, key.name);
+  int ret = codec.write_entry(key.name, entry);
   if (ret < 0) {
     CLS_LOG(0, "ERROR: write_entry returned ret=%d", ret);
     return ret;
@@ -1480,6 +1698,7 @@ static int write_version_marker(cls_method_context_t hctx, cls_rgw_obj_key& key)
  * key. Their version is going to be empty though
  */
 static int convert_plain_entry_to_versioned(cls_method_context_t hctx,
+					    DirEntryCodec& codec,
 					    cls_rgw_obj_key& key,
 					    bool demote_current,
 					    bool instance_only)
@@ -1491,7 +1710,7 @@ static int convert_plain_entry_to_versioned(cls_method_context_t hctx,
   rgw_bucket_dir_entry entry;
 
   string orig_idx;
-  int ret = read_key_entry(hctx, key, &orig_idx, &entry);
+  int ret = read_key_entry(hctx, key, &orig_idx, &entry, false, &codec);
   if (ret != -ENOENT) {
     if (ret < 0) {
       CLS_LOG(0, "ERROR: read_key_entry() returned ret=%d", ret);
@@ -1509,9 +1728,9 @@ static int convert_plain_entry_to_versioned(cls_method_context_t hctx,
     encode_obj_versioned_data_key(key, &new_idx);
 
     if (instance_only) {
-      ret = write_obj_instance_entry(hctx, entry, new_idx);
+      ret = write_obj_instance_entry(codec, entry, new_idx);
     } else {
-      ret = write_obj_entries(hctx, entry, new_idx);
+      ret = write_obj_entries(codec, entry, new_idx);
     }
     if (ret < 0) {
       CLS_LOG(0, "ERROR: write_obj_entries new_idx=%s returned %d",
@@ -1520,7 +1739,7 @@ static int convert_plain_entry_to_versioned(cls_method_context_t hctx,
     }
   }
 
-  ret = write_version_marker(hctx, key);
+  ret = write_version_marker(codec, key);
   if (ret < 0) {
     return ret;
   }
@@ -1559,9 +1778,23 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return -EINVAL;
   }
 
+  rgw_bucket_dir_header header;
+  int ret = read_bucket_header(hctx, &header);
+  if (ret < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_link_olh(): failed to read header\n");
+    return ret;
+  }
+
+  ret = reshard_log_add(hctx, header, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
+  DirEntryCodec codec(hctx, &header);
+
   /* read instance entry */
-  BIVerObjEntry obj(hctx, op.key);
-  int ret = obj.init(op.delete_marker);
+  BIVerObjEntry obj(hctx, codec, op.key);
+  ret = obj.init(op.delete_marker);
 
   /* NOTE: When a delete is issued, a key instance is always provided,
    * either the one for which the delete is requested or a new random
@@ -1626,7 +1859,7 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
    * its list entry.
    */
   if (op.key.instance.empty()) {
-    BIVerObjEntry other_obj(hctx, op.key);
+    BIVerObjEntry other_obj(hctx, codec, op.key);
     ret = other_obj.init(!op.delete_marker); /* try reading the other
 					      * null versioned
 					      * entry */
@@ -1696,7 +1929,7 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
       rgw_bucket_olh_entry& olh_entry = olh.get_entry();
       /* found olh, previous instance is no longer the latest, need to update */
       if (!(olh_entry.key == op.key)) {
-        BIVerObjEntry old_obj(hctx, olh_entry.key);
+        BIVerObjEntry old_obj(hctx, codec, olh_entry.key);
 
         ret = old_obj.demote_current();
         if (ret < 0) {
@@ -1709,7 +1942,8 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
   } else {
     bool instance_only = (op.key.instance.empty() && op.delete_marker);
     cls_rgw_obj_key key(op.key.name);
-    ret = convert_plain_entry_to_versioned(hctx, key, promote, instance_only);
+    ret = convert_plain_entry_to_versioned(hctx, codec, key, promote,
+					   instance_only);
     if (ret < 0) {
       CLS_LOG(0, "ERROR: convert_plain_entry_to_versioned ret=%d", ret);
       return ret;
@@ -1740,13 +1974,6 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return ret;
   }
 
-  rgw_bucket_dir_header header;
-  ret = read_bucket_header(hctx, &header);
-  if (ret < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_link_olh(): failed to read header\n");
-    return ret;
-  }
-
   if (op.log_op && !header.syncstopped) {
     rgw_bucket_dir_entry& entry = obj.get_dir_entry();
 
@@ -1790,15 +2017,28 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return -EINVAL;
   }
 
+  rgw_bucket_dir_header header;
+  int ret = read_bucket_header(hctx, &header);
+  if (ret < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_unlink_instance(): failed to read header\n");
+    return ret;
+  }
+
+  ret = reshard_log_add(hctx, header, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   cls_rgw_obj_key dest_key = op.key;
   if (dest_key.instance == "null") {
     dest_key.instance.clear();
   }
 
-  BIVerObjEntry obj(hctx, dest_key);
+  DirEntryCodec codec(hctx, &header);
+  BIVerObjEntry obj(hctx, codec, dest_key);
   BIOLHEntry olh(hctx, dest_key);
 
-  int ret = obj.init();
+  ret = obj.init();
   if (ret == -ENOENT) {
     return 0; /* already removed */
   }
@@ -1817,7 +2057,8 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
   if (!olh_found) {
     bool instance_only = false;
     cls_rgw_obj_key key(dest_key.name);
-    ret = convert_plain_entry_to_versioned(hctx, key, true, instance_only);
+    ret = convert_plain_entry_to_versioned(hctx, codec, key, true,
+					   instance_only);
     if (ret < 0) {
       CLS_LOG(0, "ERROR: convert_plain_entry_to_versioned ret=%d", ret);
       return ret;
@@ -1857,7 +2098,7 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     }
 
     if (found) {
-      BIVerObjEntry next(hctx, next_key);
+      BIVerObjEntry next(hctx, codec, next_key);
       ret = next.write(olh.get_epoch(), true);
       if (ret < 0) {
         CLS_LOG(0, "ERROR: next.write() returned ret=%d", ret);
@@ -1901,13 +2142,6 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return ret;
   }
 
-  rgw_bucket_dir_header header;
-  ret = read_bucket_header(hctx, &header);
-  if (ret < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_unlink_instance(): failed to read header\n");
-    return ret;
-  }
-
   if (op.log_op && !header.syncstopped) {
     rgw_bucket_entry_ver ver;
     ver.epoch = (op.olh_epoch ? op.olh_epoch : olh.get_epoch());
@@ -2012,6 +2246,11 @@ static int rgw_bucket_trim_olh_log(cls_method_context_t hctx, bufferlist *in, bu
     return -ECANCELED;
   }
 
+  ret = reshard_log_add(hctx, op.olh.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   /* remove all versions up to and including ver from the pending map */
   map<uint64_t, vector<rgw_bucket_olh_log_entry> >& log = olh_data_entry.pending_log;
   map<uint64_t, vector<rgw_bucket_olh_log_entry> >::iterator liter = log.begin();
@@ -2048,11 +2287,16 @@ static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, buffe
     return -EINVAL;
   }
 
+  int ret = reshard_log_add(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   /* read olh entry */
   rgw_bucket_olh_entry olh_data_entry;
   string olh_data_key;
   encode_olh_data_key(op.key, &olh_data_key);
-  int ret = read_index_entry(hctx, olh_data_key, &olh_data_entry);
+  ret = read_index_entry(hctx, olh_data_key, &olh_data_entry);
   if (ret < 0 && ret != -ENOENT) {
     CLS_LOG(0, "ERROR: read_index_entry() olh_key=%s ret=%d", olh_data_key.c_str(), ret);
     return ret;
@@ -2115,6 +2359,7 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
     std::chrono::seconds(
       header.tag_timeout ? header.tag_timeout : CEPH_RGW_TAG_TIMEOUT));
 
+  DirEntryCodec codec(hctx, &header);
   auto in_iter = in->cbegin();
 
   while (!in_iter.end()) {
@@ -2129,6 +2374,10 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
       return -EINVAL;
     }
 
+    rc = reshard_log_add(hctx, header, cur_change.key.name);
+    if (rc < 0)
+      return rc;
+
     bufferlist cur_disk_bl;
     string cur_change_key;
     encode_obj_index_key(cur_change.key, &cur_change_key);
@@ -2141,9 +2390,8 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
     }
 
     if (cur_disk_bl.length()) {
-      auto cur_disk_iter = cur_disk_bl.cbegin();
       try {
-        decode(cur_disk, cur_disk_iter);
+        codec.decode_entry(cur_change_key, cur_disk_bl, &cur_disk);
       } catch (buffer::error& error) {
         CLS_LOG(1, "ERROR: rgw_dir_suggest_changes(): failed to decode cur_disk\n");
         return -EINVAL;
@@ -2213,9 +2461,7 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
         stats.actual_size += cur_change.meta.size;
         header_changed = true;
         cur_change.index_ver = header.ver;
-        bufferlist cur_state_bl;
-        encode(cur_change, cur_state_bl);
-        ret = cls_cxx_map_set_val(hctx, cur_change_key, &cur_state_bl);
+        ret = codec.write_entry(cur_change_key, cur_change);
         if (ret < 0)
 	  return ret;
         if (log_op && !header.syncstopped) {
@@ -2483,6 +2729,16 @@ static int rgw_bi_get_op(cls_method_context_t hctx, bufferlist *in, bufferlist *
       return r;
   }
 
+  if (op.type != BIIndexType::OLH) {
+    try {
+      DirEntryCodec(hctx).expand_entry(idx, entry.data);
+    } catch (buffer::error& err) {
+      CLS_LOG(0, "ERROR: %s(): failed to decode entry %s", __func__,
+	      escape_str(idx).c_str());
+      return -EIO;
+    }
+  }
+
   encode(op_ret, *out);
 
   return 0;
@@ -2547,6 +2803,7 @@ static int list_plain_entries_help(cls_method_context_t hctx,
   }
 
   end_key_reached = false;
+  DirEntryCodec decoder(hctx);
   for (auto iter : raw_entries) {
     if (!end_key.empty() && iter.first >= end_key) {
       end_key_reached = true;
@@ -2555,9 +2812,8 @@ static int list_plain_entries_help(cls_method_context_t hctx,
     }
 
     rgw_bucket_dir_entry e;
-    auto biter = iter.second.cbegin();
     try {
-      decode(e, biter);
+      decoder.decode_entry(iter.first, iter.second, &e);
     } catch (buffer::error& err) {
       CLS_LOG(0, "ERROR: %s: failed to decode buffer for plain bucket index entry \"%s\"",
 	      __func__, escape_str(iter.first).c_str());
@@ -2579,7 +2835,12 @@ static int list_plain_entries_help(cls_method_context_t hctx,
     rgw_cls_bi_entry entry;
     entry.type = BIIndexType::Plain;
     entry.idx = iter.first;
-    entry.data = iter.second;
+    if (rgw_bucket_dir_entry::is_compact(iter.second)) {
+      // callers only know the regular encoding
+      encode(e, entry.data);
+    } else {
+      entry.data = iter.second;
+    }
 
     entries->push_back(entry);
     count++;
@@ -2706,6 +2967,7 @@ static int list_instance_entries(cls_method_context_t hctx,
     keys[start_after_key].claim(k);
   }
 
+  DirEntryCodec decoder(hctx);
   map<string, bufferlist>::iterator iter;
   for (iter = keys.begin(); iter != keys.end(); ++iter) {
     rgw_cls_bi_entry entry;
@@ -2723,15 +2985,18 @@ static int list_instance_entries(cls_method_context_t hctx,
 
     CLS_LOG(20, "%s(): entry.idx=%s", __func__, escape_str(entry.idx).c_str());
 
-    auto biter = entry.data.cbegin();
-
     rgw_bucket_dir_entry e;
     try {
-      decode(e, biter);
+      decoder.decode_entry(entry.idx, entry.data, &e);
     } catch (buffer::error& err) {
       CLS_LOG(0, "ERROR: %s(): failed to decode buffer (size=%d)", __func__, entry.data.length());
       return -EIO;
     }
+    if (rgw_bucket_dir_entry::is_compact(entry.data)) {
+      // callers only know the regular encoding
+      entry.data.clear();
+      encode(e, entry.data);
+    }
 
     if (!name.empty() && e.key.name != name) {
       /* we are skipping the rest of the entries */
@@ -2941,6 +3206,151 @@ static int rgw_bi_list_op(cls_method_context_t hctx,
 } // rgw_bi_list_op
 
 
+static bool bi_is_dir_entry(const string& key)
+{
+  int type = bi_entry_type(key);
+  return type == BI_BUCKET_OBJS_INDEX || type == BI_BUCKET_OBJ_INSTANCE_INDEX;
+}
+
+/*
+ * Switch a bucket index shard to or from the compact entry encoding, and
+ * rewrite up to op.max entries after op.marker in it. Entries written by
+ * later index operations use the new encoding too, so with max = 0 a
+ * shard only converts as its entries change.
+ */
+static int rgw_bi_compact_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  rgw_cls_bi_compact_op op;
+  auto in_iter = in->cbegin();
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(0, "ERROR: %s(): failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: %s(): failed to read header\n", __func__);
+    return rc;
+  }
+
+  if (header.compact_entries != op.compact) {
+    header.compact_entries = op.compact;
+    rc = write_bucket_header(hctx, &header);
+    if (rc < 0) {
+      return rc;
+    }
+  }
+
+  constexpr uint32_t MAX_BI_COMPACT_ENTRIES = 1000;
+  const uint32_t max = std::min(op.max, MAX_BI_COMPACT_ENTRIES);
+
+  rgw_cls_bi_compact_ret op_ret;
+  map<string, bufferlist> vals;
+  if (max > 0) {
+    rc = cls_cxx_map_get_vals(hctx, op.marker, string(), max, &vals,
+			      &op_ret.is_truncated);
+    if (rc < 0) {
+      return rc;
+    }
+  }
+
+  DirEntryCodec codec(hctx, &header);
+  for (auto& v : vals) {
+    op_ret.marker = v.first;
+    if (!bi_is_dir_entry(v.first) ||
+	rgw_bucket_dir_entry::is_compact(v.second) == op.compact) {
+      continue;
+    }
+    rgw_bucket_dir_entry entry;
+    try {
+      codec.decode_entry(v.first, v.second, &entry);
+    } catch (buffer::error& err) {
+      CLS_LOG(0, "ERROR: %s(): failed to decode entry %s", __func__,
+	      escape_str(v.first).c_str());
+      return -EIO;
+    }
+    rc = codec.write_entry(v.first, entry);
+    if (rc < 0) {
+      return rc;
+    }
+    ++op_ret.converted;
+  }
+
+  encode(op_ret, *out);
+
+  return 0;
+}
+
+static int rgw_bi_index_stats_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  rgw_cls_bi_index_stats_op op;
+  auto in_iter = in->cbegin();
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(0, "ERROR: %s(): failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  rgw_cls_bi_index_stats_ret op_ret;
+
+  bufferlist header_bl;
+  int rc = cls_cxx_map_read_header(hctx, &header_bl);
+  if (rc < 0) {
+    return rc;
+  }
+  if (header_bl.length() > 0) {
+    rgw_bucket_dir_header header;
+    auto iter = header_bl.cbegin();
+    try {
+      decode(header, iter);
+    } catch (buffer::error& err) {
+      CLS_LOG(1, "ERROR: %s(): failed to decode header\n", __func__);
+      return -EIO;
+    }
+    op_ret.header_bytes = header_bl.length();
+    op_ret.compact = header.compact_entries;
+  }
+  size_t dict_strings = 0;
+  rc = DirEntryCodec(hctx).get_dict_size(&dict_strings);
+  if (rc < 0) {
+    return rc;
+  }
+  op_ret.dict_strings = dict_strings;
+
+  constexpr uint32_t MAX_BI_INDEX_STATS_KEYS = 1000;
+  const uint32_t max = std::min(op.max, MAX_BI_INDEX_STATS_KEYS);
+
+  map<string, bufferlist> vals;
+  rc = cls_cxx_map_get_vals(hctx, op.marker, string(), max, &vals,
+			    &op_ret.is_truncated);
+  if (rc < 0) {
+    return rc;
+  }
+
+  for (auto& v : vals) {
+    op_ret.marker = v.first;
+    if (bi_is_dir_entry(v.first)) {
+      ++op_ret.entries;
+      if (rgw_bucket_dir_entry::is_compact(v.second)) {
+	++op_ret.compact_entries;
+      }
+      op_ret.entry_key_bytes += v.first.size();
+      op_ret.entry_value_bytes += v.second.length();
+    } else {
+      ++op_ret.other_keys;
+      op_ret.other_bytes += v.first.size() + v.second.length();
+    }
+  }
+
+  encode(op_ret, *out);
+
+  return 0;
+}
+
 int bi_log_record_decode(bufferlist& bl, rgw_bi_log_entry& e)
 {
   auto iter = bl.cbegin();
@@ -4162,6 +4572,22 @@ static int rgw_reshard_remove(cls_method_context_t hctx, bufferlist *in, bufferl
   return ret;
 }
 
+// drop the names recorded by an online reshard
+static int reshard_log_clear(cls_method_context_t hctx)
+{
+  string key_begin(1, BI_PREFIX_CHAR);
+  key_begin.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+  string key_end(1, BI_PREFIX_CHAR);
+  key_end.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX + 1]);
+
+  int rc = cls_cxx_map_remove_range(hctx, key_begin, key_end);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: %s(): cls_cxx_map_remove_range failed rc=%d\n", __func__, rc);
+    return rc;
+  }
+  return 0;
+}
+
 static int rgw_set_bucket_resharding(cls_method_context_t hctx, bufferlist *in,  bufferlist *out)
 {
   cls_rgw_set_bucket_resharding_op op;
@@ -4183,6 +4609,13 @@ static int rgw_set_bucket_resharding(cls_method_context_t hctx, bufferlist *in,
 
   header.new_instance.set_status(op.entry.new_bucket_instance_id, op.entry.num_shards, op.entry.reshard_status);
 
+  if (!header.resharding()) {
+    rc = reshard_log_clear(hctx);
+    if (rc < 0) {
+      return rc;
+    }
+  }
+
   return write_bucket_header(hctx, &header);
 }
 
@@ -4206,6 +4639,11 @@ static int rgw_clear_bucket_resharding(cls_method_context_t hctx, bufferlist *in
   }
   header.new_instance.clear();
 
+  rc = reshard_log_clear(hctx);
+  if (rc < 0) {
+    return rc;
+  }
+
   return write_bucket_header(hctx, &header);
 }
 
@@ -4228,7 +4666,8 @@ static int rgw_guard_bucket_resharding(cls_method_context_t hctx, bufferlist *in
     return rc;
   }
 
-  if (header.resharding()) {
+  // online resharding keeps accepting writes while it records their names
+  if (header.resharding() && !header.new_instance.recording_reshard_log()) {
     return op.ret_err;
   }
 
@@ -4263,6 +4702,51 @@ static int rgw_get_bucket_resharding(cls_method_context_t hctx,
   return 0;
 }
 
+static int rgw_bucket_reshard_log_list(cls_method_context_t hctx,
+				       bufferlist *in, bufferlist *out)
+{
+  cls_rgw_reshard_log_list_op op;
+
+  auto in_iter = in->cbegin();
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode entry\n", __func__);
+    return -EINVAL;
+  }
+
+  string prefix(1, BI_PREFIX_CHAR);
+  prefix.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+  string start_after = prefix + op.marker;
+
+  constexpr uint32_t MAX_RESHARD_LOG_ENTRIES = 1000;
+  const uint32_t max = std::min(op.max, MAX_RESHARD_LOG_ENTRIES);
+
+  map<string, bufferlist> vals;
+  cls_rgw_reshard_log_list_ret op_ret;
+  int rc = cls_cxx_map_get_vals(hctx, start_after, prefix, max, &vals,
+				&op_ret.is_truncated);
+  if (rc < 0) {
+    return rc;
+  }
+
+  for (auto& v : vals) {
+    uint64_t ver;
+    auto iter = v.second.cbegin();
+    try {
+      decode(ver, iter);
+    } catch (buffer::error& err) {
+      CLS_LOG(1, "ERROR: %s(): failed to decode entry\n", __func__);
+      return -EIO;
+    }
+    op_ret.entries[v.first.substr(prefix.size())] = ver;
+  }
+
+  encode(op_ret, *out);
+
+  return 0;
+}
+
 CLS_INIT(rgw)
 {
   CLS_LOG(1, "Loaded rgw class!");
@@ -4288,6 +4772,8 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bi_get_op;
   cls_method_handle_t h_rgw_bi_put_op;
   cls_method_handle_t h_rgw_bi_list_op;
+  cls_method_handle_t h_rgw_bi_compact_op;
+  cls_method_handle_t h_rgw_bi_index_stats_op;
   cls_method_handle_t h_rgw_bi_log_list_op;
   cls_method_handle_t h_rgw_bi_log_resync_op;
   cls_method_handle_t h_rgw_bi_log_stop_op;
@@ -4314,6 +4800,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_clear_bucket_resharding;
   cls_method_handle_t h_rgw_guard_bucket_resharding;
   cls_method_handle_t h_rgw_get_bucket_resharding;
+  cls_method_handle_t h_rgw_bucket_reshard_log_list;
 
   cls_register(RGW_CLASS, &h_class);
 
@@ -4340,6 +4827,8 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BI_GET, CLS_METHOD_RD, rgw_bi_get_op, &h_rgw_bi_get_op);
   cls_register_cxx_method(h_class, RGW_BI_PUT, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_put_op, &h_rgw_bi_put_op);
   cls_register_cxx_method(h_class, RGW_BI_LIST, CLS_METHOD_RD, rgw_bi_list_op, &h_rgw_bi_list_op);
+  cls_register_cxx_method(h_class, RGW_BI_COMPACT, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_compact_op, &h_rgw_bi_compact_op);
+  cls_register_cxx_method(h_class, RGW_BI_INDEX_STATS, CLS_METHOD_RD, rgw_bi_index_stats_op, &h_rgw_bi_index_stats_op);
 
   cls_register_cxx_method(h_class, RGW_BI_LOG_LIST, CLS_METHOD_RD, rgw_bi_log_list, &h_rgw_bi_log_list_op);
   cls_register_cxx_method(h_class, RGW_BI_LOG_TRIM, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_log_trim, &h_rgw_bi_log_list_op);
@@ -4384,6 +4873,8 @@ CLS_INIT(rgw)
 			  rgw_guard_bucket_resharding, &h_rgw_guard_bucket_resharding);
   cls_register_cxx_method(h_class, RGW_GET_BUCKET_RESHARDING, CLS_METHOD_RD ,
 			  rgw_get_bucket_resharding, &h_rgw_get_bucket_resharding);
+  cls_register_cxx_method(h_class, RGW_BUCKET_RESHARD_LOG_LIST, CLS_METHOD_RD,
+			  rgw_bucket_reshard_log_list, &h_rgw_bucket_reshard_log_list);
 
   return;
 }
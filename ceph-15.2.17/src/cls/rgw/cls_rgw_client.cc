@@ -220,6 +220,20 @@ static bool issue_bucket_set_tag_timeout_op(librados::IoCtx& io_ctx,
   return manager->aio_operate(io_ctx, shard_id, oid, &op);
 }
 
+static bool issue_bi_compact_op(librados::IoCtx& io_ctx,
+				const int shard_id,
+				const string& oid,
+				bool compact,
+				BucketIndexAioManager *manager) {
+  bufferlist in;
+  rgw_cls_bi_compact_op call;
+  call.compact = compact;
+  encode(call, in);
+  ObjectWriteOperation op;
+  op.exec(RGW_CLASS, RGW_BI_COMPACT, in);
+  return manager->aio_operate(io_ctx, shard_id, oid, &op);
+}
+
 int CLSRGWIssueBucketIndexInit::issue_op(const int shard_id, const string& oid)
 {
   return issue_bucket_index_init_op(io_ctx, shard_id, oid, &manager);
@@ -243,6 +257,11 @@ int CLSRGWIssueSetTagTimeout::issue_op(const int shard_id, const string& oid)
   return issue_bucket_set_tag_timeout_op(io_ctx, shard_id, oid, tag_timeout, &manager);
 }
 
+int CLSRGWIssueSetCompactIndex::issue_op(const int shard_id, const string& oid)
+{
+  return issue_bi_compact_op(io_ctx, shard_id, oid, compact, &manager);
+}
+
 void cls_rgw_bucket_update_stats(librados::ObjectWriteOperation& o,
 				 bool absolute,
                                  const map<RGWObjCategory, rgw_bucket_category_stats>& stats)
@@ -486,6 +505,53 @@ int cls_rgw_bi_list(librados::IoCtx& io_ctx, const std::string& oid,
   return 0;
 }
 
+int cls_rgw_bi_compact(librados::IoCtx& io_ctx, const string& oid, bool compact,
+                       const string& marker, uint32_t max,
+                       rgw_cls_bi_compact_ret *result)
+{
+  bufferlist in, out;
+  rgw_cls_bi_compact_op call;
+  call.compact = compact;
+  call.marker = marker;
+  call.max = max;
+  encode(call, in);
+  int r = io_ctx.exec(oid, RGW_CLASS, RGW_BI_COMPACT, in, out);
+  if (r < 0)
+    return r;
+
+  auto iter = out.cbegin();
+  try {
+    decode(*result, iter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+
+  return 0;
+}
+
+int cls_rgw_bi_index_stats(librados::IoCtx& io_ctx, const string& oid,
+                           const string& marker, uint32_t max,
+                           rgw_cls_bi_index_stats_ret *result)
+{
+  bufferlist in, out;
+  rgw_cls_bi_index_stats_op call;
+  call.marker = marker;
+  call.max = max;
+  encode(call, in);
+  int r = io_ctx.exec(oid, RGW_CLASS, RGW_BI_INDEX_STATS, in, out);
+  if (r < 0)
+    return r;
+
+  auto iter = out.cbegin();
+  try {
+    decode(*result, iter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+
+  return 0;
+}
+
 int cls_rgw_bucket_link_olh(librados::IoCtx& io_ctx, const string& oid,
                             const cls_rgw_obj_key& key, bufferlist& olh_tag,
                             bool delete_marker, const string& op_tag, rgw_bucket_dir_entry_meta *meta,
@@ -1170,6 +1236,34 @@ int cls_rgw_get_bucket_resharding(librados::IoCtx& io_ctx, const string& oid,
   return 0;
 }
 
+int cls_rgw_bucket_reshard_log_list(librados::IoCtx& io_ctx, const string& oid,
+                                    const string& marker, uint32_t max,
+                                    map<string, uint64_t> *entries,
+                                    bool *is_truncated)
+{
+  bufferlist in, out;
+  cls_rgw_reshard_log_list_op call;
+  call.marker = marker;
+  call.max = max;
+  encode(call, in);
+  int r = io_ctx.exec(oid, RGW_CLASS, RGW_BUCKET_RESHARD_LOG_LIST, in, out);
+  if (r < 0)
+    return r;
+
+  cls_rgw_reshard_log_list_ret op_ret;
+  auto iter = out.cbegin();
+  try {
+    decode(op_ret, iter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+
+  entries->swap(op_ret.entries);
+  *is_truncated = op_ret.is_truncated;
+
+  return 0;
+}
+
 void cls_rgw_guard_bucket_resharding(librados::ObjectOperation& op, int ret_err)
 {
   bufferlist in, out;
@@ -339,6 +339,18 @@ public:
     CLSRGWConcurrentIO(ioc, _bucket_objs, _max_aio), tag_timeout(_tag_timeout) {}
 };
 
+/* switch the shards to or from the compact entry encoding; existing
+ * entries convert as they are written */
+class CLSRGWIssueSetCompactIndex : public CLSRGWConcurrentIO {
+  bool compact;
+protected:
+  int issue_op(int shard_id, const string& oid) override;
+public:
+  CLSRGWIssueSetCompactIndex(librados::IoCtx& ioc, map<int, string>& _bucket_objs,
+                             uint32_t _max_aio, bool _compact) :
+    CLSRGWConcurrentIO(ioc, _bucket_objs, _max_aio), compact(_compact) {}
+};
+
 void cls_rgw_bucket_update_stats(librados::ObjectWriteOperation& o,
                                  bool absolute,
                                  const map<RGWObjCategory, rgw_bucket_category_stats>& stats);
@@ -367,6 +379,12 @@ void cls_rgw_bi_put(librados::ObjectWriteOperation& op, const string oid, rgw_cl
 int cls_rgw_bi_list(librados::IoCtx& io_ctx, const string& oid,
                    const string& name, const string& marker, uint32_t max,
                    list<rgw_cls_bi_entry> *entries, bool *is_truncated);
+int cls_rgw_bi_compact(librados::IoCtx& io_ctx, const string& oid, bool compact,
+                       const string& marker, uint32_t max,
+                       rgw_cls_bi_compact_ret *result);
+int cls_rgw_bi_index_stats(librados::IoCtx& io_ctx, const string& oid,
+                           const string& marker, uint32_t max,
+                           rgw_cls_bi_index_stats_ret *result);
 
 
 void cls_rgw_bucket_link_olh(librados::ObjectWriteOperation& op,
@@ -621,6 +639,10 @@ int cls_rgw_reshard_get(librados::IoCtx& io_ctx, const string& oid, cls_rgw_resh
 
 /* resharding attribute on bucket index shard headers */
 void cls_rgw_guard_bucket_resharding(librados::ObjectOperation& op, int ret_err);
+int cls_rgw_bucket_reshard_log_list(librados::IoCtx& io_ctx, const string& oid,
+                                    const string& marker, uint32_t max,
+                                    map<string, uint64_t> *entries,
+                                    bool *is_truncated);
 // these overloads which call io_ctx.operate() should not be called in the rgw.
 // rgw_rados_operate() should be called after the overloads w/o calls to io_ctx.operate()
 #ifndef CLS_CLIENT_HIDE_IOCTX
@@ -36,6 +36,8 @@ constexpr int RGWBIAdvanceAndRetryError = -EFBIG;
 #define RGW_BI_GET "bi_get"
 #define RGW_BI_PUT "bi_put"
 #define RGW_BI_LIST "bi_list"
+#define RGW_BI_COMPACT "bi_compact"
+#define RGW_BI_INDEX_STATS "bi_index_stats"
 
 #define RGW_BI_LOG_LIST "bi_log_list"
 #define RGW_BI_LOG_TRIM "bi_log_trim"
@@ -76,5 +78,6 @@ constexpr int RGWBIAdvanceAndRetryError = -EFBIG;
 #define RGW_CLEAR_BUCKET_RESHARDING "clear_bucket_resharding"
 #define RGW_GUARD_BUCKET_RESHARDING "guard_bucket_resharding"
 #define RGW_GET_BUCKET_RESHARDING "get_bucket_resharding"
+#define RGW_BUCKET_RESHARD_LOG_LIST "bucket_reshard_log_list"
 
 #endif
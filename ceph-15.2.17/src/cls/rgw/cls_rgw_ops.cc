@@ -541,3 +541,115 @@ void cls_rgw_get_bucket_resharding_op::generate_test_instances(
 void cls_rgw_get_bucket_resharding_op::dump(Formatter *f) const
 {
 }
+
+void cls_rgw_reshard_log_list_op::generate_test_instances(
+  list<cls_rgw_reshard_log_list_op*>& ls)
+{
+  ls.push_back(new cls_rgw_reshard_log_list_op);
+  ls.push_back(new cls_rgw_reshard_log_list_op);
+  ls.back()->marker = "foo";
+  ls.back()->max = 100;
+}
+
+void cls_rgw_reshard_log_list_op::dump(Formatter *f) const
+{
+  ::encode_json("marker", marker, f);
+  ::encode_json("max", max, f);
+}
+
+void cls_rgw_reshard_log_list_ret::generate_test_instances(
+  list<cls_rgw_reshard_log_list_ret*>& ls)
+{
+  ls.push_back(new cls_rgw_reshard_log_list_ret);
+  ls.push_back(new cls_rgw_reshard_log_list_ret);
+  ls.back()->entries["foo"] = 12;
+  ls.back()->is_truncated = true;
+}
+
+void cls_rgw_reshard_log_list_ret::dump(Formatter *f) const
+{
+  ::encode_json("entries", entries, f);
+  ::encode_json("is_truncated", is_truncated, f);
+}
+
+void rgw_cls_bi_compact_op::generate_test_instances(
+  list<rgw_cls_bi_compact_op*>& ls)
+{
+  ls.push_back(new rgw_cls_bi_compact_op);
+  ls.push_back(new rgw_cls_bi_compact_op);
+  ls.back()->compact = false;
+  ls.back()->marker = "foo";
+  ls.back()->max = 100;
+}
+
+void rgw_cls_bi_compact_op::dump(Formatter *f) const
+{
+  ::encode_json("compact", compact, f);
+  ::encode_json("marker", marker, f);
+  ::encode_json("max", max, f);
+}
+
+void rgw_cls_bi_compact_ret::generate_test_instances(
+  list<rgw_cls_bi_compact_ret*>& ls)
+{
+  ls.push_back(new rgw_cls_bi_compact_ret);
+  ls.push_back(new rgw_cls_bi_compact_ret);
+  ls.back()->marker = "foo";
+  ls.back()->is_truncated = true;
+  ls.back()->converted = 10;
+}
+
+void rgw_cls_bi_compact_ret::dump(Formatter *f) const
+{
+  ::encode_json("marker", marker, f);
+  ::encode_json("is_truncated", is_truncated, f);
+  ::encode_json("converted", converted, f);
+}
+
+void rgw_cls_bi_index_stats_op::generate_test_instances(
+  list<rgw_cls_bi_index_stats_op*>& ls)
+{
+  ls.push_back(new rgw_cls_bi_index_stats_op);
+  ls.push_back(new rgw_cls_bi_index_stats_op);
+  ls.back()->marker = "foo";
+  ls.back()->max = 100;
+}
+
+void rgw_cls_bi_index_stats_op::dump(Formatter *f) const
+{
+  ::encode_json("marker", marker, f);
+  ::encode_json("max", max, f);
+}
+
+void rgw_cls_bi_index_stats_ret::generate_test_instances(
+  list<rgw_cls_bi_index_stats_ret*>& ls)
+{
+  ls.push_back(new rgw_cls_bi_index_stats_ret);
+  ls.push_back(new rgw_cls_bi_index_stats_ret);
+  ls.back()->entries = 10;
+  ls.back()->compact_entries = 4;
+  ls.back()->entry_key_bytes = 100;
+  ls.back()->entry_value_bytes = 2000;
+  ls.back()->other_keys = 3;
+  ls.back()->other_bytes = 300;
+  ls.back()->header_bytes = 80;
+  ls.back()->dict_strings = 2;
+  ls.back()->compact = true;
+  ls.back()->marker = "foo";
+  ls.back()->is_truncated = true;
+}
+
+void rgw_cls_bi_index_stats_ret::dump(Formatter *f) const
+{
+  ::encode_json("entries", entries, f);
+  ::encode_json("compact_entries", compact_entries, f);
+  ::encode_json("entry_key_bytes", entry_key_bytes, f);
+  ::encode_json("entry_value_bytes", entry_value_bytes, f);
+  ::encode_json("other_keys", other_keys, f);
+  ::encode_json("other_bytes", other_bytes, f);
+  ::encode_json("header_bytes", header_bytes, f);
+  ::encode_json("dict_strings", dict_strings, f);
+  ::encode_json("compact", compact, f);
+  ::encode_json("marker", marker, f);
+  ::encode_json("is_truncated", is_truncated, f);
+}
@@ -732,6 +732,141 @@ struct rgw_cls_bi_list_ret {
 };
 WRITE_CLASS_ENCODER(rgw_cls_bi_list_ret)
 
+struct rgw_cls_bi_compact_op {
+  bool compact{true}; // false converts back to the regular encoding
+  string marker;
+  uint32_t max{0}; // entries to rewrite; 0 only switches the encoding
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(compact, bl);
+    encode(marker, bl);
+    encode(max, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(compact, bl);
+    decode(marker, bl);
+    decode(max, bl);
+    DECODE_FINISH(bl);
+  }
+
+  static void generate_test_instances(list<rgw_cls_bi_compact_op*>& o);
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(rgw_cls_bi_compact_op)
+
+struct rgw_cls_bi_compact_ret {
+  string marker;
+  bool is_truncated{false};
+  uint64_t converted{0};
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(marker, bl);
+    encode(is_truncated, bl);
+    encode(converted, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(marker, bl);
+    decode(is_truncated, bl);
+    decode(converted, bl);
+    DECODE_FINISH(bl);
+  }
+
+  static void generate_test_instances(list<rgw_cls_bi_compact_ret*>& o);
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(rgw_cls_bi_compact_ret)
+
+struct rgw_cls_bi_index_stats_op {
+  string marker;
+  uint32_t max{0};
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(marker, bl);
+    encode(max, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(marker, bl);
+    decode(max, bl);
+    DECODE_FINISH(bl);
+  }
+
+  static void generate_test_instances(list<rgw_cls_bi_index_stats_op*>& o);
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(rgw_cls_bi_index_stats_op)
+
+/* omap usage of a bucket index shard, for the keys after the marker */
+struct rgw_cls_bi_index_stats_ret {
+  uint64_t entries{0}; // plain and instance entries
+  uint64_t compact_entries{0};
+  uint64_t entry_key_bytes{0};
+  uint64_t entry_value_bytes{0};
+  uint64_t other_keys{0}; // bucket index log, olh, ...
+  uint64_t other_bytes{0};
+  uint64_t header_bytes{0};
+  uint64_t dict_strings{0};
+  bool compact{false};
+  string marker;
+  bool is_truncated{false};
+
+  void add(const rgw_cls_bi_index_stats_ret& other) {
+    entries += other.entries;
+    compact_entries += other.compact_entries;
+    entry_key_bytes += other.entry_key_bytes;
+    entry_value_bytes += other.entry_value_bytes;
+    other_keys += other.other_keys;
+    other_bytes += other.other_bytes;
+  }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(entries, bl);
+    encode(compact_entries, bl);
+    encode(entry_key_bytes, bl);
+    encode(entry_value_bytes, bl);
+    encode(other_keys, bl);
+    encode(other_bytes, bl);
+    encode(header_bytes, bl);
+    encode(dict_strings, bl);
+    encode(compact, bl);
+    encode(marker, bl);
+    encode(is_truncated, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(entries, bl);
+    decode(compact_entries, bl);
+    decode(entry_key_bytes, bl);
+    decode(entry_value_bytes, bl);
+    decode(other_keys, bl);
+    decode(other_bytes, bl);
+    decode(header_bytes, bl);
+    decode(dict_strings, bl);
+    decode(compact, bl);
+    decode(marker, bl);
+    decode(is_truncated, bl);
+    DECODE_FINISH(bl);
+  }
+
+  static void generate_test_instances(list<rgw_cls_bi_index_stats_ret*>& o);
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(rgw_cls_bi_index_stats_ret)
+
 struct rgw_cls_usage_log_read_op {
   uint64_t start_epoch;
   uint64_t end_epoch;
@@ -1495,4 +1630,50 @@ struct cls_rgw_get_bucket_resharding_ret  {
 };
 WRITE_CLASS_ENCODER(cls_rgw_get_bucket_resharding_ret)
 
+struct cls_rgw_reshard_log_list_op {
+  string marker;
+  uint32_t max{0};
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(marker, bl);
+    encode(max, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(marker, bl);
+    decode(max, bl);
+    DECODE_FINISH(bl);
+  }
+
+  static void generate_test_instances(list<cls_rgw_reshard_log_list_op*>& o);
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(cls_rgw_reshard_log_list_op)
+
+struct cls_rgw_reshard_log_list_ret {
+  map<string, uint64_t> entries; // object name -> version of the last change
+  bool is_truncated{false};
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(entries, bl);
+    encode(is_truncated, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(entries, bl);
+    decode(is_truncated, bl);
+    DECODE_FINISH(bl);
+  }
+
+  static void generate_test_instances(list<cls_rgw_reshard_log_list_ret*>& o);
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(cls_rgw_reshard_log_list_ret)
+
 #endif /* CEPH_CLS_RGW_OPS_H */
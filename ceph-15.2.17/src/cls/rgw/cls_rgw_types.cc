@@ -1,6 +1,8 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <algorithm>
+
 #include "cls/rgw/cls_rgw_types.h"
 #include "common/ceph_json.h"
 #include "include/utime.h"
@@ -224,6 +226,289 @@ void rgw_bucket_dir_entry::decode_json(JSONObj *obj) {
   JSONDecoder::decode_json("versioned_epoch", versioned_epoch, obj);
 }
 
+int rgw_bucket_index_dict::find(const string& s) const
+{
+  auto i = std::find(strings.begin(), strings.end(), s);
+  if (i == strings.end()) {
+    return -1;
+  }
+  return i - strings.begin();
+}
+
+int rgw_bucket_index_dict::intern(const string& s)
+{
+  int pos = find(s);
+  if (pos >= 0 || s.empty() || s.size() > MAX_STRING_LEN ||
+      strings.size() >= MAX_STRINGS) {
+    return pos;
+  }
+  strings.push_back(s);
+  return strings.size() - 1;
+}
+
+void rgw_bucket_index_dict::dump(Formatter *f) const
+{
+  encode_json("mtime_base", mtime_base, f);
+  encode_json("strings", strings, f);
+}
+
+void rgw_bucket_index_dict::generate_test_instances(list<rgw_bucket_index_dict*>& o)
+{
+  o.push_back(new rgw_bucket_index_dict);
+  o.push_back(new rgw_bucket_index_dict);
+  o.back()->mtime_base = 1577836800;
+  o.back()->strings.push_back("owner");
+  o.back()->strings.push_back("text/plain");
+}
+
+/* fields of the compact entry encoding */
+enum {
+  COMPACT_NAME_IS_KEY =  1 << 0,
+  COMPACT_EXISTS =       1 << 1,
+  COMPACT_MTIME =        1 << 2,
+  COMPACT_ETAG_MD5 =     1 << 3,
+  COMPACT_ACCOUNTED =    1 << 4, /* accounted_size differs from size */
+  COMPACT_APPENDABLE =   1 << 5,
+  COMPACT_PENDING =      1 << 6,
+};
+
+static constexpr uint8_t COMPACT_VERSION = 1;
+
+static void encode_varint(uint64_t v, bufferlist& bl)
+{
+  char buf[10];
+  int n = 0;
+  while (v >= 0x80) {
+    buf[n++] = (char)((v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  buf[n++] = (char)v;
+  bl.append(buf, n);
+}
+
+static uint64_t decode_varint(bufferlist::const_iterator& bl)
+{
+  uint64_t v = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    uint8_t c;
+    decode(c, bl);
+    v |= (uint64_t)(c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return v;
+    }
+  }
+  throw buffer::malformed_input("varint is too long");
+}
+
+static uint64_t zigzag(int64_t v)
+{
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static void encode_compact_str(const string& s, bufferlist& bl)
+{
+  encode_varint(s.size(), bl);
+  bl.append(s);
+}
+
+static void decode_compact_str(string& s, bufferlist::const_iterator& bl)
+{
+  uint64_t len = decode_varint(bl);
+  s.clear();
+  bl.copy(len, s);
+}
+
+/* the low bit tells a dictionary position from the length of an inline string */
+static void encode_dict_str(const string& s, rgw_bucket_index_dict& dict,
+                            bool intern, bufferlist& bl)
+{
+  int pos = intern ? dict.intern(s) : dict.find(s);
+  if (pos >= 0) {
+    encode_varint(((uint64_t)pos << 1) | 1, bl);
+  } else {
+    encode_varint((uint64_t)s.size() << 1, bl);
+    bl.append(s);
+  }
+}
+
+static void decode_dict_str(string& s, const rgw_bucket_index_dict& dict,
+                            bufferlist::const_iterator& bl)
+{
+  uint64_t v = decode_varint(bl);
+  if (v & 1) {
+    if ((v >> 1) >= dict.strings.size()) {
+      throw buffer::malformed_input("unknown bucket index dictionary string");
+    }
+    s = dict.strings[v >> 1];
+  } else {
+    s.clear();
+    bl.copy(v >> 1, s);
+  }
+}
+
+static int hex_digit(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+static bool is_md5_etag(const string& etag)
+{
+  return etag.size() == 32 &&
+    std::all_of(etag.begin(), etag.end(),
+                [] (char c) { return hex_digit(c) >= 0; });
+}
+
+void rgw_bucket_dir_entry::encode_compact(bufferlist& bl, const string& idx,
+                                          rgw_bucket_index_dict& dict,
+                                          bool intern) const
+{
+  using ceph::encode;
+  uint64_t fields = 0;
+  if (key.instance.empty() && key.name == idx) {
+    fields |= COMPACT_NAME_IS_KEY;
+  }
+  if (exists) {
+    fields |= COMPACT_EXISTS;
+  }
+  if (!ceph::real_clock::is_zero(meta.mtime)) {
+    fields |= COMPACT_MTIME;
+  }
+  if (is_md5_etag(meta.etag)) {
+    fields |= COMPACT_ETAG_MD5;
+  }
+  if (meta.accounted_size != meta.size) {
+    fields |= COMPACT_ACCOUNTED;
+  }
+  if (meta.appendable) {
+    fields |= COMPACT_APPENDABLE;
+  }
+  if (!pending_map.empty()) {
+    fields |= COMPACT_PENDING;
+  }
+
+  encode(COMPACT_MARKER, bl);
+  encode(COMPACT_VERSION, bl);
+  encode_varint(fields, bl);
+  if (!(fields & COMPACT_NAME_IS_KEY)) {
+    encode_compact_str(key.name, bl);
+    encode_compact_str(key.instance, bl);
+  }
+  encode_compact_str(locator, bl);
+  encode_varint(zigzag(ver.pool), bl);
+  encode_varint(ver.epoch, bl);
+  encode_varint(index_ver, bl);
+  encode_varint(flags, bl);
+  encode_varint(versioned_epoch, bl);
+  encode((uint8_t)meta.category, bl);
+  encode_varint(meta.size, bl);
+  if (fields & COMPACT_ACCOUNTED) {
+    encode_varint(zigzag(meta.accounted_size - meta.size), bl);
+  }
+  if (fields & COMPACT_MTIME) {
+    ceph_timespec ts = ceph::real_clock::to_ceph_timespec(meta.mtime);
+    encode_varint(zigzag((int64_t)ts.tv_sec - (int64_t)dict.mtime_base), bl);
+    encode_varint(ts.tv_nsec, bl);
+  }
+  if (fields & COMPACT_ETAG_MD5) {
+    char md5[16];
+    for (int i = 0; i < 16; i++) {
+      md5[i] = (char)(hex_digit(meta.etag[2 * i]) << 4 |
+                      hex_digit(meta.etag[2 * i + 1]));
+    }
+    bl.append(md5, sizeof(md5));
+  } else {
+    encode_compact_str(meta.etag, bl);
+  }
+  encode_dict_str(meta.owner, dict, intern, bl);
+  encode_dict_str(meta.owner_display_name, dict, intern, bl);
+  encode_dict_str(meta.content_type, dict, intern, bl);
+  encode_dict_str(meta.storage_class, dict, intern, bl);
+  encode_compact_str(meta.user_data, bl);
+  encode_compact_str(tag, bl);
+  if (fields & COMPACT_PENDING) {
+    encode(pending_map, bl);
+  }
+}
+
+void rgw_bucket_dir_entry::decode_compact(bufferlist::const_iterator& bl,
+                                          const string& idx,
+                                          const rgw_bucket_index_dict& dict)
+{
+  using ceph::decode;
+  uint8_t marker, v;
+  decode(marker, bl);
+  decode(v, bl);
+  if (marker != COMPACT_MARKER || v > COMPACT_VERSION) {
+    throw buffer::malformed_input("unsupported compact bucket index entry");
+  }
+  const uint64_t fields = decode_varint(bl);
+  if (fields & COMPACT_NAME_IS_KEY) {
+    key.name = idx;
+    key.instance.clear();
+  } else {
+    decode_compact_str(key.name, bl);
+    decode_compact_str(key.instance, bl);
+  }
+  decode_compact_str(locator, bl);
+  ver.pool = unzigzag(decode_varint(bl));
+  ver.epoch = decode_varint(bl);
+  index_ver = decode_varint(bl);
+  flags = (uint16_t)decode_varint(bl);
+  versioned_epoch = decode_varint(bl);
+  exists = (fields & COMPACT_EXISTS) != 0;
+
+  uint8_t category;
+  decode(category, bl);
+  meta.category = (RGWObjCategory)category;
+  meta.size = decode_varint(bl);
+  meta.accounted_size = meta.size;
+  if (fields & COMPACT_ACCOUNTED) {
+    meta.accounted_size += unzigzag(decode_varint(bl));
+  }
+  if (fields & COMPACT_MTIME) {
+    ceph_timespec ts;
+    ts.tv_sec = dict.mtime_base + unzigzag(decode_varint(bl));
+    ts.tv_nsec = decode_varint(bl);
+    meta.mtime = ceph::real_clock::from_ceph_timespec(ts);
+  } else {
+    meta.mtime = ceph::real_time();
+  }
+  if (fields & COMPACT_ETAG_MD5) {
+    static const char hex[] = "0123456789abcdef";
+    char md5[16];
+    bl.copy(sizeof(md5), md5);
+    meta.etag.resize(32);
+    for (int i = 0; i < 16; i++) {
+      meta.etag[2 * i] = hex[(uint8_t)md5[i] >> 4];
+      meta.etag[2 * i + 1] = hex[(uint8_t)md5[i] & 0xf];
+    }
+  } else {
+    decode_compact_str(meta.etag, bl);
+  }
+  decode_dict_str(meta.owner, dict, bl);
+  decode_dict_str(meta.owner_display_name, dict, bl);
+  decode_dict_str(meta.content_type, dict, bl);
+  decode_dict_str(meta.storage_class, dict, bl);
+  decode_compact_str(meta.user_data, bl);
+  decode_compact_str(tag, bl);
+  meta.appendable = (fields & COMPACT_APPENDABLE) != 0;
+  pending_map.clear();
+  if (fields & COMPACT_PENDING) {
+    decode(pending_map, bl);
+  }
+}
+
 static void dump_bi_entry(bufferlist bl, BIIndexType index_type, Formatter *formatter)
 {
   auto iter = bl.cbegin();
@@ -608,6 +893,7 @@ void rgw_bucket_dir_header::dump(Formatter *f) const
   }
   f->close_section();
   ::encode_json("new_instance", new_instance, f);
+  ::encode_json("compact_entries", compact_entries, f);
 }
 
 void rgw_bucket_dir::generate_test_instances(list<rgw_bucket_dir*>& o)
@@ -408,6 +408,42 @@ struct cls_rgw_obj_key {
 };
 WRITE_CLASS_ENCODER(cls_rgw_obj_key)
 
+/*
+ * Strings shared by many entries of a bucket index shard (owners, content
+ * types, storage classes). They are kept once per shard, under an omap key
+ * of their own, and entries in the compact encoding refer to them by
+ * position. Strings are never removed or reordered, so that existing
+ * entries stay decodable.
+ */
+struct rgw_bucket_index_dict {
+  static constexpr size_t MAX_STRINGS = 256;
+  static constexpr size_t MAX_STRING_LEN = 128;
+
+  uint64_t mtime_base = 0; // seconds; compact entries store mtimes relative to it
+  std::vector<std::string> strings;
+
+  /// position of s, or -1 if it isn't in the dictionary
+  int find(const std::string& s) const;
+  /// like find(), but add s if there is still room for it
+  int intern(const std::string& s);
+
+  void encode(bufferlist &bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(mtime_base, bl);
+    encode(strings, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator &bl) {
+    DECODE_START(1, bl);
+    decode(mtime_base, bl);
+    decode(strings, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<rgw_bucket_index_dict*>& o);
+};
+WRITE_CLASS_ENCODER(rgw_bucket_index_dict)
+
 
 struct rgw_bucket_dir_entry {
   /* a versioned object instance */
@@ -425,6 +461,10 @@ struct rgw_bucket_dir_entry {
    * may contain one or more actual entries/objects */
   static constexpr uint16_t FLAG_COMMON_PREFIX =   0x8000;
 
+  /* first byte of an entry in the compact encoding; the regular encoding
+   * starts with its struct_v, which never gets this high */
+  static constexpr uint8_t COMPACT_MARKER = 0xff;
+
   cls_rgw_obj_key key;
   rgw_bucket_entry_ver ver;
   std::string locator;
@@ -486,6 +526,23 @@ struct rgw_bucket_dir_entry {
     DECODE_FINISH(bl);
   }
 
+  /*
+   * The compact encoding is used in bucket index shards whose header has
+   * compact_entries set. It drops the per-struct version headers, writes
+   * integers as varints, leaves out the name when it is the omap key
+   * (idx), stores md5 etags in binary, mtimes relative to the shard's
+   * dict.mtime_base and shared strings as positions in dict. With intern
+   * set, shared strings missing from dict are added to it, and the caller
+   * must persist dict before the entry.
+   */
+  static bool is_compact(const bufferlist& bl) {
+    return bl.length() > 0 && (uint8_t)bl[0] == COMPACT_MARKER;
+  }
+  void encode_compact(bufferlist& bl, const std::string& idx,
+                      rgw_bucket_index_dict& dict, bool intern) const;
+  void decode_compact(bufferlist::const_iterator& bl, const std::string& idx,
+                      const rgw_bucket_index_dict& dict);
+
   bool is_current() const {
     int test_flags =
       rgw_bucket_dir_entry::FLAG_VER | rgw_bucket_dir_entry::FLAG_CURRENT;
@@ -742,7 +799,8 @@ WRITE_CLASS_ENCODER(rgw_bucket_category_stats)
 enum class cls_rgw_reshard_status : uint8_t {
   NOT_RESHARDING  = 0,
   IN_PROGRESS     = 1,
-  DONE            = 2
+  DONE            = 2,
+  IN_LOGRECORD    = 3, // index writes allowed, changed names are recorded
 };
 
 static inline std::string to_string(const cls_rgw_reshard_status status)
@@ -757,10 +815,20 @@ static inline std::string to_string(const cls_rgw_reshard_status status)
   case cls_rgw_reshard_status::DONE:
     return "done";
     break;
+  case cls_rgw_reshard_status::IN_LOGRECORD:
+    return "in-logrecord";
+    break;
   };
   return "Unknown reshard status";
 }
 
+// a reshard is under way, whether or not it still lets index writes through
+static inline bool is_resharding(const cls_rgw_reshard_status status)
+{
+  return status == cls_rgw_reshard_status::IN_PROGRESS ||
+    status == cls_rgw_reshard_status::IN_LOGRECORD;
+}
+
 struct cls_rgw_bucket_instance_entry {
   using RESHARD_STATUS = cls_rgw_reshard_status;
   
@@ -808,6 +876,9 @@ struct cls_rgw_bucket_instance_entry {
   bool resharding_in_progress() const {
     return reshard_status == RESHARD_STATUS::IN_PROGRESS;
   }
+  bool recording_reshard_log() const {
+    return reshard_status == RESHARD_STATUS::IN_LOGRECORD;
+  }
 };
 WRITE_CLASS_ENCODER(cls_rgw_bucket_instance_entry)
 
@@ -819,11 +890,13 @@ struct rgw_bucket_dir_header {
   string max_marker;
   cls_rgw_bucket_instance_entry new_instance;
   bool syncstopped;
+  bool compact_entries; // write entries in the compact encoding
 
-  rgw_bucket_dir_header() : tag_timeout(0), ver(0), master_ver(0), syncstopped(false) {}
+  rgw_bucket_dir_header() : tag_timeout(0), ver(0), master_ver(0), syncstopped(false),
+                            compact_entries(false) {}
 
   void encode(bufferlist &bl) const {
-    ENCODE_START(7, 2, bl);
+    ENCODE_START(8, 2, bl);
     encode(stats, bl);
     encode(tag_timeout, bl);
     encode(ver, bl);
@@ -831,10 +904,11 @@ struct rgw_bucket_dir_header {
     encode(max_marker, bl);
     encode(new_instance, bl);
     encode(syncstopped,bl);
+    encode(compact_entries, bl);
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::const_iterator &bl) {
-    DECODE_START_LEGACY_COMPAT_LEN(6, 2, 2, bl);
+    DECODE_START_LEGACY_COMPAT_LEN(8, 2, 2, bl);
     decode(stats, bl);
     if (struct_v > 2) {
       decode(tag_timeout, bl);
@@ -858,6 +932,11 @@ struct rgw_bucket_dir_header {
     if (struct_v >= 7) {
       decode(syncstopped,bl);
     }
+    if (struct_v >= 8) {
+      decode(compact_entries, bl);
+    } else {
+      compact_entries = false;
+    }
     DECODE_FINISH(bl);
   }
   void dump(Formatter *f) const;
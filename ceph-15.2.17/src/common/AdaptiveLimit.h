@@ -0,0 +1,91 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_ADAPTIVELIMIT_H
+#define CEPH_COMMON_ADAPTIVELIMIT_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include "common/ceph_time.h"
+
+/**
+ * A concurrency limit that follows the latency of the operations it admits.
+ *
+ * Background work (purging, garbage collection, ...) wants to run as many
+ * operations in parallel as the OSDs absorb without hurting client I/O.
+ * Callers report the latency of every completed operation; once per
+ * window (as many completions as the current limit) the average latency
+ * is compared against the target:
+ *
+ *  - below the target, the limit grows additively by one eighth (at least 1);
+ *  - above the target, the limit is cut multiplicatively by a quarter.
+ *
+ * The limit always stays within [min, max].  This class does no locking;
+ * callers serialize access with their own lock.
+ */
+class AdaptiveLimit {
+public:
+  AdaptiveLimit(uint64_t min, uint64_t max, ceph::timespan target)
+    : min_limit(std::max<uint64_t>(min, 1)),
+      max_limit(std::max(max, min_limit)),
+      target(target),
+      limit(min_limit) {}
+
+  uint64_t get() const {
+    return limit;
+  }
+
+  void set_bounds(uint64_t min, uint64_t max) {
+    min_limit = std::max<uint64_t>(min, 1);
+    max_limit = std::max(max, min_limit);
+    limit = std::clamp(limit, min_limit, max_limit);
+  }
+
+  void set_target(ceph::timespan t) {
+    target = t;
+  }
+
+  /// the average latency of the last completed window
+  ceph::timespan get_last_latency() const {
+    return last_latency;
+  }
+
+  /// record the latency of a completed operation
+  void sample(ceph::timespan lat) {
+    window_sum += lat;
+    if (++window_count < limit)
+      return;
+
+    last_latency = window_sum / window_count;
+    window_sum = ceph::timespan::zero();
+    window_count = 0;
+
+    if (last_latency > target) {
+      limit = std::max(min_limit, limit - limit / 4);
+    } else {
+      limit = std::min(max_limit, limit + std::max<uint64_t>(limit / 8, 1));
+    }
+  }
+
+private:
+  uint64_t min_limit;
+  uint64_t max_limit;
+  ceph::timespan target;
+
+  uint64_t limit;
+  uint64_t window_count = 0;
+  ceph::timespan window_sum = ceph::timespan::zero();
+  ceph::timespan last_latency = ceph::timespan::zero();
+};
+
+#endif
@@ -415,6 +415,26 @@ bool get_vdo_utilization(int fd, uint64_t *total, uint64_t *avail)
   return true;
 }
 
+int get_device_io_ticks(const std::string& devname, uint64_t *ms)
+{
+  std::string fn = "/sys/block/" + devname + "/stat";
+  FILE *f = ::fopen(fn.c_str(), "re");
+  if (!f) {
+    return -errno;
+  }
+  // field 10 is the number of milliseconds spent doing I/O
+  unsigned long long v[10];
+  int n = ::fscanf(f, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+		   &v[0], &v[1], &v[2], &v[3], &v[4],
+		   &v[5], &v[6], &v[7], &v[8], &v[9]);
+  ::fclose(f);
+  if (n != 10) {
+    return -EINVAL;
+  }
+  *ms = v[9];
+  return 0;
+}
+
 std::string _decode_model_enc(const std::string& in)
 {
   auto v = boost::replace_all_copy(in, "\\x20", " ");
@@ -898,6 +918,11 @@ bool get_vdo_utilization(int fd, uint64_t *total, uint64_t *avail)
   return false;
 }
 
+int get_device_io_ticks(const std::string& devname, uint64_t *ms)
+{
+  return -EOPNOTSUPP;
+}
+
 std::string get_device_id(const std::string& devname,
 			  std::string *err)
 {
@@ -1068,6 +1093,11 @@ bool get_vdo_utilization(int fd, uint64_t *total, uint64_t *avail)
   return false;
 }
 
+int get_device_io_ticks(const std::string& devname, uint64_t *ms)
+{
+  return -EOPNOTSUPP;
+}
+
 std::string get_device_id(const std::string& devname,
 			  std::string *err)
 {
@@ -1222,6 +1252,11 @@ bool get_vdo_utilization(int fd, uint64_t *total, uint64_t *avail)
   return false;
 }
 
+int get_device_io_ticks(const std::string& devname, uint64_t *ms)
+{
+  return -EOPNOTSUPP;
+}
+
 std::string get_device_id(const std::string& devname,
 			  std::string *err)
 {
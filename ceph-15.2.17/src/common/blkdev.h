@@ -42,6 +42,9 @@ extern int get_vdo_stats_handle(const char *devname, std::string *vdo_name);
 extern int64_t get_vdo_stat(int fd, const char *property);
 extern bool get_vdo_utilization(int fd, uint64_t *total, uint64_t *avail);
 
+/// milliseconds the device has spent doing I/O since boot (e.g., "sdb")
+extern int get_device_io_ticks(const std::string& devname, uint64_t *ms);
+
 class BlkDev {
 public:
   BlkDev(int fd);
@@ -0,0 +1,85 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <algorithm>
+#include <array>
+
+#include "fastcdc.h"
+
+namespace {
+
+// 256 pseudo-random 64-bit values from splitmix64 with a fixed seed; these
+// define where chunks are cut and must never change
+const std::array<uint64_t, 256>& gear_table()
+{
+  static const std::array<uint64_t, 256> table = [] {
+    std::array<uint64_t, 256> t;
+    uint64_t x = 0x2d358dccaa6c78a5ull;
+    for (auto& v : t) {
+      uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      v = z ^ (z >> 31);
+    }
+    return t;
+  }();
+  return table;
+}
+
+// a mask of the top 'bits' bits; the low bits of a gear hash only depend
+// on the last few bytes, the top ones on the last 64
+uint64_t top_bits(uint32_t bits)
+{
+  return bits >= 64 ? ~0ull : ~(~0ull >> bits);
+}
+
+constexpr uint64_t GEAR_WINDOW = 64;
+
+} // anonymous namespace
+
+FastCDC::FastCDC(uint32_t avg_bits, uint64_t min, uint64_t max)
+{
+  avg_bits = std::clamp<uint32_t>(avg_bits, 8, 30);
+  avg_size = 1ull << avg_bits;
+  min_size = min ? std::min(min, avg_size) : avg_size / 4;
+  max_size = max ? std::max(max, avg_size) : avg_size * 4;
+  mask_s = top_bits(avg_bits + 2);
+  mask_l = top_bits(avg_bits - 2);
+}
+
+void FastCDC::calc_chunks(const ceph::bufferlist& data,
+			  std::vector<std::pair<uint64_t, uint64_t>> *chunks) const
+{
+  const auto& gear = gear_table();
+  // nothing before this offset in a chunk can influence a cut point
+  const uint64_t hash_start = min_size > GEAR_WINDOW ? min_size - GEAR_WINDOW : 0;
+
+  uint64_t start = 0;  // offset of the current chunk
+  uint64_t n = 0;      // bytes in the current chunk
+  uint64_t h = 0;
+  for (const auto& bp : data.buffers()) {
+    auto p = reinterpret_cast<const unsigned char*>(bp.c_str());
+    const auto end = p + bp.length();
+    while (p < end) {
+      if (n < hash_start) {
+	const uint64_t skip = std::min<uint64_t>(hash_start - n, end - p);
+	p += skip;
+	n += skip;
+	continue;
+      }
+      h = (h << 1) + gear[*p++];
+      if (++n < min_size) {
+	continue;
+      }
+      if ((h & (n < avg_size ? mask_s : mask_l)) == 0 || n >= max_size) {
+	chunks->emplace_back(start, n);
+	start += n;
+	n = 0;
+	h = 0;
+      }
+    }
+  }
+  if (n) {
+    chunks->emplace_back(start, n);
+  }
+}
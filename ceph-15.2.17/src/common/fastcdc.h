@@ -0,0 +1,57 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_FASTCDC_H_
+#define CEPH_COMMON_FASTCDC_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "include/buffer.h"
+
+/**
+ * Content-defined chunking with a gear rolling hash (FastCDC).
+ *
+ * Where RabinChunk spends a 64-bit multiply and modulo on every byte,
+ * the gear hash only shifts and adds a table entry, so chunking runs at
+ * memory speed.  A cut point is declared where the top bits of the hash
+ * are zero.  The first min bytes of a chunk are skipped without hashing;
+ * a stricter mask is used until the chunk reaches the average size and
+ * a looser one after that, which narrows the chunk size distribution
+ * around the average.  A chunk never exceeds max bytes.
+ *
+ * The gear table is fixed, so the same data is always cut at the same
+ * offsets: deduplicated chunks must stay comparable across releases.
+ */
+class FastCDC {
+public:
+  /// average chunk size is 1 << avg_bits; min/max default to avg/4 and avg*4
+  explicit FastCDC(uint32_t avg_bits = 13, uint64_t min = 0, uint64_t max = 0);
+
+  uint64_t get_min_chunk() const { return min_size; }
+  uint64_t get_avg_chunk() const { return avg_size; }
+  uint64_t get_max_chunk() const { return max_size; }
+
+  /// split data into (offset, length) chunks
+  void calc_chunks(const ceph::bufferlist& data,
+		   std::vector<std::pair<uint64_t, uint64_t>> *chunks) const;
+
+private:
+  uint64_t min_size;
+  uint64_t avg_size;
+  uint64_t max_size;
+  uint64_t mask_s;  ///< used below the average size
+  uint64_t mask_l;  ///< used above the average size
+};
+
+#endif // CEPH_COMMON_FASTCDC_H_
@@ -1375,6 +1375,19 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description("The minimum amount of bytes to be kept mapped in memory for osd monitor caches."),
 
+    Option("mon_osdmap_compression", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("snappy")
+    .set_enum_allowed({"none", "snappy", "zlib", "zstd", "lz4"})
+    .set_flag(Option::FLAG_RUNTIME)
+    .add_service("mon")
+    .set_description("Compression algorithm for OSDMaps sent to OSDs")
+    .set_long_description("Each OSDMap epoch is compressed once, cached, and "
+                          "shared by all the OSDs that ask for it.  Once a "
+                          "compressed map was sent, the compressed maps take half "
+                          "of the OSDMap cache budget.  Only OSDs that subscribe "
+                          "with CEPH_SUBSCRIBE_COMPRESSED get compressed maps.")
+    .add_see_also("mon_osd_cache_size"),
+
     Option("mon_memory_target", Option::TYPE_SIZE, Option::LEVEL_BASIC)
     .set_default(2_G)
     .set_flag(Option::FLAG_RUNTIME)
@@ -2187,6 +2200,17 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description(""),
 
+    Option("paxos_pipeline_depth", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .add_service("mon")
+    .set_description("Number of paxos proposals the leader may have in flight at once")
+    .set_long_description("With a value above 1 the leader begins a new proposal "
+                          "while earlier ones are still being accepted or written, "
+                          "instead of waiting for each round to finish.  Proposals "
+                          "still commit in order.  Peons do not serve reads while "
+                          "they hold accepted proposals that have not committed."),
+
     Option("paxos_min", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(500)
     .add_service("mon")
@@ -2986,6 +3010,58 @@ std::vector<Option> get_global_options() {
     .set_description("mclock anticipation timeout in seconds")
     .set_long_description("the amount of time that mclock waits until the unused resource is forfeited"),
 
+    Option("osd_mclock_calibration", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Calibrate mclock costs and parameters to the device capacity")
+    .set_long_description("Only considered for osd_op_queue = mclock_scheduler. "
+			  "The OSD benchmarks its data device at startup and "
+			  "keeps correcting the estimate from observed commit "
+			  "latencies. Op costs then count 4K IOs, reservations "
+			  "are scaled to fit within the capacity and limits are "
+			  "capped at it.")
+    .add_see_also({"osd_op_queue",
+		   "osd_mclock_max_capacity_iops_hdd",
+		   "osd_mclock_max_capacity_iops_ssd",
+		   "osd_mclock_max_sequential_bandwidth_hdd",
+		   "osd_mclock_max_sequential_bandwidth_ssd"}),
+
+    Option("osd_mclock_max_capacity_iops_hdd", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.0)
+    .set_description("4K write IOPS of a rotational data device (0 to benchmark at startup)")
+    .set_long_description("The benchmark result is stored in the monitor config "
+			  "database for the OSD, so it runs only once.")
+    .add_see_also("osd_mclock_calibration"),
+
+    Option("osd_mclock_max_capacity_iops_ssd", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.0)
+    .set_description("4K write IOPS of a non-rotational data device (0 to benchmark at startup)")
+    .set_long_description("The benchmark result is stored in the monitor config "
+			  "database for the OSD, so it runs only once.")
+    .add_see_also("osd_mclock_calibration"),
+
+    Option("osd_mclock_max_sequential_bandwidth_hdd", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Sequential 4MB write bandwidth of a rotational data device in bytes/second (0 to benchmark at startup)")
+    .set_long_description("The benchmark result is stored in the monitor config "
+			  "database for the OSD, so it runs only once.")
+    .add_see_also("osd_mclock_calibration"),
+
+    Option("osd_mclock_max_sequential_bandwidth_ssd", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Sequential 4MB write bandwidth of a non-rotational data device in bytes/second (0 to benchmark at startup)")
+    .set_long_description("The benchmark result is stored in the monitor config "
+			  "database for the OSD, so it runs only once.")
+    .add_see_also("osd_mclock_calibration"),
+
+    Option("osd_mclock_calibration_min_util", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.5)
+    .set_min_max(0.0, 1.0)
+    .set_description("Device utilization above which samples correct the capacity estimate")
+    .set_long_description("Utilization is inferred from how far the commit "
+			  "latency is above the lowest seen; near idle, "
+			  "throughput says little about capacity.")
+    .add_see_also("osd_mclock_calibration"),
+
     Option("osd_ignore_stale_divergent_priors", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -3096,6 +3172,41 @@ std::vector<Option> get_global_options() {
     .set_default(2000)
     .set_description("Minimum heartbeat packet size in bytes. Will add dummy payload if heartbeat packet is smaller than this."),
 
+    Option("osd_heartbeat_gossip", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Ping peers at a sub-second interval and aggregate failure reports")
+    .set_long_description("Ping heartbeat peers every osd_heartbeat_gossip_interval seconds and suspect them after osd_heartbeat_gossip_grace seconds without a reply. Suspicions are shared with the other peers on the pings themselves, and once osd_heartbeat_gossip_min_reporters OSDs agree only one of them reports the failure to the monitors, on behalf of all. Only pings are padded to osd_heartbeat_min_size, once every osd_heartbeat_interval. All OSDs and monitors must be upgraded before this is enabled.")
+    .add_see_also({"osd_heartbeat_gossip_interval", "osd_heartbeat_gossip_grace"}),
+
+    Option("osd_heartbeat_gossip_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.5)
+    .set_min_max(.05, 60.0)
+    .set_description("Interval (in seconds) between peer pings with osd_heartbeat_gossip")
+    .add_see_also("osd_heartbeat_gossip_max_ping_rate"),
+
+    Option("osd_heartbeat_gossip_grace", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(2.0)
+    .set_min(.1)
+    .set_description("Seconds without a ping reply before a peer is suspected with osd_heartbeat_gossip")
+    .set_long_description("The monitors use this grace instead of osd_heartbeat_grace for failure reports confirmed by enough peers, and scale it the same way with mon_osd_adjust_heartbeat_grace. It is raised to three ping intervals if that is longer."),
+
+    Option("osd_heartbeat_gossip_min_reporters", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_min(1)
+    .set_description("OSDs that must suspect a peer before one of them reports it failed")
+    .set_long_description("Until this many OSDs, the reporter included, agree on a failure, every OSD waits osd_heartbeat_grace before reporting it on its own."),
+
+    Option("osd_heartbeat_gossip_max_suspects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Maximum suspected peers shared on a single ping"),
+
+    Option("osd_heartbeat_gossip_max_ping_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_min(1)
+    .set_description("Maximum pings per second an OSD sends with osd_heartbeat_gossip")
+    .set_long_description("The ping interval is stretched when an OSD has too many heartbeat peers to ping them all every osd_heartbeat_gossip_interval seconds."),
+
     Option("osd_pg_max_concurrent_snap_trims", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(2)
     .set_min(1)
@@ -3208,6 +3319,18 @@ std::vector<Option> get_global_options() {
     .set_default(10)
     .set_description(""),
 
+    Option("osd_backfill_bulk_max_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_description("Maximum number of small objects backfill pushes together as one recovery op")
+    .set_long_description("Backfill normally starts one recovery op, and so one push round trip, per object.  Objects no larger than osd_backfill_bulk_object_size are instead grouped into batches of up to this many, each counted as a single op against osd_recovery_max_active and sent to each target in one push message, which the target applies in one transaction.  Only replicated pools batch.  0 or 1 disables batching.")
+    .add_see_also("osd_backfill_bulk_object_size")
+    .add_see_also("osd_max_push_cost"),
+
+    Option("osd_backfill_bulk_object_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_description("Objects up to this size are backfilled in batches")
+    .add_see_also("osd_backfill_bulk_max_objects"),
+
     Option("osd_max_scrubs", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1)
     .set_description("Maximum concurrent scrubs on a single OSD"),
@@ -3320,6 +3443,23 @@ std::vector<Option> get_global_options() {
     .set_default(1024)
     .set_description("Number of keys to read from an object at a time during deep scrub"),
 
+    Option("osd_deep_scrub_reuse_csum", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Derive object data digests from the checksums kept by the object store during deep scrub")
+    .set_long_description("BlueStore verifies its crc32c blob checksums while deep scrub reads an object.  With this set, the data digest is computed from those checksums wherever they cover whole checksum chunks, instead of hashing the data again.  The digest is the same either way."),
+
+    Option("osd_deep_scrub_max_device_util", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min_max(0.0, 1.0)
+    .set_description("Sleep between deep scrub chunks while a data device is busier than this")
+    .set_long_description("Utilization is the fraction of time the busiest device backing the object store spent doing I/O since the last OSD tick, as reported by /sys/block/<dev>/stat.  0 disables the check.")
+    .add_see_also("osd_deep_scrub_device_util_sleep"),
+
+    Option("osd_deep_scrub_device_util_sleep", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.1)
+    .set_description("Duration to inject a delay between deep scrub chunks while the data device is too busy")
+    .add_see_also("osd_deep_scrub_max_device_util"),
+
     Option("osd_deep_scrub_update_digest_min_age", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(2_hr)
     .set_description("Update overall object digest only if object was last modified longer ago than this"),
@@ -3784,6 +3924,19 @@ std::vector<Option> get_global_options() {
     .set_default(255)
     .set_description(""),
 
+    Option("osd_peering_batch_delay", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("How long to hold peering messages to another OSD so that those of other PGs can be sent with them")
+    .set_long_description("Peering queries, notifies, infos and logs of different PGs bound for the same OSD are sent together in one message.  This cuts the number of messages an OSD sends and handles when many PGs peer at once, e.g. after it restarts.  0 sends each message on its own.  OSDs that do not understand batched peering messages always get them one by one.")
+    .add_see_also("osd_peering_batch_max_messages"),
+
+    Option("osd_peering_batch_max_messages", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_min(1)
+    .set_description("Send batched peering messages as soon as this many are pending for an OSD")
+    .add_see_also("osd_peering_batch_delay"),
+
     Option("osd_snap_trim_priority", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description(""),
@@ -5335,6 +5488,49 @@ std::vector<Option> get_global_options() {
                           "if you simply do not require the most up to date "
                           "performance counter data."),
 
+    Option("mgr_metrics_exporter_port", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min_max(0, 65535)
+    .add_service("mgr")
+    .set_description("TCP port on which the active manager serves daemon "
+                     "perf counters to Prometheus, or 0 to disable")
+    .set_long_description("The counters are exported under the same names "
+                          "and labels as by the prometheus module, which "
+                          "stops exporting them itself when this is set.")
+    .add_see_also("mgr_metrics_exporter_addr")
+    .add_see_also("mgr_metrics_exporter_prio_limit"),
+
+    Option("mgr_metrics_exporter_addr", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("::")
+    .add_service("mgr")
+    .set_description("Address on which the manager serves daemon perf counters")
+    .add_see_also("mgr_metrics_exporter_port"),
+
+    Option("mgr_metrics_exporter_prio_limit", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(5)
+    .add_service("mgr")
+    .set_description("Only export perf counters with at least this priority")
+    .add_see_also("mgr_metrics_exporter_port"),
+
+    Option("mgr_pgmap_apply_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .add_service("mgr")
+    .set_description("Number of threads used to sum PG stats into pool and "
+                     "cluster totals when applying a PGMap update")
+    .set_long_description("Updates with fewer than "
+                          "mgr_pgmap_apply_parallel_min PG stats are applied "
+                          "on the calling thread.")
+    .add_see_also("mgr_pgmap_apply_parallel_min"),
+
+    Option("mgr_pgmap_apply_parallel_min", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(4096)
+    .set_min(1)
+    .add_service("mgr")
+    .set_description("Minimum number of PG stats in a PGMap update for it to "
+                     "be applied in parallel")
+    .add_see_also("mgr_pgmap_apply_threads"),
+
     Option("mgr_client_bytes", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(128_M)
     .add_service("mgr"),
@@ -5571,6 +5767,18 @@ std::vector<Option> get_rgw_options() {
     .set_default(128)
     .set_description("Max number of concurrent RADOS requests when handling bucket shards."),
 
+    Option("rgw_bucket_index_compact", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Store the entries of new bucket indexes in the compact encoding")
+    .set_long_description(
+        "The compact encoding drops per-entry version headers, stores integers "
+        "as varints and md5 etags in binary, and keeps owners, content types "
+        "and storage classes once per index shard. It shrinks the omap of "
+        "bucket index objects, but can only be read by OSDs that support it, "
+        "so enable it only once all OSDs are upgraded. Existing buckets are "
+        "converted with 'radosgw-admin bi compact'.")
+    .add_see_also("rgw_override_bucket_index_max_shards"),
+
     Option("rgw_enable_quota_threads", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("Enables the quota maintenance thread.")
@@ -5628,11 +5836,32 @@ std::vector<Option> get_rgw_options() {
 
     Option("rgw_cache_lru_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10000)
+    .set_flag(Option::FLAG_STARTUP)
     .set_description("Max number of items in RGW metadata cache.")
     .set_long_description(
         "When full, the RGW metadata cache evicts least recently used entries.")
     .add_see_also("rgw_cache_enabled"),
 
+    Option("rgw_cache_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of shards of the RGW metadata cache.")
+    .set_long_description(
+        "Each shard has its own LRU and lock and holds an equal part of "
+        "rgw_cache_lru_size entries.")
+    .add_see_also("rgw_cache_lru_size"),
+
+    Option("rgw_cache_tinylfu", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Filter RGW metadata cache admissions by access frequency.")
+    .set_long_description(
+        "When a cache shard is full, a new entry only replaces the least "
+        "recently used one if it has been requested more often recently, "
+        "so that one-off lookups do not push out hot entries.")
+    .add_see_also("rgw_cache_lru_size"),
+
     Option("rgw_socket_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description("RGW FastCGI socket path (for FastCGI over Unix domain sockets).")
@@ -5714,6 +5943,18 @@ std::vector<Option> get_rgw_options() {
       "Number of threads in per-LCWorker workpools--used to accelerate "
       "per-bucket processing"),
 
+    Option("rgw_lc_bucket_split_min_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Process buckets with at least this many index shards one index shard at a time")
+    .set_long_description(
+      "Lifecycle processing of a bucket with at least this many index shards "
+      "is split by index shard. Every LCWorker of every RGW instance that "
+      "finds the bucket being processed takes index shards that nobody else "
+      "holds, under a lease of rgw_lc_lock_max_time seconds, and checkpoints "
+      "its position after every listing chunk so that an interrupted index "
+      "shard is resumed rather than restarted. Zero disables splitting.")
+    .add_see_also({"rgw_lc_max_worker", "rgw_lc_lock_max_time"}),
+
     Option("rgw_lc_max_objs", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(32)
     .set_description("Number of lifecycle data shards")
@@ -6370,11 +6611,39 @@ std::vector<Option> get_rgw_options() {
         "thread will use when purging old data.")
     .add_see_also({"rgw_gc_max_objs", "rgw_gc_obj_min_wait", "rgw_gc_processor_max_time", "rgw_gc_max_trim_chunk"}),
 
+    Option("rgw_gc_max_concurrent_io_adaptive", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Upper bound of concurrent RADOS IO operations for garbage collection when the limit adapts to OSD latency")
+    .set_long_description(
+        "If greater than rgw_gc_max_concurrent_io, the number of concurrent IO "
+        "operations used by garbage collection starts at rgw_gc_max_concurrent_io "
+        "and grows towards this value as long as removals complete within "
+        "rgw_gc_target_io_latency, backing off when they take longer. Zero "
+        "disables the adaptive limit.")
+    .add_see_also({"rgw_gc_max_concurrent_io", "rgw_gc_target_io_latency"}),
+
+    Option("rgw_gc_target_io_latency", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.1)
+    .set_min(0.0)
+    .set_description("Target latency in seconds of a garbage collection removal when the IO limit is adaptive")
+    .add_see_also("rgw_gc_max_concurrent_io_adaptive"),
+
     Option("rgw_gc_max_trim_chunk", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(16)
     .set_description("Max number of keys to remove from garbage collector log in a single operation")
     .add_see_also({"rgw_gc_max_objs", "rgw_gc_obj_min_wait", "rgw_gc_processor_max_time", "rgw_gc_max_concurrent_io"}),
 
+    Option("rgw_gc_max_queue_trim_entries", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_description("Number of processed entries after which garbage collector queue entries are trimmed")
+    .set_long_description(
+        "When the garbage collector uses the cls_rgw_gc queue, processed entries "
+        "are removed from the head of the queue once this many of them have been "
+        "handled, or when the shard is done. Trimming waits for all outstanding "
+        "removals, so a larger value keeps more IO in flight, at the cost of "
+        "redoing more removals if the gc processor stops before the trim.")
+    .add_see_also({"rgw_gc_max_trim_chunk", "rgw_gc_max_concurrent_io"}),
+
     Option("rgw_gc_max_deferred_entries_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(3072)
     .set_description("maximum allowed size of deferred entries in queue head for gc"),
@@ -6635,6 +6904,16 @@ std::vector<Option> get_rgw_options() {
     .set_default(10000)
     .set_description("Max number of parts in multipart upload"),
 
+    Option("rgw_multipart_complete_max_inflight", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Max number of part listing reads in flight while completing a multipart upload")
+    .set_long_description(
+        "CompleteMultipartUpload reads the part entries of the upload in ranges of "
+        "1000 parts. Up to this many ranges are read in parallel, and each one is "
+        "validated and added to the object manifest as soon as it and the ranges "
+        "before it have arrived."),
+
     Option("rgw_max_slo_entries", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1000)
     .set_description("Max number of entries in Swift Static Large Object manifest"),
@@ -6745,6 +7024,37 @@ std::vector<Option> get_rgw_options() {
     .add_see_also("rgw_sync_log_trim_max_buckets")
     .add_see_also("rgw_sync_log_trim_min_cold_buckets"),
 
+    Option("rgw_data_sync_spawn_window", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(20)
+    .set_min(1)
+    .set_description("Number of bucket shards each data sync shard syncs in parallel")
+    .add_see_also("rgw_sync_spawn_window_max"),
+
+    Option("rgw_bucket_sync_spawn_window", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(20)
+    .set_min(1)
+    .set_description("Number of objects each bucket shard sync copies in parallel")
+    .add_see_also("rgw_sync_spawn_window_max"),
+
+    Option("rgw_sync_spawn_window_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Upper bound of the data and bucket sync spawn windows when they adapt to sync throughput")
+    .set_long_description(
+        "If greater than rgw_data_sync_spawn_window or "
+        "rgw_bucket_sync_spawn_window, the corresponding window starts at its "
+        "configured value and moves between that value and this bound, "
+        "keeping the direction in which the number of completed sync "
+        "operations per second improved over the last "
+        "rgw_sync_spawn_window_interval. Zero keeps the windows fixed.")
+    .add_see_also({"rgw_data_sync_spawn_window", "rgw_bucket_sync_spawn_window",
+                   "rgw_sync_spawn_window_interval"}),
+
+    Option("rgw_sync_spawn_window_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(5.0)
+    .set_min(0.1)
+    .set_description("Interval in seconds over which sync throughput is measured before the spawn window is resized")
+    .add_see_also("rgw_sync_spawn_window_max"),
+
     Option("rgw_sync_data_inject_err_probability", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(0)
     .set_description(""),
@@ -6844,6 +7154,20 @@ std::vector<Option> get_rgw_options() {
     .add_tag("performance")
     .add_service("rgw"),
 
+    Option("rgw_reshard_online", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Keep accepting bucket index writes while a bucket is resharded")
+    .set_long_description(
+        "When enabled, writes to the old bucket index continue while its "
+        "entries are copied to the new index; the names of the objects they "
+        "change are recorded and copied again afterwards. Writes are only "
+        "blocked for the final pass over the objects that changed since the "
+        "previous pass. Requires that all OSDs run a cls_rgw that understands "
+        "the in-logrecord reshard status; older ones block writes for the "
+        "whole reshard.")
+    .add_see_also("rgw_reshard_max_aio")
+    .add_service("rgw"),
+
     Option("rgw_trust_forwarded_https", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Trust Forwarded and X-Forwarded-Proto headers")
@@ -8007,6 +8331,12 @@ std::vector<Option> get_mds_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("mds_log_submit_batch_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_min(1)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("maximum number of queued events the MDS journal submit thread encodes and appends per flush"),
+
     Option("mds_log_max_events", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(-1)
     .set_description("maximum number of events in the MDS journal (-1 is unlimited)"),
@@ -8150,11 +8480,62 @@ std::vector<Option> get_mds_options() {
     .set_default(10.0)
     .set_description("rate of decay for export targets communicated to clients"),
 
+    Option("mds_bal_cost_model", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("weigh balancer exports against their migration cost")
+    .set_long_description("When enabled, the balancer only exports a subtree if the load it sheds is worth its migration cost (see mds_bal_cost_base, mds_bal_cost_per_item and mds_bal_cost_min_benefit), does not re-export subtrees imported within mds_bal_import_cooldown, and migrates at most mds_bal_max_export_items items per rebalance."),
+
+    Option("mds_bal_cost_base", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min(0.0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("migration cost of any exported subtree, whatever its size")
+    .add_see_also("mds_bal_cost_model"),
+
+    Option("mds_bal_cost_per_item", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.001)
+    .set_min(0.0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("migration cost of each file or directory in an exported subtree")
+    .add_see_also("mds_bal_cost_model"),
+
+    Option("mds_bal_cost_min_benefit", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min(0.0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("minimum load an export must shed per unit of migration cost")
+    .add_see_also("mds_bal_cost_model"),
+
+    Option("mds_bal_max_export_items", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000000)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("maximum number of items exported per rebalance (0 is unlimited)")
+    .add_see_also("mds_bal_cost_model"),
+
+    Option("mds_bal_import_cooldown", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(60.0)
+    .set_min(0.0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("seconds an imported subtree is kept before the balancer may export it again")
+    .add_see_also("mds_bal_cost_model"),
+
     Option("mds_oft_prefetch_dirfrags", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("prefetch dirfrags recorded in open file table on startup")
     .set_flag(Option::FLAG_STARTUP),
 
+    Option("mds_oft_load_max_inflight", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("maximum number of open file table objects read in parallel on startup"),
+
+    Option("mds_oft_commit_max_inflight", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("maximum number of outstanding open file table writes per commit (0 is unlimited)"),
+
     Option("mds_replay_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(1.0)
     .set_description("time in seconds between replay of updates to journal by standby replay MDS"),
@@ -8319,6 +8700,20 @@ std::vector<Option> get_mds_options() {
     .set_default(64)
     .set_description("maximum number of deleted files to purge in parallel"),
 
+    Option("mds_max_purge_files_adaptive", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("upper bound of deleted files purged in parallel when the limit adapts to purge latency")
+    .set_long_description("If greater than mds_max_purge_files, the number of files purged in parallel starts at mds_max_purge_files and grows towards this value as long as the purge operations (object deletes) of a file take less than mds_purge_target_latency each on average, backing off when they take longer. Zero disables the adaptive limit.")
+    .add_see_also("mds_max_purge_files")
+    .add_see_also("mds_purge_target_latency"),
+
+    Option("mds_purge_target_latency", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.1)
+    .set_min(0.0)
+    .set_description("target latency in seconds per purge operation when the purge limit is adaptive")
+    .set_long_description("The time taken to purge a file, divided by the number of objects it removes, is compared against this target.")
+    .add_see_also("mds_max_purge_files_adaptive"),
+
     Option("mds_max_purge_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(8192)
     .set_description("maximum number of purge operations performed in parallel"),
@@ -8551,6 +8946,11 @@ std::vector<Option> get_mds_client_options() {
     .set_default(true)
     .set_description("client-enforced permission checking"),
 
+    Option("client_readdir_getattr_batch", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(256)
+    .set_description("maximum number of directory entries whose attributes are refetched with a single request during readdir")
+    .set_long_description("When readdir with stat (e.g. readdirplus) finds an entry whose caps have been revoked, the client refetches the attributes and caps of up to this many following entries in one round trip instead of sending a getattr per entry. Zero disables batching."),
+
     Option("client_dirsize_rbytes", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("set the directory size as the number of file bytes recursively used")
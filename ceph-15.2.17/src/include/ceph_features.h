@@ -111,6 +111,7 @@ DEFINE_CEPH_FEATURE(18, 1, CRUSH_TUNABLES)   // 3.6
 DEFINE_CEPH_FEATURE_RETIRED(19, 1, CHUNKY_SCRUB, JEWEL, LUMINOUS)
 DEFINE_CEPH_FEATURE(19, 2, OSD_PGLOG_HARDLIMIT)
 DEFINE_CEPH_FEATURE_RETIRED(20, 1, MON_NULLROUTE, JEWEL, LUMINOUS)
+DEFINE_CEPH_FEATURE(20, 3, OSD_PEERING_BATCH)
 
 DEFINE_CEPH_FEATURE_RETIRED(21, 1, MON_GV, HAMMER, JEWEL)
 
@@ -247,6 +248,7 @@ DEFINE_CEPH_FEATURE_DEPRECATED(63, 1, RESERVED_BROKEN, LUMINOUS) // client-facin
 	 CEPH_FEATUREMASK_SERVER_OCTOPUS | \
 	 CEPH_FEATUREMASK_OSD_REPOP_MLCOD | \
 	 CEPH_FEATURE_OSD_FIXED_COLLECTION_LIST | \
+	 CEPH_FEATUREMASK_OSD_PEERING_BATCH | \
 	 0ULL)
 
 #define CEPH_FEATURES_SUPPORTED_DEFAULT  CEPH_FEATURES_ALL
@@ -263,6 +263,7 @@ struct ceph_client_mount {
 } __attribute__ ((packed));
 
 #define CEPH_SUBSCRIBE_ONETIME    1  /* i want only 1 update after have */
+#define CEPH_SUBSCRIBE_COMPRESSED 2  /* i can take compressed osdmaps */
 
 struct ceph_mon_subscribe_item {
 	__le64 start;
@@ -465,6 +466,7 @@ int ceph_flags_sys2wire(int flags);
  * readdir request flags;
  */
 #define CEPH_READDIR_REPLY_BITFLAGS	(1<<0)
+#define CEPH_READDIR_GETATTR_BATCH	(1<<1)	/* refetch attrs/caps of known entries */
 
 /*
  * readdir reply flags.
@@ -50,6 +50,22 @@ static inline uint32_t ceph_crc32c(uint32_t crc, unsigned char const *data, unsi
   return ceph_crc32c_func(crc, data, length);
 }
 
+/**
+ * extend a crc32c with a following buffer, given only the buffer's crc
+ *
+ * Note: this is what ceph_crc32c(crc, data, length) would return, where
+ * crc_data is ceph_crc32c(-1, data, length).  It is how crc32c checksums
+ * kept for consecutive pieces of data are folded into one.
+ *
+ * @param crc crc of the preceding data
+ * @param crc_data crc of the following buffer, calculated with seed -1
+ * @param length length of the following buffer
+ */
+static inline uint32_t ceph_crc32c_combine(uint32_t crc, uint32_t crc_data, unsigned length)
+{
+  return crc_data ^ ceph_crc32c(crc ^ 0xffffffff, NULL, length);
+}
+
 #ifdef __cplusplus
 }
 #endif
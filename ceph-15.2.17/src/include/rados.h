@@ -326,6 +326,7 @@ extern const char *ceph_osd_state_name(int s);
 	f(TIER_PROMOTE,	__CEPH_OSD_OP(WR, DATA, 41),	"tier-promote")	    \
 	f(UNSET_MANIFEST, __CEPH_OSD_OP(WR, DATA, 42),	"unset-manifest")   \
 	f(TIER_FLUSH, __CEPH_OSD_OP(WR, DATA, 43),	"tier-flush")	    \
+	f(TIER_EVICT, __CEPH_OSD_OP(WR, DATA, 46),	"tier-evict")	    \
 									    \
 	/** attrs **/							    \
 	/* read */							    \
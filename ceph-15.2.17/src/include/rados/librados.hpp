@@ -519,6 +519,11 @@ inline namespace v14_2_0 {
     void tier_promote();
     void unset_manifest();
     void tier_flush();
+    /**
+     * Drop the local copy of a chunked object whose chunks are all clean
+     * and cover the whole object
+     */
+    void tier_evict();
 
 
     friend class IoCtx;
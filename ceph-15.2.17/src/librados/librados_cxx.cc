@@ -674,6 +674,13 @@ void librados::ObjectWriteOperation::tier_flush()
   o->tier_flush();
 }
 
+void librados::ObjectWriteOperation::tier_evict()
+{
+  ceph_assert(impl);
+  ::ObjectOperation *o = &impl->o;
+  o->tier_evict();
+}
+
 void librados::ObjectWriteOperation::tmap_update(const bufferlist& cmdbl)
 {
   ceph_assert(impl);
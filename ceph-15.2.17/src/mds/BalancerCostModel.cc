@@ -0,0 +1,86 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "BalancerCostModel.h"
+
+void BalancerCostModel::start_round(double now)
+{
+  round_now = now;
+  round_items = 0;
+
+  // drop import records that are out of the cooldown window
+  for (auto p = imported.begin(); p != imported.end(); ) {
+    if (conf.cooldown <= 0 || now - p->second >= conf.cooldown)
+      imported.erase(p++);
+    else
+      ++p;
+  }
+}
+
+void BalancerCostModel::note_import(dirfrag_t df, double now)
+{
+  if (conf.cooldown > 0)
+    imported[df] = now;
+}
+
+BalancerCostModel::verdict_t BalancerCostModel::admit(dirfrag_t df,
+						      double load,
+						      uint64_t items)
+{
+  verdict_t v = ADMIT;
+  auto p = imported.find(df);
+  if (p != imported.end() && round_now - p->second < conf.cooldown) {
+    v = REJECT_COOLDOWN;
+  } else if (load < conf.min_benefit * migration_cost(items)) {
+    v = REJECT_BENEFIT;
+  } else if (conf.max_items_per_round &&
+	     round_items > 0 &&
+	     round_items + items > conf.max_items_per_round) {
+    // always let the first candidate of a round through, otherwise a
+    // single big subtree could never be moved.
+    v = REJECT_BUDGET;
+  }
+
+  if (v == ADMIT) {
+    round_items += items;
+    num_admitted++;
+    imported.erase(df);
+  } else {
+    num_rejected[v]++;
+  }
+  return v;
+}
+
+const char *BalancerCostModel::verdict_name(verdict_t v)
+{
+  switch (v) {
+  case ADMIT: return "admit";
+  case REJECT_BENEFIT: return "reject_benefit";
+  case REJECT_COOLDOWN: return "reject_cooldown";
+  case REJECT_BUDGET: return "reject_budget";
+  }
+  return "???";
+}
+
+void BalancerCostModel::dump(Formatter *f) const
+{
+  f->dump_float("item_cost", conf.item_cost);
+  f->dump_float("base_cost", conf.base_cost);
+  f->dump_float("min_benefit", conf.min_benefit);
+  f->dump_unsigned("max_items_per_round", conf.max_items_per_round);
+  f->dump_float("cooldown", conf.cooldown);
+  f->dump_unsigned("round_items", round_items);
+  f->dump_unsigned("cooling_dirfrags", imported.size());
+  f->dump_unsigned(verdict_name(ADMIT), num_admitted);
+  for (auto v : {REJECT_BENEFIT, REJECT_COOLDOWN, REJECT_BUDGET})
+    f->dump_unsigned(verdict_name(v), get_num_rejected(v));
+}
@@ -0,0 +1,101 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MDS_BALANCERCOSTMODEL_H
+#define CEPH_MDS_BALANCERCOSTMODEL_H
+
+#include <map>
+
+#include "include/types.h"
+#include "common/Formatter.h"
+#include "mdstypes.h"
+
+/**
+ * Migration cost model for the MDS balancer.
+ *
+ * The balancer picks export candidates by their decayed popularity
+ * (pop_auth_subtree), which is the per-dirfrag heat map.  Popularity alone
+ * says nothing about what a migration costs: exporting a subtree freezes it
+ * and ships every item in it, and a subtree that was just imported tends to
+ * bounce straight back (export ping-pong).  This model weighs each candidate:
+ *
+ *  - the load it sheds must be worth at least min_benefit per unit of
+ *    migration cost, the cost growing with the number of items moved;
+ *  - a dirfrag imported less than cooldown seconds ago is not re-exported;
+ *  - the items migrated per rebalance round are capped, so that a large
+ *    imbalance is corrected over several rounds instead of at once.
+ *
+ * The model keeps no reference to the cache, so that it can be driven by
+ * a simulated balancer as well as by MDBalancer.
+ */
+class BalancerCostModel {
+public:
+  struct config_t {
+    double item_cost = 0.001;       ///< cost of migrating one item
+    double base_cost = 1.0;         ///< fixed cost of any migration
+    double min_benefit = 1.0;       ///< min load shed per unit of cost
+    uint64_t max_items_per_round = 0;  ///< 0 means unlimited
+    double cooldown = 0;            ///< seconds; 0 disables
+  };
+
+  enum verdict_t {
+    ADMIT = 0,
+    REJECT_BENEFIT,
+    REJECT_COOLDOWN,
+    REJECT_BUDGET,
+  };
+
+  BalancerCostModel() = default;
+  explicit BalancerCostModel(const config_t& c) : conf(c) {}
+
+  void set_config(const config_t& c) { conf = c; }
+  const config_t& get_config() const { return conf; }
+
+  double migration_cost(uint64_t items) const {
+    return conf.base_cost + conf.item_cost * items;
+  }
+
+  /// start a rebalance round at @now (seconds); resets the item budget
+  void start_round(double now);
+
+  /// remember that @df was imported at @now
+  void note_import(dirfrag_t df, double now);
+  /// forget about @df, e.g. after it has been exported again
+  void forget(dirfrag_t df) { imported.erase(df); }
+
+  /**
+   * Decide whether exporting @df, shedding @load and moving @items, is
+   * worth it.  An admitted candidate is charged against the round budget.
+   */
+  verdict_t admit(dirfrag_t df, double load, uint64_t items);
+
+  void dump(Formatter *f) const;
+
+  uint64_t get_num_admitted() const { return num_admitted; }
+  uint64_t get_num_rejected(verdict_t v) const {
+    auto p = num_rejected.find(v);
+    return p == num_rejected.end() ? 0 : p->second;
+  }
+
+  static const char *verdict_name(verdict_t v);
+
+private:
+  config_t conf;
+  double round_now = 0;
+  uint64_t round_items = 0;
+  std::map<dirfrag_t, double> imported;  // dirfrag -> import time
+
+  uint64_t num_admitted = 0;
+  std::map<verdict_t, uint64_t> num_rejected;
+};
+
+#endif
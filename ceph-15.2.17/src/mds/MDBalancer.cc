@@ -80,6 +80,7 @@ MDBalancer::MDBalancer(MDSRank *m, Messenger *msgr, MonClient *monc) :
 {
   bal_fragment_dirs = g_conf().get_val<bool>("mds_bal_fragment_dirs");
   bal_fragment_interval = g_conf().get_val<int64_t>("mds_bal_fragment_interval");
+  update_cost_model_config();
 }
 
 void MDBalancer::handle_conf_change(const std::set<std::string>& changed, const MDSMap& mds_map)
@@ -88,6 +89,39 @@ void MDBalancer::handle_conf_change(const std::set<std::string>& changed, const
     bal_fragment_dirs = g_conf().get_val<bool>("mds_bal_fragment_dirs");
   if (changed.count("mds_bal_fragment_interval"))
     bal_fragment_interval = g_conf().get_val<int64_t>("mds_bal_fragment_interval");
+  if (changed.count("mds_bal_cost_model") ||
+      changed.count("mds_bal_cost_base") ||
+      changed.count("mds_bal_cost_per_item") ||
+      changed.count("mds_bal_cost_min_benefit") ||
+      changed.count("mds_bal_max_export_items") ||
+      changed.count("mds_bal_import_cooldown"))
+    update_cost_model_config();
+}
+
+void MDBalancer::update_cost_model_config()
+{
+  bal_cost_model = g_conf().get_val<bool>("mds_bal_cost_model");
+
+  BalancerCostModel::config_t c;
+  c.base_cost = g_conf().get_val<double>("mds_bal_cost_base");
+  c.item_cost = g_conf().get_val<double>("mds_bal_cost_per_item");
+  c.min_benefit = g_conf().get_val<double>("mds_bal_cost_min_benefit");
+  c.max_items_per_round = g_conf().get_val<uint64_t>("mds_bal_max_export_items");
+  c.cooldown = g_conf().get_val<double>("mds_bal_import_cooldown");
+  cost_model.set_config(c);
+}
+
+bool MDBalancer::admit_export(CDir *dir, double pop)
+{
+  if (!bal_cost_model)
+    return true;
+
+  uint64_t items = dir->get_projected_fnode()->rstat.rsize();
+  auto v = cost_model.admit(dir->dirfrag(), pop, items);
+  dout(7) << BalancerCostModel::verdict_name(v) << " pop " << pop
+	  << " items " << items << " cost " << cost_model.migration_cost(items)
+	  << " " << *dir << dendl;
+  return v == BalancerCostModel::ADMIT;
 }
 
 void MDBalancer::handle_export_pins(void)
@@ -857,6 +891,11 @@ void MDBalancer::try_rebalance(balance_state_t& state)
     return;
   }
 
+  if (bal_cost_model) {
+    cost_model.start_round(std::chrono::duration<double>(
+	clock::now().time_since_epoch()).count());
+  }
+
   // make a sorted list of my imports
   multimap<double, CDir*> import_pop_map;
   multimap<mds_rank_t, pair<CDir*, double> > import_from_map;
@@ -922,7 +961,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
 	  continue;
 	ceph_assert(dir->inode->authority().first == target);  // cuz that's how i put it in the map, dummy
 
-	if (pop <= amount-have) {
+	if (pop <= amount-have && admit_export(dir, pop)) {
 	  dout(7) << "reexporting " << *dir << " pop " << pop
 		  << " back to mds." << target << dendl;
 	  mds->mdcache->migrator->export_dir_nicely(dir, target);
@@ -965,7 +1004,8 @@ void MDBalancer::try_rebalance(balance_state_t& state)
       }
 
       double pop = p->first;
-      if (pop <= amount-have && pop > MIN_REEXPORT) {
+      if (pop <= amount-have && pop > MIN_REEXPORT &&
+	  admit_export(dir, pop)) {
 	dout(5) << "reexporting " << *dir << " pop " << pop
 		<< " to mds." << target << dendl;
 	have += pop;
@@ -1080,7 +1120,7 @@ void MDBalancer::find_exports(CDir *dir,
       }
 
       // lucky find?
-      if (pop > needmin && pop < needmax) {
+      if (pop > needmin && pop < needmax && admit_export(subdir, pop)) {
 	exports->push_back(subdir);
 	already_exporting.insert(subdir);
 	have += pop;
@@ -1109,6 +1149,9 @@ void MDBalancer::find_exports(CDir *dir,
     if ((*it).first < midchunk)
       break;  // try later
 
+    if (!admit_export((*it).second, (*it).first))
+      continue;
+
     dout(7) << "   taking smaller " << *(*it).second << dendl;
 
     exports->push_back((*it).second);
@@ -1130,6 +1173,9 @@ void MDBalancer::find_exports(CDir *dir,
   for (;
        it != smaller.rend();
        ++it) {
+    if (!admit_export((*it).second, (*it).first))
+      continue;
+
     dout(7) << "   taking (much) smaller " << it->first << " " << *(*it).second << dendl;
 
     exports->push_back((*it).second);
@@ -1312,6 +1358,11 @@ void MDBalancer::add_import(CDir *dir)
 {
   dirfrag_load_vec_t subload = dir->pop_auth_subtree;
 
+  if (bal_cost_model) {
+    cost_model.note_import(dir->dirfrag(), std::chrono::duration<double>(
+	clock::now().time_since_epoch()).count());
+  }
+
   while (true) {
     dir = dir->inode->get_parent_dir();
     if (!dir) break;
@@ -1447,6 +1498,12 @@ int MDBalancer::dump_loads(Formatter *f) const
   }
   f->close_section(); // mds_import_map
 
+  if (bal_cost_model) {
+    f->open_object_section("cost_model");
+    cost_model.dump(f);
+    f->close_section(); // cost_model
+  }
+
   f->close_section(); // loads
   return 0;
 }
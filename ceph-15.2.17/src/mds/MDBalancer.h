@@ -22,6 +22,7 @@
 #include "messages/MHeartbeat.h"
 
 #include "MDSMap.h"
+#include "BalancerCostModel.h"
 
 class MDSRank;
 class MHeartbeat;
@@ -115,8 +116,17 @@ private:
    */
   void try_rebalance(balance_state_t& state);
 
+  void update_cost_model_config();
+  /**
+   * Ask the migration cost model whether exporting this dirfrag, shedding
+   * pop, is worth it.  Always true unless mds_bal_cost_model is set.
+   */
+  bool admit_export(CDir *dir, double pop);
+
   bool bal_fragment_dirs;
   int64_t bal_fragment_interval;
+  bool bal_cost_model = false;
+  BalancerCostModel cost_model;
   static const unsigned int AUTH_TREES_THRESHOLD = 5;
 
   MDSRank *mds;
@@ -67,6 +67,30 @@ void MDLog::create_logger()
   plb.add_u64_counter(l_mdl_replayed, "replayed", "Events replayed",
 		      "repl", PerfCountersBuilder::PRIO_INTERESTING);
   plb.add_time_avg(l_mdl_jlat, "jlat", "Journaler flush latency");
+  plb.add_u64_avg(l_mdl_batch, "batch", "Events per journal submit batch");
+  plb.add_u64_avg(l_mdl_batch_bytes, "batch_bytes",
+                  "Bytes per journal submit batch");
+
+  // queueing latency axis of the submit batch histogram, in nanoseconds
+  PerfHistogramCommon::axis_config_d batch_hist_x_axis_config{
+    "Queue latency (nsec)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    10000,
+    16,
+  };
+  // number of events in a submit batch
+  PerfHistogramCommon::axis_config_d batch_hist_y_axis_config{
+    "Batch size (events)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    1,
+    12,
+  };
+  plb.add_u64_counter_histogram(
+    l_mdl_batch_hist, "batch_histogram",
+    batch_hist_x_axis_config, batch_hist_y_axis_config,
+    "Histogram of journal submit queue latency (nanoseconds) vs. events per batch");
   plb.add_u64_counter(l_mdl_evex, "evex", "Total expired events");
   plb.add_u64_counter(l_mdl_evtrm, "evtrm", "Trimmed events");
   plb.add_u64_counter(l_mdl_segadd, "segadd", "Segments added");
@@ -350,12 +374,26 @@ public:
   }
 };
 
+uint64_t MDLog::take_submit_batch(list<PendingEvent> *queue,
+				  list<PendingEvent> *batch,
+				  uint64_t max)
+{
+  max = std::max<uint64_t>(1, max);
+  auto last = queue->begin();
+  uint64_t n = 0;
+  for (; last != queue->end() && n < max; ++n)
+    ++last;
+  batch->splice(batch->end(), *queue, queue->begin(), last);
+  return n;
+}
+
 void MDLog::_submit_thread()
 {
   dout(10) << "_submit_thread start" << dendl;
 
   std::unique_lock locker{submit_mutex};
 
+  list<PendingEvent> batch;
   while (!mds->is_daemon_stopping()) {
     if (g_conf()->mds_log_pause) {
       submit_cond.wait(locker);
@@ -373,68 +411,92 @@ void MDLog::_submit_thread()
       continue;
     }
 
+    // grab as many queued events of this segment as we are allowed to, so
+    // that they are appended back to back and share a single flush.
+    take_submit_batch(&it->second, &batch,
+		      g_conf().get_val<uint64_t>("mds_log_submit_batch_max"));
+
     int64_t features = mdsmap_up_features;
-    PendingEvent data = it->second.front();
-    it->second.pop_front();
 
     locker.unlock();
 
-    if (data.le) {
-      LogEvent *le = data.le;
-      LogSegment *ls = le->_segment;
-      // encode it, with event type
-      bufferlist bl;
-      le->encode_with_header(bl, features);
-
-      uint64_t write_pos = journaler->get_write_pos();
-
-      le->set_start_off(write_pos);
-      if (le->get_type() == EVENT_SUBTREEMAP)
-	ls->offset = write_pos;
-
-      dout(5) << "_submit_thread " << write_pos << "~" << bl.length()
-	      << " : " << *le << dendl;
-
-      // journal it.
-      const uint64_t new_write_pos = journaler->append_entry(bl);  // bl is destroyed.
-      ls->end = new_write_pos;
-
-      MDSLogContextBase *fin;
-      if (data.fin) {
-	fin = dynamic_cast<MDSLogContextBase*>(data.fin);
-	ceph_assert(fin);
-	fin->set_write_pos(new_write_pos);
+    auto batch_start = ceph::mono_clock::now();
+    auto oldest = batch.front().stamp;
+    uint64_t batch_events = 0;
+    uint64_t batch_bytes = 0;
+    bool do_flush = false;
+    for (auto& data : batch) {
+      if (data.le) {
+	LogEvent *le = data.le;
+	LogSegment *ls = le->_segment;
+	// encode it, with event type
+	bufferlist bl;
+	le->encode_with_header(bl, features);
+
+	uint64_t write_pos = journaler->get_write_pos();
+
+	le->set_start_off(write_pos);
+	if (le->get_type() == EVENT_SUBTREEMAP)
+	  ls->offset = write_pos;
+
+	dout(5) << "_submit_thread " << write_pos << "~" << bl.length()
+		<< " : " << *le << dendl;
+
+	batch_bytes += bl.length();
+	++batch_events;
+
+	// journal it.
+	const uint64_t new_write_pos = journaler->append_entry(bl);  // bl is destroyed.
+	ls->end = new_write_pos;
+
+	MDSLogContextBase *fin;
+	if (data.fin) {
+	  fin = dynamic_cast<MDSLogContextBase*>(data.fin);
+	  ceph_assert(fin);
+	  fin->set_write_pos(new_write_pos);
+	} else {
+	  fin = new C_MDL_Flushed(this, new_write_pos);
+	}
+
+	journaler->wait_for_flush(fin);
+
+	if (logger)
+	  logger->set(l_mdl_wrpos, ls->end);
+
+	delete le;
       } else {
-	fin = new C_MDL_Flushed(this, new_write_pos);
+	if (data.fin) {
+	  MDSContext* fin =
+		  dynamic_cast<MDSContext*>(data.fin);
+	  ceph_assert(fin);
+	  C_MDL_Flushed *fin2 = new C_MDL_Flushed(this, fin);
+	  fin2->set_write_pos(journaler->get_write_pos());
+	  journaler->wait_for_flush(fin2);
+	}
       }
-
-      journaler->wait_for_flush(fin);
-
       if (data.flush)
-	journaler->flush();
-
-      if (logger)
-	logger->set(l_mdl_wrpos, ls->end);
+	do_flush = true;
+    }
 
-      delete le;
-    } else {
-      if (data.fin) {
-	MDSContext* fin =
-		dynamic_cast<MDSContext*>(data.fin);
-	ceph_assert(fin);
-	C_MDL_Flushed *fin2 = new C_MDL_Flushed(this, fin);
-	fin2->set_write_pos(journaler->get_write_pos());
-	journaler->wait_for_flush(fin2);
-      }
-      if (data.flush)
-	journaler->flush();
+    // one flush covers every event of the batch that asked for it; the
+    // journaler keeps the resulting object writes in flight concurrently.
+    if (do_flush)
+      journaler->flush();
+
+    if (logger && batch_events) {
+      auto queued = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	batch_start - oldest).count();
+      logger->inc(l_mdl_batch, batch_events);
+      logger->inc(l_mdl_batch_bytes, batch_bytes);
+      logger->hinc(l_mdl_batch_hist, queued, batch_events);
     }
 
     locker.lock();
-    if (data.flush)
+    if (do_flush)
       unflushed = 0;
-    else if (data.le)
-      unflushed++;
+    else
+      unflushed += batch_events;
+    batch.clear();
   }
 }
 
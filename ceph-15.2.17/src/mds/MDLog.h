@@ -35,6 +35,9 @@ enum {
   l_mdl_rdpos,
   l_mdl_jlat,
   l_mdl_replayed,
+  l_mdl_batch,
+  l_mdl_batch_bytes,
+  l_mdl_batch_hist,
   l_mdl_last,
 };
 
@@ -175,14 +178,25 @@ public:
   // replay state
   std::map<inodeno_t, set<inodeno_t>> pending_exports;
 
-protected:
   struct PendingEvent {
-    PendingEvent(LogEvent *e, MDSContext *c, bool f=false) : le(e), fin(c), flush(f) {}
+    PendingEvent(LogEvent *e, MDSContext *c, bool f=false)
+      : le(e), fin(c), flush(f), stamp(ceph::mono_clock::now()) {}
     LogEvent *le;
     MDSContext *fin;
     bool flush;
+    ceph::mono_time stamp;  // when it was queued
   };
 
+  /**
+   * Move up to @max (at least one) events from the front of @queue to the
+   * back of @batch, keeping their order.  Returns how many were moved.
+   */
+  static uint64_t take_submit_batch(list<PendingEvent> *queue,
+				    list<PendingEvent> *batch,
+				    uint64_t max);
+
+protected:
+
   // -- replay --
   class ReplayThread : public Thread {
   public:
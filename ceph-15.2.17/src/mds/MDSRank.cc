@@ -3552,8 +3552,14 @@ const char** MDSRankDispatcher::get_tracked_conf_keys() const
     "clog_to_syslog_level",
     "fsid",
     "host",
+    "mds_bal_cost_base",
+    "mds_bal_cost_min_benefit",
+    "mds_bal_cost_model",
+    "mds_bal_cost_per_item",
     "mds_bal_fragment_dirs",
     "mds_bal_fragment_interval",
+    "mds_bal_import_cooldown",
+    "mds_bal_max_export_items",
     "mds_cache_memory_limit",
     "mds_cache_mid",
     "mds_cache_reservation",
@@ -3570,6 +3576,7 @@ const char** MDSRankDispatcher::get_tracked_conf_keys() const
     "mds_log_pause",
     "mds_max_export_size",
     "mds_max_purge_files",
+    "mds_max_purge_files_adaptive",
     "mds_forward_all_requests_to_auth",
     "mds_max_purge_ops",
     "mds_max_purge_ops_per_pg",
@@ -3578,6 +3585,7 @@ const char** MDSRankDispatcher::get_tracked_conf_keys() const
     "mds_op_history_duration",
     "mds_op_history_size",
     "mds_op_log_threshold",
+    "mds_purge_target_latency",
     "mds_recall_max_decay_rate",
     "mds_recall_warning_decay_rate",
     "mds_request_load_average_decay_rate",
@@ -29,6 +29,9 @@ enum {
   l_oft_omap_total_kv_pairs,
   l_oft_omap_total_updates,
   l_oft_omap_total_removes,
+  l_oft_commit_writes,
+  l_oft_commit_lat,
+  l_oft_load_lat,
   l_oft_last
 };
 
@@ -47,6 +50,11 @@ OpenFileTable::OpenFileTable(MDSRank *m) : mds(m) {
   b.add_u64(l_oft_omap_total_kv_pairs, "omap_total_kv_pairs");
   b.add_u64(l_oft_omap_total_updates, "omap_total_updates");
   b.add_u64(l_oft_omap_total_removes, "omap_total_removes");
+  b.add_u64_counter(l_oft_commit_writes, "commit_writes",
+		    "OMAP write operations issued by commits");
+  b.add_time_avg(l_oft_commit_lat, "commit_latency", "Commit latency");
+  b.add_time_avg(l_oft_load_lat, "load_latency",
+		 "Time to load the table on startup");
   logger.reset(b.create_perf_counters());
   mds->cct->get_perfcounters_collection()->add(logger.get());
   logger->set(l_oft_omap_total_objs, 0);
@@ -278,11 +286,57 @@ void OpenFileTable::_commit_finish(int r, uint64_t log_seq, MDSContext *fin)
   ceph_assert(log_seq >= committed_log_seq);
   committed_log_seq = log_seq;
   num_pending_commit--;
+  logger->tinc(l_oft_commit_lat, ceph::mono_clock::now() - commit_start);
 
   if (fin)
     fin->complete(r);
 }
 
+class C_IO_OFT_Write : public MDSIOContextBase {
+protected:
+  OpenFileTable *oft;
+  Context *fin;
+  MDSRank *get_mds() override { return oft->mds; }
+public:
+  C_IO_OFT_Write(OpenFileTable *t, Context *c) : oft(t), fin(c) {}
+  void finish(int r) override {
+    oft->_write_finish(r, fin);
+  }
+  void print(ostream& out) const override {
+    out << "openfiles_write";
+  }
+};
+
+void OpenFileTable::_queue_write(unsigned idx, ObjectOperation& op,
+				 Context *onfinish)
+{
+  write_queue.push(idx, op, onfinish);
+  _issue_writes();
+}
+
+void OpenFileTable::_issue_writes()
+{
+  std::list<OFTWriteQueue::write_t> ls;
+  write_queue.take(g_conf().get_val<uint64_t>("mds_oft_commit_max_inflight"),
+		   &ls);
+  SnapContext snapc;
+  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
+  for (auto& w : ls) {
+    mds->objecter->mutate(get_object_name(w.idx), oloc, w.op, snapc,
+			  ceph::real_clock::now(), 0,
+			  new C_OnFinisher(new C_IO_OFT_Write(this, w.onfinish),
+					   mds->finisher));
+    logger->inc(l_oft_commit_writes);
+  }
+}
+
+void OpenFileTable::_write_finish(int r, Context *onfinish)
+{
+  write_queue.finish();
+  onfinish->complete(r);
+  _issue_writes();
+}
+
 class C_IO_OFT_Journal : public MDSIOContextBase {
 protected:
   OpenFileTable *oft;
@@ -316,14 +370,9 @@ void OpenFileTable::_journal_finish(int r, uint64_t log_seq, MDSContext *c,
   C_GatherBuilder gather(g_ceph_context,
 			 new C_OnFinisher(new C_IO_OFT_Save(this, log_seq, c),
 			 mds->finisher));
-  SnapContext snapc;
-  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
   for (auto& it : ops_map) {
-    object_t oid = get_object_name(it.first);
-    for (auto& op : it.second) {
-      mds->objecter->mutate(oid, oloc, op, snapc, ceph::real_clock::now(),
-			    0, gather.new_sub());
-    }
+    for (auto& op : it.second)
+      _queue_write(it.first, op, gather.new_sub());
   }
   gather.activate();
 
@@ -339,14 +388,12 @@ void OpenFileTable::commit(MDSContext *c, uint64_t log_seq, int op_prio)
   num_pending_commit++;
   ceph_assert(log_seq >= committing_log_seq);
   committing_log_seq = log_seq;
+  commit_start = ceph::mono_clock::now();
 
   omap_version++;
 
   C_GatherBuilder gather(g_ceph_context);
 
-  SnapContext snapc;
-  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
-
   const unsigned max_write_size = mds->mdcache->max_dir_commit_size;
 
   struct omap_update_ctl {
@@ -393,9 +440,7 @@ void OpenFileTable::commit(MDSContext *c, uint64_t log_seq, int op_prio)
     tmp_map[key].swap(bl);
     op.omap_set(tmp_map);
 
-    object_t oid = get_object_name(idx);
-    mds->objecter->mutate(oid, oloc, op, snapc, ceph::real_clock::now(), 0,
-			  gather.new_sub());
+    _queue_write(idx, op, gather.new_sub());
 
 #ifdef HAVE_STDLIB_MAP_SPLICING
     ctl.journaled_update.merge(ctl.to_update);
@@ -446,11 +491,8 @@ void OpenFileTable::commit(MDSContext *c, uint64_t log_seq, int op_prio)
     gather.set_finisher(new C_OnFinisher(new C_IO_OFT_Save(this, log_seq, c),
 					 mds->finisher));
     for (auto& it : ops_map) {
-      object_t oid = get_object_name(it.first);
-      for (auto& op : it.second) {
-	mds->objecter->mutate(oid, oloc, op, snapc, ceph::real_clock::now(),
-			      0, gather.new_sub());
-      }
+      for (auto& op : it.second)
+	_queue_write(it.first, op, gather.new_sub());
     }
     gather.activate();
   };
@@ -720,56 +762,102 @@ void OpenFileTable::_recover_finish(int r)
   }
 
   journal_state = JOURNAL_NONE;
+  logger->tinc(l_oft_load_lat, ceph::mono_clock::now() - load_start);
   load_done = true;
   finish_contexts(g_ceph_context, waiting_for_load);
   waiting_for_load.clear();
 }
 
+void OpenFileTable::_load_decode_anchor(unsigned idx, inodeno_t ino,
+					bufferlist &bl)
+{
+  using ceph::decode;
+  auto p = bl.cbegin();
+
+  size_t count = loaded_anchor_map.size();
+  auto it = loaded_anchor_map.emplace_hint(loaded_anchor_map.end(),
+					  std::piecewise_construct,
+					  std::make_tuple(ino),
+					  std::make_tuple());
+  RecoveredAnchor& anchor = it->second;
+  decode(anchor, p);
+  frag_vec_t frags; // unused
+  decode(frags, p);
+  ceph_assert(ino == anchor.ino);
+  anchor.omap_idx = idx;
+  anchor.auth = MDS_RANK_NONE;
+
+
+  if (loaded_anchor_map.size() > count)
+    ++omap_num_items[idx];
+}
+
+void OpenFileTable::_load_read(unsigned idx, const std::string& after,
+			       bool first)
+{
+  dout(10) << __func__ << " " << idx << " from '" << after << "'" << dendl;
+  object_t oid = get_object_name(idx);
+  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
+  C_IO_OFT_Load *c = new C_IO_OFT_Load(this, idx, first);
+  ObjectOperation op;
+  if (first)
+    op.omap_get_header(&c->header_bl, &c->header_r);
+  op.omap_get_vals(after, "", uint64_t(-1),
+		   &c->values, &c->more, &c->values_r);
+  mds->objecter->read(oid, oloc, op, CEPH_NOSNAP, nullptr, 0,
+		      new C_OnFinisher(c, mds->finisher));
+}
+
+void OpenFileTable::_load_issue_reads()
+{
+  std::vector<unsigned> idxs;
+  load_queue.take_reads(omap_num_objs,
+			g_conf().get_val<uint64_t>("mds_oft_load_max_inflight"),
+			&idxs);
+  for (auto idx : idxs)
+    _load_read(idx, "", true);
+}
+
 void OpenFileTable::_load_finish(int op_r, int header_r, int values_r,
 				 unsigned idx, bool first, bool more,
 				 bufferlist &header_bl,
 				 std::map<std::string, bufferlist> &values)
 {
-  using ceph::decode;
-  int err = -EINVAL;
+  OFTLoadQueue::page_t page;
+  page.op_r = op_r;
+  page.first = first;
+  page.more = more;
+  page.header_bl.swap(header_bl);
+  page.values.swap(values);
+
+  // keep paging through this object while the earlier ones are applied
+  const std::string last_key = page.values.empty() ?
+    std::string() : page.values.rbegin()->first;
+  if (load_queue.read_done(idx, std::move(page)))
+    _load_read(idx, last_key, false);
+
+  _load_apply();
+}
 
-  auto decode_func = [this](unsigned idx, inodeno_t ino, bufferlist &bl) {
-    auto p = bl.cbegin();
-
-    size_t count = loaded_anchor_map.size();
-    auto it = loaded_anchor_map.emplace_hint(loaded_anchor_map.end(),
-					    std::piecewise_construct,
-					    std::make_tuple(ino),
-					    std::make_tuple());
-    RecoveredAnchor& anchor = it->second;
-    decode(anchor, p);
-    frag_vec_t frags; // unused
-    decode(frags, p);
-    ceph_assert(ino == anchor.ino);
-    anchor.omap_idx = idx;
-    anchor.auth = MDS_RANK_NONE;
-
-
-    if (loaded_anchor_map.size() > count)
-      ++omap_num_items[idx];
-  };
+int OpenFileTable::_load_decode_page(unsigned idx, OFTLoadQueue::page_t& page)
+{
+  using ceph::decode;
 
-  if (op_r < 0) {
-    derr << __func__ << " got " << cpp_strerror(op_r) << dendl;
-    err = op_r;
-    goto out;
+  if (page.op_r < 0) {
+    derr << __func__ << " got " << cpp_strerror(page.op_r) << dendl;
+    return page.op_r;
   }
 
   try {
-    if (first) {
-      auto p = header_bl.cbegin();
+    if (page.first) {
+      auto p = page.header_bl.cbegin();
 
       string magic;
       version_t version;
       unsigned num_objs;
       __u8 jstate;
 
-      if (header_bl.length() == 13) {
+      if (page.header_bl.length() == 13) {
 	// obsolete format.
 	decode(version, p);
 	decode(num_objs, p);
@@ -812,7 +900,7 @@ void OpenFileTable::_load_finish(int op_r, int header_r, int values_r,
       }
     }
 
-    for (auto& it : values) {
+    for (auto& it : page.values) {
       if (it.first.compare(0, 9, "_journal.") == 0) {
 	if (idx >= loaded_journals.size())
 	  loaded_journals.resize(idx + 1);
@@ -827,33 +915,45 @@ void OpenFileTable::_load_finish(int op_r, int header_r, int values_r,
 
       inodeno_t ino;
       sscanf(it.first.c_str(), "%llx", (unsigned long long*)&ino.val);
-      decode_func(idx, ino, it.second);
+      _load_decode_anchor(idx, ino, it.second);
     }
   } catch (buffer::error &e) {
     derr << __func__ << ": corrupted header/values: " << e.what() << dendl;
-    goto out;
+    return -EINVAL;
   }
+  return 0;
+}
 
-  if (more || idx + 1 < omap_num_objs) {
-    // Issue another read if we're not at the end of the omap
-    std::string last_key;
-    if (more)
-      last_key = values.rbegin()->first;
-    else
-      idx++;
-    dout(10) << __func__ << ": continue to load from '" << last_key << "'" << dendl;
-    object_t oid = get_object_name(idx);
-    object_locator_t oloc(mds->mdsmap->get_metadata_pool());
-    C_IO_OFT_Load *c = new C_IO_OFT_Load(this, idx, !more);
-    ObjectOperation op;
-    if (!more)
-      op.omap_get_header(&c->header_bl, &c->header_r);
-    op.omap_get_vals(last_key, "", uint64_t(-1),
-		     &c->values, &c->more, &c->values_r);
-    mds->objecter->read(oid, oloc, op, CEPH_NOSNAP, nullptr, 0,
-			new C_OnFinisher(c, mds->finisher));
+void OpenFileTable::_load_apply()
+{
+  using ceph::decode;
+  int err = -EINVAL;
+
+  // object 0 is always read; its header tells how many objects follow
+  unsigned idx;
+  OFTLoadQueue::page_t page;
+  while (!load_queue.is_done(omap_num_objs)) {
+    if (!load_queue.pop(omap_num_objs, &idx, &page)) {
+      _load_issue_reads();
+      return;
+    }
+    int r = _load_decode_page(idx, page);
+    if (r < 0)
+      load_queue.fail(r);
+  }
+
+  if (load_queue.num_in_flight() > 0) {
+    // wait for the reads that were in flight when we hit an error
+    dout(10) << __func__ << ": waiting for " << load_queue.num_in_flight()
+	     << " outstanding reads" << dendl;
     return;
   }
+  load_queue.clear();
+
+  if (load_queue.get_error() < 0) {
+    err = load_queue.get_error();
+    goto out;
+  }
 
   // replay journal
   if (loaded_journals.size() > 0) {
@@ -887,7 +987,7 @@ void OpenFileTable::_load_finish(int op_r, int header_r, int values_r,
 	  for (auto& q : to_update) {
 	    inodeno_t ino;
 	    sscanf(q.first.c_str(), "%llx", (unsigned long long*)&ino.val);
-	    decode_func(omap_idx, ino, q.second);
+	    _load_decode_anchor(omap_idx, ino, q.second);
 	  }
 	  for (auto& q : to_remove) {
 	    inodeno_t ino;
@@ -950,6 +1050,7 @@ out:
   if (err < 0)
     _reset_states();
 
+  logger->tinc(l_oft_load_lat, ceph::mono_clock::now() - load_start);
   load_done = true;
   finish_contexts(g_ceph_context, waiting_for_load);
   waiting_for_load.clear();
@@ -962,17 +1063,9 @@ void OpenFileTable::load(MDSContext *onload)
   if (onload)
     waiting_for_load.push_back(onload);
 
-  C_IO_OFT_Load *c = new C_IO_OFT_Load(this, 0, true);
-  object_t oid = get_object_name(0);
-  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
-
-  ObjectOperation op;
-  op.omap_get_header(&c->header_bl, &c->header_r);
-  op.omap_get_vals("", "", uint64_t(-1),
-		   &c->values, &c->more, &c->values_r);
-
-  mds->objecter->read(oid, oloc, op, CEPH_NOSNAP, nullptr, 0,
-		      new C_OnFinisher(c, mds->finisher));
+  load_start = ceph::mono_clock::now();
+  load_queue.start();
+  _load_read(0, "", true);
 }
 
 void OpenFileTable::_get_ancestors(const Anchor& parent,
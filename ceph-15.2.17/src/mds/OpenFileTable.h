@@ -19,11 +19,147 @@
 #include "Anchor.h"
 
 #include "MDSContext.h"
+#include "osdc/Objecter.h"
 
 class CDir;
 class CInode;
 class MDSRank;
 
+/**
+ * The omap writes of commits, issued in the order they were queued with at
+ * most max_inflight of them outstanding, so that a commit of a large table
+ * does not flood the OSDs with a burst of writes.  Writes to any single
+ * object stay ordered.
+ */
+class OFTWriteQueue {
+public:
+  struct write_t {
+    unsigned idx;
+    ObjectOperation op;
+    Context *onfinish;
+    write_t(unsigned i, ObjectOperation& o, Context *c) :
+      idx(i), op(o), onfinish(c) {}
+  };
+
+  void push(unsigned idx, ObjectOperation& op, Context *onfinish) {
+    queued.emplace_back(idx, op, onfinish);
+  }
+  /// move the writes that may be issued now to @p ls; 0 means no limit
+  void take(uint64_t max_inflight, std::list<write_t> *ls) {
+    while (!queued.empty() &&
+	   (max_inflight == 0 || in_flight < max_inflight)) {
+      ++in_flight;
+      ls->splice(ls->end(), queued, queued.begin());
+    }
+  }
+  /// an issued write completed
+  void finish() {
+    ceph_assert(in_flight > 0);
+    --in_flight;
+  }
+  size_t num_queued() const { return queued.size(); }
+  unsigned num_in_flight() const { return in_flight; }
+
+private:
+  std::list<write_t> queued;
+  unsigned in_flight = 0;
+};
+
+/**
+ * The reads of a load.  Objects are read in parallel, up to max_inflight
+ * reads at a time, but their pages are handed out strictly in object and
+ * page order, the same order the sequential load applied them in.  Object
+ * 0 is read first; its header tells how many objects follow.
+ */
+class OFTLoadQueue {
+public:
+  struct page_t {
+    int op_r = 0;
+    bool first = false;
+    bool more = false;
+    bufferlist header_bl;
+    std::map<std::string, bufferlist> values;
+  };
+
+  /// the first read of object 0 is issued
+  void start() {
+    pages.clear();
+    next_idx = 0;
+    issued = 1;
+    in_flight = 1;
+    err = 0;
+  }
+
+  /// objects whose first read may be issued now
+  void take_reads(unsigned num_objs, uint64_t max_inflight,
+		  std::vector<unsigned> *idxs) {
+    max_inflight = std::max<uint64_t>(1, max_inflight);
+    while (err == 0 && issued < num_objs && in_flight < max_inflight) {
+      ++in_flight;
+      idxs->push_back(issued++);
+    }
+  }
+
+  /**
+   * A read of object @p idx completed.
+   *
+   * @returns true if the next page of the object should be read, which
+   * then counts as in flight
+   */
+  bool read_done(unsigned idx, page_t&& page) {
+    ceph_assert(in_flight > 0);
+    --in_flight;
+    page.more = (page.op_r >= 0 && page.more && !page.values.empty() &&
+		 err == 0);
+    if (page.more)
+      ++in_flight;
+    bool more = page.more;
+    pages[idx].push_back(std::move(page));
+    return more;
+  }
+
+  /**
+   * Take the next page to apply, of object @p idx, if it was read.  Nothing
+   * is handed out once the load failed, or past the last of @p num_objs
+   * objects.
+   */
+  bool pop(unsigned num_objs, unsigned *idx, page_t *page) {
+    if (is_done(num_objs))
+      return false;
+    auto p = pages.find(next_idx);
+    if (p == pages.end() || p->second.empty())
+      return false;
+    *idx = next_idx;
+    *page = std::move(p->second.front());
+    p->second.pop_front();
+    if (!page->more) {
+      pages.erase(p);
+      ++next_idx;
+    }
+    return true;
+  }
+  bool is_done(unsigned num_objs) const {
+    return err < 0 || (next_idx > 0 && next_idx >= num_objs);
+  }
+
+  /// stop issuing reads; the ones in flight are still waited for
+  void fail(int r) {
+    ceph_assert(r < 0);
+    if (err == 0)
+      err = r;
+  }
+  int get_error() const { return err; }
+  unsigned num_in_flight() const { return in_flight; }
+  void clear() { pages.clear(); }
+
+private:
+  std::map<unsigned, std::list<page_t> > pages;
+  unsigned next_idx = 0;	// next object to apply
+  unsigned issued = 0;		// objects whose first read is issued
+  unsigned in_flight = 0;
+  int err = 0;
+};
+
 class OpenFileTable
 {
 public:
@@ -67,6 +203,7 @@ protected:
   friend class C_IO_OFT_Load;
   friend class C_IO_OFT_Save;
   friend class C_IO_OFT_Journal;
+  friend class C_IO_OFT_Write;
   friend class C_OFT_OpenInoFinish;
 
   uint64_t MAX_ITEMS_PER_OBJ = g_conf().get_val<uint64_t>("osd_deep_scrub_large_omap_object_key_threshold");
@@ -76,11 +213,18 @@ protected:
   static const int DIRTY_UNDEF	= -2;
 
   unsigned num_pending_commit = 0;
+  ceph::mono_time commit_start;
   void _encode_header(bufferlist& bl, int j_state);
   void _commit_finish(int r, uint64_t log_seq, MDSContext *fin);
   void _journal_finish(int r, uint64_t log_seq, MDSContext *fin,
 		       std::map<unsigned, std::vector<ObjectOperation> >& ops);
 
+  // at most mds_oft_commit_max_inflight writes are outstanding
+  OFTWriteQueue write_queue;
+  void _queue_write(unsigned idx, ObjectOperation& op, Context *onfinish);
+  void _issue_writes();
+  void _write_finish(int r, Context *onfinish);
+
   void get_ref(CInode *in, frag_t fg=-1U);
   void put_ref(CInode *in, frag_t fg=-1U);
 
@@ -97,6 +241,15 @@ protected:
 		    unsigned idx, bool first, bool more,
                     bufferlist &header_bl,
 		    std::map<std::string, bufferlist> &values);
+
+  // at most mds_oft_load_max_inflight reads are outstanding
+  OFTLoadQueue load_queue;
+  ceph::mono_time load_start;
+  void _load_read(unsigned idx, const std::string& after, bool first);
+  void _load_issue_reads();
+  void _load_apply();
+  int _load_decode_page(unsigned idx, OFTLoadQueue::page_t& page);
+  void _load_decode_anchor(unsigned idx, inodeno_t ino, bufferlist &bl);
   void _recover_finish(int r);
 
   void _open_ino_finish(inodeno_t ino, int r);
@@ -117,7 +117,11 @@ PurgeQueue::PurgeQueue(
     journaler("pq", MDS_INO_PURGE_QUEUE + rank, metadata_pool,
       CEPH_FS_ONDISK_MAGIC, objecter_, nullptr, 0,
       &finisher),
-    on_error(on_error_)
+    on_error(on_error_),
+    files_limit(cct->_conf->mds_max_purge_files,
+		cct->_conf.get_val<uint64_t>("mds_max_purge_files_adaptive"),
+		ceph::make_timespan(
+		  cct->_conf.get_val<double>("mds_purge_target_latency")))
 {
   ceph_assert(cct != nullptr);
   ceph_assert(on_error != nullptr);
@@ -146,6 +150,8 @@ void PurgeQueue::create_logger()
   pcb.add_u64(l_pq_executing, "pq_executing", "Purge queue tasks in flight");
   pcb.add_u64(l_pq_executing_high_water, "pq_executing_high_water", "Maximum number of executing file purges");
   pcb.add_u64(l_pq_item_in_journal, "pq_item_in_journal", "Purge item left in journal");
+  pcb.add_u64(l_pq_executing_limit, "pq_executing_limit", "Current limit of file purges in flight");
+  pcb.add_time_avg(l_pq_item_latency, "pq_item_latency", "Latency of purging one item");
 
   logger.reset(pcb.create_perf_counters());
   g_ceph_context->get_perfcounters_collection()->add(logger.get());
@@ -156,6 +162,7 @@ void PurgeQueue::init()
   std::lock_guard l(lock);
 
   ceph_assert(logger != nullptr);
+  logger->set(l_pq_executing_limit, _max_purge_files());
 
   finisher.start();
   timer.init();
@@ -386,6 +393,26 @@ uint32_t PurgeQueue::_calculate_ops(const PurgeItem &item) const
   return ops_required;
 }
 
+uint64_t PurgeQueue::_max_purge_files() const
+{
+  uint64_t max_files = cct->_conf->mds_max_purge_files;
+  if (max_files > 0 &&
+      cct->_conf.get_val<uint64_t>("mds_max_purge_files_adaptive") > max_files) {
+    return files_limit.get();
+  }
+  return max_files;
+}
+
+void PurgeQueue::_update_files_limit()
+{
+  files_limit.set_bounds(
+    cct->_conf->mds_max_purge_files,
+    cct->_conf.get_val<uint64_t>("mds_max_purge_files_adaptive"));
+  files_limit.set_target(ceph::make_timespan(
+    cct->_conf.get_val<double>("mds_purge_target_latency")));
+  logger->set(l_pq_executing_limit, _max_purge_files());
+}
+
 bool PurgeQueue::_can_consume()
 {
   if (readonly) {
@@ -393,11 +420,12 @@ bool PurgeQueue::_can_consume()
     return false;
   }
 
+  const uint64_t max_files = _max_purge_files();
   dout(20) << ops_in_flight << "/" << max_purge_ops << " ops, "
-           << in_flight.size() << "/" << g_conf()->mds_max_purge_files
+           << in_flight.size() << "/" << max_files
            << " files" << dendl;
 
-  if (in_flight.size() == 0 && cct->_conf->mds_max_purge_files > 0) {
+  if (in_flight.size() == 0 && max_files > 0) {
     // Always permit consumption if nothing is in flight, so that the ops
     // limit can never be so low as to forbid all progress (unless
     // administrator has deliberately paused purging by setting max
@@ -411,9 +439,9 @@ bool PurgeQueue::_can_consume()
     return false;
   }
 
-  if (in_flight.size() >= cct->_conf->mds_max_purge_files) {
+  if (in_flight.size() >= max_files) {
     dout(20) << "Throttling on item limit " << in_flight.size()
-             << "/" << cct->_conf->mds_max_purge_files << dendl;
+             << "/" << max_files << dendl;
     return false;
   } else {
     return true;
@@ -589,8 +617,9 @@ void PurgeQueue::_execute_item(
   }
   ceph_assert(gather.has_subs());
 
+  auto start = ceph::mono_clock::now();
   gather.set_finisher(new C_OnFinisher(
-                      new LambdaContext([this, expire_to](int r){
+                      new LambdaContext([this, expire_to, start, ops](int r){
     std::lock_guard l(lock);
 
     if (r == -EBLACKLISTED) {
@@ -599,6 +628,13 @@ void PurgeQueue::_execute_item(
       return;
     }
 
+    // a large file takes longer to purge than a small one without the
+    // OSDs being any busier: what the limit follows is the time per op
+    auto lat = ceph::mono_clock::now() - start;
+    logger->tinc(l_pq_item_latency, lat);
+    files_limit.sample(lat / std::max<uint32_t>(ops, 1));
+    logger->set(l_pq_executing_limit, _max_purge_files());
+
     _execute_item_complete(expire_to);
     _consume();
 
@@ -721,8 +757,11 @@ void PurgeQueue::handle_conf_change(const std::set<std::string>& changed, const
   if (changed.count("mds_max_purge_ops")
       || changed.count("mds_max_purge_ops_per_pg")) {
     update_op_limit(mds_map);
-  } else if (changed.count("mds_max_purge_files")) {
+  } else if (changed.count("mds_max_purge_files")
+	     || changed.count("mds_max_purge_files_adaptive")
+	     || changed.count("mds_purge_target_latency")) {
     std::lock_guard l(lock);
+    _update_files_limit();
     if (in_flight.empty()) {
       // We might have gone from zero to a finite limit, so
       // might need to kick off consume.
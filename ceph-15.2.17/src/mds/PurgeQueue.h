@@ -16,6 +16,7 @@
 #define PURGE_QUEUE_H_
 
 #include "include/compact_set.h"
+#include "common/AdaptiveLimit.h"
 #include "mds/MDSMap.h"
 #include "osdc/Journaler.h"
 
@@ -90,6 +91,8 @@ enum {
   l_pq_executing_high_water,
   l_pq_executed,
   l_pq_item_in_journal,
+  l_pq_executing_limit,
+  l_pq_item_latency,
   l_pq_last
 };
 
@@ -159,6 +162,10 @@ private:
 
   bool _can_consume();
 
+  // current limit on files purged in parallel
+  uint64_t _max_purge_files() const;
+  void _update_files_limit();
+
   // recover the journal write_pos (drop any partial written entry)
   void _recover();
 
@@ -203,6 +210,10 @@ private:
   // Dynamic op limit per MDS based on PG count
   uint64_t max_purge_ops = 0;
 
+  // Limit on files in flight, following the purge latency when
+  // mds_max_purge_files_adaptive is set
+  AdaptiveLimit files_limit;
+
   // How many bytes were remaining when drain() was first called,
   // used for indicating progress.
   uint64_t drain_initial = 0;
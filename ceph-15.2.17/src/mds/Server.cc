@@ -174,6 +174,15 @@ void Server::create_logger()
   plb.add_u64_counter(l_mdss_cap_acquisition_throttle,
                       "cap_acquisition_throttle", "Cap acquisition throttle counter", "cat",
                       PerfCountersBuilder::PRIO_INTERESTING);
+  plb.add_u64_counter(l_mdss_getattr_single, "getattr_single",
+                      "Single inode getattr requests", "gas",
+                      PerfCountersBuilder::PRIO_USEFUL);
+  plb.add_u64_counter(l_mdss_getattr_batch, "getattr_batch",
+                      "Batched readdir getattr requests", "gab",
+                      PerfCountersBuilder::PRIO_USEFUL);
+  plb.add_u64_counter(l_mdss_getattr_batch_entries, "getattr_batch_entries",
+                      "Entries refreshed by batched getattr requests", "gae",
+                      PerfCountersBuilder::PRIO_USEFUL);
 
   // fop latencies are useful
   plb.set_prio_default(PerfCountersBuilder::PRIO_USEFUL);
@@ -2289,8 +2298,11 @@ void Server::handle_client_request(const cref_t<MClientRequest> &req)
 
   if (mds->logger)
     mds->logger->inc(l_mds_request);
-  if (logger)
+  if (logger) {
     logger->inc(l_mdss_handle_client_request);
+    if (req->get_op() == CEPH_MDS_OP_GETATTR)
+      logger->inc(l_mdss_getattr_single);
+  }
 
   if (!mdcache->is_open()) {
     dout(5) << "waiting for root" << dendl;
@@ -4688,6 +4700,11 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
   
   session->touch_readdir_cap(numfiles);
 
+  if ((req_flags & CEPH_READDIR_GETATTR_BATCH) && logger) {
+    logger->inc(l_mdss_getattr_batch);
+    logger->inc(l_mdss_getattr_batch_entries, numfiles);
+  }
+
   __u16 flags = 0;
   if (end) {
     flags = CEPH_READDIR_FRAG_END;
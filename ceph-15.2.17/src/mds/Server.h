@@ -78,6 +78,9 @@ enum {
   l_mdss_req_unlink_latency,
   l_mdss_cap_revoke_eviction,
   l_mdss_cap_acquisition_throttle,
+  l_mdss_getattr_single,
+  l_mdss_getattr_batch,
+  l_mdss_getattr_batch_entries,
   l_mdss_last,
 };
 
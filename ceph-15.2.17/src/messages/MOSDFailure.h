@@ -21,7 +21,7 @@
 
 class MOSDFailure : public PaxosServiceMessage {
 private:
-  static constexpr int HEAD_VERSION = 4;
+  static constexpr int HEAD_VERSION = 5;
   static constexpr int COMPAT_VERSION = 4;
 
  public:
@@ -37,6 +37,7 @@ private:
   __u8 flags = 0;
   epoch_t epoch = 0;
   int32_t failed_for = 0;  // known to be failed since at least this long
+  std::vector<int32_t> confirmed_by;  // peers that gossiped the same failure
 
   MOSDFailure() : PaxosServiceMessage(MSG_OSD_FAILURE, 0, HEAD_VERSION) { }
   MOSDFailure(const uuid_d &fs, int osd, const entity_addrvec_t& av,
@@ -86,6 +87,9 @@ public:
     decode(epoch, p);
     decode(flags, p);
     decode(failed_for, p);
+    if (header.version >= 5) {
+      decode(confirmed_by, p);
+    }
   }
 
   void encode_payload(uint64_t features) override {
@@ -110,6 +114,7 @@ public:
     encode(epoch, payload);
     encode(flags, payload);
     encode(failed_for, payload);
+    encode(confirmed_by, payload);
   }
 
   std::string_view get_type_name() const override { return "osd_failure"; }
@@ -118,8 +123,11 @@ public:
 	<< (if_osd_failed() ? "failed " : "recovered ")
 	<< (is_immediate() ? "immediate " : "timeout ")
 	<< "osd." << target_osd << " " << target_addrs
-	<< " for " << failed_for << "sec e" << epoch
-	<< " v" << version << ")";
+	<< " for " << failed_for << "sec e" << epoch;
+    if (!confirmed_by.empty()) {
+      out << " confirmed by " << confirmed_by;
+    }
+    out << " v" << version << ")";
   }
 private:
   template<class T, typename... Args>
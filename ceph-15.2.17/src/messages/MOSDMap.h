@@ -19,10 +19,11 @@
 #include "msg/Message.h"
 #include "osd/OSDMap.h"
 #include "include/ceph_features.h"
+#include "compressor/Compressor.h"
 
 class MOSDMap : public Message {
 private:
-  static constexpr int HEAD_VERSION = 4;
+  static constexpr int HEAD_VERSION = 5;
   static constexpr int COMPAT_VERSION = 3;
 
 public:
@@ -31,23 +32,30 @@ public:
   std::map<epoch_t, ceph::buffer::list> maps;
   std::map<epoch_t, ceph::buffer::list> incremental_maps;
   epoch_t oldest_map =0, newest_map = 0;
+  /**
+   * Maps the monitors send to peers that subscribed with
+   * CEPH_SUBSCRIBE_COMPRESSED, in the form built by compress_map().  The
+   * receiver moves them into maps/incremental_maps with decompress().
+   */
+  std::map<epoch_t, ceph::buffer::list> compressed_maps;
+  std::map<epoch_t, ceph::buffer::list> compressed_incremental_maps;
 
   epoch_t get_first() const {
     epoch_t e = 0;
-    auto i = maps.cbegin();
-    if (i != maps.cend())  e = i->first;
-    i = incremental_maps.begin();    
-    if (i != incremental_maps.end() &&
-        (e == 0 || i->first < e)) e = i->first;
+    for (auto m : {&maps, &incremental_maps,
+		   &compressed_maps, &compressed_incremental_maps}) {
+      if (!m->empty() && (e == 0 || m->cbegin()->first < e))
+	e = m->cbegin()->first;
+    }
     return e;
   }
   epoch_t get_last() const {
     epoch_t e = 0;
-    auto i = maps.crbegin();
-    if (i != maps.crend())  e = i->first;
-    i = incremental_maps.rbegin();    
-    if (i != incremental_maps.rend() &&
-        (e == 0 || i->first > e)) e = i->first;
+    for (auto m : {&maps, &incremental_maps,
+		   &compressed_maps, &compressed_incremental_maps}) {
+      if (!m->empty() && (e == 0 || m->crbegin()->first > e))
+	e = m->crbegin()->first;
+    }
     return e;
   }
   epoch_t get_oldest() {
@@ -58,6 +66,65 @@ public:
   }
 
 
+  /**
+   * Build the compressed form of an encoded (full or incremental) map:
+   *
+   *   u8  compression algorithm (none if compression did not help)
+   *   u32 length of the encoded map
+   *   the encoded map, compressed
+   *
+   * Each map is compressed on its own so that the monitors can cache the
+   * result and share it between messages.
+   */
+  static void compress_map(const CompressorRef& compressor,
+			   const ceph::buffer::list& in,
+			   ceph::buffer::list& out) {
+    using ceph::encode;
+    ceph::buffer::list data;
+    uint8_t alg = Compressor::COMP_ALG_NONE;
+    if (compressor && compressor->compress(in, data) == 0 &&
+	data.length() < in.length()) {
+      alg = compressor->get_type();
+    } else {
+      data = in;
+    }
+    encode(alg, out);
+    encode((uint32_t)in.length(), out);
+    out.claim_append(data);
+  }
+  /// reverse compress_map(); throws ceph::buffer::error on a bad map
+  static void decompress_map(CephContext *cct,
+			     const ceph::buffer::list& in,
+			     ceph::buffer::list& out) {
+    using ceph::decode;
+    auto p = in.cbegin();
+    uint8_t alg;
+    uint32_t len;
+    decode(alg, p);
+    decode(len, p);
+    if (alg == Compressor::COMP_ALG_NONE) {
+      p.copy(len, out);
+      return;
+    }
+    CompressorRef compressor = Compressor::create(cct, alg);
+    if (!compressor ||
+	compressor->decompress(p, p.get_remaining(), out) < 0 ||
+	out.length() != len) {
+      throw ceph::buffer::malformed_input("unable to decompress osdmap");
+    }
+  }
+  /// move the compressed maps into maps/incremental_maps
+  void decompress(CephContext *cct) {
+    for (auto& [e, bl] : compressed_maps) {
+      decompress_map(cct, bl, maps[e]);
+    }
+    compressed_maps.clear();
+    for (auto& [e, bl] : compressed_incremental_maps) {
+      decompress_map(cct, bl, incremental_maps[e]);
+    }
+    compressed_incremental_maps.clear();
+  }
+
   MOSDMap() : Message{CEPH_MSG_OSD_MAP, HEAD_VERSION, COMPAT_VERSION} { }
   MOSDMap(const uuid_d &f, const uint64_t features)
     : Message{CEPH_MSG_OSD_MAP, HEAD_VERSION, COMPAT_VERSION},
@@ -85,6 +152,10 @@ public:
       mempool::osdmap::map<int64_t,snap_interval_set_t> gap_removed_snaps;
       decode(gap_removed_snaps, p);
     }
+    if (header.version >= 5) {
+      decode(compressed_incremental_maps, p);
+      decode(compressed_maps, p);
+    }
   }
   void encode_payload(uint64_t features) override {
     using ceph::encode;
@@ -149,6 +220,12 @@ public:
     if (header.version >= 4) {
       encode((uint32_t)0, payload);
     }
+    if (header.version >= 5) {
+      // only ever built for peers that understand them, which never need
+      // the maps reencoded above
+      encode(compressed_incremental_maps, payload);
+      encode(compressed_maps, payload);
+    }
   }
 
   std::string_view get_type_name() const override { return "osdmap"; }
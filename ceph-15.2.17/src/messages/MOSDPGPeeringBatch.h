@@ -0,0 +1,87 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include "msg/Message.h"
+
+/**
+ * Peering messages of many PGs bound for the same OSD, sent as one.
+ *
+ * Each entry is a complete encoded message (MOSDPGQuery2, MOSDPGNotify2,
+ * MOSDPGInfo2, MOSDPGLog, ...).  The receiver dispatches them in order
+ * as if they had arrived one by one on the same connection.  Only sent
+ * to peers with CEPH_FEATURE_OSD_PEERING_BATCH.
+ */
+class MOSDPGPeeringBatch : public Message {
+private:
+  static constexpr int HEAD_VERSION = 1;
+  static constexpr int COMPAT_VERSION = 1;
+
+public:
+  std::vector<MessageRef> msgs;
+
+  MOSDPGPeeringBatch()
+    : Message{MSG_OSD_PG_PEERING_BATCH, HEAD_VERSION, COMPAT_VERSION} {}
+  explicit MOSDPGPeeringBatch(std::vector<MessageRef>&& msgs)
+    : Message{MSG_OSD_PG_PEERING_BATCH, HEAD_VERSION, COMPAT_VERSION},
+      msgs(std::move(msgs)) {}
+private:
+  ~MOSDPGPeeringBatch() override {}
+
+public:
+  /// whether messages of @p type may be sent in a batch
+  static bool is_batchable(int type) {
+    switch (type) {
+    case MSG_OSD_PG_QUERY:
+    case MSG_OSD_PG_NOTIFY:
+    case MSG_OSD_PG_INFO:
+    case MSG_OSD_PG_LOG:
+    case MSG_OSD_PG_TRIM:
+    case MSG_OSD_PG_NOTIFY2:
+    case MSG_OSD_PG_QUERY2:
+    case MSG_OSD_PG_INFO2:
+    case MSG_OSD_BACKFILL_RESERVE:
+    case MSG_OSD_RECOVERY_RESERVE:
+    case MSG_OSD_PG_LEASE:
+    case MSG_OSD_PG_LEASE_ACK:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  std::string_view get_type_name() const override { return "pg_peering_batch"; }
+  void print(std::ostream& out) const override {
+    out << "pg_peering_batch(" << msgs.size() << " msgs)";
+  }
+
+  void encode_payload(uint64_t features) override {
+    using ceph::encode;
+    encode((uint32_t)msgs.size(), payload);
+    for (auto& m : msgs) {
+      encode_message(m.get(), features, payload);
+    }
+  }
+  void decode_payload() override {
+    using ceph::decode;
+    auto p = payload.cbegin();
+    uint32_t n;
+    decode(n, p);
+    msgs.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      Message *m = decode_message(nullptr, 0, p);
+      if (!m) {
+	throw ceph::buffer::malformed_input("bad message in pg_peering_batch");
+      }
+      msgs.emplace_back(m, false);
+      if (!is_batchable(m->get_type())) {
+	throw ceph::buffer::malformed_input(
+	  "unexpected message type in pg_peering_batch");
+      }
+    }
+  }
+private:
+  template<class T, typename... Args>
+  friend boost::intrusive_ptr<T> ceph::make_message(Args&&... args);
+};
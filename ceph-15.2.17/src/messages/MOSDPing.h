@@ -34,7 +34,7 @@
 
 class MOSDPing : public Message {
 private:
-  static constexpr int HEAD_VERSION = 5;
+  static constexpr int HEAD_VERSION = 6;
   static constexpr int COMPAT_VERSION = 4;
 
  public:
@@ -66,6 +66,7 @@ private:
   ceph::signedspan mono_send_stamp; ///< replier's send stamp
   std::optional<ceph::signedspan> delta_ub;  ///< ping sender
   epoch_t up_from = 0;
+  std::vector<int32_t> suspects;    ///< peers the sender fails to hear from
 
   uint32_t min_message_size = 0;
 
@@ -109,6 +110,9 @@ public:
       decode(mono_send_stamp, p);
       decode(delta_ub, p);
     }
+    if (header.version >= 6) {
+      decode(suspects, p);
+    }
 
     p += size;
     min_message_size = size + payload_mid_length;
@@ -130,6 +134,7 @@ public:
     encode(mono_ping_stamp, payload);
     encode(mono_send_stamp, payload);
     encode(delta_ub, payload);
+    encode(suspects, payload);
 
     if (s) {
       // this should be big enough for normal min_message padding sizes. since
@@ -157,6 +162,9 @@ public:
     if (delta_ub) {
       out << " delta_ub " << *delta_ub;
     }
+    if (!suspects.empty()) {
+      out << " suspects " << suspects;
+    }
     out << ")";
   }
 private:
@@ -90,7 +90,8 @@ DaemonServer::DaemonServer(MonClient *monc_,
       shutting_down(false),
       tick_event(nullptr),
       osd_perf_metric_collector_listener(this),
-      osd_perf_metric_collector(osd_perf_metric_collector_listener)
+      osd_perf_metric_collector(osd_perf_metric_collector_listener),
+      metrics_exporter(g_ceph_context)
 {
   g_conf().add_observer(this);
 }
@@ -153,6 +154,13 @@ int DaemonServer::init(uint64_t gid, entity_addrvec_t client_addrs)
 
   started_at = ceph_clock_now();
 
+  r = metrics_exporter.init();
+  if (r < 0) {
+    // the prometheus module can still serve the counters
+    derr << "unable to start the metrics exporter: " << cpp_strerror(r)
+	 << dendl;
+  }
+
   std::lock_guard l(lock);
   timer.init();
 
@@ -369,6 +377,7 @@ void DaemonServer::shutdown()
   dout(10) << "begin" << dendl;
   msgr->shutdown();
   msgr->wait();
+  metrics_exporter.shutdown();
   cluster_state.shutdown();
   dout(10) << "done" << dendl;
 
@@ -513,6 +522,7 @@ bool DaemonServer::handle_close(const ref_t<MMgrClose>& m)
   if (daemon_state.exists(key)) {
     DaemonStatePtr daemon = daemon_state.get(key);
     daemon_state.rm(key);
+    metrics_exporter.remove(key);
     {
       std::lock_guard l(daemon->lock);
       if (daemon->service_daemon) {
@@ -614,6 +624,7 @@ bool DaemonServer::handle_report(const ref_t<MMgrReport>& m)
       std::lock_guard l(daemon->lock);
       auto &daemon_counters = daemon->perf_counters;
       daemon_counters.update(*m.get());
+      metrics_exporter.update(key, daemon_counters);
 
       auto p = m->config_bl.cbegin();
       if (p != m->config_bl.end()) {
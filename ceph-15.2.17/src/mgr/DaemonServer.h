@@ -31,6 +31,7 @@
 #include "MgrSession.h"
 #include "DaemonState.h"
 #include "MetricCollector.h"
+#include "MetricsExporter.h"
 #include "OSDPerfMetricCollector.h"
 
 class MMgrReport;
@@ -124,6 +125,8 @@ private:
   OSDPerfMetricCollector osd_perf_metric_collector;
   void handle_osd_perf_metric_query_updated();
 
+  MetricsExporter metrics_exporter;
+
   void handle_metric_payload(const OSDMetricPayload &payload) {
     osd_perf_metric_collector.process_reports(payload);
   }
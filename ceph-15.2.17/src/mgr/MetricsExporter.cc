@@ -0,0 +1,448 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <set>
+
+#include "common/debug.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+#include "include/compat.h"
+#include "include/sock_compat.h"
+#include "msg/msg_types.h"
+
+#include "mgr/MetricsExporter.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_mgr
+#undef dout_prefix
+#define dout_prefix *_dout << "mgr.metrics_exporter " << __func__ << ": "
+
+namespace {
+
+// the services get_all_perf_counters() in mgr_module.py exports
+const std::set<std::string> exported_services = {
+  "mds", "mon", "osd", "rbd-mirror", "rgw", "tcmu-runner"
+};
+
+// same as PERFCOUNTER_TYPE_MASK in mgr_module.py
+constexpr uint8_t TYPE_MASK = ~(PERFCOUNTER_TIME | PERFCOUNTER_U64);
+
+const char *family_type(uint8_t type)
+{
+  switch (type & TYPE_MASK) {
+  case 0:
+    return "gauge";
+  case PERFCOUNTER_LONGRUNAVG:
+  case PERFCOUNTER_COUNTER:
+    return "counter";
+  default:
+    // histograms are exported through their long running averages
+    return nullptr;
+  }
+}
+
+void append_value(std::string *out, uint64_t v, bool time)
+{
+  char buf[32];
+  if (time) {
+    // nanoseconds to seconds, exactly
+    snprintf(buf, sizeof(buf), "%llu.%09llu",
+	     (unsigned long long)(v / 1000000000ull),
+	     (unsigned long long)(v % 1000000000ull));
+  } else {
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+  }
+  out->append(buf);
+}
+
+void append_sample(std::string *out, const std::string& name,
+		   const std::string& labels, uint64_t v, bool time)
+{
+  out->append(name);
+  out->append(labels);
+  out->push_back(' ');
+  append_value(out, v, time);
+  out->push_back('\n');
+}
+
+bool send_all(int fd, const char *buf, size_t len)
+{
+  while (len > 0) {
+    ssize_t r = ::send(fd, buf, len, MSG_NOSIGNAL);
+    if (r < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return false;
+    }
+    buf += r;
+    len -= r;
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+MetricsExporter::~MetricsExporter()
+{
+  shutdown();
+}
+
+std::string MetricsExporter::metric_name(const std::string& path)
+{
+  // see promethize() in the prometheus module
+  std::string name = "ceph_";
+  name.reserve(path.size() + 16);
+  for (size_t i = 0; i < path.size(); ++i) {
+    char c = path[i];
+    if (c == ':' && i + 1 < path.size() && path[i + 1] == ':') {
+      name.push_back('_');
+      ++i;
+    } else if (c == '.' || c == '/' || isspace(c)) {
+      name.push_back('_');
+    } else if (c == '+') {
+      name.append("_plus");
+    } else if (c == '-') {
+      name.append(i + 1 == path.size() ? "_minus" : "_");
+    } else {
+      name.push_back(c);
+    }
+  }
+  return name;
+}
+
+void MetricsExporter::path_labels(const std::string& daemon,
+				  const std::string& path,
+				  std::string *out_path, std::string *labels)
+{
+  *out_path = path;
+  *labels = "{ceph_daemon=\"" + daemon + "\"";
+  // see _perfpath_to_path_labels() in mgr_module.py: the counters of an
+  // image are rbd_mirror_image_<pool>/[<namespace>/]<image>.<counter>
+  static const std::string image_prefix = "rbd_mirror_image_";
+  static const std::set<std::string> image_counters = {
+    "replay", "replay_bytes", "replay_latency"
+  };
+  if (daemon.compare(0, 11, "rbd-mirror.") == 0 &&
+      path.compare(0, image_prefix.size(), image_prefix) == 0) {
+    const auto pool_end = path.find('/', image_prefix.size());
+    const auto dot = path.rfind('.');
+    if (pool_end != std::string::npos && pool_end > image_prefix.size() &&
+	dot != std::string::npos && dot > pool_end &&
+	image_counters.count(path.substr(dot + 1))) {
+      const std::string pool =
+	path.substr(image_prefix.size(), pool_end - image_prefix.size());
+      std::string rest = path.substr(pool_end + 1, dot - pool_end - 1);
+      std::string ns;
+      const auto ns_end = rest.find('/');
+      if (ns_end != std::string::npos && ns_end > 0) {
+	ns = rest.substr(0, ns_end);
+	rest.erase(0, ns_end + 1);
+      }
+      *out_path = image_prefix + path.substr(dot + 1);
+      *labels += ",pool=\"" + pool + "\",namespace=\"" + ns +
+	"\",image=\"" + rest + "\"";
+    }
+  }
+  labels->push_back('}');
+}
+
+void MetricsExporter::update(const DaemonKey& key,
+			     const DaemonPerfCounters& counters)
+{
+  if (listen_fd < 0 || !exported_services.count(key.type)) {
+    return;
+  }
+  const auto prio_limit =
+    cct->_conf.get_val<int64_t>("mgr_metrics_exporter_prio_limit");
+  const std::string daemon = ceph::to_string(key);
+  // only rbd-mirror has counters with labels of their own
+  const bool per_path_labels = (key.type == "rbd-mirror");
+  const std::string daemon_labels = "{ceph_daemon=\"" + daemon + "\"}";
+  std::string path_labels_buf;
+
+  // render outside of the lock; families are resolved afterwards
+  enum class part_t { value, sum, count };
+  struct rendered_t {
+    std::string name;
+    const PerfCounterType *type;
+    part_t part;
+    std::string lines;
+  };
+  std::vector<rendered_t> rendered;
+  rendered.reserve(counters.instances.size() * 2);
+  for (auto& [path, instance] : counters.instances) {
+    auto t = counters.types.find(path);
+    if (t == counters.types.end() || t->second.priority < prio_limit) {
+      continue;
+    }
+    const auto type = t->second.type;
+    if (!family_type(type)) {
+      continue;
+    }
+    const bool time = type & PERFCOUNTER_TIME;
+    std::string name;
+    const std::string *labels = &daemon_labels;
+    if (per_path_labels) {
+      std::string counter_path;
+      path_labels(daemon, path, &counter_path, &path_labels_buf);
+      name = metric_name(counter_path);
+      labels = &path_labels_buf;
+    } else {
+      name = metric_name(path);
+    }
+    if (type & PERFCOUNTER_LONGRUNAVG) {
+      if (instance.get_data_avg().empty()) {
+	continue;
+      }
+      auto& latest = instance.get_latest_data_avg();
+      rendered_t& sum = rendered.emplace_back(
+	rendered_t{name + "_sum", &t->second, part_t::sum, {}});
+      append_sample(&sum.lines, sum.name, *labels, latest.s, time);
+      rendered_t& count = rendered.emplace_back(
+	rendered_t{name + "_count", &t->second, part_t::count, {}});
+      append_sample(&count.lines, count.name, *labels, latest.c, false);
+    } else {
+      if (instance.get_data().empty()) {
+	continue;
+      }
+      rendered_t& r = rendered.emplace_back(
+	rendered_t{std::move(name), &t->second, part_t::value, {}});
+      append_sample(&r.lines, r.name, *labels,
+		    instance.get_latest_data().v, time);
+    }
+  }
+
+  auto samples = std::make_shared<samples_t>();
+  samples->reserve(rendered.size());
+  const auto now = ceph::coarse_mono_clock::now();
+  std::lock_guard l(lock);
+  prune_stale(now);
+  for (auto& r : rendered) {
+    auto [i, inserted] = family_index.emplace(r.name, family_headers.size());
+    if (inserted) {
+      std::string desc = r.type->description;
+      if (r.part == part_t::sum) {
+	desc += " Total";
+      } else if (r.part == part_t::count) {
+	desc += " Count";
+      }
+      // the count of a long running average is always a counter
+      family_headers.push_back(
+	"# HELP " + r.name + " " + desc + "\n# TYPE " + r.name + " " +
+	(r.part == part_t::count ? "counter" : family_type(r.type->type)) +
+	"\n");
+    }
+    samples->emplace_back(i->second, std::move(r.lines));
+  }
+  daemons[key] = {now, std::move(samples)};
+}
+
+void MetricsExporter::prune_stale(ceph::coarse_mono_time now)
+{
+  // daemons that stopped reporting are dropped after a few stats periods;
+  // look for them once a period, not on every report
+  const auto period =
+    std::chrono::seconds(cct->_conf.get_val<int64_t>("mgr_stats_period"));
+  if (now - last_prune < period) {
+    return;
+  }
+  last_prune = now;
+  const auto stale = now - 4 * period;
+  for (auto p = daemons.begin(); p != daemons.end(); ) {
+    if (p->second.stamp < stale) {
+      dout(10) << "dropping stale " << p->first << dendl;
+      p = daemons.erase(p);
+    } else {
+      ++p;
+    }
+  }
+}
+
+void MetricsExporter::remove(const DaemonKey& key)
+{
+  std::lock_guard l(lock);
+  daemons.erase(key);
+}
+
+void MetricsExporter::dump(std::string *out)
+{
+  std::vector<std::shared_ptr<const samples_t>> all;
+  std::vector<std::string> headers;
+  {
+    std::lock_guard l(lock);
+    prune_stale(ceph::coarse_mono_clock::now());
+    all.reserve(daemons.size());
+    for (auto& [key, d] : daemons) {
+      all.push_back(d.samples);
+    }
+    headers = family_headers;
+  }
+
+  std::vector<std::string> bodies(headers.size());
+  for (auto& samples : all) {
+    for (auto& [family, lines] : *samples) {
+      bodies[family].append(lines);
+    }
+  }
+  for (size_t i = 0; i < headers.size(); ++i) {
+    if (!bodies[i].empty()) {
+      out->append(headers[i]);
+      out->append(bodies[i]);
+    }
+  }
+}
+
+int MetricsExporter::init()
+{
+  const auto port = cct->_conf.get_val<uint64_t>("mgr_metrics_exporter_port");
+  if (port == 0) {
+    return 0;
+  }
+  const auto addr_str =
+    cct->_conf.get_val<std::string>("mgr_metrics_exporter_addr");
+  entity_addr_t addr;
+  if (!addr.parse(addr_str)) {
+    derr << "unable to parse mgr_metrics_exporter_addr '" << addr_str
+	 << "'" << dendl;
+    return -EINVAL;
+  }
+  addr.set_port(port);
+
+  int fd = socket_cloexec(addr.get_family(), SOCK_STREAM, 0);
+  if (fd < 0) {
+    int r = -errno;
+    derr << "unable to create socket: " << cpp_strerror(r) << dendl;
+    return r;
+  }
+  int on = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if (addr.get_family() == AF_INET6) {
+    // take ipv4 scrapes too when bound to the ipv6 wildcard
+    int off = 0;
+    ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+  }
+  if (::bind(fd, addr.get_sockaddr(), addr.get_sockaddr_len()) < 0 ||
+      ::listen(fd, 16) < 0) {
+    int r = -errno;
+    derr << "unable to listen on " << addr << ": " << cpp_strerror(r) << dendl;
+    ::close(fd);
+    return r;
+  }
+  int pipefd[2];
+  if (pipe_cloexec(pipefd, O_NONBLOCK) < 0) {
+    int r = -errno;
+    derr << "unable to create wakeup pipe: " << cpp_strerror(r) << dendl;
+    ::close(fd);
+    return r;
+  }
+  listen_fd = fd;
+  wakeup_rd_fd = pipefd[0];
+  wakeup_wr_fd = pipefd[1];
+  dout(1) << "serving metrics on " << addr << dendl;
+  create("mgr-metrics");
+  return 0;
+}
+
+void MetricsExporter::shutdown()
+{
+  if (listen_fd < 0) {
+    return;
+  }
+  char buf[1] = { 0 };
+  int r = safe_write(wakeup_wr_fd, buf, sizeof(buf));
+  if (r < 0) {
+    derr << "unable to wake up the listener: " << cpp_strerror(r) << dendl;
+  }
+  join();
+  ::close(wakeup_wr_fd);
+  ::close(wakeup_rd_fd);
+  ::close(listen_fd);
+  wakeup_wr_fd = wakeup_rd_fd = listen_fd = -1;
+}
+
+void *MetricsExporter::entry()
+{
+  while (true) {
+    struct pollfd fds[2];
+    // FIPS zeroization audit 20191115: this memset is fine.
+    memset(fds, 0, sizeof(fds));
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeup_rd_fd;
+    fds[1].events = POLLIN;
+    int r = ::poll(fds, 2, -1);
+    if (r < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      derr << "poll(2) error: " << cpp_strerror(errno) << dendl;
+      break;
+    }
+    if (fds[1].revents & POLLIN) {
+      break;
+    }
+    if (fds[0].revents & POLLIN) {
+      int fd = accept_cloexec(listen_fd, nullptr, nullptr);
+      if (fd < 0) {
+	dout(1) << "accept(2) error: " << cpp_strerror(errno) << dendl;
+	continue;
+      }
+      handle_client(fd);
+      ::close(fd);
+    }
+  }
+  return nullptr;
+}
+
+void MetricsExporter::handle_client(int fd)
+{
+  // a stuck client must not hold up the next scrape for long
+  struct timeval tv = { 5, 0 };
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  std::string request;
+  char buf[1024];
+  while (request.find("\r\n\r\n") == std::string::npos) {
+    if (request.size() > 8192) {
+      return;
+    }
+    ssize_t r = ::recv(fd, buf, sizeof(buf), 0);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r <= 0) {
+      return;
+    }
+    request.append(buf, r);
+  }
+
+  std::string status = "200 OK";
+  std::string body;
+  const auto line = request.substr(0, request.find("\r\n"));
+  if (line.compare(0, 4, "GET ") != 0) {
+    status = "405 Method Not Allowed";
+  } else {
+    const auto path = line.substr(4, line.find(' ', 4) - 4);
+    if (path == "/metrics" || path == "/") {
+      auto start = ceph::mono_clock::now();
+      dump(&body);
+      dout(10) << "served " << body.size() << " bytes in "
+	       << ceph::mono_clock::now() - start << dendl;
+    } else {
+      status = "404 Not Found";
+    }
+  }
+  const std::string header =
+    "HTTP/1.1 " + status + "\r\n"
+    "Content-Type: text/plain; version=0.0.4\r\n"
+    "Content-Length: " + std::to_string(body.size()) + "\r\n"
+    "Connection: close\r\n\r\n";
+  if (send_all(fd, header.data(), header.size())) {
+    send_all(fd, body.data(), body.size());
+  }
+}
@@ -0,0 +1,90 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_MGR_METRICS_EXPORTER_H
+#define CEPH_MGR_METRICS_EXPORTER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "common/Thread.h"
+#include "mgr/DaemonKey.h"
+#include "mgr/DaemonState.h"
+
+/**
+ * Serve daemon perf counters in the Prometheus text exposition format
+ * straight from ceph-mgr, without walking them through a python module.
+ *
+ * Every report re-renders the samples of the daemon that sent it, so a
+ * scrape only concatenates text that is already formatted.  Samples are
+ * kept per metric family and a scrape groups each family in one block,
+ * as the format requires.  Names, labels and units match what the
+ * prometheus module exports for the same counters, and so do the
+ * daemons exported (see get_all_perf_counters() in mgr_module.py):
+ * mds, mon, osd, rbd-mirror, rgw and tcmu-runner.  The per-image
+ * counters of rbd-mirror are exported under a shared name with pool,
+ * namespace and image labels, as by _perfpath_to_path_labels().
+ *
+ * The HTTP listener is a single thread serving one scrape at a time; it
+ * is only started if mgr_metrics_exporter_port is set.
+ */
+class MetricsExporter : public Thread {
+public:
+  explicit MetricsExporter(CephContext *cct) : cct(cct) {}
+  ~MetricsExporter() override;
+
+  /// listen on mgr_metrics_exporter_addr:mgr_metrics_exporter_port, if set
+  int init();
+  void shutdown();
+
+  /**
+   * Re-render the samples of one daemon; call with its DaemonState
+   * locked.  Does nothing unless the exporter is serving.
+   */
+  void update(const DaemonKey& key, const DaemonPerfCounters& counters);
+  void remove(const DaemonKey& key);
+
+  /// append the current exposition text to out
+  void dump(std::string *out);
+
+  /// the metric name the prometheus module uses for a counter path
+  static std::string metric_name(const std::string& path);
+  /**
+   * The counter path and labels the prometheus module uses for a counter
+   * of @daemon; the labels are rendered as {ceph_daemon="...",...}.
+   */
+  static void path_labels(const std::string& daemon, const std::string& path,
+			  std::string *out_path, std::string *labels);
+
+private:
+  /// (family index, sample lines) pairs for one daemon
+  using samples_t = std::vector<std::pair<size_t, std::string>>;
+  struct daemon_samples_t {
+    ceph::coarse_mono_time stamp;
+    std::shared_ptr<const samples_t> samples;
+  };
+
+  void *entry() override;
+  void handle_client(int fd);
+  /// drop daemons that stopped reporting; call with lock held
+  void prune_stale(ceph::coarse_mono_time now);
+
+  CephContext *cct;
+
+  ceph::mutex lock = ceph::make_mutex("MetricsExporter::lock");
+  std::map<std::string, size_t> family_index;  ///< metric name -> index
+  std::vector<std::string> family_headers;     ///< HELP and TYPE lines
+  std::map<DaemonKey, daemon_samples_t> daemons;
+  ceph::coarse_mono_time last_prune;
+
+  int listen_fd = -1;
+  int wakeup_rd_fd = -1;
+  int wakeup_wr_fd = -1;
+};
+
+#endif
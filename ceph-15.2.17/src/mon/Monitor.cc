@@ -714,6 +714,16 @@ int Monitor::preinit()
         "ewon", PerfCountersBuilder::PRIO_INTERESTING);
     pcb.add_u64_counter(l_mon_election_lose, "election_lose", "Elections lost",
         "elst", PerfCountersBuilder::PRIO_INTERESTING);
+    pcb.add_u64_counter(l_mon_osdmap_sent, "osdmap_sent",
+        "OSDMaps (full and incremental) sent", "osdm",
+        PerfCountersBuilder::PRIO_USEFUL);
+    pcb.add_u64_counter(l_mon_osdmap_sent_bytes, "osdmap_sent_bytes",
+        "Size of OSDMaps sent, as sent", "osmb",
+        PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
+    pcb.add_u64_counter(l_mon_osdmap_compress_saved_bytes,
+        "osdmap_compress_saved_bytes",
+        "Bytes saved by sending compressed OSDMaps", NULL,
+        PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
     logger = pcb.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
   }
@@ -4136,7 +4146,8 @@ void Monitor::handle_route(MonOpRequestRef op)
   if (m->send_osdmap_first) {
     dout(10) << " sending osdmaps from " << m->send_osdmap_first << dendl;
     osdmon()->send_incremental(m->send_osdmap_first, rr->session,
-			       true, MonOpRequestRef());
+			       true, rr->session->osdmap_compressed,
+			       MonOpRequestRef());
   }
   ceph_assert(rr->tid == m->session_mon_tid && rr->session->routed_request_tids.count(m->session_mon_tid));
   routed_requests.erase(found);
@@ -5136,7 +5147,8 @@ void Monitor::handle_subscribe(MonOpRequestRef op)
       std::lock_guard l(session_map_lock);
       session_map.add_update_sub(s, p->first, p->second.start,
 				 p->second.flags & CEPH_SUBSCRIBE_ONETIME,
-				 m->get_connection()->has_feature(CEPH_FEATURE_INCSUBOSDMAP));
+				 m->get_connection()->has_feature(CEPH_FEATURE_INCSUBOSDMAP),
+				 p->second.flags & CEPH_SUBSCRIBE_COMPRESSED);
     }
 
     if (p->first.compare(0, 6, "mdsmap") == 0 || p->first.compare(0, 5, "fsmap") == 0) {
@@ -5152,6 +5164,9 @@ void Monitor::handle_subscribe(MonOpRequestRef op)
 	  // client needs earlier osdmaps on purpose, so reset the sent epoch
 	  s->osd_epoch = 0;
 	}
+	if (p->second.flags & CEPH_SUBSCRIBE_COMPRESSED) {
+	  s->osdmap_compressed = true;
+	}
         osdmon()->check_osdmap_sub(s->sub_map["osdmap"]);
       }
     } else if (p->first == "osd_pg_creates") {
@@ -95,6 +95,9 @@ enum {
   l_mon_election_call,
   l_mon_election_win,
   l_mon_election_lose,
+  l_mon_osdmap_sent,
+  l_mon_osdmap_sent_bytes,
+  l_mon_osdmap_compress_saved_bytes,
   l_mon_last,
 };
 
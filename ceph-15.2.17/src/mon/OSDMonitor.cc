@@ -431,6 +431,8 @@ OSDMonitor::OSDMonitor(
    cct(cct),
    inc_osd_cache(g_conf()->mon_osd_cache_size),
    full_osd_cache(g_conf()->mon_osd_cache_size),
+   compressed_inc_osd_cache(g_conf()->mon_osd_cache_size),
+   compressed_full_osd_cache(g_conf()->mon_osd_cache_size),
    has_osdmap_manifest(false),
    mapper(mn->cct, &mn->cpu_tp)
 {
@@ -579,8 +581,7 @@ int OSDMonitor::_set_cache_sizes()
       return -EINVAL;
     }
     // Set the initial inc and full LRU cache sizes
-    inc_osd_cache.set_bytes(mon_memory_min);
-    full_osd_cache.set_bytes(mon_memory_min);
+    _set_osd_cache_bytes(mon_memory_min, mon_memory_min);
     mon_memory_autotune = g_conf()->mon_memory_autotune;
   }
   return 0;
@@ -2173,7 +2174,9 @@ void OSDMonitor::share_map_with_random_osd()
   uint64_t features = s->con_features ? s->con_features :
                                         mon->get_quorum_con_features();
   // whatev, they'll request more if they need it
-  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch(), features);
+  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch(), features,
+				 should_compress_osdmaps(s->osdmap_compressed));
+  note_osdmaps_sent(m);
   s->con->send_message(m);
   // NOTE: do *not* record osd has up to this epoch (as we do
   // elsewhere) as they may still need to request older values.
@@ -2757,6 +2760,8 @@ bool OSDMonitor::preprocess_get_osdmap(MonOpRequestRef op)
 
   dout(10) << __func__ << " " << *m << dendl;
   MOSDMap *reply = new MOSDMap(mon->monmap->fsid, features);
+  const bool compress = should_compress_osdmaps(
+    op->get_session() && op->get_session()->osdmap_compressed);
   epoch_t first = get_first_committed();
   epoch_t last = osdmap.get_epoch();
   int max = g_conf()->osd_map_message_max;
@@ -2764,21 +2769,25 @@ bool OSDMonitor::preprocess_get_osdmap(MonOpRequestRef op)
   for (epoch_t e = std::max(first, m->get_full_first());
        e <= std::min(last, m->get_full_last()) && max > 0 && max_bytes > 0;
        ++e, --max) {
-    bufferlist& bl = reply->maps[e];
-    int r = get_version_full(e, features, bl);
+    bufferlist& bl = compress ? reply->compressed_maps[e] : reply->maps[e];
+    int r = compress ? get_version_full_compressed(e, features, bl) :
+      get_version_full(e, features, bl);
     ceph_assert(r >= 0);
     max_bytes -= bl.length();
   }
   for (epoch_t e = std::max(first, m->get_inc_first());
        e <= std::min(last, m->get_inc_last()) && max > 0 && max_bytes > 0;
        ++e, --max) {
-    bufferlist& bl = reply->incremental_maps[e];
-    int r = get_version(e, features, bl);
+    bufferlist& bl = compress ? reply->compressed_incremental_maps[e] :
+      reply->incremental_maps[e];
+    int r = compress ? get_version_compressed(e, features, bl) :
+      get_version(e, features, bl);
     ceph_assert(r >= 0);
     max_bytes -= bl.length();
   }
   reply->oldest_map = first;
   reply->newest_map = last;
+  note_osdmaps_sent(reply);
   mon->send_reply(op, reply);
   return true;
 }
@@ -3133,6 +3142,11 @@ utime_t OSDMonitor::get_grace_time(utime_t now,
 				   failure_info_t& fi) const
 {
   utime_t orig_grace(g_conf()->osd_heartbeat_grace, 0);
+  if (fi.confirmed) {
+    // the peers have agreed on it already, after their own grace
+    orig_grace.set_from_double(
+      g_conf().get_val<double>("osd_heartbeat_gossip_grace"));
+  }
   if (!g_conf()->mon_osd_adjust_heartbeat_grace) {
     return orig_grace;
   }
@@ -3208,7 +3222,7 @@ bool OSDMonitor::check_failure(utime_t now, int target_osd, failure_info_t& fi)
     return false;
   }
   const utime_t failed_for = now - fi.get_failed_since();
-  const utime_t grace = get_grace_time(now, target_osd, fi);
+  utime_t grace = get_grace_time(now, target_osd, fi);
   if (failed_for >= grace) {
     dout(1) << " we have enough reporters to mark osd." << target_osd
 	    << " down" << dendl;
@@ -3295,6 +3309,15 @@ bool OSDMonitor::prepare_failure(MonOpRequestRef op)
 
     failure_info_t& fi = failure_info[target_osd];
     fi.add_report(reporter, failed_since, op);
+    // the peers that gossiped the same failure to the reporter count as
+    // reporters too, unless they have reported it themselves
+    for (auto peer : m->confirmed_by) {
+      if (peer != reporter && peer != target_osd && osdmap.is_up(peer) &&
+	  !fi.reporters.count(peer)) {
+	fi.add_report(peer, failed_since, MonOpRequestRef());
+	fi.confirmed = true;
+      }
+    }
     return check_failure(now, target_osd, fi);
   } else {
     // remove the report
@@ -3304,6 +3327,14 @@ bool OSDMonitor::prepare_failure(MonOpRequestRef op)
     if (failure_info.count(target_osd)) {
       failure_info_t& fi = failure_info[target_osd];
       fi.cancel_report(reporter);
+      for (auto peer : m->confirmed_by) {
+	if (fi.reporters.count(peer) && !fi.reporters[peer].op) {
+	  fi.cancel_report(peer);
+	}
+      }
+      if (!m->confirmed_by.empty()) {
+	fi.confirmed = false;
+      }
       if (fi.reporters.empty()) {
 	dout(10) << " removing last failure_info for osd." << target_osd
 		 << dendl;
@@ -4366,41 +4397,53 @@ void OSDMonitor::send_latest(MonOpRequestRef op, epoch_t start)
 }
 
 
-MOSDMap *OSDMonitor::build_latest_full(uint64_t features)
+MOSDMap *OSDMonitor::build_latest_full(uint64_t features, bool compress)
 {
   MOSDMap *r = new MOSDMap(mon->monmap->fsid, features);
-  get_version_full(osdmap.get_epoch(), features, r->maps[osdmap.get_epoch()]);
+  if (compress) {
+    get_version_full_compressed(osdmap.get_epoch(), features,
+				r->compressed_maps[osdmap.get_epoch()]);
+  } else {
+    get_version_full(osdmap.get_epoch(), features, r->maps[osdmap.get_epoch()]);
+  }
   r->oldest_map = get_first_committed();
   r->newest_map = osdmap.get_epoch();
   return r;
 }
 
-MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to, uint64_t features)
+MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to, uint64_t features,
+				       bool compress)
 {
   dout(10) << "build_incremental [" << from << ".." << to << "] with features "
-	   << std::hex << features << std::dec << dendl;
+	   << std::hex << features << std::dec
+	   << (compress ? " compressed" : "") << dendl;
   MOSDMap *m = new MOSDMap(mon->monmap->fsid, features);
   m->oldest_map = get_first_committed();
   m->newest_map = osdmap.get_epoch();
 
   for (epoch_t e = to; e >= from && e > 0; e--) {
     bufferlist bl;
-    int err = get_version(e, features, bl);
+    int err = compress ? get_version_compressed(e, features, bl) :
+      get_version(e, features, bl);
     if (err == 0) {
       ceph_assert(bl.length());
       // if (get_version(e, bl) > 0) {
       dout(20) << "build_incremental    inc " << e << " "
 	       << bl.length() << " bytes" << dendl;
-      m->incremental_maps[e] = bl;
+      (compress ? m->compressed_incremental_maps : m->incremental_maps)[e] = bl;
     } else {
       ceph_assert(err == -ENOENT);
       ceph_assert(!bl.length());
-      get_version_full(e, features, bl);
+      if (compress) {
+	get_version_full_compressed(e, features, bl);
+      } else {
+	get_version_full(e, features, bl);
+      }
       if (bl.length() > 0) {
       //else if (get_version("full", e, bl) > 0) {
       dout(20) << "build_incremental   full " << e << " "
 	       << bl.length() << " bytes" << dendl;
-      m->maps[e] = bl;
+      (compress ? m->compressed_maps : m->maps)[e] = bl;
       } else {
 	ceph_abort();  // we should have all maps.
       }
@@ -4413,7 +4456,57 @@ void OSDMonitor::send_full(MonOpRequestRef op)
 {
   op->mark_osdmon_event(__func__);
   dout(5) << "send_full to " << op->get_req()->get_orig_source_inst() << dendl;
-  mon->send_reply(op, build_latest_full(op->get_session()->con_features));
+  MOSDMap *m = build_latest_full(op->get_session()->con_features,
+				 should_compress_osdmaps(op->get_session()->osdmap_compressed));
+  note_osdmaps_sent(m);
+  mon->send_reply(op, m);
+}
+
+bool OSDMonitor::should_compress_osdmaps(bool wants)
+{
+  auto alg = g_conf().get_val<std::string>("mon_osdmap_compression");
+  if (alg != osdmap_compression) {
+    dout(10) << __func__ << " compressing osdmaps with " << alg << dendl;
+    osdmap_compression = alg;
+    osdmap_compressor = alg == "none" ? nullptr : Compressor::create(cct, alg);
+    if (alg != "none" && !osdmap_compressor) {
+      derr << __func__ << " unable to load compressor " << alg << dendl;
+    }
+    if (!osdmap_compressor) {
+      // give the compressed maps' share back to the plain ones
+      _use_compressed_osd_cache(false);
+    }
+  }
+  return wants && osdmap_compressor != nullptr;
+}
+
+void OSDMonitor::note_osdmaps_sent(const MOSDMap *m)
+{
+  uint64_t num = 0, bytes = 0, saved = 0;
+  for (auto maps : {&m->maps, &m->incremental_maps}) {
+    for (auto& [e, bl] : *maps) {
+      ++num;
+      bytes += bl.length();
+    }
+  }
+  for (auto maps : {&m->compressed_maps, &m->compressed_incremental_maps}) {
+    for (auto& [e, bl] : *maps) {
+      ++num;
+      bytes += bl.length();
+      // the uncompressed length follows the algorithm
+      auto p = bl.cbegin();
+      uint8_t alg;
+      uint32_t len;
+      decode(alg, p);
+      decode(len, p);
+      if (len > bl.length()) {
+	saved += len - bl.length();
+      }
+    }
+  }
+  mon->logger->inc(l_mon_osdmap_sent, num);
+  mon->logger->inc(l_mon_osdmap_sent_bytes, bytes);
+  mon->logger->inc(l_mon_osdmap_compress_saved_bytes, saved);
 }
 
 void OSDMonitor::send_incremental(MonOpRequestRef op, epoch_t first)
@@ -4433,13 +4526,14 @@ void OSDMonitor::send_incremental(MonOpRequestRef op, epoch_t first)
     op->mark_event("reply: send routed send_osdmap_first reply");
   } else {
     // do it ourselves
-    send_incremental(first, s, false, op);
+    send_incremental(first, s, false, s->osdmap_compressed, op);
   }
 }
 
 void OSDMonitor::send_incremental(epoch_t first,
 				  MonSession *session,
 				  bool onetime,
+				  bool compressed,
 				  MonOpRequestRef req)
 {
   dout(5) << "send_incremental [" << first << ".." << osdmap.get_epoch() << "]"
@@ -4456,6 +4550,8 @@ void OSDMonitor::send_incremental(epoch_t first,
     first = session->osd_epoch + 1;
   }
 
+  const bool compress = should_compress_osdmaps(compressed);
+
   if (first < get_first_committed()) {
     MOSDMap *m = new MOSDMap(osdmap.get_fsid(), features);
     m->oldest_map = get_first_committed();
@@ -4463,12 +4559,14 @@ void OSDMonitor::send_incremental(epoch_t first,
 
     first = get_first_committed();
     bufferlist bl;
-    int err = get_version_full(first, features, bl);
+    int err = compress ? get_version_full_compressed(first, features, bl) :
+      get_version_full(first, features, bl);
     ceph_assert(err == 0);
     ceph_assert(bl.length());
     dout(20) << "send_incremental starting with base full "
 	     << first << " " << bl.length() << " bytes" << dendl;
-    m->maps[first] = bl;
+    (compress ? m->compressed_maps : m->maps)[first] = bl;
+    note_osdmaps_sent(m);
 
     if (req) {
       mon->send_reply(req, m);
@@ -4484,7 +4582,8 @@ void OSDMonitor::send_incremental(epoch_t first,
   while (first <= osdmap.get_epoch()) {
     epoch_t last = std::min<epoch_t>(first + g_conf()->osd_map_message_max - 1,
 				     osdmap.get_epoch());
-    MOSDMap *m = build_incremental(first, last, features);
+    MOSDMap *m = build_incremental(first, last, features, compress);
+    note_osdmaps_sent(m);
 
     if (req) {
       // send some maps.  it may not be all of them, but it will get them
@@ -4568,6 +4667,25 @@ int OSDMonitor::get_version(version_t ver, uint64_t features, bufferlist& bl)
   return 0;
 }
 
+int OSDMonitor::get_version_compressed(version_t ver, uint64_t features,
+					bufferlist& bl)
+{
+  compressed_osdmap_key_t key{ver, OSDMap::get_significant_features(features),
+			      static_cast<int>(osdmap_compressor->get_type())};
+  if (compressed_inc_osd_cache.lookup(key, &bl)) {
+    return 0;
+  }
+  _use_compressed_osd_cache(true);
+  bufferlist raw;
+  int ret = get_version(ver, features, raw);
+  if (ret < 0) {
+    return ret;
+  }
+  MOSDMap::compress_map(osdmap_compressor, raw, bl);
+  compressed_inc_osd_cache.add_bytes(key, bl);
+  return 0;
+}
+
 int OSDMonitor::get_inc(version_t ver, OSDMap::Incremental& inc)
 {
   bufferlist inc_bl;
@@ -4717,6 +4835,25 @@ int OSDMonitor::get_version_full(version_t ver, uint64_t features,
   return 0;
 }
 
+int OSDMonitor::get_version_full_compressed(version_t ver, uint64_t features,
+					     bufferlist& bl)
+{
+  compressed_osdmap_key_t key{ver, OSDMap::get_significant_features(features),
+			      static_cast<int>(osdmap_compressor->get_type())};
+  if (compressed_full_osd_cache.lookup(key, &bl)) {
+    return 0;
+  }
+  _use_compressed_osd_cache(true);
+  bufferlist raw;
+  int ret = get_version_full(ver, features, raw);
+  if (ret < 0) {
+    return ret;
+  }
+  MOSDMap::compress_map(osdmap_compressor, raw, bl);
+  compressed_full_osd_cache.add_bytes(key, bl);
+  return 0;
+}
+
 epoch_t OSDMonitor::blacklist(const entity_addrvec_t& av, utime_t until)
 {
   dout(10) << "blacklist " << av << " until " << until << dendl;
@@ -4767,10 +4904,15 @@ void OSDMonitor::check_osdmap_sub(Subscription *sub)
   dout(10) << __func__ << " " << sub << " next " << sub->next
 	   << (sub->onetime ? " (onetime)":" (ongoing)") << dendl;
   if (sub->next <= osdmap.get_epoch()) {
-    if (sub->next >= 1)
-      send_incremental(sub->next, sub->session, sub->incremental_onetime);
-    else
-      sub->session->con->send_message(build_latest_full(sub->session->con_features));
+    if (sub->next >= 1) {
+      send_incremental(sub->next, sub->session, sub->incremental_onetime,
+		       sub->compressed);
+    } else {
+      MOSDMap *m = build_latest_full(sub->session->con_features,
+				     should_compress_osdmaps(sub->compressed));
+      note_osdmaps_sent(m);
+      sub->session->con->send_message(m);
+    }
     if (sub->onetime)
       mon->session_map.remove_sub(sub);
     else
@@ -5194,8 +5336,7 @@ void OSDMonitor::_set_new_cache_sizes()
     kv_alloc = rocksdb_binned_kv_cache->get_committed_size();
   }
 
-  inc_osd_cache.set_bytes(inc_alloc);
-  full_osd_cache.set_bytes(full_alloc);
+  _set_osd_cache_bytes(inc_alloc, full_alloc);
 
   dout(1) << __func__ << " cache_size:" << cache_size
            << " inc_alloc: " << inc_alloc
@@ -5204,6 +5345,30 @@ void OSDMonitor::_set_new_cache_sizes()
            << dendl;
 }
 
+void OSDMonitor::_set_osd_cache_bytes(int64_t inc_bytes, int64_t full_bytes)
+{
+  osd_cache_inc_bytes = inc_bytes;
+  osd_cache_full_bytes = full_bytes;
+  // the compressed maps get half of the budgets, but only once an OSD
+  // was sent one
+  int64_t compressed_inc = compressed_osd_cache_used ? inc_bytes / 2 : 0;
+  int64_t compressed_full = compressed_osd_cache_used ? full_bytes / 2 : 0;
+  inc_osd_cache.set_bytes(inc_bytes - compressed_inc);
+  full_osd_cache.set_bytes(full_bytes - compressed_full);
+  compressed_inc_osd_cache.set_bytes(compressed_inc);
+  compressed_full_osd_cache.set_bytes(compressed_full);
+}
+
+void OSDMonitor::_use_compressed_osd_cache(bool used)
+{
+  if (compressed_osd_cache_used == used) {
+    return;
+  }
+  dout(10) << __func__ << " " << used << dendl;
+  compressed_osd_cache_used = used;
+  _set_osd_cache_bytes(osd_cache_inc_bytes, osd_cache_full_bytes);
+}
+
 bool OSDMonitor::handle_osd_timeouts(const utime_t &now,
 				     std::map<int,utime_t> &last_osd_report)
 {
@@ -28,6 +28,7 @@
 #include "include/encoding.h"
 #include "common/simple_cache.hpp"
 #include "common/PriorityCache.h"
+#include "compressor/Compressor.h"
 #include "msg/Messenger.h"
 
 #include "osd/OSDMap.h"
@@ -62,6 +63,7 @@ struct failure_reporter_t {
 struct failure_info_t {
   map<int, failure_reporter_t> reporters;  ///< reporter -> failed_since etc
   utime_t max_failed_since;                ///< most recent failed_since
+  bool confirmed = false;  ///< reported on behalf of peers agreeing on it
 
   failure_info_t() {}
 
@@ -234,6 +236,18 @@ public:
                                    boost::hash<osdmap_key_t>>;
   osdmap_cache_t inc_osd_cache;
   osdmap_cache_t full_osd_cache;
+  // the same maps in the form MOSDMap::compress_map() builds, also keyed
+  // by the compression algorithm; once in use, they take a share of the
+  // budgets of the caches above, see _set_osd_cache_bytes()
+  using compressed_osdmap_key_t = std::tuple<version_t, uint64_t, int>;
+  using compressed_osdmap_cache_t = SimpleLRU<compressed_osdmap_key_t,
+                                              bufferlist,
+                                              std::less<compressed_osdmap_key_t>,
+                                              boost::hash<compressed_osdmap_key_t>>;
+  compressed_osdmap_cache_t compressed_inc_osd_cache;
+  compressed_osdmap_cache_t compressed_full_osd_cache;
+  std::string osdmap_compression;   ///< mon_osdmap_compression we last saw
+  CompressorRef osdmap_compressor;  ///< null if we do not compress
 
   bool has_osdmap_manifest;
   osdmap_manifest_t osdmap_manifest;
@@ -320,10 +334,15 @@ private:
   uint64_t mon_memory_target = 0;   ///< Mon target memory for cache autotuning
   uint64_t mon_memory_min = 0;      ///< Min memory to cache osdmaps
   bool mon_memory_autotune = false; ///< Cache auto tune setting
+  int64_t osd_cache_inc_bytes = 0;  ///< Bytes for inc osdmaps, plain and compressed
+  int64_t osd_cache_full_bytes = 0; ///< Bytes for full osdmaps, plain and compressed
+  bool compressed_osd_cache_used = false; ///< a compressed map was sent
   int register_cache_with_pcm();
   int _set_cache_sizes();
   int _set_cache_ratios();
   void _set_new_cache_sizes();
+  void _set_osd_cache_bytes(int64_t inc_bytes, int64_t full_bytes);
+  void _use_compressed_osd_cache(bool used);
   void _set_cache_autotuning();
   int _update_mon_cache_settings();
 
@@ -405,14 +424,21 @@ private:
   bool can_mark_in(int o);
 
   // ...
-  MOSDMap *build_latest_full(uint64_t features);
-  MOSDMap *build_incremental(epoch_t first, epoch_t last, uint64_t features);
+  MOSDMap *build_latest_full(uint64_t features, bool compress = false);
+  MOSDMap *build_incremental(epoch_t first, epoch_t last, uint64_t features,
+			     bool compress = false);
+  /// whether to send compressed maps to a client that @p wants them
+  bool should_compress_osdmaps(bool wants);
+  /// account for the maps in @p m in the mon perf counters
+  void note_osdmaps_sent(const MOSDMap *m);
   void send_full(MonOpRequestRef op);
   void send_incremental(MonOpRequestRef op, epoch_t first);
 public:
   // @param req an optional op request, if the osdmaps are replies to it. so
   //            @c Monitor::send_reply() can mark_event with it.
+  // @param compressed send compressed maps, if we compress them at all
   void send_incremental(epoch_t first, MonSession *session, bool onetime,
+			bool compressed,
 			MonOpRequestRef req = MonOpRequestRef());
 
 private:
@@ -744,6 +770,10 @@ public:
   int get_version_full(version_t ver, bufferlist& bl) override;
   int get_inc(version_t ver, OSDMap::Incremental& inc);
   int get_full_from_pinned_map(version_t ver, bufferlist& bl);
+  /// get_version() and get_version_full(), compressed
+  int get_version_compressed(version_t ver, uint64_t features, bufferlist& bl);
+  int get_version_full_compressed(version_t ver, uint64_t features,
+				  bufferlist& bl);
 
   epoch_t blacklist(const entity_addrvec_t& av, utime_t until);
   epoch_t blacklist(entity_addr_t a, utime_t until);
@@ -1,6 +1,11 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
 #include <boost/algorithm/string.hpp>
 
 #include "PGMap.h"
@@ -9,6 +14,7 @@
 #include "common/debug.h"
 #include "common/Clock.h"
 #include "common/Formatter.h"
+#include "common/Thread.h"
 #include "global/global_context.h"
 #include "include/ceph_features.h"
 #include "include/stringify.h"
@@ -1156,24 +1162,34 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
   mempool::pgmap::unordered_map<int32_t, pool_stat_t> pg_pool_sum_old;
   pg_pool_sum_old = pg_pool_sum;
 
-  for (auto p = inc.pg_stat_updates.begin();
-       p != inc.pg_stat_updates.end();
-       ++p) {
-    const pg_t &update_pg(p->first);
-    auto update_pool = update_pg.pool();
-    const pg_stat_t &update_stat(p->second);
-
-    auto pg_stat_iter = pg_stat.find(update_pg);
-    pool_stat_t &pool_sum_ref = pg_pool_sum[update_pool];
-    if (pg_stat_iter == pg_stat.end()) {
-      pg_stat.insert(make_pair(update_pg, update_stat));
-    } else {
-      stat_pg_sub(update_pg, pg_stat_iter->second);
-      pool_sum_ref.sub(pg_stat_iter->second);
-      pg_stat_iter->second = update_stat;
+  const uint64_t threads = cct ?
+    cct->_conf.get_val<uint64_t>("mgr_pgmap_apply_threads") : 1;
+  if (threads > 1 &&
+      inc.pg_stat_updates.size() >=
+        cct->_conf.get_val<uint64_t>("mgr_pgmap_apply_parallel_min")) {
+    apply_pg_stat_updates_parallel(inc, threads);
+  } else {
+    for (auto p = inc.pg_stat_updates.begin();
+	 p != inc.pg_stat_updates.end();
+	 ++p) {
+      const pg_t &update_pg(p->first);
+      auto update_pool = update_pg.pool();
+      const pg_stat_t &update_stat(p->second);
+
+      auto pg_stat_iter = pg_stat.find(update_pg);
+      pool_stat_t &pool_sum_ref = pg_pool_sum[update_pool];
+      if (pg_stat_iter == pg_stat.end()) {
+	pg_stat.insert(make_pair(update_pg, update_stat));
+      } else {
+	stat_pg_sub(update_pg, pg_stat_iter->second);
+	pg_sum.sub(pg_stat_iter->second);
+	pool_sum_ref.sub(pg_stat_iter->second);
+	pg_stat_iter->second = update_stat;
+      }
+      stat_pg_add(update_pg, update_stat);
+      pg_sum.add(update_stat);
+      pool_sum_ref.add(update_stat);
     }
-    stat_pg_add(update_pg, update_stat);
-    pool_sum_ref.add(update_stat);
   }
 
   for (auto p = inc.pool_statfs_updates.begin();
@@ -1221,6 +1237,7 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     bool pool_erased = false;
     if (s != pg_stat.end()) {
       pool_erased = stat_pg_sub(removed_pg, s->second);
+      pg_sum.sub(s->second);
 
       // decrease pool stats if pg was removed
       auto pool_stats_it = pg_pool_sum.find(removed_pg.pool());
@@ -1286,6 +1303,236 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     last_pg_scan = inc.pg_scan;
 }
 
+namespace {
+// fold a delta built with pool_stat_t::add/sub(pg_stat_t) into a sum
+void add_pg_stat_delta(pool_stat_t& sum, const pool_stat_t& d)
+{
+  sum.stats.add(d.stats);
+  sum.log_size += d.log_size;
+  sum.ondisk_log_size += d.ondisk_log_size;
+  sum.up += d.up;
+  sum.acting += d.acting;
+}
+
+// the threads apply_pg_stat_updates_parallel() hands its shards to.  They
+// are started the first time they are needed and kept for the life of the
+// process, as an update is applied every few seconds.
+class PGStatApplyPool {
+  std::mutex run_lock;	// one update at a time
+  std::mutex lock;
+  std::condition_variable cond;
+  std::condition_variable done_cond;
+  std::vector<std::thread> threads;
+  const std::function<void(uint64_t)> *job = nullptr;
+  uint64_t num_shards = 0;
+  uint64_t next_shard = 0;
+  uint64_t running = 0;
+  bool stopping = false;
+
+  void worker() {
+    std::unique_lock l(lock);
+    while (true) {
+      cond.wait(l, [this] {
+	return stopping || (job && next_shard < num_shards);
+      });
+      if (stopping) {
+	return;
+      }
+      run_shards(l);
+    }
+  }
+
+  // take shards until there are none left; called with lock held
+  void run_shards(std::unique_lock<std::mutex>& l) {
+    auto f = job;
+    while (next_shard < num_shards) {
+      uint64_t shard = next_shard++;
+      ++running;
+      l.unlock();
+      (*f)(shard);
+      l.lock();
+      if (--running == 0 && next_shard == num_shards) {
+	done_cond.notify_all();
+      }
+    }
+  }
+
+public:
+  ~PGStatApplyPool() {
+    {
+      std::lock_guard l(lock);
+      stopping = true;
+    }
+    cond.notify_all();
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  // call f(0) .. f(shards - 1) on up to nthreads threads, the caller's
+  // included, and return once they all finished
+  void run(uint64_t shards, uint64_t nthreads,
+	   const std::function<void(uint64_t)>& f) {
+    std::lock_guard rl(run_lock);
+    std::unique_lock l(lock);
+    while (threads.size() + 1 < nthreads) {
+      threads.push_back(make_named_thread("pgmap_apply",
+					  &PGStatApplyPool::worker, this));
+    }
+    job = &f;
+    num_shards = shards;
+    next_shard = 0;
+    cond.notify_all();
+    run_shards(l);
+    done_cond.wait(l, [this] { return running == 0; });
+    job = nullptr;
+  }
+
+  static PGStatApplyPool& get() {
+    static PGStatApplyPool pool;
+    return pool;
+  }
+};
+
+// an update that moves a pg within the same osds, and neither into nor out
+// of creating_pgs, only changes counters stat_pg_add/sub keep by state,
+// which the shards can sum on their own
+bool is_state_only_update(const pg_stat_t& from, const pg_stat_t& to)
+{
+  auto creating = [](const pg_stat_t& s) {
+    return (s.state & PG_STATE_CREATING) && s.parent_split_bits == 0;
+  };
+  return !creating(from) && !creating(to) &&
+    from.acting == to.acting &&
+    from.up == to.up &&
+    from.up_primary == to.up_primary &&
+    from.blocked_by == to.blocked_by;
+}
+
+struct pg_state_delta_t {
+  map<int64_t, pool_stat_t> pool_stats;
+  map<uint64_t, int32_t> by_state;
+  map<std::pair<int64_t, uint64_t>, int32_t> by_pool_state;
+  int64_t active = 0;
+  int64_t unknown = 0;
+  // the updates left for the caller, which change the pg index
+  vector<decltype(PGMap::Incremental::pg_stat_updates)::const_iterator> rest;
+
+  void count(int64_t pool, const pg_stat_t& s, int32_t n) {
+    by_state[s.state] += n;
+    by_pool_state[{pool, s.state}] += n;
+    if (s.state & PG_STATE_ACTIVE) {
+      active += n;
+    }
+    if (s.state == 0) {
+      unknown += n;
+    }
+  }
+};
+} // anonymous namespace
+
+void PGMap::apply_pg_stat_updates_parallel(const Incremental& inc,
+					   uint64_t shards)
+{
+  // pg_stat_updates is ordered by pool, so contiguous ranges of it
+  // mostly touch one or two pools each
+  using iter_t = decltype(inc.pg_stat_updates)::const_iterator;
+  if (inc.pg_stat_updates.empty()) {
+    return;
+  }
+  const uint64_t nthreads = shards;
+  shards = std::min<uint64_t>(shards, inc.pg_stat_updates.size());
+  vector<iter_t> bounds;
+  const size_t per_shard = inc.pg_stat_updates.size() / shards;
+  size_t n = 0;
+  for (auto p = inc.pg_stat_updates.begin();
+       p != inc.pg_stat_updates.end();
+       ++p, ++n) {
+    if (n % per_shard == 0 && bounds.size() < shards) {
+      bounds.push_back(p);
+    }
+  }
+  bounds.push_back(inc.pg_stat_updates.end());
+
+  // the shards only look pgs up and overwrite the stats of the ones they
+  // own, so pg_stat itself does not change shape until they are done.
+  // Each sums the difference its range makes to every pool, and to the
+  // per-state counters for the pgs that stay where they are; whatever
+  // else changes is left for the stat_pg_sub/add() below.
+  vector<pg_state_delta_t> deltas(shards);
+  std::function<void(uint64_t)> apply_shard = [&](uint64_t i) {
+    auto& delta = deltas[i];
+    for (auto p = bounds[i]; p != bounds[i + 1]; ++p) {
+      auto pool = p->first.pool();
+      pool_stat_t& d = delta.pool_stats[pool];
+      auto q = pg_stat.find(p->first);
+      if (q != pg_stat.end()) {
+	d.sub(q->second);
+      }
+      d.add(p->second);
+      if (q != pg_stat.end() && is_state_only_update(q->second, p->second)) {
+	if (q->second.state != p->second.state) {
+	  delta.count(pool, q->second, -1);
+	  delta.count(pool, p->second, 1);
+	}
+	q->second = p->second;
+      } else {
+	delta.rest.push_back(p);
+      }
+    }
+  };
+  PGStatApplyPool::get().run(shards, nthreads, apply_shard);
+
+  for (auto& delta : deltas) {
+    for (auto p : delta.rest) {
+      auto q = pg_stat.find(p->first);
+      if (q == pg_stat.end()) {
+	pg_stat.insert(make_pair(p->first, p->second));
+      } else {
+	stat_pg_sub(p->first, q->second);
+	q->second = p->second;
+      }
+      stat_pg_add(p->first, p->second);
+    }
+  }
+  // sum the counters over the shards before folding them in, so that an
+  // entry is only dropped when its count is really down to zero
+  auto& total = deltas.front();
+  for (auto delta = deltas.begin() + 1; delta != deltas.end(); ++delta) {
+    for (auto& [state, d] : delta->by_state) {
+      total.by_state[state] += d;
+    }
+    for (auto& [ps, d] : delta->by_pool_state) {
+      total.by_pool_state[ps] += d;
+    }
+    total.active += delta->active;
+    total.unknown += delta->unknown;
+    for (auto& [pool, d] : delta->pool_stats) {
+      add_pg_stat_delta(total.pool_stats[pool], d);
+    }
+  }
+  for (auto& [state, d] : total.by_state) {
+    if (d != 0 && (num_pg_by_state[state] += d) == 0) {
+      num_pg_by_state.erase(state);
+    }
+  }
+  for (auto& [ps, d] : total.by_pool_state) {
+    if (d == 0) {
+      continue;
+    }
+    auto& by_state = num_pg_by_pool_state[ps.first];
+    if ((by_state[ps.second] += d) == 0) {
+      by_state.erase(ps.second);
+    }
+  }
+  num_pg_active += total.active;
+  num_pg_unknown += total.unknown;
+  for (auto& [pool, d] : total.pool_stats) {
+    add_pg_stat_delta(pg_pool_sum[pool], d);
+    add_pg_stat_delta(pg_sum, d);
+  }
+}
+
 void PGMap::calc_stats()
 {
   num_pg = 0;
@@ -1307,6 +1554,7 @@ void PGMap::calc_stats()
        ++p) {
     auto pg = p->first;
     stat_pg_add(pg, p->second);
+    pg_sum.add(p->second);
     pg_pool_sum[pg.pool()].add(p->second);
   }
   for (auto p = pool_statfs.begin();
@@ -1325,7 +1573,6 @@ void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s,
                         bool sameosds)
 {
   auto pool = pgid.pool();
-  pg_sum.add(s);
 
   num_pg++;
   num_pg_by_state[s.state]++;
@@ -1377,7 +1624,6 @@ bool PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
                         bool sameosds)
 {
   bool pool_erased = false;
-  pg_sum.sub(s);
 
   num_pg--;
   int end = --num_pg_by_state[s.state];
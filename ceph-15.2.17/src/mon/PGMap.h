@@ -419,7 +419,10 @@ public:
 
 
   void apply_incremental(CephContext *cct, const Incremental& inc);
+  /// apply inc.pg_stat_updates, summing pool stats on 'shards' threads
+  void apply_pg_stat_updates_parallel(const Incremental& inc, uint64_t shards);
   void calc_stats();
+  /// update pg counts and indexes; callers maintain pg_sum and pg_pool_sum
   void stat_pg_add(const pg_t &pgid, const pg_stat_t &s,
 		   bool sameosds=false);
   bool stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
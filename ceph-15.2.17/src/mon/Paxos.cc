@@ -81,6 +81,9 @@ void Paxos::init()
 
   dout(10) << "init" << dendl;
   ceph_assert(is_consistent());
+
+  // drop anything we accepted behind an uncommitted value before we died
+  clear_pipeline(0);
 }
 
 void Paxos::init_logger()
@@ -124,6 +127,8 @@ void Paxos::init_logger()
   pcb.add_u64_avg(l_paxos_share_state_bytes, "share_state_bytes", "Data in shared state", NULL, 0, unit_t(UNIT_BYTES));
   pcb.add_u64_counter(l_paxos_new_pn, "new_pn", "New proposal number queries");
   pcb.add_time_avg(l_paxos_new_pn_latency, "new_pn_latency", "New proposal number getting latency");
+  pcb.add_u64_counter(l_paxos_pipelined, "pipelined", "Begins while another proposal was in flight");
+  pcb.add_u64(l_paxos_pipeline_depth, "pipeline_depth", "Proposals in flight behind the committing one");
   logger = pcb.create_perf_counters();
   g_ceph_context->get_perfcounters_collection()->add(logger);
 }
@@ -403,6 +408,13 @@ bool Paxos::store_state(MMonPaxos *m)
 	     << last_committed << "]" << dendl;
     t->put(get_name(), "last_committed", last_committed);
 
+    // we accepted the next value too (it was pipelined behind this one);
+    // it is now the one a new leader has to learn about.
+    if (last_accepted > last_committed) {
+      t->put(get_name(), "pending_v", last_committed + 1);
+      t->put(get_name(), "pending_pn", accepted_pn);
+    }
+
     // we should apply the state here -- decode every single bufferlist in the
     // map and append the transactions to 't'.
     map<version_t,bufferlist>::iterator it;
@@ -701,6 +713,54 @@ void Paxos::begin(bufferlist& v)
       }});
 }
 
+void Paxos::begin_pipelined(bufferlist& value)
+{
+  ceph_assert(mon->is_leader());
+  ceph_assert(can_pipeline());
+
+  // the head is at last_committed+1, the rest follow it
+  version_t v = pipeline.next_version(last_committed);
+  dout(10) << __func__ << " " << v << " " << value.length() << " bytes, "
+	   << (1 + pipeline.size()) << " in flight" << dendl;
+
+  auto& pv = pipeline.add(v, mon->rank);
+  pv.value = value;
+  pv.finishers.swap(pending_finishers);
+
+  // unlike begin(), leave pending_v alone: it names the value at
+  // last_committed+1, the only one recovery looks at.
+  auto t(std::make_shared<MonitorDBStore::Transaction>());
+  t->put(get_name(), v, value);
+
+  logger->inc(l_paxos_begin);
+  logger->inc(l_paxos_pipelined);
+  logger->inc(l_paxos_begin_keys, t->get_keys());
+  logger->inc(l_paxos_begin_bytes, t->get_bytes());
+  logger->set(l_paxos_pipeline_depth, pipeline.size());
+
+  auto start = ceph::coarse_mono_clock::now();
+  get_store()->apply_transaction(t);
+  auto end = ceph::coarse_mono_clock::now();
+
+  logger->tinc(l_paxos_begin_latency, to_timespan(end - start));
+
+  for (auto p : mon->get_quorum()) {
+    if (p == mon->rank) continue;
+
+    dout(10) << " sending begin " << v << " to mon." << p << dendl;
+    MMonPaxos *begin = new MMonPaxos(mon->get_epoch(), MMonPaxos::OP_BEGIN,
+				     ceph_clock_now());
+    begin->values[v] = value;
+    begin->last_committed = last_committed;
+    begin->latest_version = v;
+    begin->pn = accepted_pn;
+
+    mon->send_mon_message(begin, p);
+  }
+  // the accept timeout of the head covers us too; once we get to the head
+  // advance_pipeline() sets our own.
+}
+
 // peon
 void Paxos::handle_begin(MonOpRequestRef op)
 {
@@ -716,6 +776,14 @@ void Paxos::handle_begin(MonOpRequestRef op)
   }
   ceph_assert(begin->pn == accepted_pn);
   ceph_assert(begin->last_committed == last_committed);
+
+  // a pipelined begin names its version; it follows the last one we
+  // accepted, which may not have committed yet.
+  version_t v = last_committed+1;
+  if (begin->latest_version) {
+    v = begin->latest_version;
+    ceph_assert(v == std::max(last_committed, last_accepted) + 1);
+  }
   
   ceph_assert(g_conf()->paxos_kill_at != 4);
 
@@ -726,16 +794,19 @@ void Paxos::handle_begin(MonOpRequestRef op)
   lease_expire = {};  // cancel lease
 
   // yes.
-  version_t v = last_committed+1;
   dout(10) << "accepting value for " << v << " pn " << accepted_pn << dendl;
   // store the accepted value onto our store. We will have to decode it and
   // apply its transaction once we receive permission to commit.
   auto t(std::make_shared<MonitorDBStore::Transaction>());
   t->put(get_name(), v, begin->values[v]);
 
-  // note which pn this pending value is for.
-  t->put(get_name(), "pending_v", v);
-  t->put(get_name(), "pending_pn", accepted_pn);
+  // note which pn this pending value is for.  a pipelined value becomes
+  // pending in store_state() once the values before it commit.
+  if (v == last_committed + 1) {
+    t->put(get_name(), "pending_v", v);
+    t->put(get_name(), "pending_pn", accepted_pn);
+  }
+  last_accepted = v;
 
   dout(30) << __func__ << " transaction dump:\n";
   JSONFormatter f(true);
@@ -758,6 +829,9 @@ void Paxos::handle_begin(MonOpRequestRef op)
 				    ceph_clock_now());
   accept->pn = accepted_pn;
   accept->last_committed = last_committed;
+  // tell the leader which value this is; this also lets it know we can
+  // handle pipelined begins
+  accept->latest_version = v;
   begin->get_connection()->send_message(accept);
 }
 
@@ -775,14 +849,35 @@ void Paxos::handle_accept(MonOpRequestRef op)
     op->mark_paxos_event("have higher pn, ignore");
     return;
   }
-  if (last_committed > 0 &&
+  if (version_t v = accept->latest_version; v) {
+    // the last_committed it reports may be what a pipelined head waits for
+    pipeline.note_peer(from, accept->last_committed);
+    if (v <= last_committed) {
+      dout(10) << " this is for committed " << v << ", ignoring" << dendl;
+      op->mark_paxos_event("old round, ignore");
+      maybe_commit_pipelined_head();
+      return;
+    }
+    if (v > last_committed + 1) {
+      // pipelined; committed in order once it reaches the head
+      if (!pipeline.accept(v, from)) {
+	dout(10) << " " << v << " is no longer in flight, ignoring" << dendl;
+      } else {
+	dout(10) << " now " << pipeline.get_accepted(v) << " have accepted "
+		 << v << dendl;
+      }
+      maybe_commit_pipelined_head();
+      return;
+    }
+  } else if (last_committed > 0 &&
       accept->last_committed < last_committed-1) {
     dout(10) << " this is from an old round, ignoring" << dendl;
     op->mark_paxos_event("old round, ignore");
     return;
+  } else {
+    ceph_assert(accept->last_committed == last_committed ||   // not committed
+	   accept->last_committed == last_committed-1);  // committed
   }
-  ceph_assert(accept->last_committed == last_committed ||   // not committed
-	 accept->last_committed == last_committed-1);  // committed
 
   ceph_assert(is_updating() || is_updating_previous());
   ceph_assert(accepted.count(from) == 0);
@@ -796,7 +891,7 @@ void Paxos::handle_accept(MonOpRequestRef op)
   // stale state.
   // FIXME: we can improve this with an additional lease revocation message
   // that doesn't block for the persist.
-  if (accepted == mon->get_quorum()) {
+  if (head_committable()) {
     // yay, commit!
     dout(10) << " got majority, committing, done with update" << dendl;
     op->mark_paxos_event("commit_start");
@@ -862,6 +957,7 @@ void Paxos::commit_start()
   logger->inc(l_paxos_commit_keys, t->get_keys());
   logger->inc(l_paxos_commit_bytes, t->get_bytes());
   commit_start_stamp = ceph_clock_now();
+  pipeline.head_committing();
 
   get_store()->queue_transaction(t, new C_Committed(this));
 
@@ -939,10 +1035,63 @@ void Paxos::commit_finish()
 
     ceph_assert(g_conf()->paxos_kill_at != 10);
 
-    finish_round();
+    if (!pipeline.empty()) {
+      advance_pipeline();
+    } else {
+      finish_round();
+    }
   }
 }
 
+void Paxos::advance_pipeline()
+{
+  ceph_assert(mon->is_leader());
+  ceph_assert(is_refresh());
+  ceph_assert(!pipeline.empty());
+
+  auto pv = pipeline.pop_head(last_committed);
+  dout(10) << __func__ << " " << (last_committed + 1) << " accepted by "
+	   << pv.accepted << ", " << pipeline.size() << " behind it" << dendl;
+
+  // commit_finish() just extended the lease, and we leave its timers
+  // running: the lease keeps reads going while the pipeline drains, and
+  // the Peons' lease acks tell us they committed the value before the head.
+
+  new_value.claim(pv.value);
+  accepted.swap(pv.accepted);
+  ceph_assert(committing_finishers.empty());
+  committing_finishers.swap(pv.finishers);
+  logger->set(l_paxos_pipeline_depth, pipeline.size());
+  state = STATE_UPDATING;
+
+  // we may never go active under a steady stream of proposals; retry
+  // whatever waits on us now.  they will wait again if need be.
+  finish_contexts(g_ceph_context, waiting_for_active);
+  finish_contexts(g_ceph_context, waiting_for_readable);
+  finish_contexts(g_ceph_context, waiting_for_writeable);
+
+  if (should_trim()) {
+    trim();
+  }
+
+  if (head_committable()) {
+    dout(10) << " already accepted by everyone, committing" << dendl;
+    commit_start();
+  } else {
+    accept_timeout_event = mon->timer.add_event_after(
+      g_conf()->mon_accept_timeout_factor * g_conf()->mon_lease,
+      new C_MonContext{mon, [this](int r) {
+	  if (r == -ECANCELED)
+	    return;
+	  accept_timeout();
+	}});
+  }
+
+  // a slot just freed up
+  if (pending_proposal && can_pipeline()) {
+    propose_pending();
+  }
+}
 
 void Paxos::handle_commit(MonOpRequestRef op)
 {
@@ -1002,7 +1151,12 @@ void Paxos::extend_lease()
 	}});
   }
 
-  // set renew event
+  // set renew event; while values are pipelined we extend the lease on
+  // every commit, with the previous renewal still pending
+  if (lease_renew_event) {
+    mon->timer.cancel_event(lease_renew_event);
+    lease_renew_event = 0;
+  }
   auto at = lease_expire;
   at -= ceph::make_timespan(g_conf()->mon_lease);
   at += ceph::make_timespan(g_conf()->mon_lease_renew_interval_factor *
@@ -1107,8 +1261,12 @@ void Paxos::handle_lease(MonOpRequestRef op)
 
   warn_on_future_time(lease->sent_timestamp, lease->get_source());
 
-  // extend lease
-  if (auto new_expire = lease->lease_timestamp.to_real_time();
+  // extend lease, unless we already accepted a later value: it may commit
+  // before we hear about it, so our copy is not safe to read.
+  if (last_accepted > last_committed) {
+    dout(10) << "handle_lease on " << lease->last_committed
+	     << " but accepted " << last_accepted << ", not extending" << dendl;
+  } else if (auto new_expire = lease->lease_timestamp.to_real_time();
       lease_expire < new_expire) {
     lease_expire = new_expire;
 
@@ -1119,7 +1277,7 @@ void Paxos::handle_lease(MonOpRequestRef op)
     }
   }
 
-  state = STATE_ACTIVE;
+  state = last_accepted > last_committed ? STATE_UPDATING : STATE_ACTIVE;
 
   dout(10) << "handle_lease on " << lease->last_committed
 	   << " now " << lease_expire << dendl;
@@ -1148,6 +1306,9 @@ void Paxos::handle_lease_ack(MonOpRequestRef op)
   auto ack = op->get_req<MMonPaxos>();
   int from = ack->get_source().num();
 
+  pipeline.note_lease_ack(from, ack->last_committed);
+  maybe_commit_pipelined_head();
+
   if (!lease_ack_timeout_event) {
     dout(10) << "handle_lease_ack from " << ack->get_source()
 	     << " -- stray (probably since revoked)" << dendl;
@@ -1185,7 +1346,8 @@ void Paxos::lease_ack_timeout()
 {
   dout(1) << "lease_ack_timeout -- calling new election" << dendl;
   ceph_assert(mon->is_leader());
-  ceph_assert(is_active());
+  // the lease is kept going while values are pipelined
+  ceph_assert(is_active() || is_updating() || is_writing() || is_refresh());
   logger->inc(l_paxos_lease_ack_timeout);
   lease_ack_timeout_event = 0;
   mon->bootstrap();
@@ -1333,6 +1495,7 @@ void Paxos::shutdown()
   finish_contexts(g_ceph_context, waiting_for_readable, -ECANCELED);
   finish_contexts(g_ceph_context, waiting_for_active, -ECANCELED);
   finish_contexts(g_ceph_context, pending_finishers, -ECANCELED);
+  clear_pipeline(-ECANCELED);
   finish_contexts(g_ceph_context, committing_finishers, -ECANCELED);
   if (logger)
     g_ceph_context->get_perfcounters_collection()->remove(logger);
@@ -1347,6 +1510,7 @@ void Paxos::leader_init()
   pending_proposal.reset();
 
   reset_pending_committing_finishers();
+  clear_pipeline(-EAGAIN);
 
   logger->inc(l_paxos_start_leader);
 
@@ -1378,6 +1542,7 @@ void Paxos::peon_init()
 
   // no chance to write now!
   reset_pending_committing_finishers();
+  clear_pipeline(-EAGAIN);
   finish_contexts(g_ceph_context, waiting_for_writeable, -EAGAIN);
 
   logger->inc(l_paxos_start_peon);
@@ -1388,6 +1553,8 @@ void Paxos::restart()
   dout(10) << "restart -- canceling timeouts" << dendl;
   cancel_events();
   new_value.clear();
+  // before flushing, so that a commit in flight finishes its round
+  clear_pipeline(-EAGAIN);
 
   if (is_writing() || is_writing_previous()) {
     dout(10) << __func__ << " flushing" << dendl;
@@ -1409,10 +1576,39 @@ void Paxos::restart()
 
 void Paxos::reset_pending_committing_finishers()
 {
+  pipeline.take_finishers(committing_finishers);
   committing_finishers.splice(committing_finishers.end(), pending_finishers);
   finish_contexts(g_ceph_context, committing_finishers, -EAGAIN);
 }
 
+void Paxos::clear_pipeline(int r)
+{
+  list<Context*> finishers;
+  pipeline.take_finishers(finishers);
+  finish_contexts(g_ceph_context, finishers, r);
+  pipeline.clear();
+  last_accepted = 0;
+  if (logger) {
+    logger->set(l_paxos_pipeline_depth, 0);
+  }
+
+  if (is_shutdown()) {
+    return;
+  }
+  // values past last_committed+1 were only ever proposed behind it and will
+  // never commit; a new round would reuse their versions.
+  auto t(std::make_shared<MonitorDBStore::Transaction>());
+  for (version_t v = last_committed + 2;
+       get_store()->exists(get_name(), v);
+       ++v) {
+    dout(10) << __func__ << " discarding uncommitted " << v << dendl;
+    t->erase(get_name(), v);
+  }
+  if (!t->empty()) {
+    get_store()->apply_transaction(t);
+  }
+}
+
 void Paxos::dispatch(MonOpRequestRef op)
 {
   ceph_assert(op->is_type_paxos());
@@ -1520,13 +1716,38 @@ bool Paxos::is_writeable()
     is_lease_valid();
 }
 
+bool Paxos::head_committable() const
+{
+  return pipeline.head_committable(accepted, mon->get_quorum(),
+				   last_committed);
+}
+
+void Paxos::maybe_commit_pipelined_head()
+{
+  if (is_updating() && pipeline.is_head_pipelined() && head_committable()) {
+    dout(10) << __func__ << " quorum caught up with " << last_committed
+	     << ", committing " << (last_committed + 1) << dendl;
+    commit_start();
+  }
+}
+
+bool Paxos::can_pipeline() const
+{
+  if (!mon->is_leader() ||
+      !(is_updating() || is_writing()) ||
+      last_committed == 0 ||
+      1 + pipeline.size() >=
+        g_conf().get_val<uint64_t>("paxos_pipeline_depth")) {
+    return false;
+  }
+  return pipeline.peers_ready(mon->get_quorum(), mon->rank);
+}
+
 void Paxos::propose_pending()
 {
-  ceph_assert(is_active());
+  ceph_assert(is_active() || can_pipeline());
   ceph_assert(pending_proposal);
 
-  cancel_events();
-
   bufferlist bl;
   pending_proposal->encode(bl);
 
@@ -1540,6 +1761,13 @@ void Paxos::propose_pending()
 
   pending_proposal.reset();
 
+  if (!is_active()) {
+    begin_pipelined(bl);
+    return;
+  }
+
+  cancel_events();
+
   committing_finishers.swap(pending_finishers);
   state = STATE_UPDATING;
   begin(bl);
@@ -1572,6 +1800,11 @@ bool Paxos::trigger_propose()
     dout(10) << __func__ << " active, proposing now" << dendl;
     propose_pending();
     return true;
+  } else if (can_pipeline()) {
+    dout(10) << __func__ << " " << (1 + pipeline.size())
+	     << " in flight, pipelining now" << dendl;
+    propose_pending();
+    return true;
   } else {
     dout(10) << __func__ << " not active, will propose later" << dendl;
     return false;
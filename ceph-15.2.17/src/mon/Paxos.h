@@ -119,6 +119,7 @@ e 12v
 
 #include "MonitorDBStore.h"
 #include "mon/MonOpRequest.h"
+#include "mon/PaxosPipeline.h"
 
 class Monitor;
 class MMonPaxos;
@@ -156,6 +157,8 @@ enum {
   l_paxos_share_state_bytes,
   l_paxos_new_pn,
   l_paxos_new_pn_latency,
+  l_paxos_pipelined,
+  l_paxos_pipeline_depth,
   l_paxos_last,
 };
 
@@ -164,6 +167,9 @@ enum {
 /**
  * This library is based on the Paxos algorithm, but varies in a few key ways:
  *  1- Only a single new value is generated at a time, simplifying the recovery logic.
+ *     (With paxos_pipeline_depth > 1 the Leader may begin later values before
+ *     the first commits, but only the one at last_committed+1 is ever
+ *     recovered; the others are dropped.)
  *  2- Nodes track "committed" values, and share them generously (and trustingly)
  *  3- A 'leasing' mechanism is built-in, allowing nodes to determine when it is 
  *     safe to "read" their copy of the last committed value.
@@ -597,6 +603,23 @@ private:
    * this list.  When it commits, these finishers are notified.
    */
   list<Context*> committing_finishers;
+
+  /**
+   * Values proposed behind the one at last_committed+1, when
+   * paxos_pipeline_depth > 1.  Leader only.
+   *
+   * The Leader does not wait for a round to finish before beginning the
+   * next one.  The value at last_committed+1 is still tracked by
+   * new_value/accepted/committing_finishers; the ones behind it live here
+   * and are moved there, in order, as each commit finishes.  Values are
+   * always committed in version order.
+   */
+  PaxosPipeline pipeline;
+  /**
+   * Highest version a Peon accepted in the current pn; above last_committed
+   * only while the Leader has pipelined values in flight.
+   */
+  version_t last_accepted = 0;
   /**
    * This function re-triggers pending_ and committing_finishers
    * safely, so as to maintain existing system invariants. In particular
@@ -825,6 +848,55 @@ private:
    *
    */
   void handle_begin(MonOpRequestRef op);
+  /**
+   * Whether a new value may be begun before the one in flight commits.
+   *
+   * @returns true if paxos_pipeline_depth allows another value in flight,
+   *	      every quorum member supports pipelining, and we are in a
+   *	      normal (not recovering) round.
+   */
+  bool can_pipeline() const;
+  /**
+   * Begin @p value behind the values already in flight.
+   *
+   * The value is stored and sent to the quorum like begin() does, but it
+   * is not recorded as pending_v: should we lose the quorum, only the value
+   * at last_committed+1 is recovered, and the ones behind it are dropped
+   * along with their finishers.
+   *
+   * @pre We are the Leader
+   * @pre can_pipeline() is true
+   *
+   * @param value The value being proposed to the quorum
+   */
+  void begin_pipelined(bufferlist& value);
+  /**
+   * Move the oldest pipelined value to the head of the pipeline once the
+   * value before it committed, committing it right away if the whole
+   * quorum already accepted it.
+   *
+   * @pre We are the Leader
+   * @pre pipeline is not empty
+   * @post We are on STATE_UPDATING or STATE_WRITING
+   */
+  void advance_pipeline();
+  /**
+   * Whether the value at last_committed+1 may be committed, i.e., the whole
+   * quorum accepted it and, if it was pipelined, committed the one before.
+   */
+  bool head_committable() const;
+  /**
+   * Start committing the head if it was pipelined and has become
+   * committable, which an accept or lease ack from a Peon may just have
+   * made it.
+   */
+  void maybe_commit_pipelined_head();
+  /**
+   * Drop any pipelined values, failing their finishers with @p r, and erase
+   * from the store any values above last_committed+1: those were only ever
+   * proposed behind an uncommitted value and will never commit.
+   */
+  void clear_pipeline(int r);
   /**
    * Handle an Accept message sent by a Peon.
    *
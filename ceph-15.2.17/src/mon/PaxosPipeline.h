@@ -0,0 +1,184 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <set>
+
+#include "include/buffer.h"
+#include "include/ceph_assert.h"
+#include "include/types.h"
+
+class Context;
+
+/**
+ * The Leader's bookkeeping of the values proposed behind the one at
+ * last_committed+1, when paxos_pipeline_depth > 1.
+ *
+ * The value at last_committed+1 (the head) is tracked by Paxos itself, in
+ * new_value/accepted/committing_finishers; the ones behind it live here and
+ * are handed over, in version order, as each commit finishes.  This class
+ * decides when the head may commit: once the whole quorum accepted it and,
+ * if it was pipelined, once every Peon reported (in an accept or lease ack)
+ * having committed the value before it.
+ */
+class PaxosPipeline {
+public:
+  struct value_t {
+    ceph::bufferlist value;
+    std::set<int> accepted;
+    std::list<Context*> finishers;
+  };
+
+  size_t size() const {
+    return values.size();
+  }
+  bool empty() const {
+    return values.empty();
+  }
+
+  /// version of the next value begun behind the head
+  version_t next_version(version_t last_committed) const {
+    return last_committed + 2 + values.size();
+  }
+
+  /// begin value @p v, accepted by ourselves (@p self)
+  value_t& add(version_t v, int self) {
+    ceph_assert(values.empty() || values.rbegin()->first == v - 1);
+    value_t& pv = values[v];
+    pv.accepted.insert(self);
+    return pv;
+  }
+
+  /**
+   * Record that @p from accepted @p v.
+   *
+   * @returns false if @p v is not in flight behind the head
+   */
+  bool accept(version_t v, int from) {
+    auto p = values.find(v);
+    if (p == values.end()) {
+      return false;
+    }
+    ceph_assert(p->second.accepted.count(from) == 0);
+    p->second.accepted.insert(from);
+    return true;
+  }
+
+  const std::set<int>& get_accepted(version_t v) const {
+    return values.at(v).accepted;
+  }
+
+  /**
+   * A Peon reported its last_committed, in an accept tagged with a version
+   * (which tells us it handles pipelined begins) or in a lease ack.
+   */
+  void note_peer(int rank, version_t last_committed) {
+    version_t& lc = peers[rank];
+    lc = std::max(lc, last_committed);
+  }
+  /// note a lease ack; only Peons that handle pipelined begins count
+  void note_lease_ack(int rank, version_t last_committed) {
+    if (auto p = peers.find(rank); p != peers.end()) {
+      p->second = std::max(p->second, last_committed);
+    }
+  }
+
+  /// every other member of @p quorum handles pipelined begins
+  bool peers_ready(const std::set<int>& quorum, int self) const {
+    for (auto p : quorum) {
+      if (p != self && !peers.count(p)) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Make the oldest value the head, once the value before it committed.
+   *
+   * @pre the oldest value is at @p last_committed + 1
+   */
+  value_t pop_head(version_t last_committed) {
+    ceph_assert(!values.empty());
+    auto p = values.begin();
+    ceph_assert(p->first == last_committed + 1);
+    value_t pv = std::move(p->second);
+    values.erase(p);
+    head_pipelined = true;
+    return pv;
+  }
+
+  /// the head starts committing
+  void head_committing() {
+    head_pipelined = false;
+  }
+  bool is_head_pipelined() const {
+    return head_pipelined;
+  }
+
+  /**
+   * Whether the head may commit.
+   *
+   * A pipelined head is only committed once every Peon has committed the
+   * value before it, so that at most one value we committed is unknown to
+   * the Peons as committed, which is what recovery expects.
+   */
+  bool head_committable(const std::set<int>& accepted,
+			const std::set<int>& quorum,
+			version_t last_committed) const {
+    if (accepted != quorum) {
+      return false;
+    }
+    if (!head_pipelined) {
+      return true;
+    }
+    for (auto& [rank, lc] : peers) {
+      if (quorum.count(rank) && lc < last_committed) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+  /// move the finishers of every value behind the head to @p ls
+  void take_finishers(std::list<Context*>& ls) {
+    for (auto& p : values) {
+      ls.splice(ls.end(), p.second.finishers);
+    }
+  }
+
+  /// forget everything; the finishers must have been taken
+  void clear() {
+    for (auto& p : values) {
+      ceph_assert(p.second.finishers.empty());
+    }
+    values.clear();
+    peers.clear();
+    head_pipelined = false;
+  }
+
+private:
+  /// values behind the head, keyed by version
+  std::map<version_t, value_t> values;
+  /**
+   * Peons that told us, by tagging their accepts with a version, that they
+   * understand pipelined begins, with the last_committed they last
+   * reported in an accept or lease ack.  We only pipeline once the whole
+   * quorum is here.
+   */
+  std::map<int, version_t> peers;
+  /// the head was begun while the value before it was in flight
+  bool head_pipelined = false;
+};
@@ -39,9 +39,11 @@ struct Subscription {
   version_t next;
   bool onetime;
   bool incremental_onetime;  // has CEPH_FEATURE_INCSUBOSDMAP
+  bool compressed;           // has CEPH_SUBSCRIBE_COMPRESSED
   
   Subscription(MonSession *s, const std::string& t) : session(s), type(t), type_item(this),
-						 next(0), onetime(false), incremental_onetime(false) {}
+						 next(0), onetime(false), incremental_onetime(false),
+						 compressed(false) {}
 };
 
 struct MonSession : public RefCountedObject {
@@ -61,6 +63,9 @@ struct MonSession : public RefCountedObject {
 
   std::map<std::string, Subscription*> sub_map;
   epoch_t osd_epoch = 0;       ///< the osdmap epoch sent to the mon client
+  /// client has subscribed with CEPH_SUBSCRIBE_COMPRESSED, so it can
+  /// decode compressed osdmaps we send it unasked
+  bool osdmap_compressed = false;
 
   AuthServiceHandler *auth_handler = nullptr;
   EntityName entity_name;
@@ -248,7 +253,8 @@ struct MonSessionMap {
     return s;
   }
 
-  void add_update_sub(MonSession *s, const std::string& what, version_t start, bool onetime, bool incremental_onetime) {
+  void add_update_sub(MonSession *s, const std::string& what, version_t start, bool onetime, bool incremental_onetime,
+		      bool compressed = false) {
     Subscription *sub = 0;
     if (s->sub_map.count(what)) {
       sub = s->sub_map[what];
@@ -263,6 +269,7 @@ struct MonSessionMap {
     sub->next = start;
     sub->onetime = onetime;
     sub->incremental_onetime = onetime && incremental_onetime;
+    sub->compressed = compressed;
   }
 
   void remove_sub(Subscription *sub) {
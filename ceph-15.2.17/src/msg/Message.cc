@@ -88,6 +88,7 @@
 #include "messages/MOSDPGTrim.h"
 #include "messages/MOSDPGLease.h"
 #include "messages/MOSDPGLeaseAck.h"
+#include "messages/MOSDPGPeeringBatch.h"
 #include "messages/MOSDScrub.h"
 #include "messages/MOSDScrub2.h"
 #include "messages/MOSDScrubReserve.h"
@@ -567,6 +568,9 @@ Message *decode_message(CephContext *cct,
   case MSG_OSD_PG_LEASE_ACK:
     m = make_message<MOSDPGLeaseAck>();
     break;
+  case MSG_OSD_PG_PEERING_BATCH:
+    m = make_message<MOSDPGPeeringBatch>();
+    break;
 
   case MSG_OSD_SCRUB:
     m = make_message<MOSDScrub>();
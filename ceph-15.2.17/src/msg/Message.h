@@ -142,6 +142,7 @@
 
 #define MSG_OSD_PG_LEASE        133
 #define MSG_OSD_PG_LEASE_ACK    134
+#define MSG_OSD_PG_PEERING_BATCH 135
 
 // *** MDS ***
 
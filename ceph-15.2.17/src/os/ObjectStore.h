@@ -110,6 +110,16 @@ public:
    */
   virtual const PerfCounters* get_perf_counters() const = 0;
 
+  /**
+   * Fetch the number of committed transactions and their total commit
+   * latency in ns since mount, or (0, 0) if the store does not track it.
+   *
+   * This appears to be called with nothing locked.
+   */
+  virtual std::pair<uint64_t, uint64_t> get_commit_lat_ns() const {
+    return std::make_pair(0, 0);
+  }
+
   /**
    * a collection also orders transactions
    *
@@ -467,6 +477,31 @@ public:
      ceph::buffer::list& bl,
      uint32_t op_flags = 0) = 0;
 
+  /**
+   * read_with_crc32c -- read a byte range and extend a crc32c over it
+   *
+   * Same as read(), and also folds the bytes read into *crc.  A store
+   * that keeps crc32c checksums of its data, and verifies them on read,
+   * may derive the result from those instead of hashing the data again.
+   *
+   * @param crc in: crc32c of the preceding data; out: extended over bl
+   * @returns number of bytes read on success, or negative error code on failure.
+   */
+  virtual int read_with_crc32c(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    ceph::buffer::list& bl,
+    uint32_t *crc,
+    uint32_t op_flags = 0) {
+    int r = read(c, oid, offset, len, bl, op_flags);
+    if (r > 0) {
+      *crc = bl.crc32c(*crc);
+    }
+    return r;
+  }
+
   /**
    * fiemap -- get extent std::map of data of an object
    *
@@ -28,6 +28,7 @@
 #include "BlueStore.h"
 #include "os/kv.h"
 #include "include/compat.h"
+#include "include/crc32c.h"
 #include "include/intarith.h"
 #include "include/stringify.h"
 #include "include/str_map.h"
@@ -5009,6 +5010,10 @@ void BlueStore::_init_logger()
                     "Read EIO errors propagated to high level callers");
   b.add_u64_counter(l_bluestore_reads_with_retries, "bluestore_reads_with_retries",
                     "Read operations that required at least one retry due to failed checksum validation");
+  b.add_u64_counter(l_bluestore_read_csum_reused_bytes,
+		    "bluestore_read_csum_reused_bytes",
+		    "Bytes whose crc32c was derived from stored blob checksums "
+		    "instead of hashing the data", NULL, 0, unit_t(UNIT_BYTES));
   b.add_u64(l_bluestore_fragmentation, "bluestore_fragmentation_micros",
             "How fragmented bluestore free space is (free extents / max possible number of free extents) * 1000");
   b.add_time_avg(l_bluestore_omap_seek_to_first_lat, "omap_seek_to_first_lat",
@@ -10179,6 +10184,30 @@ int BlueStore::read(
   size_t length,
   bufferlist& bl,
   uint32_t op_flags)
+{
+  return _read(c_, oid, offset, length, bl, nullptr, op_flags);
+}
+
+int BlueStore::read_with_crc32c(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  bufferlist& bl,
+  uint32_t *crc,
+  uint32_t op_flags)
+{
+  return _read(c_, oid, offset, length, bl, crc, op_flags);
+}
+
+int BlueStore::_read(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  bufferlist& bl,
+  uint32_t *crc,
+  uint32_t op_flags)
 {
   auto start = mono_clock::now();
   Collection *c = static_cast<Collection *>(c_.get());
@@ -10210,6 +10239,8 @@ int BlueStore::read(
     r = _do_read(c, o, offset, length, bl, op_flags);
     if (r == -EIO) {
       logger->inc(l_bluestore_read_eio);
+    } else if (r >= 0 && crc) {
+      *crc = _crc32c_from_csums(o, offset, bl, *crc);
     }
   }
 
@@ -10227,7 +10258,7 @@ int BlueStore::read(
   dout(10) << __func__ << " " << cid << " " << oid
 	   << " 0x" << std::hex << offset << "~" << length << std::dec
 	   << " = " << r << dendl;
-  log_latency(__func__,
+  log_latency("read",
     l_bluestore_read_lat,
     mono_clock::now() - start,
     cct->_conf->bluestore_log_op_age);
@@ -10659,6 +10690,61 @@ int BlueStore::_verify_csum(OnodeRef& o,
   return r;
 }
 
+uint32_t BlueStore::_crc32c_from_csums(
+  OnodeRef& o,
+  uint64_t offset,
+  const bufferlist& bl,
+  uint32_t crc)
+{
+  // _do_read() has just verified the blob checksums covering bl, so
+  // whole crc32c csum chunks can stand in for the data they cover.  The
+  // rest (partial chunks, holes, compressed or otherwise checksummed
+  // blobs) is hashed from bl.
+  const uint64_t end = offset + bl.length();
+  uint64_t pos = offset;  // bl up to here is folded into crc
+  uint64_t reused = 0;
+  auto hash_to = [&](uint64_t to) {
+    if (to > pos) {
+      bufferlist t;
+      t.substr_of(bl, pos - offset, to - pos);
+      crc = t.crc32c(crc);
+      pos = to;
+    }
+  };
+  if (!cct->_conf->bluestore_ignore_data_csum) {
+    for (auto ep = o->extent_map.seek_lextent(offset);
+	 ep != o->extent_map.extent_map.end() && ep->logical_offset < end;
+	 ++ep) {
+      const bluestore_blob_t& blob = ep->blob->get_blob();
+      if (blob.is_compressed() ||
+	  blob.csum_type != Checksummer::CSUM_CRC32C) {
+	continue;
+      }
+      const uint64_t chunk = blob.get_csum_chunk_size();
+      const uint64_t b_start = ep->blob_offset +
+	std::max<uint64_t>(pos, ep->logical_offset) - ep->logical_offset;
+      const uint64_t b_end = ep->blob_offset +
+	std::min<uint64_t>(end, ep->logical_end()) - ep->logical_offset;
+      const uint64_t b_first = p2roundup(b_start, chunk);
+      const uint64_t b_last = p2align(b_end, chunk);
+      if (b_first >= b_last) {
+	continue;
+      }
+      hash_to(ep->logical_offset + b_first - ep->blob_offset);
+      for (uint64_t b = b_first; b < b_last; b += chunk) {
+	crc = ceph_crc32c_combine(crc, blob.get_csum_item(b / chunk), chunk);
+      }
+      pos += b_last - b_first;
+      reused += b_last - b_first;
+    }
+  }
+  hash_to(end);
+  logger->inc(l_bluestore_read_csum_reused_bytes, reused);
+  dout(20) << __func__ << " 0x" << std::hex << offset << "~" << bl.length()
+	   << " reused csums for 0x" << reused << std::dec << dendl;
+  return crc;
+}
+
 int BlueStore::_decompress(bufferlist& source, bufferlist* result)
 {
   int r = 0;
@@ -146,6 +146,7 @@ enum {
   l_bluestore_gc_merged,
   l_bluestore_read_eio,
   l_bluestore_reads_with_retries,
+  l_bluestore_read_csum_reused_bytes,
   l_bluestore_fragmentation,
   l_bluestore_omap_seek_to_first_lat,
   l_bluestore_omap_upper_bound_lat,
@@ -2666,6 +2667,14 @@ public:
     size_t len,
     bufferlist& bl,
     uint32_t op_flags = 0) override;
+  int read_with_crc32c(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    bufferlist& bl,
+    uint32_t *crc,
+    uint32_t op_flags = 0) override;
 
 private:
 
@@ -2741,6 +2750,15 @@ private:
     bool* csum_error,
     bufferlist& bl);
 
+  int _read(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    bufferlist& bl,
+    uint32_t *crc,
+    uint32_t op_flags);
+
   int _do_read(
     Collection *c,
     OnodeRef o,
@@ -2902,6 +2920,9 @@ public:
   const PerfCounters* get_perf_counters() const override {
     return logger;
   }
+  std::pair<uint64_t, uint64_t> get_commit_lat_ns() const override {
+    return logger->get_tavg_ns(l_bluestore_commit_lat);
+  }
   const PerfCounters* get_bluefs_perf_counters() const {
     return bluefs->get_perf_counters();
   }
@@ -3044,6 +3065,12 @@ private:
     uint64_t blob_xoffset,
     const bufferlist& bl,
     uint64_t logical_offset) const;
+  /// extend crc over bl, read from o at offset, reusing verified csums
+  uint32_t _crc32c_from_csums(
+    OnodeRef& o,
+    uint64_t offset,
+    const bufferlist& bl,
+    uint32_t crc);
   int _decompress(bufferlist& source, bufferlist* result);
 
 
@@ -2500,13 +2500,16 @@ int ECBackend::be_deep_scrub(
     stride += sinfo.get_chunk_size() - (stride % sinfo.get_chunk_size());
 
   bufferlist bl;
-  r = store->read(
-    ch,
-    ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-    pos.data_pos,
-    stride, bl,
-    fadvise_flags);
+  const ghobject_t oid(
+    poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard);
+  uint32_t crc = pos.data_hash.digest();
+  const bool reuse_csum = cct->_conf.get_val<bool>("osd_deep_scrub_reuse_csum");
+  if (reuse_csum) {
+    r = store->read_with_crc32c(
+      ch, oid, pos.data_pos, stride, bl, &crc, fadvise_flags);
+  } else {
+    r = store->read(ch, oid, pos.data_pos, stride, bl, fadvise_flags);
+  }
   if (r < 0) {
     dout(20) << __func__ << "  " << poid << " got "
 	     << r << " on read, read_error" << dendl;
@@ -2521,8 +2524,13 @@ int ECBackend::be_deep_scrub(
     return 0;
   }
   if (r > 0) {
-    pos.data_hash << bl;
+    if (reuse_csum) {
+      pos.data_hash = bufferhash(crc);
+    } else {
+      pos.data_hash << bl;
+    }
   }
+  get_parent()->get_logger()->inc(l_osd_scrub_deep_bytes, r);
   pos.data_pos += r;
   if (r == (int)stride) {
     return -EINPROGRESS;
@@ -0,0 +1,112 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "HeartbeatGossip.h"
+
+void HeartbeatGossip::suspect(int osd, utime_t failed_since)
+{
+  // keep the earliest, the peer has been silent since then
+  suspects.emplace(osd, failed_since);
+}
+
+void HeartbeatGossip::clear(int osd)
+{
+  suspects.erase(osd);
+}
+
+void HeartbeatGossip::forget(int osd)
+{
+  suspects.erase(osd);
+  heard.erase(osd);
+  for (auto& [target, peers] : heard) {
+    peers.erase(osd);
+  }
+}
+
+std::vector<int32_t> HeartbeatGossip::get_gossip(unsigned max)
+{
+  std::vector<int32_t> gossip;
+  if (suspects.size() <= max) {
+    for (auto& [osd, since] : suspects) {
+      gossip.push_back(osd);
+    }
+    return gossip;
+  }
+  // too many to send at once; carry on where the last ping stopped
+  auto p = suspects.upper_bound(gossip_pos);
+  while (gossip.size() < max) {
+    if (p == suspects.end()) {
+      p = suspects.begin();
+    }
+    gossip.push_back(p->first);
+    gossip_pos = p->first;
+    ++p;
+  }
+  return gossip;
+}
+
+void HeartbeatGossip::handle_gossip(int from,
+				    const std::vector<int32_t>& gossip,
+				    utime_t now)
+{
+  for (auto osd : gossip) {
+    if (osd != whoami && osd != from) {
+      heard[osd][from] = now;
+    }
+  }
+}
+
+void HeartbeatGossip::_expire(int osd, utime_t now, double ttl)
+{
+  auto p = heard.find(osd);
+  if (p == heard.end()) {
+    return;
+  }
+  for (auto q = p->second.begin(); q != p->second.end(); ) {
+    if (double(now - q->second) > ttl) {
+      q = p->second.erase(q);
+    } else {
+      ++q;
+    }
+  }
+  if (p->second.empty()) {
+    heard.erase(p);
+  }
+}
+
+bool HeartbeatGossip::should_report(int osd, utime_t now, double ttl,
+				    unsigned min_reporters, double fallback,
+				    std::vector<int32_t> *confirmed_by)
+{
+  confirmed_by->clear();
+  auto s = suspects.find(osd);
+  if (s == suspects.end()) {
+    // not a heartbeat failure of ours, report as usual
+    return true;
+  }
+  _expire(osd, now, ttl);
+  auto p = heard.find(osd);
+  if (p != heard.end() && p->second.size() + 1 >= min_reporters) {
+    if (whoami < p->second.begin()->first) {
+      for (auto& [peer, stamp] : p->second) {
+	confirmed_by->push_back(peer);
+      }
+      return true;
+    }
+  } else if (min_reporters <= 1) {
+    return true;
+  }
+  // the designated reporter may be gone too, or cut off from the mons
+  return double(now - s->second) >= fallback;
+}
+
+std::vector<int32_t> HeartbeatGossip::take_reported(int osd)
+{
+  std::vector<int32_t> confirmed_by;
+  auto p = reported_with.find(osd);
+  if (p != reported_with.end()) {
+    confirmed_by.swap(p->second);
+    reported_with.erase(p);
+  }
+  return confirmed_by;
+}
@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "include/utime.h"
+
+/**
+ * Share heartbeat suspicions between peers and pick one reporter.
+ *
+ * With osd_heartbeat_gossip enabled every ping and ping reply carries
+ * the peers the sender currently fails to hear from.  An OSD that
+ * suspects a peer itself collects the other OSDs that gossiped the same
+ * suspicion recently; once enough of them agree, only the one with the
+ * lowest id sends a failure report, naming the others as confirmations,
+ * so the monitor gets one message per failure instead of one from every
+ * peer.  The others hold back their own report for a while in case that
+ * one is lost, and then report as before.
+ *
+ * The OSDs of a PG ping each other, so the other shards of the PGs of a
+ * failed OSD usually hear about each other's suspicion within a round.
+ *
+ * Not thread safe; the OSD calls it under heartbeat_lock.
+ */
+class HeartbeatGossip {
+public:
+  explicit HeartbeatGossip(int whoami) : whoami(whoami) {}
+
+  /// we fail to hear from osd since failed_since
+  void suspect(int osd, utime_t failed_since);
+  /// osd replies again
+  void clear(int osd);
+  /// osd is not a peer any more
+  void forget(int osd);
+
+  bool is_suspected(int osd) const {
+    return suspects.count(osd);
+  }
+  size_t num_suspects() const {
+    return suspects.size();
+  }
+
+  /// up to max of our suspicions for the next ping, rotating through them
+  std::vector<int32_t> get_gossip(unsigned max);
+
+  /// peer from gossiped suspects at now
+  void handle_gossip(int from, const std::vector<int32_t>& gossip,
+		     utime_t now);
+
+  /**
+   * decide whether we send the failure report for a suspected osd
+   *
+   * @param ttl how long a gossiped suspicion counts as a confirmation
+   * @param min_reporters OSDs, us included, that must agree
+   * @param fallback report on our own after suspecting osd this long
+   * @param [out] confirmed_by the peers that agree, if we report
+   */
+  bool should_report(int osd, utime_t now, double ttl, unsigned min_reporters,
+		     double fallback, std::vector<int32_t> *confirmed_by);
+
+  /// remember whom a sent report named, for its cancellation
+  void reported(int osd, const std::vector<int32_t>& confirmed_by) {
+    reported_with[osd] = confirmed_by;
+  }
+  std::vector<int32_t> take_reported(int osd);
+
+private:
+  void _expire(int osd, utime_t now, double ttl);
+
+  const int whoami;
+  std::map<int, utime_t> suspects;  ///< osd -> failed since
+  /// osd -> peer -> last time that peer gossiped a suspicion of osd
+  std::map<int, std::map<int, utime_t>> heard;
+  std::map<int, std::vector<int32_t>> reported_with;
+  int gossip_pos = -1;              ///< last suspicion gossiped
+};
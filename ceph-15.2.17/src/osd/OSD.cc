@@ -97,6 +97,7 @@
 #include "messages/MOSDPGInfo2.h"
 #include "messages/MOSDPGCreate.h"
 #include "messages/MOSDPGCreate2.h"
+#include "messages/MOSDPGPeeringBatch.h"
 #include "messages/MOSDPGScan.h"
 #include "messages/MBackfillReserve.h"
 #include "messages/MRecoveryReserve.h"
@@ -2151,6 +2152,7 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
 	    get_num_op_threads()),
   heartbeat_stop(false),
   heartbeat_need_update(true),
+  hb_gossip(id),
   hb_front_client_messenger(hb_client_front),
   hb_back_client_messenger(hb_client_back),
   hb_front_server_messenger(hb_front_serverm),
@@ -2171,7 +2173,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   up_thru_wanted(0),
   requested_full_first(0),
   requested_full_last(0),
-  service(this)
+  service(this),
+  peering_batcher(cct)
 {
 
   if (!gss_ktfile_client.empty()) {
@@ -2721,136 +2724,14 @@ will start to track new ops received afterwards.";
     cmd_getval(cmdmap, "object_size", osize, (int64_t)0);
     cmd_getval(cmdmap, "object_num", onum, (int64_t)0);
 
-    uint32_t duration = cct->_conf->osd_bench_duration;
-
-    if (bsize > (int64_t) cct->_conf->osd_bench_max_block_size) {
-      // let us limit the block size because the next checks rely on it
-      // having a sane value.  If we allow any block size to be set things
-      // can still go sideways.
-      ss << "block 'size' values are capped at "
-         << byte_u_t(cct->_conf->osd_bench_max_block_size) << ". If you wish to use"
-         << " a higher value, please adjust 'osd_bench_max_block_size'";
-      ret = -EINVAL;
+    double elapsed = 0.0;
+    ret = run_osd_bench_test(count, bsize, osize, onum, &elapsed, ss);
+    if (ret != 0) {
       goto out;
-    } else if (bsize < (int64_t) (1 << 20)) {
-      // entering the realm of small block sizes.
-      // limit the count to a sane value, assuming a configurable amount of
-      // IOPS and duration, so that the OSD doesn't get hung up on this,
-      // preventing timeouts from going off
-      int64_t max_count =
-        bsize * duration * cct->_conf->osd_bench_small_size_max_iops;
-      if (count > max_count) {
-        ss << "'count' values greater than " << max_count
-           << " for a block size of " << byte_u_t(bsize) << ", assuming "
-           << cct->_conf->osd_bench_small_size_max_iops << " IOPS,"
-           << " for " << duration << " seconds,"
-           << " can cause ill effects on osd. "
-           << " Please adjust 'osd_bench_small_size_max_iops' with a higher"
-           << " value if you wish to use a higher 'count'.";
-        ret = -EINVAL;
-        goto out;
-      }
-    } else {
-      // 1MB block sizes are big enough so that we get more stuff done.
-      // However, to avoid the osd from getting hung on this and having
-      // timers being triggered, we are going to limit the count assuming
-      // a configurable throughput and duration.
-      // NOTE: max_count is the total amount of bytes that we believe we
-      //       will be able to write during 'duration' for the given
-      //       throughput.  The block size hardly impacts this unless it's
-      //       way too big.  Given we already check how big the block size
-      //       is, it's safe to assume everything will check out.
-      int64_t max_count =
-        cct->_conf->osd_bench_large_size_max_throughput * duration;
-      if (count > max_count) {
-        ss << "'count' values greater than " << max_count
-           << " for a block size of " << byte_u_t(bsize) << ", assuming "
-           << byte_u_t(cct->_conf->osd_bench_large_size_max_throughput) << "/s,"
-           << " for " << duration << " seconds,"
-           << " can cause ill effects on osd. "
-           << " Please adjust 'osd_bench_large_size_max_throughput'"
-           << " with a higher value if you wish to use a higher 'count'.";
-        ret = -EINVAL;
-        goto out;
-      }
     }
-
     if (osize && bsize > osize)
       bsize = osize;
 
-    dout(1) << " bench count " << count
-            << " bsize " << byte_u_t(bsize) << dendl;
-
-    ObjectStore::Transaction cleanupt;
-
-    if (osize && onum) {
-      bufferlist bl;
-      bufferptr bp(osize);
-      bp.zero();
-      bl.push_back(std::move(bp));
-      bl.rebuild_page_aligned();
-      for (int i=0; i<onum; ++i) {
-	char nm[30];
-	snprintf(nm, sizeof(nm), "disk_bw_test_%d", i);
-	object_t oid(nm);
-	hobject_t soid(sobject_t(oid, 0));
-	ObjectStore::Transaction t;
-	t.write(coll_t(), ghobject_t(soid), 0, osize, bl);
-	store->queue_transaction(service.meta_ch, std::move(t), NULL);
-	cleanupt.remove(coll_t(), ghobject_t(soid));
-      }
-    }
-
-    bufferlist bl;
-    bufferptr bp(bsize);
-    bp.zero();
-    bl.push_back(std::move(bp));
-    bl.rebuild_page_aligned();
-
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
-    }
-
-    utime_t start = ceph_clock_now();
-    for (int64_t pos = 0; pos < count; pos += bsize) {
-      char nm[30];
-      unsigned offset = 0;
-      if (onum && osize) {
-	snprintf(nm, sizeof(nm), "disk_bw_test_%d", (int)(rand() % onum));
-	offset = rand() % (osize / bsize) * bsize;
-      } else {
-	snprintf(nm, sizeof(nm), "disk_bw_test_%lld", (long long)pos);
-      }
-      object_t oid(nm);
-      hobject_t soid(sobject_t(oid, 0));
-      ObjectStore::Transaction t;
-      t.write(coll_t::meta(), ghobject_t(soid), offset, bsize, bl);
-      store->queue_transaction(service.meta_ch, std::move(t), NULL);
-      if (!onum || !osize)
-	cleanupt.remove(coll_t::meta(), ghobject_t(soid));
-    }
-
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
-    }
-    utime_t end = ceph_clock_now();
-
-    // clean up
-    store->queue_transaction(service.meta_ch, std::move(cleanupt), NULL);
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
-    }
-
-    double elapsed = end - start;
     double rate = count / elapsed;
     double iops = rate / bsize;
     f->open_object_section("osd_bench_results");
@@ -3483,6 +3364,7 @@ int OSD::init()
   dout(2) << "superblock: I am osd." << superblock.whoami << dendl;
 
   create_logger();
+  peering_batcher.init(logger);
 
   // prime osd stats
   {
@@ -3493,6 +3375,8 @@ int OSD::init()
     service.set_statfs(stbuf, alerts);
   }
 
+  mclock_calibrate();
+
   // client_messenger auth_client is already set up by monc.
   for (auto m : { cluster_messenger,
 	objecter_messenger,
@@ -3625,6 +3509,8 @@ int OSD::init()
     exit(1);
   }
 
+  save_mclock_calibration();
+
   osd_lock.lock();
   if (is_stopping())
     return 0;
@@ -4215,6 +4101,7 @@ int OSD::shutdown()
     std::lock_guard l(s->osdmap_lock);
     s->shard_osdmap = OSDMapRef();
   }
+  peering_batcher.shutdown();
   service.shutdown();
 
   std::lock_guard lock(osd_lock);
@@ -4920,7 +4807,7 @@ void OSD::resume_creating_pg()
   version_t start = get_osdmap_epoch() + 1;
   if (have_pending_creates) {
     // don't miss any new osdmap deleting PGs
-    if (monc->sub_want("osdmap", start, 0)) {
+    if (monc->sub_want("osdmap", start, CEPH_SUBSCRIBE_COMPRESSED)) {
       dout(4) << __func__ << ": resolicit osdmap from mon since "
 	      << start << dendl;
       do_renew_subs = true;
@@ -4928,7 +4815,8 @@ void OSD::resume_creating_pg()
   } else if (do_sub_pg_creates) {
     // no need to subscribe the osdmap continuously anymore
     // once the pgtemp and/or mon_subscribe(pg_creates) is sent
-    if (monc->sub_want_increment("osdmap", start, CEPH_SUBSCRIBE_ONETIME)) {
+    if (monc->sub_want_increment("osdmap", start,
+				  CEPH_SUBSCRIBE_ONETIME | CEPH_SUBSCRIBE_COMPRESSED)) {
       dout(4) << __func__ << ": re-subscribe osdmap(onetime) since "
 	      << start << dendl;
       do_renew_subs = true;
@@ -5068,6 +4956,7 @@ void OSD::_remove_heartbeat_peer(int n)
 	   << dendl;
   q->second.clear_mark_down();
   heartbeat_peers.erase(q);
+  hb_gossip.forget(n);
 }
 
 void OSD::need_heartbeat_peer_update()
@@ -5210,6 +5099,8 @@ void OSD::reset_heartbeat_peers(bool all)
       // stop sending failure_report to mon too
       failure_queue.erase(peer);
       failure_pending.erase(peer);
+      hb_gossip.forget(peer);
+      hb_gossip.take_reported(peer);
       it = heartbeat_peers.erase(it);
     } else {
       ++it;
@@ -5258,6 +5149,11 @@ void OSD::handle_osd_ping(MOSDPing *m)
     s->stamps = service.get_hb_stamps(from);
   }
 
+  const bool gossip = cct->_conf.get_val<bool>("osd_heartbeat_gossip");
+  if (gossip && heartbeat_peers.count(from)) {
+    hb_gossip.handle_gossip(from, m->suspects, now);
+  }
+
   switch (m->op) {
 
   case MOSDPing::PING:
@@ -5301,15 +5197,24 @@ void OSD::handle_osd_ping(MOSDPing *m)
 	break;
       }
 
-      Message *r = new MOSDPing(monc->get_fsid(),
-				curmap->get_epoch(),
-				MOSDPing::PING_REPLY,
-				m->ping_stamp,
-				m->mono_ping_stamp,
-				mnow,
-				service.get_up_epoch(),
-				cct->_conf->osd_heartbeat_min_size,
-				sender_delta_ub);
+      // with gossip only pad the replies to padded pings
+      uint32_t min_size = cct->_conf->osd_heartbeat_min_size;
+      if (gossip && m->min_message_size < min_size) {
+	min_size = 0;
+      }
+      MOSDPing *r = new MOSDPing(monc->get_fsid(),
+				 curmap->get_epoch(),
+				 MOSDPing::PING_REPLY,
+				 m->ping_stamp,
+				 m->mono_ping_stamp,
+				 mnow,
+				 service.get_up_epoch(),
+				 min_size,
+				 sender_delta_ub);
+      if (gossip) {
+	r->suspects = hb_gossip.get_gossip(
+	  cct->_conf.get_val<uint64_t>("osd_heartbeat_gossip_max_suspects"));
+      }
       con->send_message(r);
 
       if (curmap->is_up(from)) {
@@ -5508,6 +5413,7 @@ void OSD::handle_osd_ping(MOSDPing *m)
           }
 
           if (i->second.is_healthy(now)) {
+            hb_gossip.clear(from);
             // Cancel false reports
             auto failure_queue_entry = failure_queue.find(from);
             if (failure_queue_entry != failure_queue.end()) {
@@ -5574,10 +5480,13 @@ void OSD::heartbeat_entry()
     heartbeat();
 
     double wait;
+    double interval = heartbeat_interval();
     if (cct->_conf.get_val<bool>("debug_disable_randomized_ping")) {
-      wait = (float)cct->_conf->osd_heartbeat_interval;
+      wait = interval;
+    } else if (cct->_conf.get_val<bool>("osd_heartbeat_gossip")) {
+      wait = (.75 + ((float)(rand() % 10)/20.0)) * interval;
     } else {
-      wait = .5 + ((float)(rand() % 10)/10.0) * (float)cct->_conf->osd_heartbeat_interval;
+      wait = .5 + ((float)(rand() % 10)/10.0) * interval;
     }
     auto w = ceph::make_timespan(wait);
     dout(30) << "heartbeat_entry sleeping for " << wait << dendl;
@@ -5588,6 +5497,29 @@ void OSD::heartbeat_entry()
   }
 }
 
+double OSD::heartbeat_interval()
+{
+  ceph_assert(ceph_mutex_is_locked(heartbeat_lock));
+  if (!cct->_conf.get_val<bool>("osd_heartbeat_gossip")) {
+    return cct->_conf->osd_heartbeat_interval;
+  }
+  // a dense node must not flood its peers with pings
+  double pings = heartbeat_peers.size() * HeartbeatInfo::HEARTBEAT_MAX_CONN;
+  return std::max(
+    cct->_conf.get_val<double>("osd_heartbeat_gossip_interval"),
+    pings / cct->_conf.get_val<uint64_t>("osd_heartbeat_gossip_max_ping_rate"));
+}
+
+double OSD::heartbeat_grace()
+{
+  ceph_assert(ceph_mutex_is_locked(heartbeat_lock));
+  if (!cct->_conf.get_val<bool>("osd_heartbeat_gossip")) {
+    return cct->_conf->osd_heartbeat_grace;
+  }
+  return std::max(cct->_conf.get_val<double>("osd_heartbeat_gossip_grace"),
+		  3 * heartbeat_interval());
+}
+
 void OSD::heartbeat_check()
 {
   ceph_assert(ceph_mutex_is_locked(heartbeat_lock));
@@ -5633,8 +5565,10 @@ void OSD::heartbeat_check()
 	// fail
 	failure_queue[p->first] = std::min(p->second.last_rx_back, p->second.last_rx_front);
       }
+      hb_gossip.suspect(p->first, failure_queue[p->first]);
     }
   }
+  logger->set(l_osd_hb_suspects, hb_gossip.num_suspects());
 }
 
 void OSD::heartbeat()
@@ -5676,10 +5610,21 @@ void OSD::heartbeat()
 
   service.check_full_status(ratio, pratio);
 
+  const bool gossip = cct->_conf.get_val<bool>("osd_heartbeat_gossip");
+  if (gossip) {
+    // do not wait for the next tick to notice a silent peer
+    heartbeat_check();
+  }
+  std::vector<int32_t> suspects;
+  if (gossip) {
+    suspects = hb_gossip.get_gossip(
+      cct->_conf.get_val<uint64_t>("osd_heartbeat_gossip_max_suspects"));
+  }
+
   utime_t now = ceph_clock_now();
   auto mnow = service.get_mnow();
   utime_t deadline = now;
-  deadline += cct->_conf->osd_heartbeat_grace;
+  deadline += heartbeat_grace();
 
   // send heartbeats
   for (map<int,HeartbeatInfo>::iterator i = heartbeat_peers.begin();
@@ -5704,28 +5649,43 @@ void OSD::heartbeat()
     std::optional<ceph::signedspan> delta_ub;
     s->stamps->sent_ping(&delta_ub);
 
-    i->second.con_back->send_message(
-      new MOSDPing(monc->get_fsid(),
-		   service.get_osdmap_epoch(),
-		   MOSDPing::PING,
-		   now,
-		   mnow,
-		   mnow,
-		   service.get_up_epoch(),
-		   cct->_conf->osd_heartbeat_min_size,
-		   delta_ub));
-
-    if (i->second.con_front)
-      i->second.con_front->send_message(
-	new MOSDPing(monc->get_fsid(),
-		     service.get_osdmap_epoch(),
-		     MOSDPing::PING,
-		     now,
-		     mnow,
-		     mnow,
-		     service.get_up_epoch(),
-		     cct->_conf->osd_heartbeat_min_size,
-		     delta_ub));
+    // with gossip, pad the pings only as often as we would send them
+    // otherwise; that is enough to notice an mtu mismatch
+    uint32_t min_size = cct->_conf->osd_heartbeat_min_size;
+    if (gossip) {
+      if (now - i->second.last_padded_tx <
+	  utime_t(cct->_conf->osd_heartbeat_interval, 0)) {
+	min_size = 0;
+      } else {
+	i->second.last_padded_tx = now;
+      }
+    }
+
+    auto ping = new MOSDPing(monc->get_fsid(),
+			     service.get_osdmap_epoch(),
+			     MOSDPing::PING,
+			     now,
+			     mnow,
+			     mnow,
+			     service.get_up_epoch(),
+			     min_size,
+			     delta_ub);
+    ping->suspects = suspects;
+    i->second.con_back->send_message(ping);
+
+    if (i->second.con_front) {
+      ping = new MOSDPing(monc->get_fsid(),
+			  service.get_osdmap_epoch(),
+			  MOSDPing::PING,
+			  now,
+			  mnow,
+			  mnow,
+			  service.get_up_epoch(),
+			  min_size,
+			  delta_ub);
+      ping->suspects = suspects;
+      i->second.con_front->send_message(ping);
+    }
   }
 
   logger->set(l_osd_hb_to, heartbeat_peers.size());
@@ -5851,6 +5811,8 @@ void OSD::tick_without_osd_lock()
   logger->set(l_osd_cached_crc, buffer::get_cached_crc());
   logger->set(l_osd_cached_crc_adjusted, buffer::get_cached_crc_adjusted());
   logger->set(l_osd_missed_crc, buffer::get_missed_crc());
+  update_device_util();
+  update_mclock_capacity();
 
   // refresh osd stats
   struct store_statfs_t stbuf;
@@ -5862,9 +5824,13 @@ void OSD::tick_without_osd_lock()
   // osd_lock is not being held, which means the OSD state
   // might change when doing the monitor report
   if (is_active() || is_waiting_for_healthy()) {
+    bool failures;
     {
       std::lock_guard l{heartbeat_lock};
       heartbeat_check();
+      // with gossip, failures are not held back for the next mon report
+      failures = !failure_queue.empty() &&
+	cct->_conf.get_val<bool>("osd_heartbeat_gossip");
     }
     map_lock.lock_shared();
     std::lock_guard l(mon_report_lock);
@@ -5876,6 +5842,8 @@ void OSD::tick_without_osd_lock()
       last_mon_report = now;
       send_full_update();
       send_failures();
+    } else if (failures) {
+      send_failures();
     }
     map_lock.unlock_shared();
 
@@ -6691,21 +6659,47 @@ void OSD::send_failures()
   std::lock_guard l(heartbeat_lock);
   utime_t now = ceph_clock_now();
   const auto osdmap = get_osdmap();
-  while (!failure_queue.empty()) {
-    int osd = failure_queue.begin()->first;
+  const bool gossip = cct->_conf.get_val<bool>("osd_heartbeat_gossip");
+  const double grace = heartbeat_grace();
+  const auto min_reporters =
+    cct->_conf.get_val<uint64_t>("osd_heartbeat_gossip_min_reporters");
+  for (auto p = failure_queue.begin(); p != failure_queue.end(); ) {
+    int osd = p->first;
     if (!failure_pending.count(osd)) {
-      int failed_for = (int)(double)(now - failure_queue.begin()->second);
-      monc->send_mon_message(
-	new MOSDFailure(
-	  monc->get_fsid(),
-	  osd,
-	  osdmap->get_addrs(osd),
-	  failed_for,
-	  osdmap->get_epoch()));
-      failure_pending[osd] = make_pair(failure_queue.begin()->second,
+      std::vector<int32_t> confirmed_by;
+      if (gossip &&
+	  !hb_gossip.should_report(osd, now, grace, min_reporters,
+				   cct->_conf->osd_heartbeat_grace,
+				   &confirmed_by)) {
+	// another peer reports it, or too few of us agree yet
+	dout(20) << __func__ << " holding back report of osd." << osd << dendl;
+	++p;
+	continue;
+      }
+      confirmed_by.erase(
+	std::remove_if(confirmed_by.begin(), confirmed_by.end(),
+		       [&osdmap](int32_t peer) {
+			 return !osdmap->is_up(peer);
+		       }),
+	confirmed_by.end());
+      int failed_for = (int)(double)(now - p->second);
+      auto m = new MOSDFailure(
+	monc->get_fsid(),
+	osd,
+	osdmap->get_addrs(osd),
+	failed_for,
+	osdmap->get_epoch());
+      m->confirmed_by = confirmed_by;
+      monc->send_mon_message(m);
+      logger->inc(l_osd_hb_failure_reports);
+      logger->inc(l_osd_hb_failure_confirmations, confirmed_by.size());
+      if (!confirmed_by.empty()) {
+	hb_gossip.reported(osd, confirmed_by);
+      }
+      failure_pending[osd] = make_pair(p->second,
 				       osdmap->get_addrs(osd));
     }
-    failure_queue.erase(osd);
+    p = failure_queue.erase(p);
   }
 }
 
@@ -6713,6 +6707,8 @@ void OSD::send_still_alive(epoch_t epoch, int osd, const entity_addrvec_t &addrs
 {
   MOSDFailure *m = new MOSDFailure(monc->get_fsid(), osd, addrs, 0, epoch,
 				   MOSDFailure::FLAG_ALIVE);
+  // cancel the reports we made on behalf of our peers as well
+  m->confirmed_by = hb_gossip.take_reported(osd);
   monc->send_mon_message(m);
 }
 
@@ -7038,6 +7034,8 @@ void OSD::ms_fast_dispatch(Message *m)
     return handle_fast_pg_info(static_cast<MOSDPGInfo*>(m));
   case MSG_OSD_PG_REMOVE:
     return handle_fast_pg_remove(static_cast<MOSDPGRemove*>(m));
+  case MSG_OSD_PG_PEERING_BATCH:
+    return handle_fast_pg_peering_batch(static_cast<MOSDPGPeeringBatch*>(m));
 
     // these are single-pg messages that handle themselves
   case MSG_OSD_PG_LOG:
@@ -7352,6 +7350,319 @@ double OSD::scrub_sleep_time(bool must_scrub)
   return std::max(extended_sleep, normal_sleep);
 }
 
+int OSD::run_osd_bench_test(
+  int64_t count,
+  int64_t bsize,
+  int64_t osize,
+  int64_t onum,
+  double *elapsed,
+  ostream &ss)
+{
+  uint32_t duration = cct->_conf->osd_bench_duration;
+
+  if (bsize > (int64_t) cct->_conf->osd_bench_max_block_size) {
+    // let us limit the block size because the next checks rely on it
+    // having a sane value.  If we allow any block size to be set things
+    // can still go sideways.
+    ss << "block 'size' values are capped at "
+       << byte_u_t(cct->_conf->osd_bench_max_block_size) << ". If you wish to use"
+       << " a higher value, please adjust 'osd_bench_max_block_size'";
+    return -EINVAL;
+  } else if (bsize < (int64_t) (1 << 20)) {
+    // entering the realm of small block sizes.
+    // limit the count to a sane value, assuming a configurable amount of
+    // IOPS and duration, so that the OSD doesn't get hung up on this,
+    // preventing timeouts from going off
+    int64_t max_count =
+      bsize * duration * cct->_conf->osd_bench_small_size_max_iops;
+    if (count > max_count) {
+      ss << "'count' values greater than " << max_count
+         << " for a block size of " << byte_u_t(bsize) << ", assuming "
+         << cct->_conf->osd_bench_small_size_max_iops << " IOPS,"
+         << " for " << duration << " seconds,"
+         << " can cause ill effects on osd. "
+         << " Please adjust 'osd_bench_small_size_max_iops' with a higher"
+         << " value if you wish to use a higher 'count'.";
+      return -EINVAL;
+    }
+  } else {
+    // 1MB block sizes are big enough so that we get more stuff done.
+    // However, to avoid the osd from getting hung on this and having
+    // timers being triggered, we are going to limit the count assuming
+    // a configurable throughput and duration.
+    // NOTE: max_count is the total amount of bytes that we believe we
+    //       will be able to write during 'duration' for the given
+    //       throughput.  The block size hardly impacts this unless it's
+    //       way too big.  Given we already check how big the block size
+    //       is, it's safe to assume everything will check out.
+    int64_t max_count =
+      cct->_conf->osd_bench_large_size_max_throughput * duration;
+    if (count > max_count) {
+      ss << "'count' values greater than " << max_count
+         << " for a block size of " << byte_u_t(bsize) << ", assuming "
+         << byte_u_t(cct->_conf->osd_bench_large_size_max_throughput) << "/s,"
+         << " for " << duration << " seconds,"
+         << " can cause ill effects on osd. "
+         << " Please adjust 'osd_bench_large_size_max_throughput'"
+         << " with a higher value if you wish to use a higher 'count'.";
+      return -EINVAL;
+    }
+  }
+
+  if (osize && bsize > osize)
+    bsize = osize;
+
+  dout(1) << " bench count " << count
+          << " bsize " << byte_u_t(bsize) << dendl;
+
+  ObjectStore::Transaction cleanupt;
+
+  if (osize && onum) {
+    bufferlist bl;
+    bufferptr bp(osize);
+    bp.zero();
+    bl.push_back(std::move(bp));
+    bl.rebuild_page_aligned();
+    for (int i=0; i<onum; ++i) {
+      char nm[30];
+      snprintf(nm, sizeof(nm), "disk_bw_test_%d", i);
+      object_t oid(nm);
+      hobject_t soid(sobject_t(oid, 0));
+      ObjectStore::Transaction t;
+      t.write(coll_t(), ghobject_t(soid), 0, osize, bl);
+      store->queue_transaction(service.meta_ch, std::move(t), NULL);
+      cleanupt.remove(coll_t(), ghobject_t(soid));
+    }
+  }
+
+  bufferlist bl;
+  bufferptr bp(bsize);
+  bp.zero();
+  bl.push_back(std::move(bp));
+  bl.rebuild_page_aligned();
+
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+
+  utime_t start = ceph_clock_now();
+  for (int64_t pos = 0; pos < count; pos += bsize) {
+    char nm[30];
+    unsigned offset = 0;
+    if (onum && osize) {
+      snprintf(nm, sizeof(nm), "disk_bw_test_%d", (int)(rand() % onum));
+      offset = rand() % (osize / bsize) * bsize;
+    } else {
+      snprintf(nm, sizeof(nm), "disk_bw_test_%lld", (long long)pos);
+    }
+    object_t oid(nm);
+    hobject_t soid(sobject_t(oid, 0));
+    ObjectStore::Transaction t;
+    t.write(coll_t::meta(), ghobject_t(soid), offset, bsize, bl);
+    store->queue_transaction(service.meta_ch, std::move(t), NULL);
+    if (!onum || !osize)
+      cleanupt.remove(coll_t::meta(), ghobject_t(soid));
+  }
+
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+  utime_t end = ceph_clock_now();
+
+  // clean up
+  store->queue_transaction(service.meta_ch, std::move(cleanupt), NULL);
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+
+  *elapsed = end - start;
+  return 0;
+}
+
+void OSD::update_device_util()
+{
+  if (cct->_conf.get_val<double>("osd_deep_scrub_max_device_util") <= 0) {
+    device_util = 0;
+    return;
+  }
+  if (util_devices.empty()) {
+    std::set<std::string> devnames;
+    store->get_devices(&devnames);
+    for (auto& d : devnames) {
+      uint64_t ms;
+      if (get_device_io_ticks(d, &ms) == 0) {
+	util_devices.insert(d);
+      }
+    }
+    if (util_devices.empty()) {
+      return;
+    }
+  }
+  const auto now = ceph::mono_clock::now();
+  const double elapsed_ms =
+    std::chrono::duration<double, std::milli>(now - last_io_ticks_stamp).count();
+  double util = 0;
+  for (auto& d : util_devices) {
+    uint64_t ms;
+    if (get_device_io_ticks(d, &ms) < 0) {
+      continue;
+    }
+    auto p = last_io_ticks.find(d);
+    if (p != last_io_ticks.end() && elapsed_ms > 0 && ms >= p->second) {
+      util = std::max(util, std::min(1.0, (ms - p->second) / elapsed_ms));
+    }
+    last_io_ticks[d] = ms;
+  }
+  last_io_ticks_stamp = now;
+  device_util = util;
+  dout(20) << __func__ << " " << util_devices << " " << util << dendl;
+}
+
+double OSD::deep_scrub_util_sleep_time()
+{
+  const double max_util =
+    cct->_conf.get_val<double>("osd_deep_scrub_max_device_util");
+  if (max_util <= 0 || device_util <= max_util) {
+    return 0;
+  }
+  logger->inc(l_osd_scrub_deep_util_sleep);
+  return cct->_conf.get_val<double>("osd_deep_scrub_device_util_sleep");
+}
+
+void OSD::mclock_calibrate()
+{
+  if (cct->_conf->osd_op_queue != "mclock_scheduler" ||
+      !cct->_conf.get_val<bool>("osd_mclock_calibration")) {
+    return;
+  }
+  const bool rotational = store->is_rotational();
+  const std::string iops_key = rotational ?
+    "osd_mclock_max_capacity_iops_hdd" : "osd_mclock_max_capacity_iops_ssd";
+  const std::string bandwidth_key = rotational ?
+    "osd_mclock_max_sequential_bandwidth_hdd" :
+    "osd_mclock_max_sequential_bandwidth_ssd";
+  double iops = cct->_conf.get_val<double>(iops_key);
+  double bandwidth = cct->_conf.get_val<Option::size_t>(bandwidth_key);
+  std::ostringstream ss;
+  double elapsed = 0;
+  if (iops <= 0) {
+    // random 4K writes over 100 4MB objects, as many as the default
+    // osd_bench_small_size_max_iops permits
+    const int64_t ios = 3000;
+    int r = run_osd_bench_test(ios * 4096, 4096, 4 << 20, 100, &elapsed, ss);
+    if (r < 0 || elapsed <= 0) {
+      derr << __func__ << " 4K write benchmark failed: " << ss.str() << dendl;
+      return;
+    }
+    iops = ios / elapsed;
+    mclock_measured[iops_key] = stringify(iops);
+  }
+  if (bandwidth <= 0) {
+    const int64_t bytes = 128 << 20;
+    int r = run_osd_bench_test(bytes, 4 << 20, 0, 0, &elapsed, ss);
+    if (r < 0 || elapsed <= 0) {
+      derr << __func__ << " 4MB write benchmark failed: " << ss.str() << dendl;
+      return;
+    }
+    bandwidth = bytes / elapsed;
+    mclock_measured[bandwidth_key] = stringify((uint64_t)bandwidth);
+  }
+  mclock_capacity.set_benchmark(iops, bandwidth / iops);
+  dout(0) << __func__ << " " << (rotational ? "hdd " : "ssd ")
+	  << mclock_capacity << dendl;
+  logger->set(l_osd_mclock_bench_iops, iops);
+  logger->set(l_osd_mclock_bytes_per_io, mclock_capacity.get_bytes_per_io());
+
+  // the benchmark's own commits say nothing about later load
+  mclock_commit_lat.consume_next(store->get_commit_lat_ns());
+  mclock_last_sample = ceph::mono_clock::now();
+  set_mclock_capacity();
+}
+
+void OSD::save_mclock_calibration()
+{
+  for (auto& [key, val] : mclock_measured) {
+    string cmd = "{\"prefix\": \"config set\", \"who\": \"osd." +
+      stringify(whoami) + "\", \"name\": \"" + key +
+      "\", \"value\": \"" + val + "\"}";
+    vector<string> vcmd{cmd};
+    bufferlist inbl;
+    // do not hold up boot on the mons; the command is resent if they
+    // are not reachable, and dropped when we shut down
+    auto outs = std::make_shared<string>();
+    monc->start_mon_command(
+      vcmd, inbl, NULL, outs.get(),
+      new LambdaContext([cct = cct, whoami = whoami, key = key, val = val,
+			 outs](int r) {
+	if (r < 0) {
+	  // not fatal; we will measure again on the next start
+	  lgeneric_derr(cct) << "osd." << whoami
+			     << " save_mclock_calibration unable to set "
+			     << key << ": '" << *outs << "': "
+			     << cpp_strerror(r) << dendl;
+	} else {
+	  lgeneric_dout(cct, 1) << "osd." << whoami
+				<< " save_mclock_calibration " << key
+				<< " = " << val << dendl;
+	}
+      }));
+  }
+  mclock_measured.clear();
+}
+
+void OSD::update_mclock_capacity()
+{
+  if (!mclock_capacity.is_calibrated()) {
+    return;
+  }
+  uint64_t cost = 0;
+  for (auto shard : shards) {
+    std::lock_guard l(shard->shard_lock);
+    cost += shard->scheduler->get_dispatched_cost();
+  }
+  mclock_commit_lat.consume_next(store->get_commit_lat_ns());
+  const auto now = ceph::mono_clock::now();
+  const double elapsed =
+    std::chrono::duration<double>(now - mclock_last_sample).count();
+  const double served =
+    elapsed > 0 ? (cost - mclock_dispatched_cost) / elapsed : 0;
+  const double latency = mclock_commit_lat.current_avg() / 1000000000.0;
+  mclock_dispatched_cost = cost;
+  mclock_last_sample = now;
+
+  logger->set(l_osd_mclock_served_iops, served);
+  if (mclock_capacity.sample(
+	served, latency,
+	cct->_conf.get_val<double>("osd_mclock_calibration_min_util"))) {
+    dout(20) << __func__ << " served " << served << " latency " << latency
+	     << " " << mclock_capacity << dendl;
+    set_mclock_capacity();
+  }
+  utime_t base_lat;
+  base_lat.set_from_double(mclock_capacity.get_base_latency());
+  logger->tset(l_osd_mclock_base_lat, base_lat);
+}
+
+void OSD::set_mclock_capacity()
+{
+  const double iops = mclock_capacity.get_iops() / num_shards;
+  for (auto shard : shards) {
+    std::lock_guard l(shard->shard_lock);
+    shard->scheduler->update_capacity(iops,
+				      mclock_capacity.get_bytes_per_io());
+  }
+  logger->set(l_osd_mclock_capacity_iops, mclock_capacity.get_iops());
+}
+
 bool OSD::scrub_time_permit(utime_t now)
 {
   struct tm bdt;
@@ -7753,7 +8064,8 @@ void OSD::osdmap_subscribe(version_t epoch, bool force_request)
 
   latest_subscribed_epoch = std::max<uint64_t>(epoch, latest_subscribed_epoch);
 
-  if (monc->sub_want_increment("osdmap", epoch, CEPH_SUBSCRIBE_ONETIME) ||
+  if (monc->sub_want_increment("osdmap", epoch,
+				CEPH_SUBSCRIBE_ONETIME | CEPH_SUBSCRIBE_COMPRESSED) ||
       force_request) {
     monc->renew_subs();
   }
@@ -7864,6 +8176,18 @@ void OSD::handle_osd_map(MOSDMap *m)
     return;
   }
 
+  if (!m->compressed_maps.empty() || !m->compressed_incremental_maps.empty()) {
+    try {
+      m->decompress(cct);
+    } catch (buffer::error& e) {
+      derr << "handle_osd_map failed to decompress maps from "
+	   << m->get_source_inst() << ": " << e.what() << dendl;
+      m->put();
+      osdmap_subscribe(get_osdmap_epoch() + 1, true);
+      return;
+    }
+  }
+
   // share with the objecter
   if (!is_preboot())
     service.objecter->handle_osd_map(m);
@@ -9155,9 +9479,7 @@ void OSD::dispatch_context(PeeringCtx &ctx, PG *pg, OSDMapRef curmap,
 	continue;
       }
       service.maybe_share_map(con.get(), curmap);
-      for (auto m : ls) {
-	con->send_message2(m);
-      }
+      peering_batcher.queue(con, std::move(ls));
       ls.clear();
     }
   }
@@ -9170,6 +9492,25 @@ void OSD::dispatch_context(PeeringCtx &ctx, PG *pg, OSDMapRef curmap,
   }
 }
 
+void OSD::handle_fast_pg_peering_batch(MOSDPGPeeringBatch *m)
+{
+  dout(10) << __func__ << " " << *m << " from " << m->get_source() << dendl;
+  if (!require_osd_peer(m)) {
+    m->put();
+    return;
+  }
+  // decode_payload() has rejected anything but peering messages
+  for (auto& sub : m->msgs) {
+    // as if it had arrived on its own
+    sub->set_connection(m->get_connection());
+    sub->set_src(m->get_source());
+    sub->set_recv_stamp(m->get_recv_stamp());
+    ms_fast_dispatch(sub.detach());
+  }
+  m->msgs.clear();
+  m->put();
+}
+
 void OSD::handle_fast_pg_create(MOSDPGCreate2 *m)
 {
   dout(7) << __func__ << " " << *m << " from " << m->get_source() << dendl;
@@ -43,6 +43,7 @@
 #include "Session.h"
 
 #include "osd/scheduler/OpScheduler.h"
+#include "osd/scheduler/CapacityEstimator.h"
 
 #include <atomic>
 #include <map>
@@ -59,6 +60,8 @@
 #include "messages/MOSDOp.h"
 #include "common/EventTrace.h"
 #include "osd/osd_perf_counters.h"
+#include "osd/HeartbeatGossip.h"
+#include "osd/PeeringBatcher.h"
 
 #define CEPH_OSD_PROTOCOL    10 /* cluster internal */
 
@@ -96,6 +99,7 @@ class MOSDPGQuery;
 class MOSDPGNotify;
 class MOSDPGInfo;
 class MOSDPGRemove;
+class MOSDPGPeeringBatch;
 class MOSDForceRecovery;
 class MMonGetPurgedSnapsReply;
 
@@ -1363,6 +1367,7 @@ private:
     utime_t last_tx;    ///< last time we sent a ping request
     utime_t last_rx_front;  ///< last time we got a ping reply on the front side
     utime_t last_rx_back;   ///< last time we got a ping reply on the back side
+    utime_t last_padded_tx; ///< last ping padded to osd_heartbeat_min_size
     epoch_t epoch;      ///< most recent epoch we wanted this peer
     /// number of connections we send and receive heartbeat pings/replies
     static constexpr int HEARTBEAT_MAX_CONN = 2;
@@ -1436,6 +1441,7 @@ private:
   bool heartbeat_stop;
   std::atomic<bool> heartbeat_need_update;   
   map<int,HeartbeatInfo> heartbeat_peers;  ///< map of osd id to HeartbeatInfo
+  HeartbeatGossip hb_gossip;
   utime_t last_mon_heartbeat;
   Messenger *hb_front_client_messenger;
   Messenger *hb_back_client_messenger;
@@ -1466,6 +1472,10 @@ private:
   void heartbeat();
   void heartbeat_check();
   void heartbeat_entry();
+  /// seconds between two rounds of pings
+  double heartbeat_interval();
+  /// seconds without a reply before a peer is failed
+  double heartbeat_grace();
   void need_heartbeat_peer_update();
 
   void heartbeat_kick() {
@@ -1858,6 +1868,33 @@ protected:
 
   double scrub_sleep_time(bool must_scrub);
 
+  // -- deep scrub throttling by device utilization --
+  std::set<std::string> util_devices;           ///< raw devices of the store
+  std::map<std::string, uint64_t> last_io_ticks; ///< device -> io ms
+  ceph::mono_time last_io_ticks_stamp;
+  std::atomic<double> device_util = {0};         ///< busiest device, 0..1
+  void update_device_util();
+  /// delay before the next deep scrub chunk, if the data device is busy
+  double deep_scrub_util_sleep_time();
+
+  // -- mclock capacity calibration --
+  ceph::osd::scheduler::CapacityEstimator mclock_capacity;
+  PerfCounters::avg_tracker<uint64_t> mclock_commit_lat;
+  uint64_t mclock_dispatched_cost = 0;   ///< summed over the op shards
+  ceph::mono_time mclock_last_sample;
+  /// benchmark results not yet stored in the mon config database
+  std::map<std::string, std::string> mclock_measured;
+  int run_osd_bench_test(int64_t count, int64_t bsize, int64_t osize,
+			 int64_t onum, double *elapsed, std::ostream &ss);
+  /// benchmark the data device to seed the mclock capacity estimate
+  void mclock_calibrate();
+  /// store what mclock_calibrate() measured, so that it runs only once
+  void save_mclock_calibration();
+  /// correct the estimate from the load and latency since the last tick
+  void update_mclock_capacity();
+  /// hand each op shard its share of the estimated capacity
+  void set_mclock_capacity();
+
   // -- generic pg peering --
   PeeringCtx create_context();
   void dispatch_context(PeeringCtx &ctx, PG *pg, OSDMapRef curmap,
@@ -1889,6 +1926,7 @@ protected:
   void handle_pg_notify_nopg(const MNotifyRec& q);
   void handle_fast_pg_info(MOSDPGInfo *m);
   void handle_fast_pg_remove(MOSDPGRemove *m);
+  void handle_fast_pg_peering_batch(MOSDPGPeeringBatch *m);
 
 public:
   // used by OSDShard
@@ -1961,6 +1999,7 @@ private:
     case MSG_OSD_PG_RECOVERY_DELETE_REPLY:
     case MSG_OSD_PG_LEASE:
     case MSG_OSD_PG_LEASE_ACK:
+    case MSG_OSD_PG_PEERING_BATCH:
       return true;
     default:
       return false;
@@ -2062,6 +2101,8 @@ public:
   friend class OSDService;
 
 private:
+  PeeringBatcher peering_batcher;
+
   void set_perf_queries(const ConfigPayload &config_payload);
   MetricPayload get_perf_reports();
 
@@ -524,7 +524,7 @@ void PG::_finish_recovery(Context *c)
   }
 }
 
-void PG::start_recovery_op(const hobject_t& soid)
+void PG::start_recovery_op(const hobject_t& soid, const hobject_t *batch)
 {
   dout(10) << "start_recovery_op " << soid
 #ifdef DEBUG_RECOVERY_OIDS
@@ -536,7 +536,14 @@ void PG::start_recovery_op(const hobject_t& soid)
 #ifdef DEBUG_RECOVERY_OIDS
   recovering_oids.insert(soid);
 #endif
-  osd->start_recovery_op(this, soid);
+  if (batch) {
+    recovery_op_batch[soid] = *batch;
+    if (recovery_op_batch_active[*batch]++ > 0) {
+      // the batch holds an op already
+      return;
+    }
+  }
+  osd->start_recovery_op(this, batch ? *batch : soid);
 }
 
 void PG::finish_recovery_op(const hobject_t& soid, bool dequeue)
@@ -552,7 +559,22 @@ void PG::finish_recovery_op(const hobject_t& soid, bool dequeue)
   ceph_assert(recovering_oids.count(soid));
   recovering_oids.erase(recovering_oids.find(soid));
 #endif
-  osd->finish_recovery_op(this, soid, dequeue);
+  hobject_t op_oid = soid;
+  if (auto p = recovery_op_batch.find(soid); p != recovery_op_batch.end()) {
+    op_oid = p->second;
+    recovery_op_batch.erase(p);
+    auto q = recovery_op_batch_active.find(op_oid);
+    ceph_assert(q != recovery_op_batch_active.end());
+    if (--q->second > 0) {
+      // the rest of the batch is still in flight
+      if (!dequeue) {
+	queue_recovery();
+      }
+      return;
+    }
+    recovery_op_batch_active.erase(q);
+  }
+  osd->finish_recovery_op(this, op_oid, dequeue);
 
   if (!dequeue) {
     queue_recovery();
@@ -755,9 +777,14 @@ void PG::clear_recovery_state()
   while (recovery_ops_active > 0) {
 #ifdef DEBUG_RECOVERY_OIDS
     soid = *recovering_oids.begin();
+#else
+    // objects of a batch must be named to release the batch's op once
+    soid = recovery_op_batch.empty() ? hobject_t() :
+      recovery_op_batch.begin()->first;
 #endif
     finish_recovery_op(soid, true);
   }
+  ceph_assert(recovery_op_batch.empty());
 
   backfill_info.clear();
   peer_backfill_info.clear();
@@ -2485,6 +2512,13 @@ void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
 {
   OSDService *osds = osd;
   double scrub_sleep = osds->osd->scrub_sleep_time(scrubber.must_scrub);
+  if (state_test(PG_STATE_DEEP_SCRUB) &&
+      (scrubber.state == PG::Scrubber::NEW_CHUNK ||
+       scrubber.state == PG::Scrubber::INACTIVE) &&
+      scrubber.needs_sleep) {
+    scrub_sleep = std::max(scrub_sleep,
+			   osds->osd->deep_scrub_util_sleep_time());
+  }
   if (scrub_sleep > 0 &&
       (scrubber.state == PG::Scrubber::NEW_CHUNK ||
        scrubber.state == PG::Scrubber::INACTIVE) &&
@@ -667,6 +667,10 @@ protected:
   bool recovery_queued;
 
   int recovery_ops_active;
+  // objects of a backfill bulk batch share the OSD recovery op of the
+  // first object of the batch, which is released with the last of them
+  map<hobject_t, hobject_t> recovery_op_batch;  ///< object -> first object
+  map<hobject_t, int> recovery_op_batch_active; ///< first object -> in flight
   set<pg_shard_t> waiting_on_backfill;
 #ifdef DEBUG_RECOVERY_OIDS
   multiset<hobject_t> recovering_oids;
@@ -1062,7 +1066,9 @@ protected:
   void cancel_recovery();
   void clear_recovery_state();
   virtual void _clear_recovery_state() = 0;
-  void start_recovery_op(const hobject_t& soid);
+  /// @param batch first object of the backfill bulk batch @p soid is in
+  void start_recovery_op(const hobject_t& soid,
+			 const hobject_t *batch = nullptr);
   void finish_recovery_op(const hobject_t& soid, bool dequeue=false);
 
   virtual void _split_into(pg_t child_pgid, PG *child, unsigned split_bits) = 0;
@@ -39,6 +39,13 @@ static ostream& _prefix(std::ostream *_dout, PGBackend *pgb) {
   return pgb->get_parent()->gen_dbg_prefix(*_dout);
 }
 
+static ceph::timespan thread_cpu_time()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
 void PGBackend::recover_delete_object(const hobject_t &oid, eversion_t v,
 				      RecoveryHandle *h)
 {
@@ -618,7 +625,10 @@ int PGBackend::be_scan_list(
       o.attrs);
 
     if (pos.deep) {
+      const auto cpu_start = thread_cpu_time();
       r = be_deep_scrub(poid, map, pos, o);
+      get_parent()->get_logger()->tinc(l_osd_scrub_deep_cpu,
+				       thread_cpu_time() - cpu_start);
     }
     dout(25) << __func__ << "  " << poid << dendl;
   } else if (r == -ENOENT) {
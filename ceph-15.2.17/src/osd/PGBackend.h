@@ -335,9 +335,11 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
     */
    struct RecoveryHandle {
      bool cache_dont_need;
+     /// holds a backfill bulk batch, which may go out in fewer messages
+     bool bulk_backfill;
      map<pg_shard_t, vector<pair<hobject_t, eversion_t> > > deletes;
 
-     RecoveryHandle(): cache_dont_need(false) {}
+     RecoveryHandle(): cache_dont_need(false), bulk_backfill(false) {}
      virtual ~RecoveryHandle() {}
    };
 
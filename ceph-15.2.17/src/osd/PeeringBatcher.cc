@@ -0,0 +1,85 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "PeeringBatcher.h"
+
+#include "common/debug.h"
+#include "common/perf_counters.h"
+#include "include/ceph_features.h"
+#include "include/Context.h"
+#include "messages/MOSDPGPeeringBatch.h"
+#include "osd/osd_perf_counters.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix *_dout << "osd.peering_batcher "
+
+void PeeringBatcher::init(PerfCounters *perf)
+{
+  logger = perf;
+  std::lock_guard l{lock};
+  timer.init();
+}
+
+void PeeringBatcher::shutdown()
+{
+  std::lock_guard l{lock};
+  timer.shutdown();
+  pending.clear();
+}
+
+void PeeringBatcher::queue(const ConnectionRef& con,
+			   std::vector<MessageRef>&& ls)
+{
+  const double delay = cct->_conf.get_val<double>("osd_peering_batch_delay");
+  if (delay <= 0 ||
+      !HAVE_FEATURE(con->get_features(), OSD_PEERING_BATCH)) {
+    for (auto& m : ls) {
+      con->send_message2(std::move(m));
+    }
+    return;
+  }
+  const auto max_messages =
+    cct->_conf.get_val<uint64_t>("osd_peering_batch_max_messages");
+  std::lock_guard l{lock};
+  for (auto& m : ls) {
+    if (!MOSDPGPeeringBatch::is_batchable(m->get_type())) {
+      // send it after what is pending, to keep the order
+      _flush(con);
+      con->send_message2(std::move(m));
+      continue;
+    }
+    auto& q = pending[con];
+    q.push_back(std::move(m));
+    if (q.size() >= max_messages) {
+      _flush(con);
+    } else if (q.size() == 1) {
+      timer.add_event_after(
+	delay,
+	new LambdaContext([this, con](int) {
+	  _flush(con);
+	}));
+    }
+  }
+}
+
+void PeeringBatcher::_flush(const ConnectionRef& con)
+{
+  ceph_assert(ceph_mutex_is_locked(lock));
+  auto p = pending.find(con);
+  if (p == pending.end()) {
+    return;
+  }
+  auto msgs = std::move(p->second);
+  pending.erase(p);
+  if (msgs.size() == 1) {
+    con->send_message2(std::move(msgs.front()));
+    return;
+  }
+  dout(20) << __func__ << " " << msgs.size() << " messages to "
+	   << con->get_peer_addr() << dendl;
+  logger->inc(l_osd_peering_batch);
+  logger->inc(l_osd_peering_batch_msgs, msgs.size());
+  con->send_message2(ceph::make_message<MOSDPGPeeringBatch>(std::move(msgs)));
+}
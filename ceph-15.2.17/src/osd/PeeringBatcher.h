@@ -0,0 +1,47 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/Timer.h"
+#include "msg/Connection.h"
+#include "msg/MessageRef.h"
+
+class PerfCounters;
+
+/**
+ * Coalesce peering messages bound for the same OSD across PGs.
+ *
+ * Every PG sends the messages of a peering event as soon as it has
+ * processed it, so an OSD coming back up sends thousands of small
+ * queries, notifies, infos and logs to the same few peers.  With
+ * osd_peering_batch_delay set, they are held per connection and sent as
+ * one MOSDPGPeeringBatch once osd_peering_batch_max_messages are pending
+ * or the delay has passed since the first of them was queued.  Messages
+ * keep their order on each connection.  Peers without
+ * CEPH_FEATURE_OSD_PEERING_BATCH get every message on its own.
+ */
+class PeeringBatcher {
+public:
+  explicit PeeringBatcher(CephContext *cct)
+    : cct(cct), timer(cct, lock) {}
+
+  void init(PerfCounters *logger);
+  void shutdown();
+
+  /// send ls to con, now or as part of a batch
+  void queue(const ConnectionRef& con, std::vector<MessageRef>&& ls);
+
+private:
+  void _flush(const ConnectionRef& con);
+
+  CephContext *cct;
+  PerfCounters *logger = nullptr;
+  ceph::mutex lock = ceph::make_mutex("PeeringBatcher::lock");
+  SafeTimer timer;
+  std::map<ConnectionRef, std::vector<MessageRef>> pending;
+};
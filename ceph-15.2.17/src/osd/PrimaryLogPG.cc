@@ -2358,7 +2358,8 @@ PrimaryLogPG::cache_result_t PrimaryLogPG::maybe_handle_manifest_detail(
     if (op.op == CEPH_OSD_OP_SET_REDIRECT ||
 	op.op == CEPH_OSD_OP_SET_CHUNK || 
 	op.op == CEPH_OSD_OP_UNSET_MANIFEST ||
-	op.op == CEPH_OSD_OP_TIER_FLUSH) {
+	op.op == CEPH_OSD_OP_TIER_FLUSH ||
+	op.op == CEPH_OSD_OP_TIER_EVICT) {
       return cache_result_t::NOOP;
     } else if (op.op == CEPH_OSD_OP_TIER_PROMOTE) {
       bool is_dirty = false;
@@ -2402,6 +2403,16 @@ PrimaryLogPG::cache_result_t PrimaryLogPG::maybe_handle_manifest_detail(
       ceph_assert(m->get_type() == CEPH_MSG_OSD_OP);
       hobject_t head = m->get_hobj();
 
+      // xattrs stay with the manifest object; reading them does not need
+      // the evicted chunks back
+      if (std::all_of(m->ops.begin(), m->ops.end(), [](const OSDOp& o) {
+	    return o.op.op == CEPH_OSD_OP_GETXATTR ||
+		   o.op.op == CEPH_OSD_OP_GETXATTRS ||
+		   o.op.op == CEPH_OSD_OP_CMPXATTR;
+	  })) {
+	return cache_result_t::NOOP;
+      }
+
       if (is_degraded_or_backfilling_object(head)) {
 	dout(20) << __func__ << ": " << head << " is degraded, waiting" << dendl;
 	wait_for_degraded_object(head, op);
@@ -5691,6 +5702,7 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
     case CEPH_OSD_OP_SET_REDIRECT:
     case CEPH_OSD_OP_TIER_PROMOTE:
     case CEPH_OSD_OP_TIER_FLUSH:
+    case CEPH_OSD_OP_TIER_EVICT:
       break;
     default:
       if (op.op & CEPH_OSD_OP_MODE_WR)
@@ -6931,7 +6943,7 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
 	for (auto &p : oi.manifest.chunk_map) {
 	  if ((p.first <= src_offset && p.first + p.second.length > src_offset) ||
-	      (p.first > src_offset && p.first <= src_offset + src_length)) {
+	      (p.first > src_offset && p.first < src_offset + src_length)) {
 	    dout(20) << __func__ << " overlapped !! offset: " << src_offset << " length: " << src_length
 		    << " chunk_info: " << p << dendl;
 	    result = -EOPNOTSUPP;
@@ -7099,6 +7111,79 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
       break;
 
+    case CEPH_OSD_OP_TIER_EVICT:
+      ++ctx->num_write;
+      result = 0;
+      {
+	if (pool.info.is_tier()) {
+	  result = -EINVAL;
+	  break;
+	}
+	if (!obs.exists) {
+	  result = -ENOENT;
+	  break;
+	}
+	if (get_osdmap()->require_osd_release < ceph_release_t::octopus) {
+	  result = -EOPNOTSUPP;
+	  break;
+	}
+	if (!oi.has_manifest() || !oi.manifest.is_chunked()) {
+	  result = -EINVAL;
+	  break;
+	}
+
+	// only clean chunks that cover the whole object can be dropped; the
+	// data is read back from the chunk pool on the next access
+	uint64_t chunks_size = 0;
+	bool is_dirty = false;
+	bool all_missing = true;
+	for (auto& p : oi.manifest.chunk_map) {
+	  if (p.second.is_dirty()) {
+	    is_dirty = true;
+	    break;
+	  }
+	  if (!p.second.is_missing()) {
+	    all_missing = false;
+	  }
+	  chunks_size += p.second.length;
+	}
+	if (is_dirty) {
+	  result = -EBUSY;
+	  break;
+	}
+	if (chunks_size != oi.size) {
+	  dout(10) << " chunks cover " << chunks_size << " of " << oi.size
+		   << " bytes, not evicting" << dendl;
+	  result = -EINVAL;
+	  break;
+	}
+	if (oi.size == 0 || all_missing) {
+	  break;
+	}
+
+	// punch out the data but keep the size, which reads and stat still
+	// report
+	for (auto& p : oi.manifest.chunk_map) {
+	  if (p.second.is_missing()) {
+	    continue;
+	  }
+	  t->zero(soid, p.first, p.second.length);
+	  interval_set<uint64_t> punched;
+	  punched.insert(p.first, p.second.length);
+	  ctx->modified_ranges.union_of(punched);
+	  ctx->clean_regions.mark_data_region_dirty(p.first, p.second.length);
+	  p.second.set_flag(chunk_info_t::FLAG_MISSING);
+	}
+	oi.clear_data_digest();
+	ctx->delta_stats.num_wr++;
+	ctx->modify = true;
+	osd->logger->inc(l_osd_tier_manifest_evict);
+	dout(10) << "tier-evict oid:" << oi.soid << " user_version: "
+		 << oi.user_version << dendl;
+      }
+
+      break;
+
     case CEPH_OSD_OP_UNSET_MANIFEST:
       ++ctx->num_write;
       result = 0;
@@ -13023,8 +13108,20 @@ uint64_t PrimaryLogPG::recover_backfill(
   }
   backfill_info.trim_to(last_backfill_started);
 
+  // on replicated pools, objects up to bulk_object_size are pushed in
+  // batches of up to bulk_max_objects, each batch holding a single
+  // recovery op, here and in the OSD's count
+  const uint64_t bulk_max_objects = pool.info.is_replicated() ?
+    cct->_conf.get_val<uint64_t>("osd_backfill_bulk_max_objects") : 0;
+  const uint64_t bulk_object_size =
+    cct->_conf.get_val<Option::size_t>("osd_backfill_bulk_object_size");
+  uint64_t bulk_objects = 0;  // in the batch still open, if any
+  hobject_t bulk_batch;       // first object of that batch
+
   PGBackend::RecoveryHandle *h = pgbackend->open_recovery_op();
-  while (ops < max) {
+  PGBackend::RecoveryHandle *bulk_h = pgbackend->open_recovery_op();
+  bulk_h->bulk_backfill = true;
+  while (ops < max || bulk_objects > 0) {
     if (backfill_info.begin <= earliest_peer_backfill() &&
 	!backfill_info.extends_to_end() && backfill_info.empty()) {
       hobject_t next = backfill_info.end;
@@ -13036,6 +13133,18 @@ uint64_t PrimaryLogPG::recover_backfill(
 
     dout(20) << "   my backfill interval " << backfill_info << dendl;
 
+    // only an open batch may run past max; a scan is an op of its own
+    if (ops >= max &&
+	std::any_of(get_backfill_targets().begin(),
+		    get_backfill_targets().end(),
+		    [this](const pg_shard_t& bt) {
+		      const BackfillInterval& pbi = peer_backfill_info[bt];
+		      return pbi.begin <= backfill_info.begin &&
+			!pbi.extends_to_end() && pbi.empty();
+		    })) {
+      break;
+    }
+
     bool sent_scan = false;
     for (set<pg_shard_t>::const_iterator i = get_backfill_targets().begin();
 	 i != get_backfill_targets().end();
@@ -13146,6 +13255,11 @@ uint64_t PrimaryLogPG::recover_backfill(
       if (!need_ver_targs.empty() || !missing_targs.empty()) {
 	ObjectContextRef obc = get_object_context(backfill_info.begin, false);
 	ceph_assert(obc);
+	const bool bulk = bulk_max_objects > 1 &&
+	  obc->obs.oi.size <= bulk_object_size;
+	if (ops >= max && !(bulk && bulk_objects > 0)) {
+	  break;
+	}
 	if (obc->get_recovery_read()) {
 	  if (!need_ver_targs.empty()) {
 	    dout(20) << " BACKFILL replacing " << check
@@ -13161,13 +13275,29 @@ uint64_t PrimaryLogPG::recover_backfill(
 	  all_push.insert(all_push.end(), missing_targs.begin(), missing_targs.end());
 
 	  handle.reset_tp_timeout();
-	  int r = prep_backfill_object_push(backfill_info.begin, obj_v, obc, all_push, h);
+	  if (bulk && bulk_objects == 0) {
+	    bulk_batch = backfill_info.begin;
+	  }
+	  int r = prep_backfill_object_push(backfill_info.begin, obj_v, obc,
+					    all_push, bulk ? bulk_h : h,
+					    bulk ? &bulk_batch : nullptr);
 	  if (r < 0) {
 	    *work_started = true;
 	    dout(0) << __func__ << " Error " << r << " trying to backfill " << backfill_info.begin << dendl;
 	    break;
 	  }
-	  ops++;
+	  osd->logger->inc(l_osd_backfill_objects);
+	  if (!bulk) {
+	    ops++;
+	  } else {
+	    if (bulk_objects == 0) {
+	      ops++;
+	      osd->logger->inc(l_osd_backfill_bulk_batches);
+	    }
+	    if (++bulk_objects == bulk_max_objects) {
+	      bulk_objects = 0;
+	    }
+	  }
 	} else {
 	  *work_started = true;
 	  dout(20) << "backfill blocking on " << backfill_info.begin
@@ -13234,6 +13364,7 @@ uint64_t PrimaryLogPG::recover_backfill(
   }
 
   pgbackend->run_recovery_op(h, get_recovery_op_priority());
+  pgbackend->run_recovery_op(bulk_h, get_recovery_op_priority());
 
   dout(5) << "backfill_pos is " << backfill_pos << dendl;
   for (set<hobject_t>::iterator i = backfills_in_flight.begin();
@@ -13317,7 +13448,8 @@ int PrimaryLogPG::prep_backfill_object_push(
   hobject_t oid, eversion_t v,
   ObjectContextRef obc,
   vector<pg_shard_t> peers,
-  PGBackend::RecoveryHandle *h)
+  PGBackend::RecoveryHandle *h,
+  const hobject_t *batch)
 {
   dout(10) << __func__ << " " << oid << " v " << v << " to peers " << peers << dendl;
   ceph_assert(!peers.empty());
@@ -13327,7 +13459,7 @@ int PrimaryLogPG::prep_backfill_object_push(
 
   ceph_assert(!recovering.count(oid));
 
-  start_recovery_op(oid);
+  start_recovery_op(oid, batch);
   recovering.insert(make_pair(oid, obc));
 
   int r = pgbackend->recover_object(
@@ -1343,7 +1343,8 @@ protected:
   int prep_backfill_object_push(
     hobject_t oid, eversion_t v, ObjectContextRef obc,
     vector<pg_shard_t> peers,
-    PGBackend::RecoveryHandle *h);
+    PGBackend::RecoveryHandle *h,
+    const hobject_t *batch = nullptr);
   void send_remove_op(const hobject_t& oid, eversion_t v, pg_shard_t peer);
 
 
@@ -34,6 +34,9 @@ static ostream& _prefix(std::ostream *_dout, ReplicatedBackend *pgb) {
 }
 
 namespace {
+// encoded omap entries deep scrub hashes in one go
+constexpr unsigned OMAP_SCRUB_BATCH_BYTES = 64 << 10;
+
 class PG_SendMessageOnConn: public Context {
   PGBackend::Listener *pg;
   Message *reply;
@@ -113,7 +116,7 @@ void ReplicatedBackend::run_recovery_op(
   int priority)
 {
   RPGHandle *h = static_cast<RPGHandle *>(_h);
-  send_pushes(priority, h->pushes);
+  send_pushes(priority, h->pushes, h->bulk_backfill);
   send_pulls(priority, h->pulls);
   send_recovery_deletes(priority, h->deletes);
   delete h;
@@ -637,22 +640,31 @@ int ReplicatedBackend::be_deep_scrub(
     }
 
     bufferlist bl;
-    r = store->read(
-      ch,
-      ghobject_t(
-	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-      pos.data_pos,
-      cct->_conf->osd_deep_scrub_stride, bl,
-      fadvise_flags);
+    const ghobject_t oid(
+      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard);
+    if (cct->_conf.get_val<bool>("osd_deep_scrub_reuse_csum")) {
+      uint32_t crc = pos.data_hash.digest();
+      r = store->read_with_crc32c(
+	ch, oid, pos.data_pos, cct->_conf->osd_deep_scrub_stride, bl,
+	&crc, fadvise_flags);
+      if (r > 0) {
+	pos.data_hash = bufferhash(crc);
+      }
+    } else {
+      r = store->read(
+	ch, oid, pos.data_pos, cct->_conf->osd_deep_scrub_stride, bl,
+	fadvise_flags);
+      if (r > 0) {
+	pos.data_hash << bl;
+      }
+    }
     if (r < 0) {
       dout(20) << __func__ << "  " << poid << " got "
 	       << r << " on read, read_error" << dendl;
       o.read_error = true;
       return 0;
     }
-    if (r > 0) {
-      pos.data_hash << bl;
-    }
+    get_parent()->get_logger()->inc(l_osd_scrub_deep_bytes, r);
     pos.data_pos += r;
     if (r == cct->_conf->osd_deep_scrub_stride) {
       dout(20) << __func__ << "  " << poid << " more data, digest so far 0x"
@@ -702,19 +714,28 @@ int ReplicatedBackend::be_deep_scrub(
     iter->seek_to_first();
   }
   int max = g_conf()->osd_deep_scrub_keys;
+  // encode entries back to back and hash them a batch at a time; crc32c
+  // over the concatenation is the same as entry by entry
+  bufferlist batch;
+  auto hash_batch = [&]() {
+    get_parent()->get_logger()->inc(l_osd_scrub_deep_bytes, batch.length());
+    pos.omap_hash << batch;
+    batch.clear();
+  };
   while (iter->status() == 0 && iter->valid()) {
     pos.omap_bytes += iter->value().length();
     ++pos.omap_keys;
     --max;
-    // fixme: we can do this more efficiently.
-    bufferlist bl;
-    encode(iter->key(), bl);
-    encode(iter->value(), bl);
-    pos.omap_hash << bl;
+    encode(iter->key(), batch);
+    encode(iter->value(), batch);
+    if (batch.length() >= OMAP_SCRUB_BATCH_BYTES) {
+      hash_batch();
+    }
 
     iter->next();
 
     if (iter->valid() && max == 0) {
+      hash_batch();
       pos.omap_pos = iter->key();
       return -EINPROGRESS;
     }
@@ -725,6 +746,7 @@ int ReplicatedBackend::be_deep_scrub(
       return 0;
     }
   }
+  hash_batch();
 
   if (pos.omap_keys > cct->_conf->
 	osd_deep_scrub_large_omap_object_key_threshold ||
@@ -1182,6 +1204,11 @@ void ReplicatedBackend::calc_head_subsets(
     data_subset.intersection_of(it->second.clean_regions.get_dirty_regions());
     dout(10) << "calc_head_subsets " << head
              << " data_subset " << data_subset << dendl;
+    if (data_subset.size() < size) {
+      get_parent()->get_logger()->inc(l_osd_recovery_partial);
+      get_parent()->get_logger()->inc(l_osd_recovery_clean_bytes,
+				      size - data_subset.size());
+    }
   }
 
   if (get_parent()->get_pool().allow_incomplete_clones()) {
@@ -1933,7 +1960,34 @@ void ReplicatedBackend::handle_push(
   }
 }
 
-void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &pushes)
+size_t ReplicatedBackend::get_push_message_len(
+  CephContext *cct,
+  vector<PushOp>::const_iterator begin,
+  vector<PushOp>::const_iterator end,
+  bool bulk_backfill)
+{
+  uint64_t max_pushes = cct->_conf->osd_max_push_objects;
+  if (bulk_backfill) {
+    // a batch of small objects queued by backfill goes out in one message
+    max_pushes = std::max<uint64_t>(
+      max_pushes,
+      cct->_conf.get_val<uint64_t>("osd_backfill_bulk_max_objects"));
+  }
+  uint64_t cost = 0;
+  size_t pushes = 0;
+  for (auto j = begin;
+       (j != end &&
+	cost < cct->_conf->osd_max_push_cost &&
+	pushes < max_pushes);
+       ++j) {
+    cost += j->cost(cct);
+    pushes += 1;
+  }
+  return pushes;
+}
+
+void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &pushes,
+				    bool bulk_backfill)
 {
   for (map<pg_shard_t, vector<PushOp> >::iterator i = pushes.begin();
        i != pushes.end();
@@ -1946,7 +2000,6 @@ void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &
     vector<PushOp>::iterator j = i->second.begin();
     while (j != i->second.end()) {
       uint64_t cost = 0;
-      uint64_t pushes = 0;
       MOSDPGPush *msg = new MOSDPGPush();
       msg->from = get_parent()->whoami_shard();
       msg->pgid = get_parent()->primary_spg_t();
@@ -1954,15 +2007,13 @@ void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &
       msg->min_epoch = get_parent()->get_last_peering_reset_epoch();
       msg->set_priority(prio);
       msg->is_repair = get_parent()->pg_is_repair();
-      for (;
-           (j != i->second.end() &&
-	    cost < cct->_conf->osd_max_push_cost &&
-	    pushes < cct->_conf->osd_max_push_objects) ;
-	   ++j) {
+      for (size_t n = get_push_message_len(cct, j, i->second.cend(),
+					   bulk_backfill);
+	   n > 0;
+	   --n, ++j) {
 	dout(20) << __func__ << ": sending push " << *j
 		 << " to osd." << i->first << dendl;
 	cost += j->cost(cct);
-	pushes += 1;
 	msg->pushes.push_back(*j);
       }
       msg->set_cost(cost);
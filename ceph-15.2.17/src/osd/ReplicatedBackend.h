@@ -259,7 +259,21 @@ private:
 			       bufferlist *data_usable);
   void _failed_pull(pg_shard_t from, const hobject_t &soid);
 
-  void send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &pushes);
+  void send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &pushes,
+		   bool bulk_backfill = false);
+public:
+  /**
+   * The number of pushes from @p begin on that go out in one MOSDPGPush:
+   * up to osd_max_push_objects, or osd_backfill_bulk_max_objects for the
+   * pushes of a backfill bulk batch, and until osd_max_push_cost is
+   * reached.  Always at least one, unless there are none.
+   */
+  static size_t get_push_message_len(
+    CephContext *cct,
+    vector<PushOp>::const_iterator begin,
+    vector<PushOp>::const_iterator end,
+    bool bulk_backfill);
+private:
   void prep_push_op_blank(const hobject_t& soid, PushOp *op);
   void send_pulls(
     int priority,
@@ -235,6 +235,9 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     "Failed tier flush attempts");
   osd_plb.add_u64_counter(
     l_osd_tier_evict, "tier_evict", "Tier evictions");
+  osd_plb.add_u64_counter(
+    l_osd_tier_manifest_evict, "tier_manifest_evict",
+    "Chunked objects whose data was dropped by tier-evict");
   osd_plb.add_u64_counter(
     l_osd_tier_whiteout, "tier_whiteout", "Tier whiteouts");
   osd_plb.add_u64_counter(
@@ -278,6 +281,66 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64_counter(
+    l_osd_scrub_deep_bytes, "scrub_deep_bytes",
+    "Data and omap bytes hashed by deep scrub", NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_time(
+    l_osd_scrub_deep_cpu, "scrub_deep_cpu",
+    "CPU time spent reading and hashing objects for deep scrub");
+  osd_plb.add_u64_counter(
+    l_osd_scrub_deep_util_sleep, "scrub_deep_util_sleep",
+    "Deep scrub chunks delayed because the data device was busy");
+
+  osd_plb.add_u64_counter(
+    l_osd_backfill_objects, "backfill_objects",
+    "Objects pushed by backfill", "bfo", PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_u64_counter(
+    l_osd_backfill_bulk_batches, "backfill_bulk_batches",
+    "Batches of small objects backfill pushed as one recovery op");
+
+  osd_plb.add_u64_counter(
+    l_osd_peering_batch, "peering_batch",
+    "Peering message batches sent");
+  osd_plb.add_u64_counter(
+    l_osd_peering_batch_msgs, "peering_batch_msgs",
+    "Peering messages sent in batches");
+
+  osd_plb.add_u64(
+    l_osd_hb_suspects, "heartbeat_suspects",
+    "Heartbeat peers we fail to hear from");
+  osd_plb.add_u64_counter(
+    l_osd_hb_failure_reports, "heartbeat_failure_reports",
+    "Failure reports sent to the monitors");
+  osd_plb.add_u64_counter(
+    l_osd_hb_failure_confirmations, "heartbeat_failure_confirmations",
+    "Peers named as confirming our failure reports");
+
+  osd_plb.add_u64_counter(
+    l_osd_recovery_partial, "recovery_partial_objects",
+    "Objects pushed with only the extents the pg log marks modified");
+  osd_plb.add_u64_counter(
+    l_osd_recovery_clean_bytes, "recovery_clean_bytes",
+    "Object bytes the pg log marks clean, left out of recovery pushes",
+    NULL, 0, unit_t(UNIT_BYTES));
+
+  osd_plb.add_u64(
+    l_osd_mclock_bench_iops, "mclock_bench_iops",
+    "4K write IOPS measured by the startup benchmark");
+  osd_plb.add_u64(
+    l_osd_mclock_capacity_iops, "mclock_capacity_iops",
+    "Estimated sustained device capacity in 4K IOPS",
+    "mcap", PerfCountersBuilder::PRIO_USEFUL);
+  osd_plb.add_u64(
+    l_osd_mclock_bytes_per_io, "mclock_bytes_per_io",
+    "Bytes costing as much device time as one 4K IO",
+    NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_u64(
+    l_osd_mclock_served_iops, "mclock_served_iops",
+    "Cost dispatched by the mclock schedulers per second, in 4K IOs");
+  osd_plb.add_time(
+    l_osd_mclock_base_lat, "mclock_base_latency",
+    "Lowest recent store commit latency");
+
   return osd_plb.create_perf_counters();
 }
  
@@ -94,6 +94,7 @@ enum {
   l_osd_tier_try_flush,
   l_osd_tier_try_flush_fail,
   l_osd_tier_evict,
+  l_osd_tier_manifest_evict,
   l_osd_tier_whiteout,
   l_osd_tier_dirty,
   l_osd_tier_clean,
@@ -118,6 +119,29 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_scrub_deep_bytes,
+  l_osd_scrub_deep_cpu,
+  l_osd_scrub_deep_util_sleep,
+
+  l_osd_backfill_objects,
+  l_osd_backfill_bulk_batches,
+
+  l_osd_peering_batch,
+  l_osd_peering_batch_msgs,
+
+  l_osd_hb_suspects,
+  l_osd_hb_failure_reports,
+  l_osd_hb_failure_confirmations,
+
+  l_osd_recovery_partial,
+  l_osd_recovery_clean_bytes,
+
+  l_osd_mclock_bench_iops,
+  l_osd_mclock_capacity_iops,
+  l_osd_mclock_bytes_per_io,
+  l_osd_mclock_served_iops,
+  l_osd_mclock_base_lat,
+
   l_osd_last,
 };
 
@@ -0,0 +1,55 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "osd/scheduler/CapacityEstimator.h"
+
+namespace ceph::osd::scheduler {
+
+void CapacityEstimator::set_benchmark(double _iops, double _bytes_per_io)
+{
+  bench_iops = _iops;
+  bytes_per_io = _bytes_per_io;
+  iops = _iops;
+  base_latency = 0;
+}
+
+bool CapacityEstimator::sample(double served, double latency, double min_util)
+{
+  if (!is_calibrated() || served <= 0 || latency <= 0) {
+    return false;
+  }
+  if (base_latency == 0 || latency < base_latency) {
+    base_latency = latency;
+  } else {
+    base_latency = std::min(latency, base_latency * base_latency_drift);
+  }
+  const double util = 1.0 - base_latency / latency;
+  if (util <= 0 || util < min_util) {
+    return false;
+  }
+  iops = (1.0 - alpha) * iops + alpha * (served / util);
+  iops = std::clamp(iops, bench_iops * min_bench_ratio,
+		    bench_iops * max_bench_ratio);
+  return true;
+}
+
+std::ostream& operator<<(std::ostream& out, const CapacityEstimator& c)
+{
+  return out << "capacity(" << c.get_iops() << " iops, bench "
+	     << c.get_bench_iops() << " iops, " << c.get_bytes_per_io()
+	     << " bytes/io, base lat " << c.get_base_latency() << ")";
+}
+
+}
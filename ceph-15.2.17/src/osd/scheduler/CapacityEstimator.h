@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+
+#pragma once
+
+#include <ostream>
+
+namespace ceph::osd::scheduler {
+
+/**
+ * Estimates the sustained capacity of the OSD's data device, in IOs of
+ * the benchmark's 4K size per second.
+ *
+ * The estimate starts from a benchmark run when the OSD starts, and is
+ * then corrected from what the device actually does.  Each sample pairs
+ * the IO the schedulers dispatched per second with the store's commit
+ * latency over the same period.  The lowest latency seen approximates
+ * the unloaded service time; as a single server queue, the device was
+ * busy 1 - base / latency of the time, and the dispatched rate divided
+ * by that is what it would sustain at full load.  Samples taken while
+ * the device was mostly idle say little about its capacity and are
+ * ignored.
+ */
+class CapacityEstimator {
+  double bench_iops = 0;
+  double bytes_per_io = 0;
+  double iops = 0;
+  double base_latency = 0;
+
+public:
+  /// weight of each accepted sample
+  static constexpr double alpha = 0.2;
+  /// growth of the base latency per sample, so that it follows a device
+  /// that got slower for good
+  static constexpr double base_latency_drift = 1.001;
+  /// how far the estimate may stray from the benchmark
+  static constexpr double min_bench_ratio = 0.1;
+  static constexpr double max_bench_ratio = 2.0;
+
+  /// seed from a benchmark: 4K IOPS, and the bytes transferred at full
+  /// bandwidth in the time of one such IO
+  void set_benchmark(double iops, double bytes_per_io);
+
+  /**
+   * Account for one sample period.
+   *
+   * @param served IO dispatched per second, in 4K IO units
+   * @param latency mean commit latency in seconds
+   * @param min_util least device utilization that makes a sample count
+   * @return true if the estimate changed
+   */
+  bool sample(double served, double latency, double min_util);
+
+  bool is_calibrated() const {
+    return bench_iops > 0;
+  }
+  double get_bench_iops() const {
+    return bench_iops;
+  }
+  double get_bytes_per_io() const {
+    return bytes_per_io;
+  }
+  double get_iops() const {
+    return iops;
+  }
+  double get_base_latency() const {
+    return base_latency;
+  }
+};
+
+std::ostream& operator<<(std::ostream& out, const CapacityEstimator& c);
+
+}
@@ -48,6 +48,15 @@ public:
   // Print human readable brief description with relevant parameters
   virtual void print(std::ostream &out) const = 0;
 
+  // Set the device capacity this scheduler may hand out, in 4K IOs per
+  // second, and the bytes that take as long as one such IO
+  virtual void update_capacity(double iops, double bytes_per_io) {}
+
+  // Total cost of the ops dequeued so far, in 4K IOs; 0 if not tracked
+  virtual uint64_t get_dispatched_cost() const {
+    return 0;
+  }
+
   // Destructor
   virtual ~OpScheduler() {};
 };
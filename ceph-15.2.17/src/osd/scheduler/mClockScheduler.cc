@@ -31,6 +31,7 @@ using namespace std::placeholders;
 namespace ceph::osd::scheduler {
 
 mClockScheduler::mClockScheduler(CephContext *cct) :
+  cct(cct),
   scheduler(
     std::bind(&mClockScheduler::ClientRegistry::get_info,
 	      &client_registry,
@@ -39,27 +40,55 @@ mClockScheduler::mClockScheduler(CephContext *cct) :
     cct->_conf.get_val<double>("osd_mclock_scheduler_anticipation_timeout"))
 {
   cct->_conf.add_observer(this);
-  client_registry.update_from_config(cct->_conf);
+  client_registry.update_from_config(cct->_conf, capacity);
 }
 
-void mClockScheduler::ClientRegistry::update_from_config(const ConfigProxy &conf)
+void mClockScheduler::ClientRegistry::update_from_config(
+  const ConfigProxy &conf,
+  double capacity)
 {
+  double client_res = conf.get_val<uint64_t>("osd_mclock_scheduler_client_res");
+  double client_lim = conf.get_val<uint64_t>("osd_mclock_scheduler_client_lim");
+  double recovery_res =
+    conf.get_val<uint64_t>("osd_mclock_scheduler_background_recovery_res");
+  double recovery_lim =
+    conf.get_val<uint64_t>("osd_mclock_scheduler_background_recovery_lim");
+  double best_effort_res =
+    conf.get_val<uint64_t>("osd_mclock_scheduler_background_best_effort_res");
+  double best_effort_lim =
+    conf.get_val<uint64_t>("osd_mclock_scheduler_background_best_effort_lim");
+
+  if (capacity > 0) {
+    // reservations beyond what the device can do would leave the weights
+    // no say, and limits beyond it are never reached
+    const double res_sum = client_res + recovery_res + best_effort_res;
+    if (res_sum > capacity) {
+      const double scale = capacity / res_sum;
+      client_res *= scale;
+      recovery_res *= scale;
+      best_effort_res *= scale;
+    }
+    client_lim = std::min(client_lim, capacity);
+    recovery_lim = std::min(recovery_lim, capacity);
+    best_effort_lim = std::min(best_effort_lim, capacity);
+  }
+
   default_external_client_info.update(
-    conf.get_val<uint64_t>("osd_mclock_scheduler_client_res"),
+    client_res,
     conf.get_val<uint64_t>("osd_mclock_scheduler_client_wgt"),
-    conf.get_val<uint64_t>("osd_mclock_scheduler_client_lim"));
+    client_lim);
 
   internal_client_infos[
     static_cast<size_t>(op_scheduler_class::background_recovery)].update(
-    conf.get_val<uint64_t>("osd_mclock_scheduler_background_recovery_res"),
+    recovery_res,
     conf.get_val<uint64_t>("osd_mclock_scheduler_background_recovery_wgt"),
-    conf.get_val<uint64_t>("osd_mclock_scheduler_background_recovery_lim"));
+    recovery_lim);
 
   internal_client_infos[
     static_cast<size_t>(op_scheduler_class::background_best_effort)].update(
-    conf.get_val<uint64_t>("osd_mclock_scheduler_background_best_effort_res"),
+    best_effort_res,
     conf.get_val<uint64_t>("osd_mclock_scheduler_background_best_effort_wgt"),
-    conf.get_val<uint64_t>("osd_mclock_scheduler_background_best_effort_lim"));
+    best_effort_lim);
 }
 
 const dmc::ClientInfo *mClockScheduler::ClientRegistry::get_external_client(
@@ -88,13 +117,32 @@ const dmc::ClientInfo *mClockScheduler::ClientRegistry::get_info(
 
 void mClockScheduler::dump(ceph::Formatter &f) const
 {
+  f.dump_float("capacity_iops", capacity);
+  f.dump_float("bytes_per_io", bytes_per_io);
+  f.dump_unsigned("dispatched_cost", dispatched_cost);
+}
+
+unsigned mClockScheduler::calc_cost(const OpSchedulerItem &item) const
+{
+  if (bytes_per_io <= 0) {
+    return 1;
+  }
+  // no single op should take more than a second of the device
+  const double cost = 1 + std::max(item.get_cost(), 0) / bytes_per_io;
+  return std::max(1.0, std::min(cost, capacity));
+}
+
+void mClockScheduler::update_capacity(double iops, double _bytes_per_io)
+{
+  capacity = iops;
+  bytes_per_io = _bytes_per_io;
+  client_registry.update_from_config(cct->_conf, capacity);
 }
 
 void mClockScheduler::enqueue(OpSchedulerItem&& item)
 {
   auto id = get_scheduler_id(item);
-  // TODO: express cost, mclock params in terms of per-node capacity?
-  auto cost = 1; //std::max(item.get_cost(), 1);
+  auto cost = calc_cost(item);
 
   // TODO: move this check into OpSchedulerItem, handle backwards compat
   if (op_scheduler_class::immediate == item.get_scheduler_class()) {
@@ -134,6 +182,7 @@ OpSchedulerItem mClockScheduler::dequeue()
       ceph_assert(result.is_retn());
 
       auto &retn = result.get_retn();
+      dispatched_cost += calc_cost(*retn.request);
       return std::move(*retn.request);
     }
   }
@@ -160,7 +209,7 @@ void mClockScheduler::handle_conf_change(
   const ConfigProxy& conf,
   const std::set<std::string> &changed)
 {
-  client_registry.update_from_config(conf);
+  client_registry.update_from_config(conf, capacity);
 }
 
 }
@@ -56,10 +56,16 @@ WRITE_CMP_OPERATORS_2(scheduler_id_t, class_id, client_profile_id)
 /**
  * Scheduler implementation based on mclock.
  *
- * TODO: explain configs
+ * Reservations, weights and limits come from the
+ * osd_mclock_scheduler_* options.  Once the device capacity is known
+ * (see update_capacity()), an op costs one unit plus one per bytes_per_io
+ * bytes it carries, so the options count 4K IOs per second; reservations
+ * are scaled down to fit within the capacity and limits are capped at it.
  */
 class mClockScheduler : public OpScheduler, md_config_obs_t {
 
+  CephContext *cct;
+
   class ClientRegistry {
     std::array<
       crimson::dmclock::ClientInfo,
@@ -76,7 +82,7 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
     const crimson::dmclock::ClientInfo *get_external_client(
       const client_profile_id_t &client) const;
   public:
-    void update_from_config(const ConfigProxy &conf);
+    void update_from_config(const ConfigProxy &conf, double capacity);
     const crimson::dmclock::ClientInfo *get_info(
       const scheduler_id_t &id) const;
   } client_registry;
@@ -90,6 +96,12 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
   mclock_queue_t scheduler;
   std::list<OpSchedulerItem> immediate;
 
+  double capacity = 0;       ///< 4K IOs per second, 0 if unknown
+  double bytes_per_io = 0;
+  uint64_t dispatched_cost = 0;
+
+  unsigned calc_cost(const OpSchedulerItem &item) const;
+
   static scheduler_id_t get_scheduler_id(const OpSchedulerItem &item) {
     return scheduler_id_t{
       item.get_scheduler_class(),
@@ -124,6 +136,12 @@ public:
     ostream << "mClockScheduler";
   }
 
+  void update_capacity(double iops, double bytes_per_io) final;
+
+  uint64_t get_dispatched_cost() const final {
+    return dispatched_cost;
+  }
+
   const char** get_tracked_conf_keys() const final;
   void handle_conf_change(const ConfigProxy& conf,
 			  const std::set<std::string> &changed) final;
@@ -1206,7 +1206,13 @@ class Module(MgrModule):
         self.get_pg_status()
         self.get_num_objects()
 
-        for daemon, counters in self.get_all_perf_counters().items():
+        # ceph-mgr serves the daemon perf counters itself when
+        # mgr_metrics_exporter_port is set
+        if self.get_ceph_option('mgr_metrics_exporter_port'):
+            perf_counters = {}  # type: Dict[str, dict]
+        else:
+            perf_counters = self.get_all_perf_counters()
+        for daemon, counters in perf_counters.items():
             for path, counter_info in counters.items():
                 # Skip histograms, they are represented by long running avgs
                 stattype = self._stattype_to_str(counter_info['type'])
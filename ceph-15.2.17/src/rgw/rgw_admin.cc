@@ -141,6 +141,9 @@ void usage()
   cout << "  bi put                     store bucket index object entries\n";
   cout << "  bi list                    list raw bucket index entries\n";
   cout << "  bi purge                   purge bucket index entries\n";
+  cout << "  bi compact                 convert bucket index entries to the compact encoding\n";
+  cout << "  bi expand                  convert bucket index entries to the regular encoding\n";
+  cout << "  bi stats                   show the omap usage of the bucket index\n";
   cout << "  object rm                  remove object\n";
   cout << "  object put                 put object\n";
   cout << "  object stat                stat an object for its metadata\n";
@@ -616,6 +619,9 @@ enum class OPT {
   BI_PUT,
   BI_LIST,
   BI_PURGE,
+  BI_COMPACT,
+  BI_EXPAND,
+  BI_STATS,
   OLH_GET,
   OLH_READLOG,
   QUOTA_SET,
@@ -818,6 +824,9 @@ static SimpleCmd::Commands all_cmds = {
   { "bi put", OPT::BI_PUT },
   { "bi list", OPT::BI_LIST },
   { "bi purge", OPT::BI_PURGE },
+  { "bi compact", OPT::BI_COMPACT },
+  { "bi expand", OPT::BI_EXPAND },
+  { "bi stats", OPT::BI_STATS },
   { "olh get", OPT::OLH_GET },
   { "olh readlog", OPT::OLH_READLOG },
   { "quota set", OPT::QUOTA_SET },
@@ -3847,6 +3856,7 @@ int main(int argc, const char **argv)
 			 OPT::OBJECT_STAT,
 			 OPT::BI_GET,
 			 OPT::BI_LIST,
+			 OPT::BI_STATS,
 			 OPT::OLH_GET,
 			 OPT::OLH_READLOG,
 			 OPT::GC_LIST,
@@ -6639,6 +6649,147 @@ next:
     formatter->flush(cout);
   }
 
+  if (opt_cmd == OPT::BI_COMPACT || opt_cmd == OPT::BI_EXPAND) {
+    if (bucket_name.empty()) {
+      cerr << "ERROR: bucket name not specified" << std::endl;
+      return EINVAL;
+    }
+    RGWBucketInfo bucket_info;
+    int ret = init_bucket(tenant, bucket_name, bucket_id, bucket_info, bucket);
+    if (ret < 0) {
+      cerr << "ERROR: could not init bucket: " << cpp_strerror(-ret) << std::endl;
+      return -ret;
+    }
+
+    if (max_entries < 0) {
+      max_entries = 1000;
+    }
+    const bool compact = (opt_cmd == OPT::BI_COMPACT);
+    int max_shards = (bucket_info.num_shards > 0 ? bucket_info.num_shards : 1);
+    uint64_t total = 0;
+
+    formatter->open_object_section("result");
+    formatter->open_array_section("shards");
+
+    int i = (specified_shard_id ? shard_id : 0);
+    for (; i < max_shards; i++) {
+      RGWRados::BucketShard bs(store->getRados());
+      int shard_id = (bucket_info.num_shards > 0  ? i : -1);
+      int ret = bs.init(bucket, shard_id, nullptr /* no RGWBucketInfo */);
+      if (ret < 0) {
+        cerr << "ERROR: bs.init(bucket=" << bucket << ", shard=" << shard_id << "): " << cpp_strerror(-ret) << std::endl;
+        return -ret;
+      }
+
+      string shard_marker;
+      uint64_t converted = 0;
+      rgw_cls_bi_compact_ret result;
+      do {
+        ret = store->getRados()->bi_compact(bs, compact, shard_marker, max_entries, &result);
+        if (ret < 0) {
+          cerr << "ERROR: bi_compact(): " << cpp_strerror(-ret) << std::endl;
+          return -ret;
+        }
+        converted += result.converted;
+        shard_marker = result.marker;
+      } while (result.is_truncated);
+
+      formatter->open_object_section("shard");
+      encode_json("shard_id", shard_id, formatter);
+      encode_json("converted", converted, formatter);
+      formatter->close_section();
+      formatter->flush(cout);
+      total += converted;
+
+      if (specified_shard_id)
+        break;
+    }
+    formatter->close_section();
+    encode_json("converted", total, formatter);
+    formatter->close_section();
+    formatter->flush(cout);
+  }
+
+  if (opt_cmd == OPT::BI_STATS) {
+    if (bucket_name.empty()) {
+      cerr << "ERROR: bucket name not specified" << std::endl;
+      return EINVAL;
+    }
+    RGWBucketInfo bucket_info;
+    int ret = init_bucket(tenant, bucket_name, bucket_id, bucket_info, bucket);
+    if (ret < 0) {
+      cerr << "ERROR: could not init bucket: " << cpp_strerror(-ret) << std::endl;
+      return -ret;
+    }
+
+    if (max_entries < 0) {
+      max_entries = 1000;
+    }
+    int max_shards = (bucket_info.num_shards > 0 ? bucket_info.num_shards : 1);
+
+    auto dump_stats = [&](const rgw_cls_bi_index_stats_ret& stats) {
+      encode_json("entries", stats.entries, formatter);
+      encode_json("compact_entries", stats.compact_entries, formatter);
+      encode_json("entry_key_bytes", stats.entry_key_bytes, formatter);
+      encode_json("entry_value_bytes", stats.entry_value_bytes, formatter);
+      encode_json("other_keys", stats.other_keys, formatter);
+      encode_json("other_bytes", stats.other_bytes, formatter);
+      encode_json("header_bytes", stats.header_bytes, formatter);
+      encode_json("total_bytes", stats.entry_key_bytes + stats.entry_value_bytes +
+                  stats.other_bytes + stats.header_bytes, formatter);
+    };
+
+    rgw_cls_bi_index_stats_ret total;
+    formatter->open_object_section("bi_stats");
+    formatter->open_array_section("shards");
+
+    int i = (specified_shard_id ? shard_id : 0);
+    for (; i < max_shards; i++) {
+      RGWRados::BucketShard bs(store->getRados());
+      int shard_id = (bucket_info.num_shards > 0  ? i : -1);
+      int ret = bs.init(bucket, shard_id, nullptr /* no RGWBucketInfo */);
+      if (ret < 0) {
+        cerr << "ERROR: bs.init(bucket=" << bucket << ", shard=" << shard_id << "): " << cpp_strerror(-ret) << std::endl;
+        return -ret;
+      }
+
+      rgw_cls_bi_index_stats_ret shard_stats;
+      rgw_cls_bi_index_stats_ret result;
+      do {
+        ret = store->getRados()->bi_index_stats(bs, shard_stats.marker, max_entries, &result);
+        if (ret < 0) {
+          cerr << "ERROR: bi_index_stats(): " << cpp_strerror(-ret) << std::endl;
+          return -ret;
+        }
+        shard_stats.add(result);
+        shard_stats.marker = result.marker;
+      } while (result.is_truncated);
+      shard_stats.header_bytes = result.header_bytes;
+      shard_stats.dict_strings = result.dict_strings;
+      shard_stats.compact = result.compact;
+
+      formatter->open_object_section("shard");
+      encode_json("shard_id", shard_id, formatter);
+      encode_json("compact", shard_stats.compact, formatter);
+      encode_json("dict_strings", shard_stats.dict_strings, formatter);
+      dump_stats(shard_stats);
+      formatter->close_section();
+      formatter->flush(cout);
+
+      total.add(shard_stats);
+      total.header_bytes += shard_stats.header_bytes;
+
+      if (specified_shard_id)
+        break;
+    }
+    formatter->close_section();
+    formatter->open_object_section("total");
+    dump_stats(total);
+    formatter->close_section();
+    formatter->close_section();
+    formatter->flush(cout);
+  }
+
   if (opt_cmd == OPT::BI_PURGE) {
     if (bucket_name.empty()) {
       cerr << "ERROR: bucket name not specified" << std::endl;
@@ -51,6 +51,14 @@ class ClientIO : public io::RestfulClient,
     return write_data(buf, len);
   }
 
+  size_t send_body_buffers(const ceph::bufferlist& bl) override {
+    return write_buffers(bl);
+  }
+
+  /* Send all segments of @bl with a single gathered write, without
+   * flattening it first. Returns and throws like write_data(). */
+  virtual size_t write_buffers(const ceph::bufferlist& bl) = 0;
+
   RGWEnv& get_env() noexcept override {
     return env;
   }
@@ -15,6 +15,7 @@
 #include "common/async/shared_mutex.h"
 #include "common/errno.h"
 #include "common/strtol.h"
+#include "include/scope_guard.h"
 
 #include "rgw_asio_client.h"
 #include "rgw_asio_frontend.h"
@@ -31,6 +32,7 @@
 #include "rgw_zone.h"
 
 #include "rgw_asio_frontend_timer.h"
+#include "rgw_perf_counters.h"
 #include "rgw_dmclock_async_scheduler.h"
 
 #define dout_subsys ceph_subsys_rgw
@@ -61,6 +63,38 @@ auto make_stack_allocator() {
   return boost::context::protected_fixedsize_stack{512*1024};
 }
 
+// transfer statistics of a single connection, accumulated over all of its
+// requests and reported when it is closed
+struct connection_stats {
+  uint64_t requests = 0;
+  uint64_t bytes_sent = 0;
+  uint64_t bytes_received = 0;
+  ceph::timespan write_time = ceph::timespan::zero();
+};
+
+void report_connection_stats(CephContext* cct, const connection_stats& stats)
+{
+  if (!stats.requests) {
+    return;
+  }
+  // throughput while the connection was actually writing, so that idle
+  // keep-alive time doesn't dilute it
+  const double secs = std::chrono::duration<double>(stats.write_time).count();
+  const uint64_t tx_rate = secs > 0 ? stats.bytes_sent / secs : 0;
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_conn_bytes_sent, stats.bytes_sent);
+    perfcounter->inc(l_rgw_conn_bytes_received, stats.bytes_received);
+    if (tx_rate) {
+      perfcounter->inc(l_rgw_conn_tx_rate, tx_rate);
+    }
+  }
+  ldout(cct, 10) << "connection closed: requests=" << stats.requests
+      << " bytes_sent=" << stats.bytes_sent
+      << " bytes_received=" << stats.bytes_received
+      << " write_time=" << stats.write_time
+      << " tx_rate=" << tx_rate << "B/s" << dendl;
+}
+
 template <typename Stream>
 class StreamIO : public rgw::asio::ClientIO {
   CephContext* const cct;
@@ -68,23 +102,17 @@ class StreamIO : public rgw::asio::ClientIO {
   timeout_timer& timeout;
   yield_context yield;
   parse_buffer& buffer;
- public:
-  StreamIO(CephContext *cct, Stream& stream, timeout_timer& timeout,
-           rgw::asio::parser_type& parser, yield_context yield,
-           parse_buffer& buffer, bool is_ssl,
-           const tcp::endpoint& local_endpoint,
-           const tcp::endpoint& remote_endpoint)
-      : ClientIO(parser, is_ssl, local_endpoint, remote_endpoint),
-        cct(cct), stream(stream), timeout(timeout), yield(yield),
-        buffer(buffer)
-  {}
+  connection_stats& stats;
 
-  size_t write_data(const char* buf, size_t len) override {
+  template <typename ConstBufferSequence>
+  size_t write(const ConstBufferSequence& buffers) {
     boost::system::error_code ec;
+    const auto start = ceph::mono_clock::now();
     timeout.start();
-    auto bytes = boost::asio::async_write(stream, boost::asio::buffer(buf, len),
-                                          yield[ec]);
+    auto bytes = boost::asio::async_write(stream, buffers, yield[ec]);
     timeout.cancel();
+    stats.write_time += ceph::mono_clock::now() - start;
+    stats.bytes_sent += bytes;
     if (ec) {
       ldout(cct, 4) << "write_data failed: " << ec.message() << dendl;
       if (ec == boost::asio::error::broken_pipe) {
@@ -95,6 +123,31 @@ class StreamIO : public rgw::asio::ClientIO {
     }
     return bytes;
   }
+ public:
+  StreamIO(CephContext *cct, Stream& stream, timeout_timer& timeout,
+           rgw::asio::parser_type& parser, yield_context yield,
+           parse_buffer& buffer, bool is_ssl,
+           const tcp::endpoint& local_endpoint,
+           const tcp::endpoint& remote_endpoint,
+           connection_stats& stats)
+      : ClientIO(parser, is_ssl, local_endpoint, remote_endpoint),
+        cct(cct), stream(stream), timeout(timeout), yield(yield),
+        buffer(buffer), stats(stats)
+  {}
+
+  size_t write_data(const char* buf, size_t len) override {
+    return write(boost::asio::buffer(buf, len));
+  }
+
+  size_t write_buffers(const ceph::bufferlist& bl) override {
+    // point at the segments of the bufferlist rather than copying them
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.reserve(bl.get_num_buffers());
+    for (const auto& ptr : bl.buffers()) {
+      buffers.emplace_back(ptr.c_str(), ptr.length());
+    }
+    return write(buffers);
+  }
 
   size_t recv_body(char* buf, size_t max) override {
     auto& message = parser.get();
@@ -115,7 +168,9 @@ class StreamIO : public rgw::asio::ClientIO {
         throw rgw::io::Exception(ec.value(), std::system_category());
       }
     }
-    return max - body_remaining.size;
+    const size_t received = max - body_remaining.size;
+    stats.bytes_received += received;
+    return received;
   }
 };
 
@@ -166,6 +221,11 @@ void handle_connection(boost::asio::io_context& context,
 
   auto cct = env.store->ctx();
 
+  connection_stats stats;
+  auto report_stats = make_scope_guard([cct, &stats] {
+      report_connection_stats(cct, stats);
+    });
+
   // read messages from the stream until eof
   for (;;) {
     // configure the parser
@@ -224,7 +284,7 @@ void handle_connection(boost::asio::io_context& context,
 
       StreamIO real_client{cct, stream, timeout, parser, yield, buffer,
                            is_ssl, socket.local_endpoint(),
-                           remote_endpoint};
+                           remote_endpoint, stats};
 
       auto real_client_io = rgw::io::add_reordering(
                               rgw::io::add_buffering(cct,
@@ -237,6 +297,7 @@ void handle_connection(boost::asio::io_context& context,
       process_request(env.store, env.rest, &req, env.uri_prefix,
                       *env.auth_registry, &client, env.olog, y,
                       scheduler, &http_ret);
+      stats.requests++;
 
       if (cct->_conf->subsys.should_gather(dout_subsys, 1)) {
         // access log line elements begin per Apache Combined Log Format with additions following
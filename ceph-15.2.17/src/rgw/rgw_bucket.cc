@@ -1776,7 +1776,7 @@ void get_stale_instances(rgw::sal::RGWRadosStore *store, const std::string& buck
   }
 
   // Don't process further in this round if bucket is resharding
-  if (cur_bucket_info.reshard_status == cls_rgw_reshard_status::IN_PROGRESS)
+  if (is_resharding(cur_bucket_info.reshard_status))
     return;
 
   other_instances.erase(std::remove_if(other_instances.begin(), other_instances.end(),
@@ -0,0 +1,258 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#include <errno.h>
+#include <algorithm>
+#include <cmath>
+
+#include "rgw_bucket_list_merge.h"
+
+uint32_t RGWBucketListMerger::calc_first_batch(uint32_t num_entries,
+						uint32_t num_shards)
+{
+  // We want to minimize the chances that when num_shards >>
+  // num_entries that we return much fewer than num_entries to the
+  // client. Given all the overhead of making a cls call to the osd,
+  // returning a few entries is not much more work than returning one
+  // entry. This minimum might be better tuned based on future
+  // experiments where num_shards >> num_entries. (Note: ">>" should
+  // be interpreted as "much greater than".)
+  constexpr uint32_t min_read = 8;
+
+  // The following is based on _"Balls into Bins" -- A Simple and
+  // Tight Analysis_ by Raab and Steger. We add 1 as a way to handle
+  // cases when num_shards >> num_entries (it almost serves as a
+  // ceiling calculation). We also assume alpha is 1.0 and extract it
+  // from the calculation.
+  uint32_t calc_read =
+    1 +
+    static_cast<uint32_t>((num_entries / num_shards) +
+			  sqrt((2 * num_entries) *
+			       log(num_shards) / num_shards));
+
+  return std::max(min_read, calc_read);
+}
+
+int RGWBucketListMerger::init(const std::vector<int>& shard_ids,
+			      const cls_rgw_obj_key& start_after,
+			      uint16_t expansion_factor)
+{
+  uint32_t batch = max_batch;
+  if (expansion_factor <= 11) {
+    // we'll max out the exponential multiplication factor at 1024 (2<<10)
+    const uint32_t scale = expansion_factor ? 1u << (expansion_factor - 1) : 1;
+    batch = std::min<uint64_t>(
+      max_batch,
+      uint64_t(scale) * calc_first_batch(max_batch, shard_ids.size()));
+  }
+
+  std::map<int, cls_rgw_obj_key> markers;
+  for (auto id : shard_ids) {
+    markers.emplace(id, start_after);
+  }
+
+  std::map<int, rgw_cls_list_ret> results;
+  ++num_fetches;
+  int r = fetch(markers, batch, results);
+  if (r < 0) {
+    return r;
+  }
+
+  for (auto& [id, result] : results) {
+    shard_t& s = shards[id];
+    s.batch = batch;
+    set_page(id, s, std::move(result));
+  }
+  return 0;
+}
+
+void RGWBucketListMerger::set_page(int shard_id, shard_t& s,
+				   rgw_cls_list_ret&& result)
+{
+  num_fetched += result.dir.m.size();
+  cls_filtered = cls_filtered && result.cls_filtered;
+  s.result = std::move(result);
+  s.cursor = s.result.dir.m.begin();
+  add_candidate(shard_id, s);
+  if (s.needs_refill()) {
+    need_refill.insert(shard_id);
+  }
+}
+
+void RGWBucketListMerger::append_page(shard_t& s, rgw_cls_list_ret&& result)
+{
+  // the shard's next entry is already a candidate; drop what it handed out
+  // and add the new page behind what it has left
+  num_fetched += result.dir.m.size();
+  cls_filtered = cls_filtered && result.cls_filtered;
+  auto& m = s.result.dir.m;
+  m.erase(m.begin(), s.cursor);
+  for (auto& e : result.dir.m) {
+    m.emplace_hint(m.end(), e.first, std::move(e.second));
+  }
+  s.cursor = m.begin();
+  s.result.is_truncated = result.is_truncated;
+  s.result.marker = std::move(result.marker);
+}
+
+void RGWBucketListMerger::add_running_low()
+{
+  // the key the page would end at, going by the entries at hand; a
+  // truncated shard whose page ends before it runs out before the caller
+  // has all it wants, and is listed now rather than when that happens
+  const uint32_t wanted =
+    num_returned < max_batch ? max_batch - num_returned : 1;
+  std::vector<const std::string*> keys;
+  for (auto& [id, s] : shards) {
+    for (auto i = s.cursor; i != s.result.dir.m.end(); ++i) {
+      keys.push_back(&i->first);
+    }
+  }
+  const std::string *end_key = nullptr;
+  if (keys.size() >= wanted) {
+    auto nth = keys.begin() + (wanted - 1);
+    std::nth_element(keys.begin(), nth, keys.end(),
+		     [](const std::string *a, const std::string *b) {
+		       return *a < *b;
+		     });
+    end_key = *nth;
+  }
+  for (auto& [id, s] : shards) {
+    if (s.at_end() || !s.result.is_truncated || s.stalled) {
+      continue;
+    }
+    if (!end_key || s.result.dir.m.rbegin()->first < *end_key) {
+      need_refill.insert(id);
+    }
+  }
+}
+
+void RGWBucketListMerger::add_candidate(int shard_id, shard_t& s)
+{
+  for (; !s.at_end(); ++s.cursor) {
+    const std::string& name = s.cursor->first;
+    if (have_last && name <= last_name) {
+      continue; // a common prefix that another shard already returned
+    }
+    if (candidates.emplace(name, shard_id).second) {
+      return;
+    }
+    // skip duplicate common prefixes
+  }
+}
+
+int RGWBucketListMerger::refill()
+{
+  add_running_low();
+
+  std::map<int, cls_rgw_obj_key> markers;
+  uint32_t batch = 0;
+  for (auto id : need_refill) {
+    shard_t& s = shards.at(id);
+    cls_rgw_obj_key marker = s.result.marker;
+    if (marker.empty() && !s.result.dir.m.empty()) {
+      // older OSDs don't return a marker
+      marker = s.result.dir.m.rbegin()->second.key;
+    }
+    if (marker.empty()) {
+      s.stalled = true;
+      continue;
+    }
+    // no point in reading more than the caller still wants
+    const uint32_t wanted =
+      num_returned < max_batch ? max_batch - num_returned : 1;
+    s.batch = std::min(wanted, s.batch * 2);
+    batch = std::max(batch, s.batch);
+    markers.emplace(id, std::move(marker));
+  }
+  need_refill.clear();
+  if (markers.empty()) {
+    return 0;
+  }
+
+  std::map<int, rgw_cls_list_ret> results;
+  ++num_fetches;
+  int r = fetch(markers, batch, results);
+  if (r < 0) {
+    return r;
+  }
+
+  for (auto& [id, result] : results) {
+    shard_t& s = shards.at(id);
+    const cls_rgw_obj_key& prev = markers[id];
+    bool progress = !result.dir.m.empty() ||
+      !result.is_truncated ||
+      prev < result.marker;
+    if (!progress) {
+      // a shard listed ahead of time is only given up on once it has
+      // run out
+      if (s.at_end()) {
+	s.stalled = true;
+      }
+      continue;
+    }
+    if (s.at_end()) {
+      set_page(id, s, std::move(result));
+    } else {
+      append_page(s, std::move(result));
+    }
+  }
+  return 0;
+}
+
+int RGWBucketListMerger::peek(entry_ref_t *ref)
+{
+  // an exhausted shard that still has entries must be refilled before
+  // anything else is returned; its next entry may sort first
+  while (!need_refill.empty()) {
+    int r = refill();
+    if (r < 0) {
+      return r;
+    }
+  }
+  for (auto& [id, s] : shards) {
+    if (s.stalled) {
+      return -ENOENT;
+    }
+  }
+
+  if (candidates.empty()) {
+    return -ENOENT;
+  }
+  int id = candidates.begin()->second;
+  shard_t& s = shards.at(id);
+  ref->shard = id;
+  ref->name = &s.cursor->first;
+  ref->entry = &s.cursor->second;
+  return 0;
+}
+
+void RGWBucketListMerger::pop()
+{
+  auto c = candidates.begin();
+  int id = c->second;
+  last_name = c->first;
+  have_last = true;
+  candidates.erase(c);
+  ++num_returned;
+
+  shard_t& s = shards.at(id);
+  ++s.cursor;
+  add_candidate(id, s);
+  if (s.needs_refill()) {
+    need_refill.insert(id);
+  }
+}
+
+bool RGWBucketListMerger::is_truncated() const
+{
+  if (!candidates.empty()) {
+    return true;
+  }
+  for (auto& [id, s] : shards) {
+    if (s.result.is_truncated) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,132 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#ifndef CEPH_RGW_BUCKET_LIST_MERGE_H
+#define CEPH_RGW_BUCKET_LIST_MERGE_H
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "cls/rgw/cls_rgw_ops.h"
+
+/**
+ * K-way merge of the ordered listings of a bucket's index shards.
+ *
+ * Every shard has a cursor into the last page it returned, and the next
+ * entry of each shard sits in a candidate map sorted by key.  Entries are
+ * handed out in key order.  When the cursor of a truncated shard runs
+ * out, only that shard is asked for its next page, starting at its own
+ * marker, and the merge carries on.  The other shards keep their
+ * unconsumed entries; the whole listing is not restarted.
+ *
+ * Each shard's first page is sized from the number of entries wanted and
+ * the number of shards (see calc_first_batch()).  Every refill of the
+ * same shard doubles its batch size, up to the number of entries the
+ * caller still wants, so a shard holding a long run of the keys is
+ * drained in few round trips.
+ *
+ * Refills are batched: when a shard runs out, every other truncated
+ * shard left with fewer entries than its share of what the caller still
+ * wants is listed in the same parallel request, and its new page is
+ * appended to the entries it has not handed out yet.  Shards that run
+ * out at about the same time, as they do when keys are spread evenly,
+ * then cost one round trip rather than one each.
+ *
+ * The merger does no I/O itself; fetch() lists the given shards, each
+ * after its own marker, so it can be driven by cls_rgw as well as by a
+ * simulated index.
+ */
+class RGWBucketListMerger {
+public:
+  // shard id -> marker to list after; fills shard id -> result
+  using fetch_func_t =
+    std::function<int(const std::map<int, cls_rgw_obj_key>& markers,
+		      uint32_t num_entries,
+		      std::map<int, rgw_cls_list_ret>& results)>;
+
+  struct entry_ref_t {
+    int shard = -1;
+    const std::string *name = nullptr;
+    rgw_bucket_dir_entry *entry = nullptr;
+  };
+
+  RGWBucketListMerger(fetch_func_t _fetch, uint32_t _max_batch)
+    : fetch(std::move(_fetch)), max_batch(std::max<uint32_t>(_max_batch, 1)) {}
+
+  /**
+   * List the first page of @shard_ids, starting after @start_after.  Each
+   * step of @expansion_factor doubles the first page, for callers that
+   * got too few entries out of an earlier call (e.g. due to filtering).
+   */
+  int init(const std::vector<int>& shard_ids,
+	   const cls_rgw_obj_key& start_after,
+	   uint16_t expansion_factor = 0);
+
+  /**
+   * The number of entries to ask of each of @num_shards shards so that,
+   * with keys spread over the shards at random, @num_entries entries are
+   * most likely found in one round.
+   */
+  static uint32_t calc_first_batch(uint32_t num_entries, uint32_t num_shards);
+
+  /**
+   * Point @ref at the next entry in key order, refilling exhausted
+   * shards as needed.  The reference stays valid until pop().  Returns
+   * -ENOENT once no entry can be returned, either because all shards are
+   * done or because a shard stopped making progress (is_truncated() then
+   * tells the two apart).
+   */
+  int peek(entry_ref_t *ref);
+  /// consume the entry returned by peek()
+  void pop();
+
+  /// true if any shard may hold entries that were not returned yet
+  bool is_truncated() const;
+  /// true if every shard filtered on the OSD side (see rgw_cls_list_ret)
+  bool is_cls_filtered() const { return cls_filtered; }
+
+  uint64_t get_num_fetches() const { return num_fetches; }
+  uint64_t get_num_fetched() const { return num_fetched; }
+
+private:
+  struct shard_t {
+    rgw_cls_list_ret result;
+    decltype(result.dir.m)::iterator cursor;
+    uint32_t batch = 0;
+    bool stalled = false;
+
+    bool at_end() const { return cursor == result.dir.m.end(); }
+    size_t remaining() const {
+      return std::distance<decltype(result.dir.m)::const_iterator>(
+	cursor, result.dir.m.end());
+    }
+    bool needs_refill() const {
+      return at_end() && result.is_truncated && !stalled;
+    }
+  };
+
+  fetch_func_t fetch;
+  const uint32_t max_batch;
+
+  std::map<int, shard_t> shards;
+  std::map<std::string, int> candidates; // next key -> shard id
+  std::set<int> need_refill;
+  std::string last_name;
+  bool have_last = false;
+  bool cls_filtered = true;
+  uint32_t num_returned = 0;
+
+  uint64_t num_fetches = 0;
+  uint64_t num_fetched = 0;
+
+  void set_page(int shard_id, shard_t& s, rgw_cls_list_ret&& result);
+  void append_page(shard_t& s, rgw_cls_list_ret&& result);
+  void add_running_low();
+  void add_candidate(int shard_id, shard_t& s);
+  int refill();
+};
+
+#endif
@@ -5,19 +5,48 @@
 #include "rgw_perf_counters.h"
 
 #include <errno.h>
+#include <algorithm>
 
 #define dout_subsys ceph_subsys_rgw
 
 
+std::shared_lock<ceph::shared_mutex> ObjectCache::read_lock(Shard& shard)
+{
+  std::shared_lock l{shard.lock, std::try_to_lock};
+  if (!l.owns_lock()) {
+    if (perfcounter) perfcounter->inc(l_rgw_cache_lock_contended);
+    l.lock();
+  }
+  return l;
+}
+
+std::unique_lock<ceph::shared_mutex> ObjectCache::write_lock(Shard& shard)
+{
+  std::unique_lock l{shard.lock, std::try_to_lock};
+  if (!l.owns_lock()) {
+    if (perfcounter) perfcounter->inc(l_rgw_cache_lock_contended);
+    l.lock();
+  }
+  return l;
+}
+
 int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
 {
+  if (!enabled) {
+    return -ENOENT;
+  }
+  const uint64_t hash = hash_name(name);
+  Shard& shard = *shards[shard_index(hash)];
 
-  std::shared_lock rl{lock};
+  auto rl = read_lock(shard);
   if (!enabled) {
     return -ENOENT;
   }
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
+  if (admission) {
+    shard.sketch.increment(hash);
+  }
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
     ldout(cct, 10) << "cache get: name=" << name << " : miss" << dendl;
     if (perfcounter) {
       perfcounter->inc(l_rgw_cache_miss);
@@ -29,14 +58,14 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
        (ceph::coarse_mono_clock::now() - iter->second.info.time_added) > expiry) {
     ldout(cct, 10) << "cache get: name=" << name << " : expiry miss" << dendl;
     rl.unlock();
-    std::unique_lock wl{lock};  // write lock for insertion
+    auto wl = write_lock(shard);  // write lock for insertion
     // check that wasn't already removed by other thread
-    iter = cache_map.find(name);
-    if (iter != cache_map.end()) {
+    iter = shard.cache_map.find(name);
+    if (iter != shard.cache_map.end()) {
       for (auto &kv : iter->second.chained_entries)
         kv.first->invalidate(kv.second);
-      remove_lru(name, iter->second.lru_iter);
-      cache_map.erase(iter);
+      remove_lru(shard, iter->second.lru_iter);
+      shard.cache_map.erase(iter);
     }
     if (perfcounter) {
       perfcounter->inc(l_rgw_cache_miss);
@@ -46,14 +75,15 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 
   ObjectCacheEntry *entry = &iter->second;
 
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << lru_counter
+  std::unique_lock<ceph::shared_mutex> wl;
+  if (shard.lru_counter - entry->lru_promotion_ts > shard.lru_window) {
+    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << shard.lru_counter
                    << " promotion_ts=" << entry->lru_promotion_ts << dendl;
     rl.unlock();
-    std::unique_lock wl{lock};  // write lock for insertion
+    wl = write_lock(shard);  // write lock for insertion
     /* need to redo this because entry might have dropped off the cache */
-    iter = cache_map.find(name);
-    if (iter == cache_map.end()) {
+    iter = shard.cache_map.find(name);
+    if (iter == shard.cache_map.end()) {
       ldout(cct, 10) << "lost race! cache get: name=" << name << " : miss" << dendl;
       if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
       return -ENOENT;
@@ -61,8 +91,8 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 
     entry = &iter->second;
     /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(name, *entry, iter->second.lru_iter);
+    if (shard.lru_counter - entry->lru_promotion_ts > shard.lru_window) {
+      touch_lru(shard, iter->first, *entry, iter->second.lru_iter);
     }
   }
 
@@ -96,7 +126,24 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*> cache_info_entries,
 				    RGWChainedCache::Entry *chained_entry)
 {
-  std::unique_lock l{lock};
+  if (!enabled) {
+    return false;
+  }
+
+  // the entries may live in different shards; lock them in shard order
+  std::vector<unsigned> shard_ids;
+  shard_ids.reserve(cache_info_entries.size());
+  for (auto cache_info : cache_info_entries) {
+    shard_ids.push_back(shard_index(hash_name(cache_info->cache_locator)));
+  }
+  std::sort(shard_ids.begin(), shard_ids.end());
+  shard_ids.erase(std::unique(shard_ids.begin(), shard_ids.end()),
+		  shard_ids.end());
+  std::vector<std::unique_lock<ceph::shared_mutex>> locks;
+  locks.reserve(shard_ids.size());
+  for (auto id : shard_ids) {
+    locks.push_back(write_lock(*shards[id]));
+  }
 
   if (!enabled) {
     return false;
@@ -108,6 +155,8 @@ bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*>
   for (auto cache_info : cache_info_entries) {
     ldout(cct, 10) << "chain_cache_entry: cache_locator="
 		   << cache_info->cache_locator << dendl;
+    auto& cache_map =
+      shards[shard_index(hash_name(cache_info->cache_locator))]->cache_map;
     auto iter = cache_map.find(cache_info->cache_locator);
     if (iter == cache_map.end()) {
       ldout(cct, 20) << "chain_cache_entry: couldn't find cache locator" << dendl;
@@ -136,9 +185,34 @@ bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*>
   return true;
 }
 
+bool ObjectCache::admit(Shard& shard, const string& name, uint64_t hash)
+{
+  if (!admission || shard.lru_size < shard_lru_max || shard.lru.empty()) {
+    return true;
+  }
+  // TinyLFU: only displace the LRU victim with an entry that was asked
+  // for more often recently
+  const string& victim = *shard.lru.front();
+  unsigned candidate_freq = shard.sketch.estimate(hash);
+  unsigned victim_freq = shard.sketch.estimate(hash_name(victim));
+  if (candidate_freq > victim_freq) {
+    return true;
+  }
+  ldout(cct, 10) << "cache put: name=" << name << " not admitted (freq "
+		 << candidate_freq << " <= victim " << victim << " freq "
+		 << victim_freq << ")" << dendl;
+  return false;
+}
+
 void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
 {
-  std::unique_lock l{lock};
+  if (!enabled) {
+    return;
+  }
+  const uint64_t hash = hash_name(name);
+  Shard& shard = *shards[shard_index(hash)];
+
+  auto l = write_lock(shard);
 
   if (!enabled) {
     return;
@@ -147,12 +221,21 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
   ldout(cct, 10) << "cache put: name=" << name << " info.flags=0x"
                  << std::hex << info.flags << std::dec << dendl;
 
-  auto [iter, inserted] = cache_map.emplace(name, ObjectCacheEntry{});
+  if (admission && shard.sketch.needs_aging()) {
+    shard.sketch.age();
+  }
+
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
+    if (!admit(shard, name, hash)) {
+      if (perfcounter) perfcounter->inc(l_rgw_cache_rejected);
+      return;
+    }
+    iter = shard.cache_map.emplace(name, ObjectCacheEntry{}).first;
+    iter->second.lru_iter = shard.lru.end();
+  }
   ObjectCacheEntry& entry = iter->second;
   entry.info.time_added = ceph::coarse_mono_clock::now();
-  if (inserted) {
-    entry.lru_iter = lru.end();
-  }
   ObjectCacheInfo& target = entry.info;
 
   invalidate_lru(entry);
@@ -160,7 +243,7 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
   entry.chained_entries.clear();
   entry.gen++;
 
-  touch_lru(name, entry, entry.lru_iter);
+  touch_lru(shard, iter->first, entry, entry.lru_iter);
 
   target.status = info.status;
 
@@ -213,14 +296,19 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
 
 bool ObjectCache::remove(const string& name)
 {
-  std::unique_lock l{lock};
+  if (!enabled) {
+    return false;
+  }
+  Shard& shard = *shards[shard_index(hash_name(name))];
+
+  auto l = write_lock(shard);
 
   if (!enabled) {
     return false;
   }
 
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end())
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end())
     return false;
 
   ldout(cct, 10) << "removing " << name << " from cache" << dendl;
@@ -230,60 +318,59 @@ bool ObjectCache::remove(const string& name)
     kv.first->invalidate(kv.second);
   }
 
-  remove_lru(name, iter->second.lru_iter);
-  cache_map.erase(iter);
+  remove_lru(shard, iter->second.lru_iter);
+  shard.cache_map.erase(iter);
   return true;
 }
 
-void ObjectCache::touch_lru(const string& name, ObjectCacheEntry& entry,
-			    std::list<string>::iterator& lru_iter)
+void ObjectCache::touch_lru(Shard& shard, const string& name,
+			    ObjectCacheEntry& entry,
+			    std::list<const string*>::iterator& lru_iter)
 {
-  while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
-    auto iter = lru.begin();
-    if ((*iter).compare(name) == 0) {
+  while (shard.lru_size > shard_lru_max) {
+    auto iter = shard.lru.begin();
+    if (*iter == &name) {
       /*
        * if the entry we're touching happens to be at the lru end, don't remove it,
        * lru shrinking can wait for next time
        */
       break;
     }
-    auto map_iter = cache_map.find(*iter);
-    ldout(cct, 10) << "removing entry: name=" << *iter << " from cache LRU" << dendl;
-    if (map_iter != cache_map.end()) {
+    ldout(cct, 10) << "removing entry: name=" << **iter << " from cache LRU" << dendl;
+    auto map_iter = shard.cache_map.find(**iter);
+    if (map_iter != shard.cache_map.end()) {
       ObjectCacheEntry& entry = map_iter->second;
       invalidate_lru(entry);
-      cache_map.erase(map_iter);
+      shard.cache_map.erase(map_iter);
     }
-    lru.pop_front();
-    lru_size--;
+    shard.lru.pop_front();
+    shard.lru_size--;
+    if (perfcounter) perfcounter->inc(l_rgw_cache_evicted);
   }
 
-  if (lru_iter == lru.end()) {
-    lru.push_back(name);
-    lru_size++;
+  if (lru_iter == shard.lru.end()) {
+    shard.lru.push_back(&name);
+    shard.lru_size++;
     lru_iter--;
     ldout(cct, 10) << "adding " << name << " to cache LRU end" << dendl;
   } else {
     ldout(cct, 10) << "moving " << name << " to cache LRU end" << dendl;
-    lru.erase(lru_iter);
-    lru.push_back(name);
-    lru_iter = lru.end();
-    --lru_iter;
+    shard.lru.splice(shard.lru.end(), shard.lru, lru_iter);
   }
 
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
+  shard.lru_counter++;
+  entry.lru_promotion_ts = shard.lru_counter;
 }
 
-void ObjectCache::remove_lru(const string& name,
-			     std::list<string>::iterator& lru_iter)
+void ObjectCache::remove_lru(Shard& shard,
+			     std::list<const string*>::iterator& lru_iter)
 {
-  if (lru_iter == lru.end())
+  if (lru_iter == shard.lru.end())
     return;
 
-  lru.erase(lru_iter);
-  lru_size--;
-  lru_iter = lru.end();
+  shard.lru.erase(lru_iter);
+  shard.lru_size--;
+  lru_iter = shard.lru.end();
 }
 
 void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
@@ -295,9 +382,34 @@ void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
   }
 }
 
+void ObjectCache::set_ctx(CephContext *_cct)
+{
+  cct = _cct;
+  // the shards are sized once; these options only take effect on restart
+  unsigned num_shards = std::max<uint64_t>(
+    1, cct->_conf.get_val<uint64_t>("rgw_cache_shards"));
+  uint64_t lru_max = std::max<int64_t>(cct->_conf->rgw_cache_lru_size, 1);
+  shard_lru_max = (lru_max + num_shards - 1) / num_shards;
+  admission = cct->_conf.get_val<bool>("rgw_cache_tinylfu");
+  expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
+				  "rgw_cache_expiry_interval"));
+
+  shards.clear();
+  shards.reserve(num_shards);
+  for (unsigned i = 0; i < num_shards; ++i) {
+    auto shard = std::make_unique<Shard>("ObjectCache::shard." +
+					 std::to_string(i));
+    shard->lru_window = shard_lru_max / 2;
+    if (admission) {
+      shard->sketch.resize(shard_lru_max);
+    }
+    shards.push_back(std::move(shard));
+  }
+}
+
 void ObjectCache::set_enabled(bool status)
 {
-  std::unique_lock l{lock};
+  std::lock_guard l{chain_lock};
 
   enabled = status;
 
@@ -308,19 +420,20 @@ void ObjectCache::set_enabled(bool status)
 
 void ObjectCache::invalidate_all()
 {
-  std::unique_lock l{lock};
+  std::lock_guard l{chain_lock};
 
   do_invalidate_all();
 }
 
 void ObjectCache::do_invalidate_all()
 {
-  cache_map.clear();
-  lru.clear();
-
-  lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
+  for (auto& shard : shards) {
+    std::unique_lock l{shard->lock};
+    shard->cache_map.clear();
+    shard->lru.clear();
+    shard->lru_size = 0;
+    shard->lru_counter = 0;
+  }
 
   for (auto& cache : chained_cache) {
     cache->invalidate_all();
@@ -328,12 +441,12 @@ void ObjectCache::do_invalidate_all()
 }
 
 void ObjectCache::chain_cache(RGWChainedCache *cache) {
-  std::unique_lock l{lock};
+  std::lock_guard l{chain_lock};
   chained_cache.push_back(cache);
 }
 
 void ObjectCache::unchain_cache(RGWChainedCache *cache) {
-  std::unique_lock l{lock};
+  std::lock_guard l{chain_lock};
 
   auto iter = chained_cache.begin();
   for (; iter != chained_cache.end(); ++iter) {
@@ -351,4 +464,3 @@ ObjectCache::~ObjectCache()
     cache->unregistered();
   }
 }
-
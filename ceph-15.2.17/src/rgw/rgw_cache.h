@@ -4,6 +4,7 @@
 #ifndef CEPH_RGWCACHE_H
 #define CEPH_RGWCACHE_H
 
+#include <atomic>
 #include <string>
 #include <map>
 #include <unordered_map>
@@ -14,6 +15,7 @@
 
 #include "cls/version/cls_version_types.h"
 #include "rgw_common.h"
+#include "rgw_frequency_sketch.h"
 
 enum {
   UPDATE_OBJ,
@@ -151,7 +153,7 @@ public:
 
 struct ObjectCacheEntry {
   ObjectCacheInfo info;
-  std::list<string>::iterator lru_iter;
+  std::list<const string*>::iterator lru_iter;
   uint64_t lru_promotion_ts;
   uint64_t gen;
   std::vector<pair<RGWChainedCache *, string> > chained_entries;
@@ -159,29 +161,57 @@ struct ObjectCacheEntry {
   ObjectCacheEntry() : lru_promotion_ts(0), gen(0) {}
 };
 
+/*
+ * The cache is split into rgw_cache_shards shards by key hash, each with
+ * its own map, LRU and lock, so that concurrent requests for different
+ * entries rarely touch the same lock.  The LRU holds pointers to the
+ * (stable) map keys rather than copies of them.
+ */
 class ObjectCache {
-  std::unordered_map<string, ObjectCacheEntry> cache_map;
-  std::list<string> lru;
-  unsigned long lru_size;
-  unsigned long lru_counter;
-  unsigned long lru_window;
-  ceph::shared_mutex lock = ceph::make_shared_mutex("ObjectCache");
+  struct Shard {
+    std::unordered_map<string, ObjectCacheEntry> cache_map;
+    std::list<const string*> lru;
+    unsigned long lru_size = 0;
+    unsigned long lru_counter = 0;
+    unsigned long lru_window = 0;
+    ceph::shared_mutex lock;
+    RGWFrequencySketch sketch;
+
+    explicit Shard(const std::string& name)
+      : lock(ceph::make_shared_mutex(name)) {}
+  };
+  std::vector<std::unique_ptr<Shard>> shards;
+  unsigned long shard_lru_max = 0;
+  bool admission = false;
+
+  ceph::mutex chain_lock = ceph::make_mutex("ObjectCache::chain_lock");
   CephContext *cct;
 
   vector<RGWChainedCache *> chained_cache;
 
-  bool enabled;
+  std::atomic<bool> enabled;
   ceph::timespan expiry;
 
-  void touch_lru(const string& name, ObjectCacheEntry& entry,
-		 std::list<string>::iterator& lru_iter);
-  void remove_lru(const string& name, std::list<string>::iterator& lru_iter);
+  static uint64_t hash_name(const string& name) {
+    return std::hash<string>()(name);
+  }
+  unsigned shard_index(uint64_t hash) const {
+    return hash % shards.size();
+  }
+
+  std::shared_lock<ceph::shared_mutex> read_lock(Shard& shard);
+  std::unique_lock<ceph::shared_mutex> write_lock(Shard& shard);
+
+  bool admit(Shard& shard, const string& name, uint64_t hash);
+  void touch_lru(Shard& shard, const string& name, ObjectCacheEntry& entry,
+		 std::list<const string*>::iterator& lru_iter);
+  void remove_lru(Shard& shard, std::list<const string*>::iterator& lru_iter);
   void invalidate_lru(ObjectCacheEntry& entry);
 
   void do_invalidate_all();
 
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), cct(NULL), enabled(false) { }
+  ObjectCache() : cct(NULL), enabled(false) { }
   ~ObjectCache();
   int get(const std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   std::optional<ObjectCacheInfo> get(const std::string& name) {
@@ -192,10 +222,13 @@ public:
 
   template<typename F>
   void for_each(const F& f) {
-    std::shared_lock l{lock};
-    if (enabled) {
-      auto now  = ceph::coarse_mono_clock::now();
-      for (const auto& [name, entry] : cache_map) {
+    if (!enabled) {
+      return;
+    }
+    auto now  = ceph::coarse_mono_clock::now();
+    for (auto& shard : shards) {
+      std::shared_lock l{shard->lock};
+      for (const auto& [name, entry] : shard->cache_map) {
         if (expiry.count() && (now - entry.info.time_added) < expiry) {
           f(name, entry);
         }
@@ -205,12 +238,7 @@ public:
 
   void put(const std::string& name, ObjectCacheInfo& bl, rgw_cache_entry_info *cache_info);
   bool remove(const std::string& name);
-  void set_ctx(CephContext *_cct) {
-    cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
-    expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
-						"rgw_cache_expiry_interval"));
-  }
+  void set_ctx(CephContext *_cct);
   bool chain_cache_entry(std::initializer_list<rgw_cache_entry_info*> cache_info_entries,
 			 RGWChainedCache::Entry *chained_entry);
 
@@ -25,6 +25,7 @@
 #include "rgw_metadata.h"
 #include "rgw_sync_counters.h"
 #include "rgw_sync_module.h"
+#include "rgw_sync_window.h"
 #include "rgw_sal.h"
 
 #include "cls/lock/cls_lock_client.h"
@@ -1263,6 +1264,8 @@ class RGWRunBucketSourcesSyncCR : public RGWCoroutine {
   int num_shards{0};
   int cur_shard{0};
   bool again = false;
+  RGWSyncWindow spawn_window;
+  size_t spawned{0};
 
 public:
   RGWRunBucketSourcesSyncCR(RGWDataSyncCtx *_sc,
@@ -1380,9 +1383,16 @@ public:
   }
 };
 
-#define BUCKET_SHARD_SYNC_SPAWN_WINDOW 20
 #define DATA_SYNC_MAX_ERR_ENTRIES 10
 
+static RGWSyncWindow make_sync_window(CephContext *cct, const char *name)
+{
+  return RGWSyncWindow(cct->_conf.get_val<uint64_t>(name),
+                       cct->_conf.get_val<uint64_t>("rgw_sync_spawn_window_max"),
+                       ceph::make_timespan(
+                         cct->_conf.get_val<double>("rgw_sync_spawn_window_interval")));
+}
+
 class RGWDataSyncShardCR : public RGWCoroutine {
   RGWDataSyncCtx *sc;
   RGWDataSyncEnv *sync_env;
@@ -1419,7 +1429,7 @@ class RGWDataSyncShardCR : public RGWCoroutine {
 
   int total_entries;
 
-  int spawn_window;
+  RGWSyncWindow spawn_window;
 
   bool *reset_backoff;
 
@@ -1453,7 +1463,7 @@ public:
 						      shard_id(_shard_id),
 						      sync_marker(_marker),
                                                       marker_tracker(NULL), truncated(false),
-                                                      total_entries(0), spawn_window(BUCKET_SHARD_SYNC_SPAWN_WINDOW), reset_backoff(NULL),
+                                                      total_entries(0), spawn_window(make_sync_window(cct, "rgw_data_sync_spawn_window")), reset_backoff(NULL),
                                                       lease_cr(nullptr), lease_stack(nullptr), error_repo(nullptr), max_error_entries(DATA_SYNC_MAX_ERR_ENTRIES),
                                                       retry_backoff_secs(RETRY_BACKOFF_SECS_DEFAULT), tn(_tn) {
     set_description() << "data sync shard source_zone=" << sc->source_zone << " shard_id=" << shard_id;
@@ -1576,15 +1586,17 @@ public:
           }
           sync_marker.marker = *iter;
 
-          while ((int)num_spawned() > spawn_window) {
+          while (num_spawned() > spawn_window.get()) {
             set_status() << "num_spawned() > spawn_window";
             yield wait_for_child();
             int ret;
+            const size_t spawned = num_spawned();
             while (collect(&ret, lease_stack.get())) {
               if (ret < 0) {
                 tn->log(10, "a sync operation returned error");
               }
             }
+            spawn_window.complete(spawned - num_spawned());
           }
         }
       } while (omapkeys->more);
@@ -1717,10 +1729,11 @@ public:
           } else {
             spawn(new RGWDataSyncSingleEntryCR(sc, log_iter->entry.key, log_iter->log_id, marker_tracker, error_repo, false, tn), false);
           }
-          while ((int)num_spawned() > spawn_window) {
+          while (num_spawned() > spawn_window.get()) {
             set_status() << "num_spawned() > spawn_window";
             yield wait_for_child();
             int ret;
+            const size_t spawned = num_spawned();
             while (collect(&ret, lease_stack.get())) {
               if (ret < 0) {
                 tn->log(10, "a sync operation returned error");
@@ -1728,6 +1741,7 @@ public:
               }
               /* not waiting for child here */
             }
+            spawn_window.complete(spawned - num_spawned());
           }
         }
 
@@ -3614,8 +3628,6 @@ done:
   }
 };
 
-#define BUCKET_SYNC_SPAWN_WINDOW 20
-
 class RGWBucketShardFullSyncCR : public RGWCoroutine {
   RGWDataSyncCtx *sc;
   RGWDataSyncEnv *sync_env;
@@ -3628,6 +3640,7 @@ class RGWBucketShardFullSyncCR : public RGWCoroutine {
   RGWBucketFullSyncShardMarkerTrack marker_tracker;
   rgw_obj_key list_marker;
   bucket_list_entry *entry{nullptr};
+  RGWSyncWindow spawn_window;
 
   int total_entries{0};
 
@@ -3694,6 +3707,7 @@ public:
       sync_pipe(_sync_pipe), bs(_sync_pipe.info.source_bs),
       lease_cr(lease_cr), sync_info(sync_info),
       marker_tracker(sc, status_oid, sync_info.full_marker),
+      spawn_window(make_sync_window(cct, "rgw_bucket_sync_spawn_window")),
       status_oid(status_oid),
       tn(sync_env->sync_tracer->add_node(tn_parent, "full_sync",
                                          SSTR(bucket_shard_str{bs}))) {
@@ -3763,9 +3777,10 @@ int RGWBucketShardFullSyncCR::operate()
                                  entry->key, &marker_tracker, zones_trace, tn),
                       false);
         }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > spawn_window.get()) {
           yield wait_for_child();
           bool again = true;
+          const size_t spawned = num_spawned();
           while (again) {
             again = collect(&ret, nullptr);
             if (ret < 0) {
@@ -3774,6 +3789,7 @@ int RGWBucketShardFullSyncCR::operate()
               /* we have reported this error */
             }
           }
+          spawn_window.complete(spawned - num_spawned());
         }
       }
     } while (list_result.is_truncated && sync_status == 0);
@@ -3839,6 +3855,7 @@ class RGWBucketShardIncrementalSyncCR : public RGWCoroutine {
   rgw_obj_key key;
   rgw_bi_log_entry *entry{nullptr};
   RGWBucketIncSyncShardMarkerTrack marker_tracker;
+  RGWSyncWindow spawn_window;
   bool updated_status{false};
   const string& status_oid;
   rgw_zone_id zone_id;
@@ -3862,6 +3879,7 @@ public:
       sync_pipe(_sync_pipe), bs(_sync_pipe.info.source_bs),
       lease_cr(lease_cr), sync_info(sync_info),
       marker_tracker(sc, status_oid, sync_info.inc_marker),
+      spawn_window(make_sync_window(cct, "rgw_bucket_sync_spawn_window")),
       status_oid(status_oid), zone_id(sync_env->svc->zone->get_zone().id),
       tn(sync_env->sync_tracer->add_node(_tn_parent, "inc_sync",
                                          SSTR(bucket_shard_str{bs})))
@@ -4067,10 +4085,11 @@ int RGWBucketShardIncrementalSyncCR::operate()
                   false);
           }
         // }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > spawn_window.get()) {
           set_status() << "num_spawned() > spawn_window";
           yield wait_for_child();
           bool again = true;
+          const size_t spawned = num_spawned();
           while (again) {
             again = collect(&ret, nullptr);
             if (ret < 0) {
@@ -4080,6 +4099,7 @@ int RGWBucketShardIncrementalSyncCR::operate()
             }
             /* not waiting for child here */
           }
+          spawn_window.complete(spawned - num_spawned());
         }
       }
     } while (!list_result.empty() && sync_status == 0 && !syncstopped);
@@ -4270,7 +4290,8 @@ RGWRunBucketSourcesSyncCR::RGWRunBucketSourcesSyncCR(RGWDataSyncCtx *_sc,
       target_bs(_target_bs),
       source_bs(_source_bs),
       tn(sync_env->sync_tracer->add_node(_tn_parent, "bucket_sync_sources",
-                                         SSTR( "target=" << target_bucket.value_or(rgw_bucket()) << ":source_bucket=" << source_bucket.value_or(rgw_bucket()) << ":source_zone=" << sc->source_zone)))
+                                         SSTR( "target=" << target_bucket.value_or(rgw_bucket()) << ":source_bucket=" << source_bucket.value_or(rgw_bucket()) << ":source_zone=" << sc->source_zone))),
+      spawn_window(make_sync_window(cct, "rgw_data_sync_spawn_window"))
 {
   if (target_bs) {
     target_bucket = target_bs->bucket;
@@ -4336,10 +4357,11 @@ int RGWRunBucketSourcesSyncCR::operate()
         ldpp_dout(sync_env->dpp, 20) << __func__ << "(): sync_pair=" << sync_pair << dendl;
 
         yield spawn(new RGWRunBucketSyncCoroutine(sc, sync_pair, tn), false);
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > spawn_window.get()) {
           set_status() << "num_spawned() > spawn_window";
           yield wait_for_child();
           again = true;
+          spawned = num_spawned();
           while (again) {
             again = collect(&ret, nullptr);
             if (ret < 0) {
@@ -4348,6 +4370,7 @@ int RGWRunBucketSourcesSyncCR::operate()
               return set_cr_error(ret);
             }
           }
+          spawn_window.complete(spawned - num_spawned());
         }
       }
     }
@@ -0,0 +1,94 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#ifndef CEPH_RGW_FREQUENCY_SKETCH_H
+#define CEPH_RGW_FREQUENCY_SKETCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Approximate access frequency of cache keys (a count-min sketch), used
+ * for TinyLFU admission: when the cache is full, a new entry only
+ * replaces the LRU victim if it was accessed more often recently.
+ *
+ * Each key maps to one small saturating counter in each of 4 rows; its
+ * frequency estimate is the smallest of those counters.  Once the number
+ * of increments reaches ten times the cache capacity, all counters are
+ * halved so that old popularity fades away.
+ *
+ * increment() and estimate() may be called concurrently; age() and
+ * resize() must be serialized against everything else by the caller.
+ */
+class RGWFrequencySketch {
+  static constexpr unsigned ROWS = 4;
+  static constexpr uint8_t MAX_COUNT = 15;
+
+  std::unique_ptr<std::atomic<uint8_t>[]> table;
+  uint64_t width = 0;   // counters per row, a power of two
+  uint64_t sample_size = 0;
+  std::atomic<uint64_t> additions = {0};
+
+  uint64_t index(uint64_t hash, unsigned row) const {
+    static constexpr uint64_t seeds[ROWS] = {
+      0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+      0x9ae16a3b2f90404full, 0xcbf29ce484222325ull,
+    };
+    uint64_t h = (hash + seeds[row]) * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 32;
+    return row * width + (h & (width - 1));
+  }
+
+public:
+  explicit RGWFrequencySketch(uint64_t capacity = 0) {
+    resize(capacity);
+  }
+
+  void resize(uint64_t capacity) {
+    width = 16;
+    while (width < capacity)
+      width <<= 1;
+    table.reset(new std::atomic<uint8_t>[ROWS * width]);
+    for (uint64_t i = 0; i < ROWS * width; ++i)
+      table[i].store(0, std::memory_order_relaxed);
+    sample_size = 10 * std::max<uint64_t>(capacity, 1);
+    additions = 0;
+  }
+
+  void increment(uint64_t hash) {
+    for (unsigned row = 0; row < ROWS; ++row) {
+      auto& c = table[index(hash, row)];
+      uint8_t v = c.load(std::memory_order_relaxed);
+      while (v < MAX_COUNT &&
+	     !c.compare_exchange_weak(v, v + 1, std::memory_order_relaxed)) {}
+    }
+    additions.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  unsigned estimate(uint64_t hash) const {
+    unsigned v = MAX_COUNT;
+    for (unsigned row = 0; row < ROWS; ++row) {
+      v = std::min<unsigned>(v, table[index(hash, row)].load(
+			       std::memory_order_relaxed));
+    }
+    return v;
+  }
+
+  bool needs_aging() const {
+    return additions.load(std::memory_order_relaxed) >= sample_size;
+  }
+
+  /// halve every counter
+  void age() {
+    for (uint64_t i = 0; i < ROWS * width; ++i) {
+      table[i].store(table[i].load(std::memory_order_relaxed) >> 1,
+		     std::memory_order_relaxed);
+    }
+    additions.store(additions.load(std::memory_order_relaxed) / 2,
+		    std::memory_order_relaxed);
+  }
+};
+
+#endif
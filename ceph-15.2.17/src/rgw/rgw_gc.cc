@@ -14,6 +14,7 @@
 #include "cls/lock/cls_lock_client.h"
 #include "include/random.h"
 #include "rgw_gc_log.h"
+#include "common/AdaptiveLimit.h"
 
 #include <list> // XXX
 #include <sstream>
@@ -298,6 +299,8 @@ class RGWGCIOManager {
     string oid;
     int index{-1};
     string tag;
+    ceph::mono_time start;
+    ceph::mono_time end;  // first time it was seen complete
   };
 
   deque<IO> ios;
@@ -307,16 +310,27 @@ class RGWGCIOManager {
    */
   vector<map<string, size_t> > tag_io_size;
 
-#define MAX_AIO_DEFAULT 10
-  size_t max_aio{MAX_AIO_DEFAULT};
+  /* the number of ios kept in flight; it only moves when
+   * rgw_gc_max_concurrent_io_adaptive is above rgw_gc_max_concurrent_io
+   */
+  AdaptiveLimit max_aio;
+  bool adaptive{false};
 
 public:
   RGWGCIOManager(const DoutPrefixProvider* _dpp, CephContext *_cct, RGWGC *_gc) : dpp(_dpp),
                                                                                   cct(_cct),
-                                                                                  gc(_gc) {
-    max_aio = cct->_conf->rgw_gc_max_concurrent_io;
+                                                                                  gc(_gc),
+    max_aio(std::max<int64_t>(cct->_conf->rgw_gc_max_concurrent_io, 1),
+	    cct->_conf.get_val<uint64_t>("rgw_gc_max_concurrent_io_adaptive"),
+	    ceph::make_timespan(
+	      cct->_conf.get_val<double>("rgw_gc_target_io_latency"))) {
+    adaptive = cct->_conf.get_val<uint64_t>("rgw_gc_max_concurrent_io_adaptive") >
+      (uint64_t)cct->_conf->rgw_gc_max_concurrent_io;
     remove_tags.resize(min(static_cast<int>(cct->_conf->rgw_gc_max_objs), rgw_shards_max()));
     tag_io_size.resize(min(static_cast<int>(cct->_conf->rgw_gc_max_objs), rgw_shards_max()));
+    if (perfcounter) {
+      perfcounter->set(l_rgw_gc_io_limit, max_aio.get());
+    }
   }
 
   ~RGWGCIOManager() {
@@ -327,7 +341,7 @@ public:
 
   int schedule_io(IoCtx *ioctx, const string& oid, ObjectWriteOperation *op,
 		  int index, const string& tag) {
-    while (ios.size() > max_aio) {
+    while (ios.size() > max_aio.get()) {
       if (gc->going_down()) {
         return 0;
       }
@@ -343,15 +357,47 @@ public:
     if (ret < 0) {
       return ret;
     }
-    ios.push_back(IO{IO::TailIO, c, oid, index, tag});
+    ios.push_back(IO{IO::TailIO, c, oid, index, tag, ceph::mono_clock::now()});
 
     return 0;
   }
 
+  /* Completions are reaped in submission order, so an io may have finished
+   * long before we get to wait for it. Stamp every io that is already
+   * complete, so that its latency is not inflated by the ones ahead of it.
+   */
+  void stamp_completions() {
+    auto now = ceph::mono_clock::now();
+    for (auto& io : ios) {
+      if (io.type == IO::TailIO && io.end == ceph::mono_time() &&
+	  io.c->is_complete()) {
+	io.end = now;
+      }
+    }
+  }
+
+  void sample_latency(IO& io) {
+    if (io.end == ceph::mono_time()) {
+      io.end = ceph::mono_clock::now();
+    }
+    auto lat = io.end - io.start;
+    max_aio.sample(lat);
+    if (perfcounter) {
+      perfcounter->tinc(l_rgw_gc_io_lat, lat);
+      perfcounter->set(l_rgw_gc_io_limit, max_aio.get());
+    }
+  }
+
   int handle_next_completion() {
     ceph_assert(!ios.empty());
     IO& io = ios.front();
-    io.c->wait_for_complete();
+    if (adaptive && io.type == IO::TailIO) {
+      stamp_completions();
+      io.c->wait_for_complete();
+      sample_latency(io);
+    } else {
+      io.c->wait_for_complete();
+    }
     int ret = io.c->get_return_value();
     io.c->release();
 
@@ -525,7 +571,36 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
   string marker;
   string next_marker;
   bool truncated;
-  IoCtx *ctx = new IoCtx;
+  /* one ioctx per data pool; a chain may span pools */
+  map<string, IoCtx> ctxs;
+  /* processed queue entries not yet trimmed from the queue head */
+  uint64_t untrimmed = 0;
+  const uint64_t trim_entries =
+    std::max<uint64_t>(cct->_conf.get_val<uint64_t>("rgw_gc_max_queue_trim_entries"), 1);
+
+  auto trim_queue = [&]() {
+    if (untrimmed == 0) {
+      return 0;
+    }
+    int r = io_manager.drain_ios();
+    if (r < 0) {
+      /* some removal failed; these entries will be processed again */
+      untrimmed = 0;
+      return r;
+    }
+    //Remove the entries from the queue
+    ldpp_dout(this, 5) << "RGWGC::process removing " << untrimmed <<
+      " entries, marker: " << marker << dendl;
+    r = io_manager.remove_queue_entries(index, untrimmed);
+    untrimmed = 0;
+    if (r < 0) {
+      ldpp_dout(this, 0) <<
+        "WARNING: failed to remove queue entries" << dendl;
+      return r;
+    }
+    return 0;
+  };
+
   do {
     int max = 100;
     std::list<cls_rgw_gc_obj_info> entries;
@@ -575,97 +650,126 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
 
     marker = next_marker;
 
-    string last_pool;
-    std::list<cls_rgw_gc_obj_info>::iterator iter;
-    for (iter = entries.begin(); iter != entries.end(); ++iter) {
-      cls_rgw_gc_obj_info& info = *iter;
-
-      ldpp_dout(this, 20) << "RGWGC::process iterating over entry tag='" <<
-	info.tag << "', time=" << info.time << ", chain.objs.size()=" <<
-	info.chain.objs.size() << dendl;
-
-      std::list<cls_rgw_obj>::iterator liter;
-      cls_rgw_obj_chain& chain = info.chain;
-
-      utime_t now = ceph_clock_now();
-      if (now >= end) {
-        goto done;
-      }
-      if (! transitioned_objects_cache[index]) {
-        if (chain.objs.empty()) {
-          io_manager.schedule_tag_removal(index, info.tag);
-        } else {
-          io_manager.add_tag_io_size(index, info.tag, chain.objs.size());
-        }
-      }
-      if (! chain.objs.empty()) {
-	for (liter = chain.objs.begin(); liter != chain.objs.end(); ++liter) {
-	  cls_rgw_obj& obj = *liter;
-
-	  if (obj.pool != last_pool) {
-	    delete ctx;
-	    ctx = new IoCtx;
-	    ret = rgw_init_ioctx(store->get_rados_handle(), obj.pool, *ctx);
+    {
+      /* Gather the removals of the whole batch and group them by pool and
+       * placement group, then issue them round-robin across the groups:
+       * the ios in flight are spread over as many PGs (and so OSDs) as the
+       * batch touches, instead of queueing up behind one busy PG.
+       */
+      struct Removal {
+	IoCtx *ctx;
+	const cls_rgw_obj *obj;
+	const string *tag;
+      };
+      map<pair<string, uint32_t>, std::deque<Removal>> pgs;
+
+      std::list<cls_rgw_gc_obj_info>::iterator iter;
+      for (iter = entries.begin(); iter != entries.end(); ++iter) {
+	cls_rgw_gc_obj_info& info = *iter;
+
+	ldpp_dout(this, 20) << "RGWGC::process iterating over entry tag='" <<
+	  info.tag << "', time=" << info.time << ", chain.objs.size()=" <<
+	  info.chain.objs.size() << dendl;
+
+	cls_rgw_obj_chain& chain = info.chain;
+
+	if (! transitioned_objects_cache[index]) {
+	  if (chain.objs.empty()) {
+	    io_manager.schedule_tag_removal(index, info.tag);
+	  } else {
+	    io_manager.add_tag_io_size(index, info.tag, chain.objs.size());
+	  }
+	}
+	for (auto& obj : chain.objs) {
+	  auto ctx_iter = ctxs.find(obj.pool);
+	  if (ctx_iter == ctxs.end()) {
+	    IoCtx ctx;
+	    ret = rgw_init_ioctx(store->get_rados_handle(), obj.pool, ctx);
 	    if (ret < 0) {
-        if (transitioned_objects_cache[index]) {
-          goto done;
-        }
-	      last_pool = "";
+	      if (transitioned_objects_cache[index]) {
+		goto done;
+	      }
 	      ldpp_dout(this, 0) << "ERROR: failed to create ioctx pool=" <<
 		obj.pool << dendl;
 	      continue;
 	    }
-	    last_pool = obj.pool;
+	    ctx_iter = ctxs.emplace(obj.pool, std::move(ctx)).first;
 	  }
+	  uint32_t pg = 0;
+	  ctx_iter->second.get_object_pg_hash_position2(
+	    obj.loc.empty() ? obj.key.name : obj.loc, &pg);
+	  pgs[make_pair(obj.pool, pg)].push_back(
+	    Removal{&ctx_iter->second, &obj, &info.tag});
+	}
+      }
+
+      while (!pgs.empty()) {
+	for (auto pg_iter = pgs.begin(); pg_iter != pgs.end(); ) {
+	  Removal& r = pg_iter->second.front();
 
-	  ctx->locator_set_key(obj.loc);
+	  utime_t now = ceph_clock_now();
+	  if (now >= end) {
+	    goto done;
+	  }
 
-	  const string& oid = obj.key.name; /* just stored raw oid there */
+	  r.ctx->locator_set_key(r.obj->loc);
 
-	  ldpp_dout(this, 5) << "RGWGC::process removing " << obj.pool <<
-	    ":" << obj.key.name << dendl;
+	  const string& oid = r.obj->key.name; /* just stored raw oid there */
+
+	  ldpp_dout(this, 5) << "RGWGC::process removing " << r.obj->pool <<
+	    ":" << oid << dendl;
 	  ObjectWriteOperation op;
-	  cls_refcount_put(op, info.tag, true);
+	  cls_refcount_put(op, *r.tag, true);
 
-	  ret = io_manager.schedule_io(ctx, oid, &op, index, info.tag);
+	  ret = io_manager.schedule_io(r.ctx, oid, &op, index, *r.tag);
 	  if (ret < 0) {
 	    ldpp_dout(this, 0) <<
 	      "WARNING: failed to schedule deletion for oid=" << oid << dendl;
-      if (transitioned_objects_cache[index]) {
-        //If deleting oid failed for any of them, we will not delete queue entries
-        goto done;
-      }
+	    if (transitioned_objects_cache[index]) {
+	      //If deleting oid failed for any of them, we will not delete queue entries
+	      goto done;
+	    }
 	  }
 	  if (going_down()) {
 	    // leave early, even if tag isn't removed, it's ok since it
 	    // will be picked up next time around
 	    goto done;
 	  }
-	} // chains loop
-      } // else -- chains not empty
-    } // entries loop
-    if (transitioned_objects_cache[index] && entries.size() > 0) {
-      ret = io_manager.drain_ios();
-      if (ret < 0) {
-        goto done;
-      }
-      //Remove the entries from the queue
-      ldpp_dout(this, 5) << "RGWGC::process removing entries, marker: " << marker << dendl;
-      ret = io_manager.remove_queue_entries(index, entries.size());
-      if (ret < 0) {
-        ldpp_dout(this, 0) <<
-          "WARNING: failed to remove queue entries" << dendl;
-        goto done;
+
+	  pg_iter->second.pop_front();
+	  if (pg_iter->second.empty()) {
+	    pg_iter = pgs.erase(pg_iter);
+	  } else {
+	    ++pg_iter;
+	  }
+	} // pgs loop
+      } // while removals pending
+    }
+
+    if (transitioned_objects_cache[index]) {
+      /* trimming waits for every io in flight, so only do it every
+       * rgw_gc_max_queue_trim_entries entries rather than after each batch
+       */
+      untrimmed += entries.size();
+      if (untrimmed >= trim_entries || !truncated) {
+        ret = trim_queue();
+        if (ret < 0) {
+          goto done;
+        }
       }
     }
   } while (truncated);
 
 done:
-  /* we don't drain here, because if we're going down we don't want to
-   * hold the system if backend is unresponsive
+  /* the entries of earlier batches are done and can still be trimmed: we get
+   * here when we ran out of time, but also when the listing that follows them
+   * finds nothing expired. We don't drain if we're going down, because we
+   * don't want to hold the system if backend is unresponsive
    */
+  if (untrimmed > 0 && transitioned_objects_cache[index] && !going_down()) {
+    trim_queue();
+  }
   l.unlock(&store->gc_pool_ctx, obj_names[index]);
-  delete ctx;
 
   return 0;
 }
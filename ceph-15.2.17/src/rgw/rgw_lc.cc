@@ -4,6 +4,7 @@
 #include <string.h>
 #include <iostream>
 #include <map>
+#include <set>
 #include <algorithm>
 #include <tuple>
 #include <functional>
@@ -432,11 +433,15 @@ class LCObjsLister {
   vector<rgw_bucket_dir_entry>::iterator obj_iter;
   rgw_bucket_dir_entry pre_obj;
   int64_t delay_ms;
+  int fetch_ret{0};
 
 public:
-  LCObjsLister(rgw::sal::RGWRadosStore *_store, RGWBucketInfo& _bucket_info) :
+  LCObjsLister(rgw::sal::RGWRadosStore *_store, RGWBucketInfo& _bucket_info,
+	       int shard_id = RGW_NO_SHARD) :
       store(_store), bucket_info(_bucket_info),
       target(store->getRados(), bucket_info), list_op(&target) {
+    /* with a shard id, only that bucket index shard is listed */
+    target.set_shard_id(shard_id);
     list_op.params.list_versions = bucket_info.versioned();
     list_op.params.allow_unordered = true;
     delay_ms = store->ctx()->_conf.get_val<int64_t>("rgw_lc_thread_delay");
@@ -447,6 +452,19 @@ public:
     list_op.params.prefix = prefix;
   }
 
+  /* resume listing after the given key, as if its entry, last modified
+   * at mtime, had just been listed */
+  void set_marker(const rgw_obj_index_key& marker, ceph::real_time mtime) {
+    list_op.params.marker = marker;
+    pre_obj.key = marker;
+    pre_obj.meta.mtime = mtime;
+  }
+
+  /* why get_obj() stopped short, if it did */
+  int get_error() const {
+    return fetch_ret;
+  }
+
   int init() {
     return fetch();
   }
@@ -481,6 +499,7 @@ public:
         if (ret < 0) {
           ldout(store->ctx(), 0) << "ERROR: list_op returned ret=" << ret
 				 << dendl;
+          fetch_ret = ret;
           return false;
         }
       }
@@ -644,9 +663,25 @@ class LCOpRule {
   std::vector<shared_ptr<LCOpFilter> > filters; // n.b., sharing ovhd
   std::vector<shared_ptr<LCOpAction> > actions;
 
+  /* the listing chunk of the entry, when processing by index shard */
+  std::shared_ptr<rgw::lc::ChunkTracker> chunks;
+  uint64_t chunk{0};
+
 public:
   LCOpRule(op_env& _env) : env(_env) {}
 
+  void set_chunk(const std::shared_ptr<rgw::lc::ChunkTracker>& tracker,
+		 uint64_t id) {
+    chunks = tracker;
+    chunk = id;
+  }
+
+  void complete() {
+    if (chunks) {
+      chunks->complete(chunk);
+    }
+  }
+
   boost::optional<std::string> get_next_key_name() {
     return next_key_name;
   }
@@ -894,8 +929,10 @@ int RGWLC::handle_multipart_expiration(
       list_op.params.marker = list_op.get_next_marker();
       ret = list_op.list_objects(1000, &objs, NULL, &is_truncated, null_yield);
       if (ret < 0) {
-          if (ret == (-ENOENT))
-            return 0;
+          if (ret == (-ENOENT)) {
+            /* a single index shard that is gone was resharded away */
+            return target->get_shard_id() == RGW_NO_SHARD ? 0 : -ECANCELED;
+          }
           ldpp_dout(this, 0) << "ERROR: store->list_objects():" <<dendl;
           return ret;
       }
@@ -1437,85 +1474,355 @@ int LCOpRule::process(rgw_bucket_dir_entry& o,
 
 }
 
-int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
-			     time_t stop_at, bool once)
+static inline vector<int> random_sequence(uint32_t n)
 {
-  RGWLifecycleConfiguration  config(cct);
-  RGWBucketInfo bucket_info;
-  map<string, bufferlist> bucket_attrs;
-  string no_ns, list_versions;
-  vector<rgw_bucket_dir_entry> objs;
-  vector<std::string> result;
-  boost::split(result, shard_id, boost::is_any_of(":"));
-  string bucket_tenant = result[0];
-  string bucket_name = result[1];
-  string bucket_marker = result[2];
-  int ret = store->getRados()->get_bucket_info(
-    store->svc(), bucket_tenant, bucket_name, bucket_info, NULL, null_yield,
-    &bucket_attrs);
+  vector<int> v(n, 0);
+  std::generate(v.begin(), v.end(),
+    [ix = 0]() mutable {
+      return ix++;
+    });
+  std::random_shuffle(v.begin(), v.end());
+  return v;
+}
+
+static void lc_rule_process(RGWLC::LCWorker* wk, WorkQ* wq, WorkItem& wi)
+{
+  auto wt =
+    boost::get<std::tuple<LCOpRule, rgw_bucket_dir_entry>>(wi);
+  auto& [op_rule, o] = wt;
+
+  ldpp_dout(wk->get_lc(), 20)
+    << __func__ << "(): key=" << o.key << wq->thr_name() 
+    << dendl;
+  int ret = op_rule.process(o, wk->get_lc(), wq);
   if (ret < 0) {
-    ldpp_dout(this, 0) << "LC:get_bucket_info for " << bucket_name
-		       << " failed" << dendl;
+    ldpp_dout(wk->get_lc(), 20)
+      << "ERROR: orule.process() returned ret=" << ret
+      << wq->thr_name() 
+      << dendl;
+  }
+  op_rule.complete();
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_lc_objects_processed);
+  }
+}
+
+static std::string get_lc_bucket_progress_oid(const string& shard_id)
+{
+  return lc_oid_prefix + "_bucket." + shard_id;
+}
+
+/* longest wait for index shards held by other workers */
+static constexpr auto lc_shard_max_backoff = std::chrono::seconds(30);
+
+/* xattr of the progress object that holds its rgw_lc_shard_round */
+static constexpr const char* lc_shard_round_attr = "lc.round";
+
+RGWLC::ShardLease::ShardLease(librados::IoCtx& ioctx, const std::string& oid,
+			      int shard, const std::string& cookie,
+			      const utime_t& duration)
+  : ioctx(ioctx), oid(oid), shard(shard),
+    lock("lc_shard." + std::to_string(shard))
+{
+  lock.set_cookie(cookie);
+  lock.set_duration(duration);
+}
+
+int RGWLC::ShardLease::acquire(const rgw_lc_shard_round& round)
+{
+  round_bl.clear();
+  encode(round, round_bl);
+  /* never recreate the progress object of a round that is over, nor
+   * take part in a round that was started over */
+  librados::ObjectWriteOperation op;
+  op.assert_exists();
+  op.cmpxattr(lc_shard_round_attr, LIBRADOS_CMPXATTR_OP_EQ, round_bl);
+  lock.set_may_renew(false);
+  lock.lock_exclusive(&op);
+  int ret = ioctx.operate(oid, &op);
+  if (ret < 0) {
+    return ret;
+  }
+  std::map<std::string, bufferlist> vals;
+  ret = ioctx.omap_get_vals_by_keys(oid, {std::to_string(shard)}, &vals);
+  if (ret < 0) {
+    release();
     return ret;
   }
+  progress = rgw_lc_shard_progress();
+  if (!vals.empty()) {
+    try {
+      auto iter = vals.begin()->second.cbegin();
+      decode(progress, iter);
+    } catch (buffer::error& err) {
+      progress = rgw_lc_shard_progress();
+    }
+  }
+  if (progress.round != round.round) {
+    progress = rgw_lc_shard_progress();
+    progress.round = round.round;
+  }
+  return 0;
+}
 
-  auto stack_guard = make_scope_guard(
-    [&worker, &bucket_info]
-      {
-	worker->workpool->drain();
-      }
-    );
+int RGWLC::ShardLease::checkpoint(uint32_t rule, const rgw_obj_index_key& marker,
+				  bool done, ceph::real_time marker_mtime)
+{
+  rgw_lc_shard_progress p = progress;
+  p.rule = rule;
+  p.marker = marker;
+  p.done = done;
+  p.marker_mtime = marker_mtime;
+
+  bufferlist bl;
+  encode(p, bl);
+
+  librados::ObjectWriteOperation op;
+  op.assert_exists();
+  op.cmpxattr(lc_shard_round_attr, LIBRADOS_CMPXATTR_OP_EQ, round_bl);
+  lock.set_may_renew(true);
+  lock.lock_exclusive(&op);
+  op.omap_set({{std::to_string(shard), bl}});
+  int ret = ioctx.operate(oid, &op);
+  if (ret < 0) {
+    return ret;
+  }
+  progress = std::move(p);
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_lc_checkpoint);
+  }
+  return 0;
+}
 
-  if (bucket_info.bucket.marker != bucket_marker) {
-    ldpp_dout(this, 1) << "LC: deleting stale entry found for bucket="
-		       << bucket_tenant << ":" << bucket_name
-		       << " cur_marker=" << bucket_info.bucket.marker
-                       << " orig_marker=" << bucket_marker << dendl;
+void RGWLC::ShardLease::release()
+{
+  lock.unlock(&ioctx, oid);
+}
+
+namespace rgw::lc {
+
+static int read_shard_round(librados::IoCtx& ioctx, const std::string& oid,
+			    rgw_lc_shard_round *round, bufferlist *bl)
+{
+  int ret = ioctx.getxattr(oid, lc_shard_round_attr, *bl);
+  if (ret == -ENODATA) {
     return -ENOENT;
   }
+  if (ret < 0) {
+    return ret;
+  }
+  try {
+    auto iter = bl->cbegin();
+    decode(*round, iter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+  return 0;
+}
 
-  RGWRados::Bucket target(store->getRados(), bucket_info);
+int get_shard_round(librados::IoCtx& ioctx, const std::string& oid,
+		    rgw_lc_shard_round *round)
+{
+  bufferlist bl;
+  return read_shard_round(ioctx, oid, round, &bl);
+}
 
-  map<string, bufferlist>::iterator aiter = bucket_attrs.find(RGW_ATTR_LC);
-  if (aiter == bucket_attrs.end())
+int start_shard_round(librados::IoCtx& ioctx, const std::string& oid,
+		      const rgw_lc_shard_round& round, bool create,
+		      rgw_lc_shard_round *cur_round)
+{
+  bufferlist cur_bl;
+  int ret = read_shard_round(ioctx, oid, cur_round, &cur_bl);
+  if (ret == 0 && cur_round->same_layout(round)) {
     return 0;
+  }
+  if (ret == -ENOENT && !create) {
+    return ret;
+  }
+  if (ret < 0 && ret != -ENOENT && ret != -EIO) {
+    return ret;
+  }
 
-  bufferlist::const_iterator iter{&aiter->second};
-  try {
-      config.decode(iter);
-    } catch (const buffer::error& e) {
-      ldpp_dout(this, 0) << __func__ <<  "() decode life cycle config failed"
-			 << dendl;
-      return -1;
+  bufferlist bl;
+  encode(round, bl);
+  librados::ObjectWriteOperation op;
+  if (ret == 0) {
+    /* the bucket was resharded: start over, unless another worker got
+     * there first.  Workers still on the old round fail their next
+     * checkpoint. */
+    op.cmpxattr(lc_shard_round_attr, LIBRADOS_CMPXATTR_OP_EQ, cur_bl);
+  } else {
+    op.create(false);
+  }
+  op.omap_clear();
+  op.setxattr(lc_shard_round_attr, bl);
+  ret = ioctx.operate(oid, &op);
+  if (ret == -ECANCELED || ret == -ENOENT) {
+    ret = get_shard_round(ioctx, oid, cur_round);
+    if (ret < 0) {
+      return ret;
     }
+    return cur_round->same_layout(round) ? 0 : -ECANCELED;
+  }
+  if (ret < 0) {
+    return ret;
+  }
+  *cur_round = round;
+  return 0;
+}
 
-  auto pf = [](RGWLC::LCWorker* wk, WorkQ* wq, WorkItem& wi) {
-    auto wt =
-      boost::get<std::tuple<LCOpRule, rgw_bucket_dir_entry>>(wi);
-    auto& [op_rule, o] = wt;
+int read_shards_done(librados::IoCtx& ioctx, const std::string& oid,
+		     uint64_t round, std::set<int> *done)
+{
+  std::string marker;
+  bool more = true;
+  while (more) {
+    std::map<std::string, bufferlist> vals;
+    int ret = ioctx.omap_get_vals2(oid, marker, 1000, &vals, &more);
+    if (ret == -ENOENT) {
+      return 0;
+    }
+    if (ret < 0) {
+      return ret;
+    }
+    for (auto& [key, bl] : vals) {
+      rgw_lc_shard_progress progress;
+      try {
+	auto iter = bl.cbegin();
+	decode(progress, iter);
+      } catch (buffer::error& err) {
+	continue;
+      }
+      if (progress.round == round && progress.done) {
+	done->insert(atoi(key.c_str()));
+      }
+    }
+    if (!vals.empty()) {
+      marker = vals.rbegin()->first;
+    }
+  }
+  return 0;
+}
 
-    ldpp_dout(wk->get_lc(), 20)
-      << __func__ << "(): key=" << o.key << wq->thr_name() 
-      << dendl;
-    int ret = op_rule.process(o, wk->dpp, wq);
+int finish_shard_round(librados::IoCtx& ioctx, const std::string& oid)
+{
+  int ret = ioctx.remove(oid);
+  if (ret == -ENOENT) {
+    /* another worker saw the round through */
+    return 0;
+  }
+  return ret;
+}
+
+int process_shard_round(const DoutPrefixProvider *dpp,
+			librados::IoCtx& ioctx, const std::string& oid,
+			const rgw_lc_shard_round& round, bool helper,
+			const std::string& cookie, const utime_t& lease_duration,
+			const shard_round_ops& ops, bool *worked)
+{
+  /* the round outlives the lc entry's start_time, which every cycle
+   * resets, so that an interrupted round resumes from its checkpoints */
+  rgw_lc_shard_round cur_round;
+  int ret = start_shard_round(ioctx, oid, round, !helper, &cur_round);
+  if (ret == -ENOENT) {
+    /* not started yet, or already done */
+    return -EAGAIN;
+  }
+  if (ret < 0) {
+    ldpp_dout(dpp, 0) << "ERROR: failed to read lifecycle round of " << oid
+		      << ", ret=" << ret << dendl;
+    return ret;
+  }
+
+  auto backoff = std::chrono::seconds(1);
+  while (!ops.should_stop()) {
+    std::set<int> done;
+    ret = read_shards_done(ioctx, oid, cur_round.round, &done);
     if (ret < 0) {
-      ldpp_dout(wk->get_lc(), 20)
-	<< "ERROR: orule.process() returned ret=" << ret
-	<< wq->thr_name() 
-	<< dendl;
+      ldpp_dout(dpp, 0) << "ERROR: failed to read lifecycle progress of "
+			<< oid << ", ret=" << ret << dendl;
+      return ret;
+    }
+    if (done.size() >= cur_round.num_shards) {
+      ret = finish_shard_round(ioctx, oid);
+      if (ret < 0) {
+	ldpp_dout(dpp, 0) << "WARNING: failed to remove lifecycle progress "
+			  << oid << ", ret=" << ret << dendl;
+      }
+      return 0;
     }
-  };
-  worker->workpool->setf(pf);
 
-  multimap<string, lc_op>& prefix_map = config.get_prefix_map();
-  ldpp_dout(this, 10) << __func__ <<  "() prefix_map size="
-		      << prefix_map.size()
-		      << dendl;
+    bool claimed = false;
+    for (auto shard : random_sequence(cur_round.num_shards)) {
+      if (done.count(shard)) {
+	continue;
+      }
+      RGWLC::ShardLease lease(ioctx, oid, shard, cookie, lease_duration);
+      ret = lease.acquire(cur_round);
+      if (ret == -EBUSY || ret == -EEXIST) {
+	/* another worker has it */
+	continue;
+      }
+      if (ret == -ENOENT) {
+	/* another worker saw the round through */
+	return 0;
+      }
+      if (ret < 0) {
+	return ret;
+      }
+      if (lease.get_progress().done) {
+	lease.release();
+	continue;
+      }
+      claimed = true;
+      if (worked) {
+	*worked = true;
+      }
+      ret = ops.process_shard(lease);
+      lease.release();
+      if (ret < 0 && ret != -EBUSY) {
+	return ret;
+      }
+      if (ops.should_stop()) {
+	break;
+      }
+    }
 
+    if (claimed) {
+      backoff = std::chrono::seconds(1);
+    } else {
+      if (helper) {
+	return -EAGAIN;
+      }
+      /* the remaining index shards are held by other workers; wait for
+       * them to finish, or for their lease to expire */
+      ldpp_dout(dpp, 5) << __func__ << "(): waiting " << backoff.count()
+			<< "s for " << cur_round.num_shards - done.size()
+			<< " index shards of " << oid
+			<< " processed by other workers" << dendl;
+      ops.wait(backoff);
+      backoff = std::min(backoff * 2, lc_shard_max_backoff);
+    }
+  }
+  /* stopped with index shards left: the round stays in progress */
+  return -EAGAIN;
+}
+
+} // namespace rgw::lc
+
+int RGWLC::process_rules(RGWBucketInfo& bucket_info,
+			 multimap<string, lc_op>& prefix_map,
+			 LCWorker* worker, time_t stop_at, bool once,
+			 ShardLease* lease)
+{
+  worker->workpool->setf(lc_rule_process);
+
+  int ret;
   rgw_obj_key pre_marker;
   rgw_obj_key next_marker;
+  uint32_t rule = 0;
   for(auto prefix_iter = prefix_map.begin(); prefix_iter != prefix_map.end();
-      ++prefix_iter) {
+      ++prefix_iter, ++rule) {
 
     if (worker_should_stop(stop_at, once)) {
       ldout(cct, 5) << __func__ << " interval budget EXPIRED worker "
@@ -1524,6 +1831,11 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
       return 0;
     }
 
+    if (lease && rule < lease->get_progress().rule) {
+      /* done before the last checkpoint */
+      continue;
+    }
+
     auto& op = prefix_iter->second;
     if (!is_valid_op(op)) {
       continue;
@@ -1538,27 +1850,254 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
       pre_marker = next_marker;
     }
 
-    LCObjsLister ol(store, bucket_info);
+    LCObjsLister ol(store, bucket_info,
+		    lease ? lease->get_shard() : RGW_NO_SHARD);
     ol.set_prefix(prefix_iter->first);
+    std::shared_ptr<rgw::lc::ChunkTracker> chunks;
+    if (lease) {
+      rgw_obj_index_key marker;
+      ceph::real_time marker_mtime;
+      if (rule == lease->get_progress().rule) {
+	marker = lease->get_progress().marker;
+	marker_mtime = lease->get_progress().marker_mtime;
+	ol.set_marker(marker, marker_mtime);
+      }
+      chunks = std::make_shared<rgw::lc::ChunkTracker>(marker, marker_mtime);
+    }
 
     ret = ol.init();
     if (ret < 0) {
-      if (ret == (-ENOENT))
-        return 0;
+      if (ret == (-ENOENT)) {
+	/* an index shard that is gone was resharded away */
+	return lease ? -ECANCELED : 0;
+      }
       ldpp_dout(this, 0) << "ERROR: store->list_objects():" <<dendl;
       return ret;
     }
 
+    /* with a lease, every listing chunk checkpoints what the workpool
+     * finished so far, which renews the lease */
+    int lease_ret = 0;
+    auto fetch_barrier = [&]() {
+      if (!lease) {
+	return;
+      }
+      auto prev = ol.get_prev_obj();
+      chunks->end_chunk(prev.key, prev.meta.mtime);
+      rgw_obj_index_key marker;
+      ceph::real_time marker_mtime;
+      chunks->get_marker(&marker, &marker_mtime);
+      int r = lease->checkpoint(rule, marker, false, marker_mtime);
+      if (r < 0) {
+	ldpp_dout(this, 0) << "WARNING: lost lifecycle lease on index shard "
+			   << lease->get_shard() << " of "
+			   << bucket_info.bucket << ", r=" << r << dendl;
+	lease_ret = r;
+      }
+    };
+
     op_env oenv(op, store, worker, bucket_info, ol);
     LCOpRule orule(oenv);
     orule.build(); // why can't ctor do it?
     rgw_bucket_dir_entry* o{nullptr};
-    for (; ol.get_obj(&o /* , fetch_barrier */); ol.next()) {
+    for (; ol.get_obj(&o, fetch_barrier); ol.next()) {
+      if (lease_ret < 0) {
+	break;
+      }
       orule.update();
+      if (chunks) {
+	orule.set_chunk(chunks, chunks->add());
+      }
       std::tuple<LCOpRule, rgw_bucket_dir_entry> t1 = {orule, *o};
       worker->workpool->enqueue(WorkItem{t1});
     }
     worker->workpool->drain();
+    if (lease_ret < 0) {
+      return lease_ret == -ECANCELED ? lease_ret : -EBUSY;
+    }
+    if (lease && ol.get_error() < 0) {
+      /* don't mark the index shard done past entries never listed */
+      ret = ol.get_error();
+      return ret == -ENOENT ? -ECANCELED : ret;
+    }
+  }
+
+  return 0;
+}
+
+int RGWLC::bucket_lc_process_shard(RGWBucketInfo& bucket_info,
+				   multimap<string, lc_op>& prefix_map,
+				   LCWorker* worker, ShardLease& lease,
+				   time_t stop_at, bool once)
+{
+  auto start = ceph::mono_clock::now();
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_lc_shard_active);
+  }
+  auto active_guard = make_scope_guard(
+    []
+      {
+	if (perfcounter) {
+	  perfcounter->dec(l_rgw_lc_shard_active);
+	}
+      }
+    );
+
+  ldpp_dout(this, 5) << __func__ << "(): START " << bucket_info.bucket
+		     << " index shard " << lease.get_shard()
+		     << " rule " << lease.get_progress().rule
+		     << " marker " << lease.get_progress().marker
+		     << " worker ix: " << worker->ix << dendl;
+
+  int ret = process_rules(bucket_info, prefix_map, worker, stop_at, once,
+			  &lease);
+  if (ret < 0) {
+    return ret;
+  }
+  if (going_down() || worker_should_stop(stop_at, once)) {
+    return 0;
+  }
+
+  RGWRados::Bucket target(store->getRados(), bucket_info);
+  target.set_shard_id(lease.get_shard());
+  ret = handle_multipart_expiration(&target, prefix_map, worker, stop_at, once);
+  if (ret < 0) {
+    return ret;
+  }
+  if (going_down() || worker_should_stop(stop_at, once)) {
+    return 0;
+  }
+
+  ret = lease.checkpoint(prefix_map.size(), rgw_obj_index_key(), true);
+  if (ret < 0) {
+    return ret;
+  }
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_lc_shard_done);
+    perfcounter->tinc(l_rgw_lc_shard_lat, ceph::mono_clock::now() - start);
+  }
+  ldpp_dout(this, 5) << __func__ << "(): DONE " << bucket_info.bucket
+		     << " index shard " << lease.get_shard()
+		     << " worker ix: " << worker->ix << dendl;
+  return 0;
+}
+
+int RGWLC::bucket_lc_process_shards(RGWBucketInfo& bucket_info,
+				    const string& shard_id,
+				    multimap<string, lc_op>& prefix_map,
+				    LCWorker* worker, time_t stop_at,
+				    bool once, uint64_t round, bool helper,
+				    bool *worked)
+{
+  librados::IoCtx& ioctx = store->getRados()->lc_pool_ctx;
+  const string oid = get_lc_bucket_progress_oid(shard_id);
+  const utime_t lease_duration(cct->_conf->rgw_lc_lock_max_time, 0);
+  const string lease_cookie = cookie + "." + std::to_string(worker->ix);
+
+  rgw_lc_shard_round shard_round;
+  shard_round.round = round;
+  shard_round.bucket_id = bucket_info.bucket.bucket_id;
+  shard_round.num_shards = bucket_info.num_shards;
+
+  rgw::lc::shard_round_ops ops;
+  ops.should_stop = [&]() {
+    return going_down() || worker_should_stop(stop_at, once);
+  };
+  ops.wait = [worker](std::chrono::seconds backoff) {
+    std::unique_lock l{worker->lock};
+    worker->cond.wait_for(l, backoff);
+  };
+  ops.process_shard = [&](ShardLease& lease) {
+    return bucket_lc_process_shard(bucket_info, prefix_map, worker, lease,
+				   stop_at, once);
+  };
+  int ret = rgw::lc::process_shard_round(this, ioctx, oid, shard_round,
+					 helper, lease_cookie, lease_duration,
+					 ops, worked);
+  if (ret == -ECANCELED) {
+    /* whoever reads the new bucket instance starts the round over */
+    ldpp_dout(this, 5) << __func__ << "(): " << bucket_info.bucket
+		       << " was resharded during its lifecycle round" << dendl;
+    return -EAGAIN;
+  }
+  return ret;
+}
+
+int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
+			     time_t stop_at, bool once, uint64_t round,
+			     bool helper, bool *worked)
+{
+  RGWLifecycleConfiguration  config(cct);
+  RGWBucketInfo bucket_info;
+  map<string, bufferlist> bucket_attrs;
+  string no_ns, list_versions;
+  vector<rgw_bucket_dir_entry> objs;
+  vector<std::string> result;
+  boost::split(result, shard_id, boost::is_any_of(":"));
+  string bucket_tenant = result[0];
+  string bucket_name = result[1];
+  string bucket_marker = result[2];
+  int ret = store->getRados()->get_bucket_info(
+    store->svc(), bucket_tenant, bucket_name, bucket_info, NULL, null_yield,
+    &bucket_attrs);
+  if (ret < 0) {
+    ldpp_dout(this, 0) << "LC:get_bucket_info for " << bucket_name
+		       << " failed" << dendl;
+    return ret;
+  }
+
+  const uint64_t split_min_shards =
+    cct->_conf.get_val<uint64_t>("rgw_lc_bucket_split_min_shards");
+  const bool split = split_min_shards > 0 &&
+    bucket_info.num_shards >= split_min_shards;
+  if (helper && !split) {
+    /* only buckets processed by index shard can take more workers */
+    return 0;
+  }
+
+  auto stack_guard = make_scope_guard(
+    [&worker, &bucket_info]
+      {
+	worker->workpool->drain();
+      }
+    );
+
+  if (bucket_info.bucket.marker != bucket_marker) {
+    ldpp_dout(this, 1) << "LC: deleting stale entry found for bucket="
+		       << bucket_tenant << ":" << bucket_name
+		       << " cur_marker=" << bucket_info.bucket.marker
+                       << " orig_marker=" << bucket_marker << dendl;
+    return -ENOENT;
+  }
+
+  RGWRados::Bucket target(store->getRados(), bucket_info);
+
+  map<string, bufferlist>::iterator aiter = bucket_attrs.find(RGW_ATTR_LC);
+  if (aiter == bucket_attrs.end())
+    return 0;
+
+  bufferlist::const_iterator iter{&aiter->second};
+  try {
+      config.decode(iter);
+    } catch (const buffer::error& e) {
+      ldpp_dout(this, 0) << __func__ <<  "() decode life cycle config failed"
+			 << dendl;
+      return -1;
+    }
+
+  multimap<string, lc_op>& prefix_map = config.get_prefix_map();
+  ldpp_dout(this, 10) << __func__ <<  "() prefix_map size="
+		      << prefix_map.size()
+		      << dendl;
+
+  if (split) {
+    return bucket_lc_process_shards(bucket_info, shard_id, prefix_map, worker,
+				    stop_at, once, round, helper, worked);
+  }
+
+  ret = process_rules(bucket_info, prefix_map, worker, stop_at, once, nullptr);
+  if (ret < 0 || worker_should_stop(stop_at, once)) {
+    return ret;
   }
 
   ret = handle_multipart_expiration(&target, prefix_map, worker, stop_at, once);
@@ -1600,6 +2139,12 @@ int RGWLC::bucket_lc_post(int index, int max_lock_sec,
         ldpp_dout(this, 0) << "RGWLC::bucket_lc_post() failed to remove entry "
             << obj_names[index] << dendl;
       }
+      store->getRados()->lc_pool_ctx.remove(
+	get_lc_bucket_progress_oid(entry.bucket));
+      goto clean;
+    } else if (result == -EAGAIN) {
+      /* stopped part way through a bucket processed by index shard; it
+       * stays in progress until the round is seen through */
       goto clean;
     } else if (result < 0) {
       entry.status = lc_failed;
@@ -1653,17 +2198,6 @@ int RGWLC::list_lc_progress(string& marker, uint32_t max_entries,
   return 0;
 }
 
-static inline vector<int> random_sequence(uint32_t n)
-{
-  vector<int> v(n, 0);
-  std::generate(v.begin(), v.end(),
-    [ix = 0]() mutable {
-      return ix++;
-    });
-  std::random_shuffle(v.begin(), v.end());
-  return v;
-}
-
 int RGWLC::process(LCWorker* worker, bool once = false)
 {
   int max_secs = cct->_conf->rgw_lc_lock_max_time;
@@ -1759,7 +2293,29 @@ int RGWLC::process(int index, int max_lock_secs, LCWorker* worker,
 	    dout(5) << "RGWLC::process(): ACTIVE entry: " << entry
 		    << " index: " << index << " worker ix: " << worker->ix
 		  << dendl;
-	    goto exit;
+	    /* a bucket processed by index shard can take more workers */
+	    l.unlock(&store->getRados()->lc_pool_ctx, obj_names[index]);
+	    rgw_lc_shard_round shard_round;
+	    ret = rgw::lc::get_shard_round(
+	      store->getRados()->lc_pool_ctx,
+	      get_lc_bucket_progress_oid(entry.bucket), &shard_round);
+	    if (ret < 0) {
+	      /* not processed by index shard, or no round in progress: no
+	       * need to look the bucket up */
+	      return 0;
+	    }
+	    bool worked = false;
+	    ret = bucket_lc_process(entry.bucket, worker, thread_stop_at(),
+				    once, entry.start_time, true /* helper */,
+				    &worked);
+	    if (worked && ret == 0) {
+	      /* this worker saw the round through */
+	      bucket_lc_post(index, max_lock_secs, entry, ret, worker);
+	    }
+	    if (worked && !once) {
+	      continue;
+	    }
+	    return 0;
 	  }
 	}
       }
@@ -1819,7 +2375,8 @@ int RGWLC::process(int index, int max_lock_secs, LCWorker* worker,
 	    << dendl;
 
     l.unlock(&store->getRados()->lc_pool_ctx, obj_names[index]);
-    ret = bucket_lc_process(entry.bucket, worker, thread_stop_at(), once);
+    ret = bucket_lc_process(entry.bucket, worker, thread_stop_at(), once,
+			    entry.start_time);
     bucket_lc_post(index, max_lock_secs, entry, ret, worker);
   } while(1 && !once);
 
@@ -2061,6 +2618,10 @@ int RGWLC::remove_bucket_config(RGWBucketInfo& bucket_info,
     return cls_rgw_lc_rm_entry(*ctx, oid, entry);
   });
 
+  /* progress of a bucket processed by index shard, if any */
+  store->getRados()->get_lc_pool_ctx()->remove(
+    get_lc_bucket_progress_oid(get_lc_shard_name(bucket)));
+
   return ret;
 } /* RGWLC::remove_bucket_config */
 
@@ -5,6 +5,7 @@
 #define CEPH_RGW_LC_H
 
 #include <map>
+#include <set>
 #include <string>
 #include <iostream>
 
@@ -19,10 +20,13 @@
 #include "rgw_common.h"
 #include "rgw_rados.h"
 #include "cls/rgw/cls_rgw_types.h"
+#include "cls/lock/cls_lock_client.h"
 #include "rgw_tag.h"
 #include "rgw_sal.h"
 
 #include <atomic>
+#include <deque>
+#include <mutex>
 #include <tuple>
 
 #define HASH_PRIME 7877
@@ -462,6 +466,72 @@ public:
 };
 WRITE_CLASS_ENCODER(RGWLifecycleConfiguration)
 
+/* A round of processing a bucket one index shard at a time (see
+ * rgw_lc_bucket_split_min_shards), for the index layout it began with.
+ * Kept in an xattr of a per-bucket progress object in the lc pool; the
+ * object is removed once every index shard is done.  Resharding the
+ * bucket starts the round over, as its checkpoints name index shards
+ * that no longer exist. */
+struct rgw_lc_shard_round {
+  uint64_t round{0};          // start_time of the lc entry that began it
+  std::string bucket_id;      // bucket instance whose index is processed
+  uint32_t num_shards{0};
+
+  bool same_layout(const rgw_lc_shard_round& r) const {
+    return bucket_id == r.bucket_id && num_shards == r.num_shards;
+  }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(round, bl);
+    encode(bucket_id, bl);
+    encode(num_shards, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(round, bl);
+    decode(bucket_id, bl);
+    decode(num_shards, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(rgw_lc_shard_round)
+
+/* Where processing of one index shard got to in a round.  Kept in the
+ * omap of the progress object, keyed by index shard. */
+struct rgw_lc_shard_progress {
+  uint64_t round{0};          // the round it belongs to
+  uint32_t rule{0};           // position in the rule prefix map
+  rgw_obj_index_key marker;   // last key processed for that rule
+  bool done{false};
+  /* mtime of the marker's entry, which the noncurrent version listed
+   * after it expires from */
+  ceph::real_time marker_mtime;
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(2, 1, bl);
+    encode(round, bl);
+    encode(rule, bl);
+    encode(marker, bl);
+    encode(done, bl);
+    encode(marker_mtime, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(2, bl);
+    decode(round, bl);
+    decode(rule, bl);
+    decode(marker, bl);
+    decode(done, bl);
+    if (struct_v >= 2) {
+      decode(marker_mtime, bl);
+    }
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(rgw_lc_shard_progress)
+
 class RGWLC : public DoutPrefixProvider {
   CephContext *cct;
   rgw::sal::RGWRadosStore *store;
@@ -473,6 +543,7 @@ class RGWLC : public DoutPrefixProvider {
 public:
 
   class WorkPool;
+  class ShardLease;
 
   class LCWorker : public Thread
   {
@@ -522,7 +593,8 @@ public:
 		       vector<cls_rgw_lc_entry>&, int& index);
   int bucket_lc_prepare(int index, LCWorker* worker);
   int bucket_lc_process(string& shard_id, LCWorker* worker, time_t stop_at,
-			bool once);
+			bool once, uint64_t round = 0, bool helper = false,
+			bool *worked = nullptr);
   int bucket_lc_post(int index, int max_lock_sec,
 		     cls_rgw_lc_entry& entry, int& result, LCWorker* worker);
   bool going_down();
@@ -543,10 +615,167 @@ public:
   int handle_multipart_expiration(RGWRados::Bucket *target,
 				  const multimap<string, lc_op>& prefix_map,
 				  LCWorker* worker, time_t stop_at, bool once);
+  int process_rules(RGWBucketInfo& bucket_info,
+		    multimap<string, lc_op>& prefix_map, LCWorker* worker,
+		    time_t stop_at, bool once, ShardLease* lease);
+  int bucket_lc_process_shards(RGWBucketInfo& bucket_info,
+			       const string& shard_id,
+			       multimap<string, lc_op>& prefix_map,
+			       LCWorker* worker, time_t stop_at, bool once,
+			       uint64_t round, bool helper, bool *worked);
+  int bucket_lc_process_shard(RGWBucketInfo& bucket_info,
+			      multimap<string, lc_op>& prefix_map,
+			      LCWorker* worker, ShardLease& lease,
+			      time_t stop_at, bool once);
 };
 
+/*
+ * Lease on one index shard of a bucket that is processed one index shard
+ * at a time.  The lease is an exclusive cls_lock named after the index
+ * shard on the bucket's progress object, so that any lifecycle worker of
+ * any RGW instance can take a shard that nobody else holds.  Every
+ * checkpoint renews the lease in the same operation that records the
+ * progress, and fails once the lease was lost to another worker.
+ */
+class RGWLC::ShardLease {
+  librados::IoCtx& ioctx;
+  const std::string oid;
+  const int shard;
+  rados::cls::lock::Lock lock;
+  bufferlist round_bl;
+  rgw_lc_shard_progress progress;
+
+public:
+  ShardLease(librados::IoCtx& ioctx, const std::string& oid, int shard,
+	     const std::string& cookie, const utime_t& duration);
+
+  int get_shard() const {
+    return shard;
+  }
+
+  const rgw_lc_shard_progress& get_progress() const {
+    return progress;
+  }
+
+  /* take the lease and load the checkpoint of the given round; -ENOENT
+   * once the round is over and its progress object removed, -ECANCELED
+   * once another round took its place.  Checkpoints fail likewise. */
+  int acquire(const rgw_lc_shard_round& round);
+  int checkpoint(uint32_t rule, const rgw_obj_index_key& marker, bool done,
+		 ceph::real_time marker_mtime = ceph::real_time());
+  void release();
+}; /* RGWLC::ShardLease */
+
 namespace rgw::lc {
 
+/* Start a round of processing a bucket by index shard, unless an earlier
+ * round of the same index layout was interrupted: that one is resumed.
+ * A round of another layout is started over, unless someone else did so
+ * meanwhile (-ECANCELED if that was for yet another layout).  Without
+ * create, returns -ENOENT rather than starting a round where there is
+ * none.  *cur_round is set to the round that is current. */
+int start_shard_round(librados::IoCtx& ioctx, const std::string& oid,
+		      const rgw_lc_shard_round& round, bool create,
+		      rgw_lc_shard_round *cur_round);
+/* the round a bucket is being processed in, -ENOENT if none */
+int get_shard_round(librados::IoCtx& ioctx, const std::string& oid,
+		    rgw_lc_shard_round *round);
+/* which index shards are done in the given round */
+int read_shards_done(librados::IoCtx& ioctx, const std::string& oid,
+		     uint64_t round, std::set<int> *done);
+/* drop the progress of a round once every index shard is done */
+int finish_shard_round(librados::IoCtx& ioctx, const std::string& oid);
+
+/* what process_shard_round() runs on the lifecycle worker */
+struct shard_round_ops {
+  std::function<bool()> should_stop;
+  /* wait for index shards held by other workers */
+  std::function<void(std::chrono::seconds)> wait;
+  /* process the index shard of the lease from its checkpoint */
+  std::function<int(RGWLC::ShardLease&)> process_shard;
+};
+
+/* Take part in a round of processing a bucket by index shard, taking
+ * index shards nobody else holds until every one is done.  Returns 0
+ * once the round is seen through, by this worker or another; -EAGAIN
+ * when stopped with index shards left, or when a helper finds no round
+ * or nothing to take; -ECANCELED when the bucket was resharded under the
+ * round.  *worked is set if any index shard was processed. */
+int process_shard_round(const DoutPrefixProvider *dpp,
+			librados::IoCtx& ioctx, const std::string& oid,
+			const rgw_lc_shard_round& round, bool helper,
+			const std::string& cookie, const utime_t& lease_duration,
+			const shard_round_ops& ops, bool *worked);
+
+/*
+ * The listing chunks of an index shard, whose entries are processed by
+ * the workpool in any order.  A chunk is finished once all its entries
+ * are; the shard can be checkpointed at the end of the last chunk that is
+ * finished along with every chunk before it, without draining the
+ * workpool.
+ */
+class ChunkTracker {
+  struct chunk_t {
+    uint64_t pending{0};
+    bool ended{false};
+    rgw_obj_index_key last;
+    ceph::real_time last_mtime;
+  };
+
+  std::mutex lock;
+  uint64_t first{0};            // id of chunks.front()
+  std::deque<chunk_t> chunks;
+  rgw_obj_index_key marker;
+  ceph::real_time marker_mtime;
+
+  void trim() {
+    while (chunks.size() > 1 && chunks.front().ended &&
+	   chunks.front().pending == 0) {
+      marker = chunks.front().last;
+      marker_mtime = chunks.front().last_mtime;
+      chunks.pop_front();
+      ++first;
+    }
+  }
+
+public:
+  /* listing starts after marker */
+  ChunkTracker(const rgw_obj_index_key& marker, ceph::real_time marker_mtime)
+    : chunks(1), marker(marker), marker_mtime(marker_mtime) {}
+
+  /* an entry of the chunk being listed is queued; returns the chunk */
+  uint64_t add() {
+    std::lock_guard l{lock};
+    ++chunks.back().pending;
+    return first + chunks.size() - 1;
+  }
+  /* an entry of the given chunk is processed */
+  void complete(uint64_t chunk) {
+    std::lock_guard l{lock};
+    auto& c = chunks.at(chunk - first);
+    ceph_assert(c.pending > 0);
+    --c.pending;
+    trim();
+  }
+  /* the chunk being listed ended with last; a new one begins */
+  void end_chunk(const rgw_obj_index_key& last, ceph::real_time last_mtime) {
+    std::lock_guard l{lock};
+    auto& c = chunks.back();
+    c.ended = true;
+    c.last = last;
+    c.last_mtime = last_mtime;
+    chunks.emplace_back();
+    trim();
+  }
+  /* the key every entry up to which is processed */
+  void get_marker(rgw_obj_index_key *m, ceph::real_time *m_mtime) {
+    std::lock_guard l{lock};
+    *m = marker;
+    *m_mtime = marker_mtime;
+  }
+};
+
+
 int fix_lc_shard_entry(rgw::sal::RGWRadosStore *store, const RGWBucketInfo& bucket_info,
 		       const map<std::string,bufferlist>& battrs);
 
@@ -12,6 +12,7 @@
 #include "rgw_multi.h"
 #include "rgw_op.h"
 #include "rgw_sal.h"
+#include "rgw_aio_throttle.h"
 
 #include "services/svc_sys_obj.h"
 #include "services/svc_tier_rados.h"
@@ -187,6 +188,142 @@ int list_multipart_parts(rgw::sal::RGWRadosStore *store, RGWBucketInfo& bucket_i
   return 0;
 }
 
+static string part_key(uint32_t num)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "part.%08u", num);
+  return buf;
+}
+
+int read_multipart_parts(rgw::sal::RGWRadosStore *store,
+                         RGWBucketInfo& bucket_info,
+                         CephContext *cct,
+                         const string& upload_id,
+                         const string& meta_oid,
+                         const std::vector<uint32_t>& part_nums,
+                         size_t chunk, size_t max_inflight,
+                         const multipart_parts_cb& cb,
+                         optional_yield y)
+{
+  if (!is_v2_upload_id(upload_id) || part_nums.empty()) {
+    return -ENOTSUP;
+  }
+  chunk = std::max<size_t>(chunk, 1);
+
+  rgw_obj obj;
+  obj.init_ns(bucket_info.bucket, meta_oid, RGW_OBJ_NS_MULTIPART);
+  obj.set_in_extra_data(true);
+
+  rgw_raw_obj raw_obj;
+  store->getRados()->obj_to_raw(bucket_info.placement_rule, obj, &raw_obj);
+
+  auto rados_obj = store->svc()->rados->obj(raw_obj);
+  int r = rados_obj.open();
+  if (r < 0) {
+    return r;
+  }
+
+  struct range_t {
+    size_t first = 0;   // index into part_nums
+    size_t count = 0;
+    map<string, bufferlist> vals;
+    bool more = false;
+    bool done = false;
+  };
+  std::vector<range_t> ranges((part_nums.size() + chunk - 1) / chunk);
+  size_t next_range = 0;  // next range to hand to cb
+
+  // decode a range, checking that it holds exactly the parts we expect
+  auto decode_range = [&](range_t& range,
+                          map<uint32_t, RGWUploadPartInfo>& parts) {
+    if (range.vals.size() != range.count) {
+      return -ENOTSUP;
+    }
+    size_t i = range.first;
+    for (auto& [key, bl] : range.vals) {
+      const uint32_t num = part_nums[i++];
+      if (key != part_key(num)) {
+        return -ENOTSUP;
+      }
+      RGWUploadPartInfo info;
+      try {
+        auto bli = bl.cbegin();
+        decode(info, bli);
+      } catch (buffer::error& err) {
+        ldout(cct, 0) << "ERROR: could not part info, caught buffer::error" <<
+          dendl;
+        return -EIO;
+      }
+      if (info.num != num) {
+        return -ENOTSUP;
+      }
+      parts[num] = std::move(info);
+    }
+    range.vals.clear();
+    return 0;
+  };
+
+  auto handle_completions = [&](rgw::AioResultList&& results) {
+    int r = rgw::check_for_errors(results);
+    if (r < 0) {
+      return r;
+    }
+    for (auto& result : results) {
+      ranges[result.id].done = true;
+    }
+    while (next_range < ranges.size() && ranges[next_range].done) {
+      map<uint32_t, RGWUploadPartInfo> parts;
+      r = decode_range(ranges[next_range], parts);
+      if (r < 0) {
+        return r;
+      }
+      r = cb(parts);
+      if (r < 0) {
+        return r;
+      }
+      ++next_range;
+    }
+    return 0;
+  };
+
+  auto aio = rgw::make_throttle(std::max<size_t>(max_inflight, 1), y);
+
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    auto& range = ranges[i];
+    range.first = i * chunk;
+    range.count = std::min(chunk, part_nums.size() - range.first);
+
+    const string start_after = part_key(i == 0 ? 0 : part_nums[range.first - 1]);
+    // ask the last range for one extra entry, to notice parts that were
+    // uploaded but aren't being completed
+    const bool last = (i + 1 == ranges.size());
+    librados::ObjectReadOperation op;
+    op.omap_get_vals2(start_after, range.count + (last ? 1 : 0),
+                      &range.vals, &range.more, nullptr);
+
+    r = handle_completions(aio->get(rados_obj,
+                                    rgw::Aio::librados_op(std::move(op), y),
+                                    1, i));
+    if (r < 0) {
+      aio->drain();
+      return r;
+    }
+  }
+
+  while (next_range < ranges.size()) {
+    auto completed = aio->wait();
+    if (completed.empty()) {
+      return -EIO;
+    }
+    r = handle_completions(std::move(completed));
+    if (r < 0) {
+      aio->drain();
+      return r;
+    }
+  }
+  return 0;
+}
+
 int list_multipart_parts(rgw::sal::RGWRadosStore *store, struct req_state *s,
 			 const string& upload_id,
 			 const string& meta_oid, int num_parts,
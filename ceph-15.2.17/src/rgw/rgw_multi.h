@@ -4,7 +4,10 @@
 #ifndef CEPH_RGW_MULTI_H
 #define CEPH_RGW_MULTI_H
 
+#include <functional>
 #include <map>
+#include <vector>
+#include "common/async/yield_context.h"
 #include "rgw_xml.h"
 #include "rgw_obj_manifest.h"
 #include "rgw_compression_types.h"
@@ -123,6 +126,30 @@ extern int list_multipart_parts(rgw::sal::RGWRadosStore *store, struct req_state
                                 int *next_marker, bool *truncated,
                                 bool assume_unsorted = false);
 
+/*
+ * Read the part entries of a sorted (v2) multipart upload whose parts are
+ * exactly @part_nums (ascending). The omap is read in ranges of @chunk parts
+ * with up to @max_inflight reads outstanding; each range is passed to @cb, in
+ * part number order, as soon as it and every range before it have arrived,
+ * so the caller works on it while later ranges are still being read.
+ *
+ * Returns -ENOTSUP if the upload isn't sorted or its entries don't match
+ * @part_nums, possibly after some ranges were already handed to @cb; the
+ * caller should then start over with list_multipart_parts(). An error
+ * returned by @cb is passed through.
+ */
+using multipart_parts_cb = std::function<int(map<uint32_t, RGWUploadPartInfo>&)>;
+
+extern int read_multipart_parts(rgw::sal::RGWRadosStore *store,
+                                RGWBucketInfo& bucket_info,
+                                CephContext *cct,
+                                const string& upload_id,
+                                const string& meta_oid,
+                                const std::vector<uint32_t>& part_nums,
+                                size_t chunk, size_t max_inflight,
+                                const multipart_parts_cb& cb,
+                                optional_yield y);
+
 extern int abort_multipart_upload(rgw::sal::RGWRadosStore *store, CephContext *cct, RGWObjectCtx *obj_ctx,
                                 RGWBucketInfo& bucket_info, RGWMPObj& mp_obj);
 
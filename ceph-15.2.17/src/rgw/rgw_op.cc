@@ -6041,7 +6041,6 @@ void RGWCompleteMultipart::execute()
   RGWMultiXMLParser parser;
   string meta_oid;
   map<uint32_t, RGWUploadPartInfo> obj_parts;
-  map<uint32_t, RGWUploadPartInfo>::iterator obj_iter;
   map<string, bufferlist> attrs;
   off_t ofs = 0;
   MD5 hash;
@@ -6149,29 +6148,14 @@ void RGWCompleteMultipart::execute()
     return;
   }
 
-  do {
-    op_ret = list_multipart_parts(store, s, upload_id, meta_oid, max_parts,
-				  marker, obj_parts, &marker, &truncated);
-    if (op_ret == -ENOENT) {
-      op_ret = -ERR_NO_SUCH_UPLOAD;
-    }
-    if (op_ret < 0)
-      return;
-
-    total_parts += obj_parts.size();
-    if (!truncated && total_parts != (int)parts->parts.size()) {
-      ldpp_dout(this, 0) << "NOTICE: total parts mismatch: have: " << total_parts
-		       << " expected: " << parts->parts.size() << dendl;
-      op_ret = -ERR_INVALID_PART;
-      return;
-    }
-
-    for (obj_iter = obj_parts.begin(); iter != parts->parts.end() && obj_iter != obj_parts.end(); ++iter, ++obj_iter, ++handled_parts) {
+  /* validate the parts and append them to the manifest, in part number
+   * order, as they are read */
+  auto apply_parts = [&](map<uint32_t, RGWUploadPartInfo>& obj_parts) {
+    for (auto obj_iter = obj_parts.begin(); iter != parts->parts.end() && obj_iter != obj_parts.end(); ++iter, ++obj_iter, ++handled_parts) {
       uint64_t part_size = obj_iter->second.accounted_size;
       if (handled_parts < (int)parts->parts.size() - 1 &&
           part_size < min_part_size) {
-        op_ret = -ERR_TOO_SMALL;
-        return;
+        return -ERR_TOO_SMALL;
       }
 
       char petag[CEPH_CRYPTO_MD5_DIGESTSIZE];
@@ -6179,15 +6163,13 @@ void RGWCompleteMultipart::execute()
         ldpp_dout(this, 0) << "NOTICE: parts num mismatch: next requested: "
 			 << iter->first << " next uploaded: "
 			 << obj_iter->first << dendl;
-        op_ret = -ERR_INVALID_PART;
-        return;
+        return -ERR_INVALID_PART;
       }
       string part_etag = rgw_string_unquote(iter->second);
       if (part_etag.compare(obj_iter->second.etag) != 0) {
         ldpp_dout(this, 0) << "NOTICE: etag mismatch: part: " << iter->first
 			 << " etag: " << iter->second << dendl;
-        op_ret = -ERR_INVALID_PART;
-        return;
+        return -ERR_INVALID_PART;
       }
 
       hex_to_buf(obj_iter->second.etag.c_str(), petag,
@@ -6204,8 +6186,7 @@ void RGWCompleteMultipart::execute()
       if (obj_part.manifest.empty()) {
         ldpp_dout(this, 0) << "ERROR: empty manifest for object part: obj="
 			 << src_obj << dendl;
-        op_ret = -ERR_INVALID_PART;
-        return;
+        return -ERR_INVALID_PART;
       } else {
         manifest.append(obj_part.manifest, store->svc()->zone);
       }
@@ -6216,8 +6197,7 @@ void RGWCompleteMultipart::execute()
             (cs_info.compression_type != obj_part.cs_info.compression_type))) {
           ldpp_dout(this, 0) << "ERROR: compression type was changed during multipart upload ("
                            << cs_info.compression_type << ">>" << obj_part.cs_info.compression_type << ")" << dendl;
-          op_ret = -ERR_INVALID_PART;
-          return;
+          return -ERR_INVALID_PART;
       }
 
       if (part_compressed) {
@@ -6248,7 +6228,56 @@ void RGWCompleteMultipart::execute()
       ofs += obj_part.size;
       accounted_size += obj_part.accounted_size;
     }
-  } while (truncated);
+    return 0;
+  };
+
+  std::vector<uint32_t> part_nums;
+  part_nums.reserve(parts->parts.size());
+  for (const auto& part : parts->parts) {
+    part_nums.push_back(part.first);
+  }
+  op_ret = read_multipart_parts(store, s->bucket_info, s->cct, upload_id,
+                                meta_oid, part_nums, max_parts,
+                                s->cct->_conf.get_val<uint64_t>("rgw_multipart_complete_max_inflight"),
+                                apply_parts, s->yield);
+  if (op_ret == -ENOTSUP) {
+    /* not a sorted upload, or its entries didn't match the request: list
+     * the parts one page at a time, which sorts out the details */
+    hash.Restart();
+    manifest = RGWObjManifest();
+    cs_info = RGWCompressionInfo();
+    compressed = false;
+    remove_objs.clear();
+    ofs = 0;
+    accounted_size = 0;
+    iter = parts->parts.begin();
+    handled_parts = 0;
+
+    do {
+      op_ret = list_multipart_parts(store, s, upload_id, meta_oid, max_parts,
+                                    marker, obj_parts, &marker, &truncated);
+      if (op_ret == -ENOENT) {
+        op_ret = -ERR_NO_SUCH_UPLOAD;
+      }
+      if (op_ret < 0)
+        return;
+
+      total_parts += obj_parts.size();
+      if (!truncated && total_parts != (int)parts->parts.size()) {
+        ldpp_dout(this, 0) << "NOTICE: total parts mismatch: have: " << total_parts
+                           << " expected: " << parts->parts.size() << dendl;
+        op_ret = -ERR_INVALID_PART;
+        return;
+      }
+
+      op_ret = apply_parts(obj_parts);
+    } while (op_ret == 0 && truncated);
+  } else if (op_ret == -ENOENT) {
+    op_ret = -ERR_NO_SUCH_UPLOAD;
+  }
+  if (op_ret < 0)
+    return;
+
   hash.Final((unsigned char *)final_etag);
 
   buf_to_hex((unsigned char *)final_etag, sizeof(final_etag), final_etag_str);
@@ -28,13 +28,38 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64(l_rgw_qlen, "qlen", "Queue length");
   plb.add_u64(l_rgw_qactive, "qactive", "Active requests queue");
 
+  plb.add_u64_counter(l_rgw_conn_bytes_sent, "conn_bytes_sent",
+                      "Bytes sent on closed frontend connections");
+  plb.add_u64_counter(l_rgw_conn_bytes_received, "conn_bytes_received",
+                      "Bytes received on closed frontend connections");
+  plb.add_u64_avg(l_rgw_conn_tx_rate, "conn_tx_rate",
+                  "Per-connection send throughput (bytes/sec)");
+
   plb.add_u64_counter(l_rgw_cache_hit, "cache_hit", "Cache hits");
   plb.add_u64_counter(l_rgw_cache_miss, "cache_miss", "Cache miss");
+  plb.add_u64_counter(l_rgw_cache_evicted, "cache_evicted",
+		      "Cache entries evicted from the LRU");
+  plb.add_u64_counter(l_rgw_cache_rejected, "cache_rejected",
+		      "Cache puts not admitted by the frequency filter");
+  plb.add_u64_counter(l_rgw_cache_lock_contended, "cache_lock_contended",
+		      "Cache shard lock acquisitions that had to wait");
 
   plb.add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit", "Keystone token cache hits");
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
   plb.add_u64_counter(l_rgw_gc_retire, "gc_retire_object", "GC object retires");
+  plb.add_u64(l_rgw_gc_io_limit, "gc_io_limit",
+	      "Current limit of concurrent GC IO operations");
+  plb.add_time_avg(l_rgw_gc_io_lat, "gc_io_lat", "GC removal latency");
+
+  plb.add_u64_counter(l_rgw_reshard_entries_copied, "reshard_entries_copied",
+		      "Bucket index entries copied by resharding");
+  plb.add_u64_counter(l_rgw_reshard_log_replayed, "reshard_log_replayed",
+		      "Objects copied again after changing during online resharding");
+  plb.add_time_avg(l_rgw_reshard_block_lat, "reshard_block_lat",
+		   "Time bucket index writes were blocked by resharding");
+  plb.add_time_avg(l_rgw_reshard_write_lat, "reshard_write_lat",
+		   "Bucket index prepare latency while the bucket is resharded");
 
   plb.add_u64_counter(l_rgw_lc_expire_current, "lc_expire_current",
 		      "Lifecycle current expiration");
@@ -49,6 +74,16 @@ int rgw_perf_start(CephContext *cct)
 		      "Lifecycle non-current transition");
   plb.add_u64_counter(l_rgw_lc_abort_mpu, "lc_abort_mpu",
 		      "Lifecycle abort multipart upload");
+  plb.add_u64_counter(l_rgw_lc_objects_processed, "lc_objects_processed",
+		      "Objects evaluated against lifecycle rules");
+  plb.add_u64_counter(l_rgw_lc_checkpoint, "lc_checkpoint",
+		      "Lifecycle progress checkpoints of bucket index shards");
+  plb.add_u64(l_rgw_lc_shard_active, "lc_shard_active",
+	      "Bucket index shards being processed by lifecycle");
+  plb.add_u64_counter(l_rgw_lc_shard_done, "lc_shard_done",
+		      "Bucket index shards finished by lifecycle");
+  plb.add_time_avg(l_rgw_lc_shard_lat, "lc_shard_lat",
+		   "Time to process a bucket index shard by lifecycle");
 
   plb.add_u64_counter(l_rgw_pubsub_event_triggered, "pubsub_event_triggered", "Pubsub events with at least one topic");
   plb.add_u64_counter(l_rgw_pubsub_event_lost, "pubsub_event_lost", "Pubsub events lost");
@@ -25,13 +25,27 @@ enum {
   l_rgw_qlen,
   l_rgw_qactive,
 
+  l_rgw_conn_bytes_sent,
+  l_rgw_conn_bytes_received,
+  l_rgw_conn_tx_rate,
+
   l_rgw_cache_hit,
   l_rgw_cache_miss,
+  l_rgw_cache_evicted,
+  l_rgw_cache_rejected,
+  l_rgw_cache_lock_contended,
 
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
 
   l_rgw_gc_retire,
+  l_rgw_gc_io_limit,
+  l_rgw_gc_io_lat,
+
+  l_rgw_reshard_entries_copied,
+  l_rgw_reshard_log_replayed,
+  l_rgw_reshard_block_lat,
+  l_rgw_reshard_write_lat,
 
   l_rgw_lc_expire_current,
   l_rgw_lc_expire_noncurrent,
@@ -39,6 +53,11 @@ enum {
   l_rgw_lc_transition_current,
   l_rgw_lc_transition_noncurrent,
   l_rgw_lc_abort_mpu,
+  l_rgw_lc_objects_processed,
+  l_rgw_lc_checkpoint,
+  l_rgw_lc_shard_active,
+  l_rgw_lc_shard_done,
+  l_rgw_lc_shard_lat,
 
   l_rgw_pubsub_event_triggered,
   l_rgw_pubsub_event_lost,
@@ -28,10 +28,12 @@
 #include "rgw_acl_s3.h" /* for dumping s3policy in debug log */
 #include "rgw_aio_throttle.h"
 #include "rgw_bucket.h"
+#include "rgw_bucket_list_merge.h"
 #include "rgw_rest_conn.h"
 #include "rgw_cr_rados.h"
 #include "rgw_cr_rest.h"
 #include "rgw_putobj_processor.h"
+#include "rgw_perf_counters.h"
 
 #include "cls/rgw/cls_rgw_ops.h"
 #include "cls/rgw/cls_rgw_client.h"
@@ -6046,10 +6048,18 @@ int RGWRados::Bucket::UpdateIndex::prepare(RGWModifyOp op, const string *write_t
     }
   }
 
+  const bool resharding =
+    target->bucket_info.reshard_status != cls_rgw_reshard_status::NOT_RESHARDING;
+  const auto start = ceph::mono_clock::now();
+
   int r = guard_reshard(nullptr, [&](BucketShard *bs) -> int {
 				   return store->cls_obj_prepare_op(*bs, op, optag, obj, bilog_flags, y, zones_trace);
 				 });
 
+  if (resharding && perfcounter) {
+    perfcounter->tinc(l_rgw_reshard_write_lat, ceph::mono_clock::now() - start);
+  }
+
   if (r < 0) {
     return r;
   }
@@ -8088,6 +8098,20 @@ int RGWRados::bi_list(BucketShard& bs, const string& obj_name_filter, const stri
   return 0;
 }
 
+int RGWRados::bi_compact(BucketShard& bs, bool compact, const string& marker, uint32_t max,
+			 rgw_cls_bi_compact_ret *result)
+{
+  auto& ref = bs.bucket_obj.get_ref();
+  return cls_rgw_bi_compact(ref.pool.ioctx(), ref.obj.oid, compact, marker, max, result);
+}
+
+int RGWRados::bi_index_stats(BucketShard& bs, const string& marker, uint32_t max,
+			     rgw_cls_bi_index_stats_ret *result)
+{
+  auto& ref = bs.bucket_obj.get_ref();
+  return cls_rgw_bi_index_stats(ref.pool.ioctx(), ref.obj.oid, marker, max, result);
+}
+
 int RGWRados::bi_list(rgw_bucket& bucket, int shard_id, const string& filter_obj, const string& marker, uint32_t max, list<rgw_cls_bi_entry> *entries, bool *is_truncated)
 {
   BucketShard bs(this);
@@ -8260,30 +8284,7 @@ int RGWRados::cls_obj_set_bucket_tag_timeout(RGWBucketInfo& bucket_info, uint64_
 uint32_t RGWRados::calc_ordered_bucket_list_per_shard(uint32_t num_entries,
 						      uint32_t num_shards)
 {
-  // We want to minimize the chances that when num_shards >>
-  // num_entries that we return much fewer than num_entries to the
-  // client. Given all the overhead of making a cls call to the osd,
-  // returning a few entries is not much more work than returning one
-  // entry. This minimum might be better tuned based on future
-  // experiments where num_shards >> num_entries. (Note: ">>" should
-  // be interpreted as "much greater than".)
-  constexpr uint32_t min_read = 8;
-
-  // The following is based on _"Balls into Bins" -- A Simple and
-  // Tight Analysis_ by Raab and Steger. We add 1 as a way to handle
-  // cases when num_shards >> num_entries (it almost serves as a
-  // ceiling calculation). We also assume alpha is 1.0 and extract it
-  // from the calculation. Future work could involve memoizing some of
-  // the transcendental functions to minimize repeatedly re-calling
-  // them with the same parameters, which we expect to be the case the
-  // majority of the time.
-  uint32_t calc_read =
-    1 +
-    static_cast<uint32_t>((num_entries / num_shards) +
-			  sqrt((2 * num_entries) *
-			       log(num_shards) / num_shards));
-
-  return std::max(min_read, calc_read);
+  return RGWBucketListMerger::calc_first_batch(num_entries, num_shards);
 }
 
 
@@ -8329,135 +8330,51 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
     return r;
   }
 
-  const uint32_t shard_count = shard_oids.size();
-  uint32_t num_entries_per_shard;
-  if (expansion_factor == 0) {
-    num_entries_per_shard =
-      calc_ordered_bucket_list_per_shard(num_entries, shard_count);
-  } else if (expansion_factor <= 11) {
-    // we'll max out the exponential multiplication factor at 1024 (2<<10)
-    num_entries_per_shard =
-      std::min(num_entries,
-	       (uint32_t(1 << (expansion_factor - 1)) *
-		calc_ordered_bucket_list_per_shard(num_entries, shard_count)));
-  } else {
-    num_entries_per_shard = num_entries;
-  }
-
-  ldout(cct, 10) << "RGWRados::" << __func__ <<
-    " request from each of " << shard_count <<
-    " shard(s) for " << num_entries_per_shard << " entries to get " <<
-    num_entries << " total entries" << dendl;
-
   auto& ioctx = index_pool.ioctx();
-  map<int, rgw_cls_list_ret> shard_list_results;
+  // list each shard after its own marker, all in parallel
+  auto fetch = [&](const std::map<int, cls_rgw_obj_key>& markers,
+		   uint32_t max_entries,
+		   std::map<int, rgw_cls_list_ret>& results) -> int {
+    std::map<int, std::string> oids;
+    for (auto& [shard, marker] : markers) {
+      oids.emplace(shard, shard_oids[shard]);
+      // CLSRGWIssueBucketList continues a shard from the marker of its
+      // existing result rather than from start_obj
+      results[shard].marker = marker;
+    }
+    ldout(cct, 20) << "RGWRados::" << __func__ << ": listing " <<
+      oids.size() << " shard(s) for " << max_entries << " entries" << dendl;
+    return CLSRGWIssueBucketList(ioctx, cls_rgw_obj_key(), prefix, delimiter,
+				 max_entries, list_versions, oids, results,
+				 cct->_conf->rgw_bucket_index_max_aio)();
+  };
+
+  RGWBucketListMerger merger(fetch, num_entries);
+  std::vector<int> shard_ids;
+  shard_ids.reserve(shard_oids.size());
+  for (auto& s : shard_oids) {
+    shard_ids.push_back(s.first);
+  }
   cls_rgw_obj_key start_after_key(start_after.name, start_after.instance);
-  r = CLSRGWIssueBucketList(ioctx, start_after_key, prefix, delimiter,
-			    num_entries_per_shard,
-			    list_versions, shard_oids, shard_list_results,
-			    cct->_conf->rgw_bucket_index_max_aio)();
+  // the merger sizes the first page of each shard from num_entries and
+  // the number of shards
+  r = merger.init(shard_ids, start_after_key, expansion_factor);
   if (r < 0) {
     return r;
   }
 
-  // to manage the iterators through each shard's list results
-  struct ShardTracker {
-    const size_t shard_idx;
-    rgw_cls_list_ret& result;
-    const std::string& oid_name;
-    RGWRados::ent_map_t::iterator cursor;
-    RGWRados::ent_map_t::iterator end;
-
-    // manages an iterator through a shard and provides other
-    // accessors
-    ShardTracker(size_t _shard_idx,
-		 rgw_cls_list_ret& _result,
-		 const std::string& _oid_name):
-      shard_idx(_shard_idx),
-      result(_result),
-      oid_name(_oid_name),
-      cursor(_result.dir.m.begin()),
-      end(_result.dir.m.end())
-    {}
-
-    inline const std::string& entry_name() const {
-      return cursor->first;
-    }
-    rgw_bucket_dir_entry& dir_entry() const {
-      return cursor->second;
-    }
-    inline bool is_truncated() const {
-      return result.is_truncated;
-    }
-    inline ShardTracker& advance() {
-      ++cursor;
-      // return a self-reference to allow for chaining of calls, such
-      // as x.advance().at_end()
-      return *this;
-    }
-    inline bool at_end() const {
-      return cursor == end;
-    }
-  }; // ShardTracker
-
-  // add the next unique candidate, or return false if we reach the end
-  auto next_candidate = [] (ShardTracker& t,
-                            std::map<std::string, size_t>& candidates,
-                            size_t tracker_idx) {
-    while (!t.at_end()) {
-      if (candidates.emplace(t.entry_name(), tracker_idx).second) {
-        return;
-      }
-      t.advance(); // skip duplicate common prefixes
-    }
-  };
-
-  // one tracker per shard requested (may not be all shards)
-  std::vector<ShardTracker> results_trackers;
-  results_trackers.reserve(shard_list_results.size());
-  for (auto& r : shard_list_results) {
-    results_trackers.emplace_back(r.first, r.second, shard_oids[r.first]);
-
-    // if any *one* shard's result is trucated, the entire result is
-    // truncated
-    *is_truncated = *is_truncated || r.second.is_truncated;
-
-    // unless *all* are shards are cls_filtered, the entire result is
-    // not filtered
-    *cls_filtered = *cls_filtered && r.second.cls_filtered;
-  }
-
-  // create a map to track the next candidate entry from ShardTracker
-  // (key=candidate, value=index into results_trackers); as we consume
-  // entries from shards, we replace them with the next entries in the
-  // shards until we run out
-  std::map<std::string, size_t> candidates;
-  size_t tracker_idx = 0;
-  for (auto& t : results_trackers) {
-    // it's important that the values in the map refer to the index
-    // into the results_trackers vector, which may not be the same
-    // as the shard number (i.e., when not all shards are requested)
-    next_candidate(t, candidates, tracker_idx);
-    ++tracker_idx;
-  }
-
-  rgw_bucket_dir_entry*
-    last_entry_visited = nullptr; // to set last_entry (marker)
+  // to set last_entry (marker)
+  std::optional<rgw_obj_index_key> last_entry_visited;
   map<string, bufferlist> updates;
   uint32_t count = 0;
-  while (count < num_entries && !candidates.empty()) {
-    r = 0;
-    // select the next entry in lexical order (first key in map);
-    // again tracker_idx is not necessarily shard number, but is index
-    // into results_trackers vector
-    tracker_idx = candidates.begin()->second;
-    auto& tracker = results_trackers.at(tracker_idx);
-
-    const string& name = tracker.entry_name();
-    rgw_bucket_dir_entry& dirent = tracker.dir_entry();
+  RGWBucketListMerger::entry_ref_t next;
+  while (count < num_entries && (r = merger.peek(&next)) == 0) {
+    // select the next entry in lexical order across all shards
+    const string& name = *next.name;
+    rgw_bucket_dir_entry& dirent = *next.entry;
 
     ldout(cct, 20) << "RGWRados::" << __func__ << " currently processing " <<
-      dirent.key << " from shard " << tracker.shard_idx << dendl;
+      dirent.key << " from shard " << next.shard << dendl;
 
     const bool force_check =
       force_check_filter && force_check_filter(dirent.key.name);
@@ -8473,7 +8390,7 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
       librados::IoCtx sub_ctx;
       sub_ctx.dup(ioctx);
       r = check_disk_state(sub_ctx, bucket_info, dirent, dirent,
-			   updates[tracker.oid_name], y);
+			   updates[shard_oids[next.shard]], y);
       if (r < 0 && r != -ENOENT) {
 	return r;
       }
@@ -8481,32 +8398,26 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
       r = 0;
     }
 
+    last_entry_visited = dirent.key;
     if (r >= 0) {
       ldout(cct, 10) << "RGWRados::" << __func__ << ": got " <<
 	dirent.key.name << "[" << dirent.key.instance << "]" << dendl;
       m[name] = std::move(dirent);
-      last_entry_visited = &(m[name]);
       ++count;
     } else {
       ldout(cct, 10) << "RGWRados::" << __func__ << ": skipping " <<
 	dirent.key.name << "[" << dirent.key.instance << "]" << dendl;
-      last_entry_visited = &tracker.dir_entry();
     }
 
-    // refresh the candidates map
-    candidates.erase(candidates.begin());
-    tracker.advance();
-
-    next_candidate(tracker, candidates, tracker_idx);
-
-    if (tracker.at_end() && tracker.is_truncated()) {
-      // once we exhaust one shard that is truncated, we need to stop,
-      // as we cannot be certain that one of the next entries needs to
-      // come from that shard; S3 and swift protocols allow returning
-      // fewer than what was requested
-      break;
-    }
+    merger.pop();
   } // while we haven't provided requested # of result entries
+  if (r < 0 && r != -ENOENT) {
+    return r;
+  }
+
+  // unless *all* are shards are cls_filtered, the entire result is
+  // not filtered
+  *cls_filtered = *cls_filtered && merger.is_cls_filtered();
 
   // suggest updates if there are any
   for (auto& miter : updates) {
@@ -8523,17 +8434,12 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
 
   // determine truncation by checking if all the returned entries are
   // consumed or not
-  *is_truncated = false;
-  for (const auto& t : results_trackers) {
-    if (!t.at_end() || t.is_truncated()) {
-      *is_truncated = true;
-      break;
-    }
-  }
+  *is_truncated = merger.is_truncated();
 
   ldout(cct, 20) << "RGWRados::" << __func__ <<
     ": returning, count=" << count << ", is_truncated=" << *is_truncated <<
-    dendl;
+    ", index requests=" << merger.get_num_fetches() <<
+    ", entries read=" << merger.get_num_fetched() << dendl;
 
   if (*is_truncated && count < num_entries) {
     ldout(cct, 10) << "RGWRados::" << __func__ <<
@@ -8541,8 +8447,8 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
       count << ", which is truncated" << dendl;
   }
 
-  if (last_entry_visited != nullptr && last_entry) {
-    *last_entry = last_entry_visited->key;
+  if (last_entry_visited && last_entry) {
+    *last_entry = *last_entry_visited;
     ldout(cct, 20) << "RGWRados::" << __func__ <<
       ": returning, last_entry=" << *last_entry << dendl;
   } else {
@@ -47,6 +47,8 @@ struct RGWZoneGroup;
 struct RGWZoneParams;
 class RGWReshard;
 class RGWReshardWait;
+struct rgw_cls_bi_compact_ret;
+struct rgw_cls_bi_index_stats_ret;
 
 class RGWSysObjectCtx;
 
@@ -1420,6 +1422,8 @@ public:
   int bi_put(rgw_bucket& bucket, rgw_obj& obj, rgw_cls_bi_entry& entry);
   int bi_list(rgw_bucket& bucket, int shard_id, const string& filter_obj, const string& marker, uint32_t max, list<rgw_cls_bi_entry> *entries, bool *is_truncated);
   int bi_list(BucketShard& bs, const string& filter_obj, const string& marker, uint32_t max, list<rgw_cls_bi_entry> *entries, bool *is_truncated);
+  int bi_compact(BucketShard& bs, bool compact, const string& marker, uint32_t max, rgw_cls_bi_compact_ret *result);
+  int bi_index_stats(BucketShard& bs, const string& marker, uint32_t max, rgw_cls_bi_index_stats_ret *result);
   int bi_list(rgw_bucket& bucket, const string& obj_name, const string& marker, uint32_t max,
               list<rgw_cls_bi_entry> *entries, bool *is_truncated);
   int bi_remove(BucketShard& bs);
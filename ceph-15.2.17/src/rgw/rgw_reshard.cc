@@ -9,6 +9,7 @@
 #include "rgw_bucket.h"
 #include "rgw_reshard.h"
 #include "rgw_sal.h"
+#include "rgw_perf_counters.h"
 #include "cls/rgw/cls_rgw_client.h"
 #include "cls/lock/cls_lock_client.h"
 #include "common/errno.h"
@@ -419,8 +420,8 @@ public:
     }
   }
 
-  int start() {
-    int ret = set_status(cls_rgw_reshard_status::IN_PROGRESS);
+  int start(cls_rgw_reshard_status status) {
+    int ret = set_status(status);
     if (ret < 0) {
       return ret;
     }
@@ -526,9 +527,253 @@ int RGWBucketReshardLock::renew(const Clock::time_point& now) {
 }
 
 
+// returns the shard of the new bucket index that holds the entries of key
+static int get_target_shard(rgw::sal::RGWRadosStore *store,
+			    const RGWBucketInfo& new_bucket_info,
+			    const cls_rgw_obj_key& cls_key,
+			    int *shard_index)
+{
+  rgw_obj_key key(cls_key);
+  rgw_obj obj(new_bucket_info.bucket, key);
+  RGWMPObj mp;
+  if (key.ns == RGW_OBJ_NS_MULTIPART && mp.from_meta(key.name)) {
+    // place the multipart .meta object on the same shard as its head object
+    obj.index_hash_source = mp.get_key();
+  }
+  int target_shard_id;
+  int ret = store->getRados()->get_target_shard_id(new_bucket_info, obj.get_hash_object(), &target_shard_id);
+  if (ret < 0) {
+    lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
+    return ret;
+  }
+
+  *shard_index = (target_shard_id > 0 ? target_shard_id : 0);
+  return 0;
+}
+
+// lists all index entries (plain, instance and olh) of one object
+static int list_object_entries(librados::IoCtx& ioctx, const string& oid,
+			       const string& name,
+			       list<rgw_cls_bi_entry> *entries)
+{
+  string marker;
+  bool is_truncated = true;
+  while (is_truncated) {
+    list<rgw_cls_bi_entry> l;
+    int ret = cls_rgw_bi_list(ioctx, oid, name, marker, 1000, &l, &is_truncated);
+    if (ret == -ENOENT) {
+      return 0;
+    }
+    if (ret < 0) {
+      return ret;
+    }
+    if (l.empty()) {
+      break;
+    }
+    marker = l.back().idx;
+    entries->splice(entries->end(), l);
+  }
+  return 0;
+}
+
+static void account_entry(rgw_cls_bi_entry& entry, bool add,
+			  map<RGWObjCategory, rgw_bucket_category_stats>& stats)
+{
+  cls_rgw_obj_key key;
+  RGWObjCategory category;
+  rgw_bucket_category_stats entry_stats;
+  if (!entry.get_info(&key, &category, &entry_stats)) {
+    return;
+  }
+  // the stats are unsigned: a removal wraps around here and is undone
+  // when the OSD adds the delta to the shard header
+  rgw_bucket_category_stats& target = stats[category];
+  if (add) {
+    target.num_entries += entry_stats.num_entries;
+    target.total_size += entry_stats.total_size;
+    target.total_size_rounded += entry_stats.total_size_rounded;
+    target.actual_size += entry_stats.actual_size;
+  } else {
+    target.num_entries -= entry_stats.num_entries;
+    target.total_size -= entry_stats.total_size;
+    target.total_size_rounded -= entry_stats.total_size_rounded;
+    target.actual_size -= entry_stats.actual_size;
+  }
+}
+
+namespace rgw::reshard {
+
+int resync_object_entries(CephContext *cct,
+			  librados::IoCtx& src_ioctx, const string& src_oid,
+			  librados::IoCtx& dst_ioctx, const string& dst_oid,
+			  const string& name)
+{
+  list<rgw_cls_bi_entry> src_entries;
+  int ret = list_object_entries(src_ioctx, src_oid, name, &src_entries);
+  if (ret < 0) {
+    lderr(cct) << "ERROR: failed to list index entries of " << name <<
+      " in " << src_oid << ": " << cpp_strerror(-ret) << dendl;
+    return ret;
+  }
+
+  list<rgw_cls_bi_entry> dst_entries;
+  ret = list_object_entries(dst_ioctx, dst_oid, name, &dst_entries);
+  if (ret < 0) {
+    lderr(cct) << "ERROR: failed to list index entries of " << name <<
+      " in " << dst_oid << ": " << cpp_strerror(-ret) << dendl;
+    return ret;
+  }
+
+  map<RGWObjCategory, rgw_bucket_category_stats> stats;
+  librados::ObjectWriteOperation op;
+  if (!dst_entries.empty()) {
+    std::set<string> stale;
+    for (auto& entry : dst_entries) {
+      stale.insert(entry.idx);
+      account_entry(entry, false, stats);
+    }
+    op.omap_rm_keys(stale);
+  }
+  for (auto& entry : src_entries) {
+    cls_rgw_bi_put(op, dst_oid, entry);
+    account_entry(entry, true, stats);
+  }
+  cls_rgw_bucket_update_stats(op, false, stats);
+
+  ret = dst_ioctx.operate(dst_oid, &op);
+  if (ret < 0) {
+    lderr(cct) << "ERROR: failed to update index entries of " << name <<
+      " in " << dst_oid << ": " << cpp_strerror(-ret) << dendl;
+    return ret;
+  }
+  return 0;
+}
+
+int sync_reshard_log(CephContext *cct, librados::IoCtx& ioctx,
+		     const string& oid, std::map<string, uint64_t>& synced,
+		     const std::function<int(const string&)>& resync,
+		     uint64_t *count)
+{
+  string marker;
+  bool is_truncated = true;
+  while (is_truncated) {
+    map<string, uint64_t> entries;
+    int ret = cls_rgw_bucket_reshard_log_list(ioctx, oid, marker, 1000,
+					      &entries, &is_truncated);
+    if (ret < 0) {
+      lderr(cct) << "ERROR: failed to list reshard log of " << oid <<
+	": " << cpp_strerror(-ret) << dendl;
+      return ret;
+    }
+    if (entries.empty()) {
+      break;
+    }
+    marker = entries.rbegin()->first;
+
+    for (auto& [name, ver] : entries) {
+      auto iter = synced.find(name);
+      if (iter != synced.end() && iter->second == ver) {
+	continue;
+      }
+      ret = resync(name);
+      if (ret < 0) {
+	return ret;
+      }
+      synced[name] = ver;
+      ++(*count);
+    }
+  }
+  return 0;
+}
+
+} // namespace rgw::reshard
+
+int RGWBucketReshard::renew_locks()
+{
+  Clock::time_point now = Clock::now();
+  if (!reshard_lock.should_renew(now)) {
+    return 0;
+  }
+
+  // assume outer locks have timespans at least the size of ours, so
+  // can call inside conditional
+  if (outer_reshard_lock) {
+    int ret = outer_reshard_lock->renew(now);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  int ret = reshard_lock.renew(now);
+  if (ret < 0) {
+    lderr(store->ctx()) << "Error renewing bucket lock: " << ret << dendl;
+    return ret;
+  }
+  return 0;
+}
+
+/*
+ * Copies every object recorded in the reshard log of the old index
+ * shards to the new index again, unless it was already copied at the
+ * logged version.
+ */
+int RGWBucketReshard::sync_reshard_log(const RGWBucketInfo& new_bucket_info,
+				       reshard_log_versions& synced,
+				       uint64_t *count)
+{
+  const int num_source_shards =
+    (bucket_info.num_shards > 0 ? bucket_info.num_shards : 1);
+  synced.resize(num_source_shards);
+
+  for (int i = 0; i < num_source_shards; ++i) {
+    RGWRados::BucketShard bs(store->getRados());
+    int ret = bs.init(bucket_info.bucket, i, nullptr /* no RGWBucketInfo */);
+    if (ret < 0) {
+      return ret;
+    }
+    auto& src = bs.bucket_obj.get_ref();
+
+    auto resync = [&] (const string& name) {
+      int target_shard;
+      int r = get_target_shard(store, new_bucket_info, cls_rgw_obj_key(name),
+			       &target_shard);
+      if (r < 0) {
+	return r;
+      }
+      RGWRados::BucketShard dst_bs(store->getRados());
+      r = dst_bs.init(new_bucket_info.bucket,
+		      (new_bucket_info.num_shards > 0 ? target_shard : -1),
+		      nullptr /* no RGWBucketInfo */);
+      if (r < 0) {
+	return r;
+      }
+      auto& dst = dst_bs.bucket_obj.get_ref();
+      r = rgw::reshard::resync_object_entries(store->ctx(),
+					       src.pool.ioctx(), src.obj.oid,
+					       dst.pool.ioctx(), dst.obj.oid,
+					       name);
+      if (r < 0) {
+	return r;
+      }
+      if (perfcounter) {
+	perfcounter->inc(l_rgw_reshard_log_replayed);
+      }
+      return renew_locks();
+    };
+
+    ret = rgw::reshard::sync_reshard_log(store->ctx(), src.pool.ioctx(),
+					 src.obj.oid, synced[i], resync, count);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
+  return 0;
+}
+
 int RGWBucketReshard::do_reshard(int num_shards,
 				 RGWBucketInfo& new_bucket_info,
 				 int max_entries,
+				 bool online,
 				 bool verbose,
 				 ostream *out,
 				 Formatter *formatter)
@@ -537,6 +782,9 @@ int RGWBucketReshard::do_reshard(int num_shards,
 
   int ret = 0;
 
+  // unless resharding online, index writes are blocked from here on
+  ceph::mono_time block_start = ceph::mono_clock::now();
+
   if (out) {
     (*out) << "tenant: " << bucket_info.bucket.tenant << std::endl;
     (*out) << "bucket name: " << bucket_info.bucket.name << std::endl;
@@ -559,7 +807,10 @@ int RGWBucketReshard::do_reshard(int num_shards,
   // complete successfully
   BucketInfoReshardUpdate bucket_info_updater(store, bucket_info, bucket_attrs, new_bucket_info.bucket.bucket_id);
 
-  ret = bucket_info_updater.start();
+  // an online reshard shows as in-logrecord until it completes, also while
+  // it blocks writes for its final pass
+  ret = bucket_info_updater.start(online ? cls_rgw_reshard_status::IN_LOGRECORD :
+				  cls_rgw_reshard_status::IN_PROGRESS);
   if (ret < 0) {
     ldout(store->ctx(), 0) << __func__ << ": failed to update bucket info ret=" << ret << dendl;
     return ret;
@@ -609,47 +860,26 @@ int RGWBucketReshard::do_reshard(int num_shards,
 
 	marker = entry.idx;
 
-	int target_shard_id;
 	cls_rgw_obj_key cls_key;
 	RGWObjCategory category;
 	rgw_bucket_category_stats stats;
 	bool account = entry.get_info(&cls_key, &category, &stats);
-	rgw_obj_key key(cls_key);
-	rgw_obj obj(new_bucket_info.bucket, key);
-	RGWMPObj mp;
-	if (key.ns == RGW_OBJ_NS_MULTIPART && mp.from_meta(key.name)) {
-	  // place the multipart .meta object on the same shard as its head object
-	  obj.index_hash_source = mp.get_key();
-	}
-	int ret = store->getRados()->get_target_shard_id(new_bucket_info, obj.get_hash_object(), &target_shard_id);
+
+	int shard_index;
+	int ret = get_target_shard(store, new_bucket_info, cls_key, &shard_index);
 	if (ret < 0) {
-	  lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
 	  return ret;
 	}
 
-	int shard_index = (target_shard_id > 0 ? target_shard_id : 0);
-
 	ret = target_shards_mgr.add_entry(shard_index, entry, account,
 					  category, stats);
 	if (ret < 0) {
 	  return ret;
 	}
 
-	Clock::time_point now = Clock::now();
-	if (reshard_lock.should_renew(now)) {
-	  // assume outer locks have timespans at least the size of ours, so
-	  // can call inside conditional
-	  if (outer_reshard_lock) {
-	    ret = outer_reshard_lock->renew(now);
-	    if (ret < 0) {
-	      return ret;
-	    }
-	  }
-	  ret = reshard_lock.renew(now);
-	  if (ret < 0) {
-	    lderr(store->ctx()) << "Error renewing bucket lock: " << ret << dendl;
-	    return ret;
-	  }
+	ret = renew_locks();
+	if (ret < 0) {
+	  return ret;
 	}
 	if (verbose_json_out) {
 	  formatter->close_section();
@@ -658,7 +888,15 @@ int RGWBucketReshard::do_reshard(int num_shards,
 	  (*out) << " " << total_entries;
 	}
       } // entries loop
+
+      if (perfcounter) {
+	perfcounter->inc(l_rgw_reshard_entries_copied, entries.size());
+      }
     }
+
+    ldout(store->ctx(), 5) << __func__ << ": bucket " << bucket.name <<
+      ": copied old shard " << (i + 1) << "/" << num_source_shards <<
+      ", " << total_entries << " entries so far" << dendl;
   }
 
   if (verbose_json_out) {
@@ -674,6 +912,34 @@ int RGWBucketReshard::do_reshard(int num_shards,
     return -EIO;
   }
 
+  if (online) {
+    // writes went on during the copy; copy the objects they changed
+    // again, then block writes and copy the few that changed meanwhile
+    reshard_log_versions synced;
+    uint64_t count = 0;
+    ret = sync_reshard_log(new_bucket_info, synced, &count);
+    if (ret < 0) {
+      return ret;
+    }
+    ldout(store->ctx(), 5) << __func__ << ": bucket " << bucket.name <<
+      ": copied " << count << " objects changed during resharding" << dendl;
+
+    block_start = ceph::mono_clock::now();
+    ret = set_resharding_status(new_bucket_info.bucket.bucket_id, num_shards,
+				cls_rgw_reshard_status::IN_PROGRESS);
+    if (ret < 0) {
+      return ret;
+    }
+
+    count = 0;
+    ret = sync_reshard_log(new_bucket_info, synced, &count);
+    if (ret < 0) {
+      return ret;
+    }
+    ldout(store->ctx(), 5) << __func__ << ": bucket " << bucket.name <<
+      ": copied " << count << " objects with writes blocked" << dendl;
+  }
+
   ret = store->ctl()->bucket->link_bucket(new_bucket_info.owner, new_bucket_info.bucket, bucket_info.creation_time, null_yield);
   if (ret < 0) {
     lderr(store->ctx()) << "failed to link new bucket instance (bucket_id=" << new_bucket_info.bucket.bucket_id << ": " << cpp_strerror(-ret) << ")" << dendl;
@@ -686,6 +952,11 @@ int RGWBucketReshard::do_reshard(int num_shards,
     /* don't error out, reshard process succeeded */
   }
 
+  if (perfcounter) {
+    perfcounter->tinc(l_rgw_reshard_block_lat,
+		      ceph::mono_clock::now() - block_start);
+  }
+
   return 0;
   // NB: some error clean-up is done by ~BucketInfoReshardUpdate
 } // RGWBucketReshard::do_reshard
@@ -700,6 +971,8 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
                               bool verbose, ostream *out, Formatter *formatter,
 			      RGWReshard* reshard_log)
 {
+  const bool online = store->ctx()->_conf.get_val<bool>("rgw_reshard_online");
+
   int ret = reshard_lock.lock();
   if (ret < 0) {
     return ret;
@@ -720,9 +993,11 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
   }
 
   // set resharding status of current bucket_info & shards with
-  // information about planned resharding
-  ret = set_resharding_status(new_bucket_info.bucket.bucket_id,
-			      num_shards, cls_rgw_reshard_status::IN_PROGRESS);
+  // information about planned resharding; an online reshard records
+  // the writes it lets through instead of blocking them
+  ret = set_resharding_status(new_bucket_info.bucket.bucket_id, num_shards,
+			      (online ? cls_rgw_reshard_status::IN_LOGRECORD :
+			       cls_rgw_reshard_status::IN_PROGRESS));
   if (ret < 0) {
     goto error_out;
   }
@@ -730,6 +1005,7 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
   ret = do_reshard(num_shards,
 		   new_bucket_info,
 		   max_op_entries,
+		   online,
                    verbose, out, formatter);
   if (ret < 0) {
     goto error_out;
@@ -84,11 +84,20 @@ private:
   // allocated in at once
   static const std::initializer_list<uint16_t> reshard_primes;
 
+  // per source shard, the objects copied again after an online
+  // reshard recorded a change, and the version of that change
+  using reshard_log_versions = std::vector<std::map<std::string, uint64_t>>;
+
   int create_new_bucket_instance(int new_num_shards,
 				 RGWBucketInfo& new_bucket_info);
+  int renew_locks();
+  int sync_reshard_log(const RGWBucketInfo& new_bucket_info,
+		       reshard_log_versions& synced,
+		       uint64_t *count);
   int do_reshard(int num_shards,
 		 RGWBucketInfo& new_bucket_info,
 		 int max_entries,
+		 bool online,
                  bool verbose,
                  ostream *os,
 		 Formatter *formatter);
@@ -278,4 +287,24 @@ public:
   void stop();
 };
 
+namespace rgw::reshard {
+
+/* Replace the index entries (plain, instance and olh) of object 'name'
+ * in bucket index object dst_oid with the ones currently in src_oid,
+ * adjusting the stats of dst_oid to match. */
+int resync_object_entries(CephContext *cct,
+			  librados::IoCtx& src_ioctx, const std::string& src_oid,
+			  librados::IoCtx& dst_ioctx, const std::string& dst_oid,
+			  const std::string& name);
+/* Call resync() for each object in the reshard log of bucket index object
+ * oid, unless synced has it at the logged version already; synced and
+ * *count are updated for each object resynced. */
+int sync_reshard_log(CephContext *cct, librados::IoCtx& ioctx,
+		     const std::string& oid,
+		     std::map<std::string, uint64_t>& synced,
+		     const std::function<int(const std::string&)>& resync,
+		     uint64_t *count);
+
+} // namespace rgw::reshard
+
 #endif
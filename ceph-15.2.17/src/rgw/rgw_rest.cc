@@ -765,7 +765,13 @@ int dump_body(struct req_state* const s,
 
 int dump_body(struct req_state* const s, /* const */ ceph::buffer::list& bl)
 {
-  return dump_body(s, bl.c_str(), bl.length());
+  /* Pass the segments down as they are; bl.c_str() would copy a fragmented
+   * list into a single contiguous buffer. */
+  try {
+    return RESTFUL_IO(s)->send_body_buffers(bl);
+  } catch (rgw::io::Exception& e) {
+    return -e.code().value();
+  }
 }
 
 int dump_body(struct req_state* const s, const std::string& str)
@@ -449,7 +449,10 @@ done:
 
 send_data:
   if (get_data && !op_ret) {
-    int r = dump_body(s, bl.c_str() + bl_ofs, bl_len);
+    /* Reference the requested range instead of flattening the whole list. */
+    bufferlist data;
+    data.substr_of(bl, bl_ofs, bl_len);
+    int r = dump_body(s, data);
     if (r < 0)
       return r;
   }
@@ -0,0 +1,94 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#ifndef CEPH_RGW_SYNC_WINDOW_H
+#define CEPH_RGW_SYNC_WINDOW_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include "common/ceph_time.h"
+
+/**
+ * Number of sync operations a coroutine keeps in flight, sized from the
+ * throughput it observes.
+ *
+ * Unlike the OSD-facing limits, the cost of a sync operation is dominated
+ * by the remote zone and the network in between, so there is no latency
+ * to aim for.  Instead the window hill-climbs on throughput: callers
+ * report completions while they wait for the window to drain, and after
+ * every interval the completion rate is compared with that of the
+ * previous interval.  If it improved, the window keeps moving in the same
+ * direction (by an eighth, at least 1); otherwise it turns around.
+ *
+ * The window stays within [min, max]; with max <= min it is fixed.
+ * Intervals without any completion, or that were interrupted by idle
+ * time, are discarded.  This class does no locking.
+ */
+class RGWSyncWindow {
+public:
+  RGWSyncWindow(uint64_t min, uint64_t max, ceph::timespan interval)
+    : min_window(std::max<uint64_t>(min, 1)),
+      max_window(std::max(max, min_window)),
+      interval(interval),
+      window(min_window) {}
+
+  uint64_t get() const {
+    return window;
+  }
+
+  bool is_adaptive() const {
+    return max_window > min_window;
+  }
+
+  /// completions per second measured over the last full interval
+  double get_last_rate() const {
+    return last_rate;
+  }
+
+  /// record that n spawned operations completed
+  void complete(uint64_t n, ceph::mono_time now = ceph::mono_clock::now()) {
+    if (!is_adaptive()) {
+      return;
+    }
+    count += n;
+    const auto elapsed = now - interval_start;
+    if (elapsed < interval) {
+      return;
+    }
+    if (elapsed > interval * 4 || count == 0) {
+      // the caller went idle in between, this says nothing about the window
+      reset(now);
+      return;
+    }
+
+    const double rate = count / ceph::to_seconds<double>(elapsed);
+    if (last_rate > 0 && rate < last_rate) {
+      growing = !growing;
+    }
+    last_rate = rate;
+
+    const uint64_t step = std::max<uint64_t>(window / 8, 1);
+    window = growing ? std::min(max_window, window + step)
+                     : std::max(min_window, window - step);
+    reset(now);
+  }
+
+private:
+  void reset(ceph::mono_time now) {
+    interval_start = now;
+    count = 0;
+  }
+
+  uint64_t min_window;
+  uint64_t max_window;
+  ceph::timespan interval;
+
+  uint64_t window;
+  bool growing = true;
+  double last_rate = 0;
+  uint64_t count = 0;
+  ceph::mono_time interval_start;
+};
+
+#endif
@@ -324,9 +324,17 @@ int RGWSI_BucketIndex_RADOS::init_index(RGWBucketInfo& bucket_info)
   map<int, string> bucket_objs;
   get_bucket_index_objects(dir_oid, bucket_info.num_shards, &bucket_objs);
 
-  return CLSRGWIssueBucketIndexInit(index_pool.ioctx(),
+  r = CLSRGWIssueBucketIndexInit(index_pool.ioctx(),
+				 bucket_objs,
+				 cct->_conf->rgw_bucket_index_max_aio)();
+  if (r < 0 || !cct->_conf.get_val<bool>("rgw_bucket_index_compact")) {
+    return r;
+  }
+
+  return CLSRGWIssueSetCompactIndex(index_pool.ioctx(),
 				    bucket_objs,
-				    cct->_conf->rgw_bucket_index_max_aio)();
+				    cct->_conf->rgw_bucket_index_max_aio,
+				    true)();
 }
 
 int RGWSI_BucketIndex_RADOS::clean_index(RGWBucketInfo& bucket_info)
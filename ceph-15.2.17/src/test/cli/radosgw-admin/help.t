@@ -36,6 +36,9 @@
     bi put                     store bucket index object entries
     bi list                    list raw bucket index entries
     bi purge                   purge bucket index entries
+    bi compact                 convert bucket index entries to the compact encoding
+    bi expand                  convert bucket index entries to the regular encoding
+    bi stats                   show the omap usage of the bucket index
     object rm                  remove object
     object put                 put object
     object stat                stat an object for its metadata
@@ -1251,3 +1251,329 @@ TEST_F(cls_rgw, bi_log_trim)
     EXPECT_FALSE(truncated);
   }
 }
+
+TEST_F(cls_rgw, reshard_log)
+{
+  string bucket_oid = str_int("reshard_log", 0);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  auto guard = [] (librados::IoCtx& ioctx, const string& oid) {
+    ObjectWriteOperation op;
+    cls_rgw_guard_bucket_resharding(op, -EBUSY);
+    return ioctx.operate(oid, &op);
+  };
+  auto add_obj = [] (librados::IoCtx& ioctx, string oid, int i) {
+    cls_rgw_obj_key obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+    index_prepare(ioctx, oid, CLS_RGW_OP_ADD, tag, obj, loc);
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = RGWObjCategory::None;
+    meta.size = 1024;
+    index_complete(ioctx, oid, CLS_RGW_OP_ADD, tag, 1, obj, meta);
+  };
+
+  // nothing is recorded unless an online reshard is in progress
+  add_obj(ioctx, bucket_oid, 0);
+
+  cls_rgw_bucket_instance_entry entry;
+  entry.set_status("new_id", 7, cls_rgw_reshard_status::IN_LOGRECORD);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+  ASSERT_EQ(0, guard(ioctx, bucket_oid));
+
+  for (int i = 1; i < 4; i++) {
+    add_obj(ioctx, bucket_oid, i);
+  }
+
+  map<string, uint64_t> log;
+  bool truncated = false;
+  ASSERT_EQ(0, cls_rgw_bucket_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                               &log, &truncated));
+  ASSERT_FALSE(truncated);
+  ASSERT_EQ(3u, log.size());
+  ASSERT_EQ(0u, log.count("obj-0"));
+  const uint64_t ver = log["obj-1"];
+
+  // a later change records a later version; markers page through the log
+  add_obj(ioctx, bucket_oid, 1);
+  log.clear();
+  ASSERT_EQ(0, cls_rgw_bucket_reshard_log_list(ioctx, bucket_oid, "", 1,
+                                               &log, &truncated));
+  ASSERT_TRUE(truncated);
+  ASSERT_EQ(1u, log.size());
+  ASSERT_LT(ver, log["obj-1"]);
+  log.clear();
+  ASSERT_EQ(0, cls_rgw_bucket_reshard_log_list(ioctx, bucket_oid, "obj-1", 100,
+                                               &log, &truncated));
+  ASSERT_EQ(2u, log.size());
+  ASSERT_EQ(1u, log.count("obj-2"));
+
+  // the log does not show up as index entries
+  list<rgw_cls_bi_entry> entries;
+  ASSERT_EQ(0, cls_rgw_bi_list(ioctx, bucket_oid, "", "", 128,
+                               &entries, &truncated));
+  ASSERT_EQ(4u, entries.size());
+
+  // a prepare alone is not recorded; its complete is
+  {
+    cls_rgw_obj_key obj("obj-prepared");
+    string tag = "tag-prepared";
+    string loc;
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+    log.clear();
+    ASSERT_EQ(0, cls_rgw_bucket_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                                 &log, &truncated));
+    ASSERT_EQ(0u, log.count("obj-prepared"));
+  }
+
+  // switching to a blocking reshard stops writes
+  entry.set_status("new_id", 7, cls_rgw_reshard_status::IN_PROGRESS);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+  ASSERT_EQ(-EBUSY, guard(ioctx, bucket_oid));
+
+  // and clearing the reshard status drops the log
+  ASSERT_EQ(0, cls_rgw_clear_bucket_resharding(ioctx, bucket_oid));
+  ASSERT_EQ(0, guard(ioctx, bucket_oid));
+  log.clear();
+  ASSERT_EQ(0, cls_rgw_bucket_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                               &log, &truncated));
+  ASSERT_TRUE(log.empty());
+}
+
+TEST_F(cls_rgw, reshard_log_olh)
+{
+  string bucket_oid = str_int("reshard_log_olh", 0);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  // a versioned object, linked before the reshard starts
+  cls_rgw_obj_key obj("obj", "inst");
+  string tag = "tag";
+  string loc;
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+  rgw_bucket_dir_entry_meta meta;
+  meta.category = RGWObjCategory::None;
+  meta.size = 1024;
+  index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 1, obj, meta);
+
+  cls_rgw_bucket_instance_entry entry;
+  entry.set_status("new_id", 7, cls_rgw_reshard_status::IN_LOGRECORD);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+
+  // trimming its olh log changes the olh entry, which is recorded
+  ObjectWriteOperation trim;
+  cls_rgw_trim_olh_log(trim, cls_rgw_obj_key("obj"), 1, tag);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &trim));
+
+  map<string, uint64_t> log;
+  bool truncated = false;
+  ASSERT_EQ(0, cls_rgw_bucket_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                               &log, &truncated));
+  ASSERT_EQ(1u, log.size());
+  ASSERT_EQ(1u, log.count("obj"));
+}
+
+TEST_F(cls_rgw, compact_index)
+{
+  string bucket_oid = str_int("compact_index", 0);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  const auto mtime = ceph::real_clock::now();
+  auto add_obj = [mtime] (librados::IoCtx& ioctx, string oid, int i) {
+    cls_rgw_obj_key obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+    index_prepare(ioctx, oid, CLS_RGW_OP_ADD, tag, obj, loc);
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = RGWObjCategory::Main;
+    meta.size = 1024 * i;
+    meta.mtime = mtime;
+    meta.etag = "d41d8cd98f00b204e9800998ecf8427e";
+    meta.owner = "tenant$owner";
+    meta.owner_display_name = "Owner";
+    meta.content_type = "application/octet-stream";
+    index_complete(ioctx, oid, CLS_RGW_OP_ADD, tag, 1, obj, meta);
+  };
+
+  for (int i = 0; i < 5; i++) {
+    add_obj(ioctx, bucket_oid, i);
+  }
+
+  rgw_cls_bi_index_stats_ret before;
+  ASSERT_EQ(0, cls_rgw_bi_index_stats(ioctx, bucket_oid, "", 1000, &before));
+  ASSERT_FALSE(before.compact);
+  ASSERT_EQ(5u, before.entries);
+  ASSERT_EQ(0u, before.compact_entries);
+
+  // convert the existing entries a page at a time
+  rgw_cls_bi_compact_ret result;
+  string marker;
+  uint64_t converted = 0;
+  do {
+    ASSERT_EQ(0, cls_rgw_bi_compact(ioctx, bucket_oid, true, marker, 2, &result));
+    converted += result.converted;
+    marker = result.marker;
+  } while (result.is_truncated);
+  ASSERT_EQ(5u, converted);
+
+  // later writes use the compact encoding as well
+  add_obj(ioctx, bucket_oid, 5);
+
+  rgw_cls_bi_index_stats_ret after;
+  ASSERT_EQ(0, cls_rgw_bi_index_stats(ioctx, bucket_oid, "", 1000, &after));
+  ASSERT_TRUE(after.compact);
+  ASSERT_EQ(6u, after.entries);
+  ASSERT_EQ(6u, after.compact_entries);
+  ASSERT_EQ(3u, after.dict_strings);
+  ASSERT_LT(after.entry_value_bytes / after.entries,
+            before.entry_value_bytes / before.entries / 2);
+  // the dictionary isn't kept in the header
+  ASSERT_LT(after.header_bytes, before.header_bytes + 32);
+
+  // bucket listing and bi_list return the entries unchanged
+  std::map<int, rgw_cls_list_ret> results;
+  list_entries(ioctx, bucket_oid, 100, results);
+  ASSERT_EQ(6u, results[0].dir.m.size());
+  for (auto& i : results[0].dir.m) {
+    rgw_bucket_dir_entry& e = i.second;
+    ASSERT_EQ(i.first, e.key.name);
+    ASSERT_TRUE(e.exists);
+    ASSERT_EQ(mtime, e.meta.mtime);
+    ASSERT_EQ("d41d8cd98f00b204e9800998ecf8427e", e.meta.etag);
+    ASSERT_EQ("tenant$owner", e.meta.owner);
+    ASSERT_EQ("application/octet-stream", e.meta.content_type);
+    ASSERT_EQ(e.meta.size, e.meta.accounted_size);
+    ASSERT_TRUE(e.pending_map.empty());
+  }
+  ASSERT_EQ(5u * 1024, results[0].dir.m["obj-5"].meta.size);
+  test_stats(ioctx, bucket_oid, RGWObjCategory::Main, 6, 15 * 1024);
+
+  list<rgw_cls_bi_entry> entries;
+  bool truncated = false;
+  ASSERT_EQ(0, cls_rgw_bi_list(ioctx, bucket_oid, "", "", 100,
+                               &entries, &truncated));
+  ASSERT_EQ(6u, entries.size());
+  for (auto& entry : entries) {
+    ASSERT_FALSE(rgw_bucket_dir_entry::is_compact(entry.data));
+    rgw_bucket_dir_entry e;
+    auto iter = entry.data.cbegin();
+    decode(e, iter);
+    ASSERT_EQ(entry.idx, e.key.name);
+    ASSERT_EQ("Owner", e.meta.owner_display_name);
+  }
+
+  // and converting back restores the regular encoding
+  ASSERT_EQ(0, cls_rgw_bi_compact(ioctx, bucket_oid, false, "", 1000, &result));
+  ASSERT_EQ(6u, result.converted);
+  ASSERT_EQ(0, cls_rgw_bi_index_stats(ioctx, bucket_oid, "", 1000, &after));
+  ASSERT_FALSE(after.compact);
+  ASSERT_EQ(0u, after.compact_entries);
+}
+
+TEST_F(cls_rgw, compact_index_versioned)
+{
+  string bucket_oid = str_int("compact_index_versioned", 0);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  // entries are written compact from the start
+  rgw_cls_bi_compact_ret result;
+  ASSERT_EQ(0, cls_rgw_bi_compact(ioctx, bucket_oid, true, "", 0, &result));
+
+  // a plain object, then two versions of it, which converts the plain one
+  // to a versioned one; the olh tag is the same throughout
+  string tag = "tag";
+  string loc;
+  auto add_obj = [&] (const cls_rgw_obj_key& key, int epoch) {
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, key, loc);
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = RGWObjCategory::Main;
+    meta.size = 1024 * epoch;
+    meta.owner = "owner";
+    meta.content_type = "text/plain";
+    index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, epoch, key, meta);
+  };
+  add_obj(cls_rgw_obj_key("obj"), 1);
+  add_obj(cls_rgw_obj_key("obj", "v1"), 2);
+  add_obj(cls_rgw_obj_key("obj", "v2"), 3);
+
+  // the instance, list and version marker entries are all compact; the
+  // olh entry is not a dir entry and keeps its encoding
+  rgw_cls_bi_index_stats_ret stats;
+  ASSERT_EQ(0, cls_rgw_bi_index_stats(ioctx, bucket_oid, "", 1000, &stats));
+  ASSERT_TRUE(stats.compact);
+  ASSERT_LT(0u, stats.entries);
+  ASSERT_EQ(stats.entries, stats.compact_entries);
+  ASSERT_EQ(2u, stats.dict_strings);
+
+  list<rgw_cls_bi_entry> entries;
+  bool truncated = false;
+  ASSERT_EQ(0, cls_rgw_bi_list(ioctx, bucket_oid, "", "", 100,
+                               &entries, &truncated));
+  set<string> instances;
+  int olh_entries = 0;
+  for (auto& entry : entries) {
+    ASSERT_FALSE(rgw_bucket_dir_entry::is_compact(entry.data));
+    auto iter = entry.data.cbegin();
+    if (entry.type == BIIndexType::OLH) {
+      rgw_bucket_olh_entry olh;
+      decode(olh, iter);
+      ASSERT_EQ(cls_rgw_obj_key("obj", "v2"), olh.key);
+      ++olh_entries;
+      continue;
+    }
+    rgw_bucket_dir_entry e;
+    decode(e, iter);
+    ASSERT_EQ("obj", e.key.name);
+    if (entry.type == BIIndexType::Instance) {
+      instances.insert(e.key.instance);
+      ASSERT_EQ("owner", e.meta.owner);
+      ASSERT_EQ("text/plain", e.meta.content_type);
+    }
+  }
+  ASSERT_EQ(1, olh_entries);
+  ASSERT_EQ(set<string>({"", "v1", "v2"}), instances);
+
+  auto list_versions = [&] () {
+    std::map<int, rgw_cls_list_ret> results;
+    list_entries(ioctx, bucket_oid, 100, results);
+    map<string, rgw_bucket_dir_entry> versions;
+    for (auto& i : results[0].dir.m) {
+      versions[i.second.key.instance] = i.second;
+    }
+    return versions;
+  };
+  auto versions = list_versions();
+  ASSERT_EQ(3u, versions.size());
+  ASSERT_TRUE(versions["v2"].is_current());
+  ASSERT_FALSE(versions["v1"].is_current());
+  ASSERT_FALSE(versions[""].is_current());
+  ASSERT_EQ(1u, versions[""].versioned_epoch);
+  ASSERT_EQ(2u * 1024, versions["v1"].meta.size);
+  ASSERT_EQ("owner", versions["v1"].meta.owner);
+
+  // unlinking the current version makes the next one current
+  rgw_zone_set zones_trace;
+  ASSERT_EQ(0, cls_rgw_bucket_unlink_instance(ioctx, bucket_oid,
+                                              cls_rgw_obj_key("obj", "v2"),
+                                              "unlink-tag", tag, 4, true,
+                                              zones_trace));
+  versions = list_versions();
+  ASSERT_EQ(2u, versions.size());
+  ASSERT_TRUE(versions["v1"].is_current());
+  ASSERT_EQ("text/plain", versions["v1"].meta.content_type);
+
+  ASSERT_EQ(0, cls_rgw_bi_index_stats(ioctx, bucket_oid, "", 1000, &stats));
+  ASSERT_EQ(stats.entries, stats.compact_entries);
+  ASSERT_EQ(2u, stats.dict_strings);
+}
@@ -0,0 +1,67 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "common/AdaptiveLimit.h"
+#include "gtest/gtest.h"
+
+using namespace std::chrono_literals;
+
+TEST(AdaptiveLimit, Bounds)
+{
+  AdaptiveLimit l(0, 0, 10ms);
+  ASSERT_EQ(1u, l.get());
+
+  l.set_bounds(8, 4);
+  ASSERT_EQ(8u, l.get());
+
+  l.set_bounds(2, 16);
+  ASSERT_EQ(8u, l.get());
+  l.set_bounds(10, 16);
+  ASSERT_EQ(10u, l.get());
+}
+
+TEST(AdaptiveLimit, GrowAndShrink)
+{
+  AdaptiveLimit l(4, 64, 10ms);
+  ASSERT_EQ(4u, l.get());
+
+  // a window is as long as the current limit
+  for (int i = 0; i < 3; ++i)
+    l.sample(1ms);
+  ASSERT_EQ(4u, l.get());
+  l.sample(1ms);
+  ASSERT_EQ(5u, l.get());
+  ASSERT_EQ(1ms, l.get_last_latency());
+
+  while (l.get() < 64)
+    l.sample(1ms);
+  for (int i = 0; i < 1000; ++i)
+    l.sample(1ms);
+  ASSERT_EQ(64u, l.get());
+
+  for (int i = 0; i < 64; ++i)
+    l.sample(100ms);
+  ASSERT_EQ(48u, l.get());
+
+  for (int i = 0; i < 10000; ++i)
+    l.sample(100ms);
+  ASSERT_EQ(4u, l.get());
+}
+
+TEST(AdaptiveLimit, Converges)
+{
+  // a device that serves 100 ops in parallel at 5ms, queueing beyond that
+  auto latency = [](uint64_t in_flight) {
+    auto lat = 5ms;
+    if (in_flight > 100)
+      lat = lat * in_flight / 100;
+    return lat;
+  };
+
+  AdaptiveLimit l(1, 10000, 6ms);
+  for (int i = 0; i < 100000; ++i)
+    l.sample(latency(l.get()));
+
+  ASSERT_GE(l.get(), 80u);
+  ASSERT_LE(l.get(), 130u);
+}
@@ -301,6 +301,25 @@ double estimate_clock_resolution()
   return range;
 }
 
+TEST(Crc32c, Combine) {
+  // as bluestore folds per-chunk csums into one crc over the whole range
+  unsigned char buf[4096 * 3 + 17];
+  for (size_t i = 0; i < sizeof(buf); ++i)
+    buf[i] = rand();
+  for (unsigned chunk : {1u, 16u, 17u, 4096u}) {
+    for (uint32_t seed : {0u, 1u, 0xffffffffu, 0x12345678u}) {
+      uint32_t crc = seed;
+      size_t pos = 0;
+      for (; pos + chunk <= sizeof(buf); pos += chunk) {
+	uint32_t c = ceph_crc32c(-1, buf + pos, chunk);
+	crc = ceph_crc32c_combine(crc, c, chunk);
+      }
+      crc = ceph_crc32c(crc, buf + pos, sizeof(buf) - pos);
+      ASSERT_EQ(ceph_crc32c(seed, buf, sizeof(buf)), crc);
+    }
+  }
+}
+
 TEST(Crc32c, zeros_performance_compare) {
   double resolution = estimate_clock_resolution();
   utime_t start;
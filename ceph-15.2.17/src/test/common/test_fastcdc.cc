@@ -0,0 +1,106 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "include/buffer.h"
+#include "common/fastcdc.h"
+#include "gtest/gtest.h"
+
+using ceph::bufferlist;
+using ceph::bufferptr;
+using chunk_list = std::vector<std::pair<uint64_t, uint64_t>>;
+
+static bufferlist random_data(size_t len, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  bufferptr bp(len);
+  for (size_t i = 0; i < len; ++i) {
+    bp.c_str()[i] = gen() & 0xff;
+  }
+  bufferlist bl;
+  bl.append(std::move(bp));
+  return bl;
+}
+
+TEST(FastCDC, covers_input_within_bounds) {
+  FastCDC cdc(12);
+  bufferlist bl = random_data(1 << 20, 1);
+  chunk_list chunks;
+  cdc.calc_chunks(bl, &chunks);
+
+  ASSERT_GT(chunks.size(), 1u);
+  uint64_t expected_offset = 0;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    ASSERT_EQ(expected_offset, chunks[i].first);
+    ASSERT_LE(chunks[i].second, cdc.get_max_chunk());
+    if (i + 1 < chunks.size()) {
+      ASSERT_GE(chunks[i].second, cdc.get_min_chunk());
+    }
+    expected_offset += chunks[i].second;
+  }
+  ASSERT_EQ(bl.length(), expected_offset);
+
+  // the average lands near the requested size
+  const uint64_t avg = bl.length() / chunks.size();
+  ASSERT_GT(avg, cdc.get_avg_chunk() / 2);
+  ASSERT_LT(avg, cdc.get_avg_chunk() * 2);
+}
+
+TEST(FastCDC, small_input) {
+  FastCDC cdc(12);
+  bufferlist bl;
+  bl.append("hello");
+  chunk_list chunks;
+  cdc.calc_chunks(bl, &chunks);
+  ASSERT_EQ(1u, chunks.size());
+  ASSERT_EQ(0u, chunks[0].first);
+  ASSERT_EQ(5u, chunks[0].second);
+
+  chunks.clear();
+  cdc.calc_chunks(bufferlist(), &chunks);
+  ASSERT_TRUE(chunks.empty());
+}
+
+TEST(FastCDC, independent_of_buffer_layout) {
+  FastCDC cdc(11);
+  bufferlist bl = random_data(256 << 10, 2);
+  bufferlist fragmented;
+  for (unsigned off = 0; off < bl.length(); off += 1000) {
+    bufferlist part;
+    part.substr_of(bl, off, std::min<unsigned>(1000, bl.length() - off));
+    fragmented.append(part.c_str(), part.length());
+    fragmented.append(bufferptr(0));
+  }
+  ASSERT_GT(fragmented.get_num_buffers(), 1u);
+
+  chunk_list a, b;
+  cdc.calc_chunks(bl, &a);
+  cdc.calc_chunks(fragmented, &b);
+  ASSERT_EQ(a, b);
+}
+
+TEST(FastCDC, resynchronizes_after_insert) {
+  FastCDC cdc(12);
+  bufferlist bl = random_data(1 << 20, 3);
+  bufferlist shifted;
+  shifted.append("0123456789");
+  shifted.append(bl);
+
+  chunk_list a, b;
+  cdc.calc_chunks(bl, &a);
+  cdc.calc_chunks(shifted, &b);
+
+  // past the first few chunks the cut points are the same, just shifted
+  std::set<uint64_t> cuts;
+  for (auto& c : a) {
+    cuts.insert(c.first + 10);
+  }
+  size_t common = 0;
+  for (auto& c : b) {
+    common += cuts.count(c.first);
+  }
+  ASSERT_GE(common + 3, a.size());
+}
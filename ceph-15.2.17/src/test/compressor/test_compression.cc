@@ -23,6 +23,7 @@
 #include "compressor/Compressor.h"
 #include "compressor/CompressionPlugin.h"
 #include "global/global_context.h"
+#include "messages/MOSDMap.h"
 #include "osd/OSDMap.h"
 
 class CompressorTest : public ::testing::Test,
@@ -196,6 +197,43 @@ TEST_P(CompressorTest, round_trip_osdmap)
   delete o;
 }
 
+TEST_P(CompressorTest, round_trip_mosdmap)
+{
+#include "osdmaps/osdmap.2982809.h"
+
+  bufferlist orig;
+  orig.append((char*)osdmap_a, sizeof(osdmap_a));
+  bufferlist noise;
+  for (unsigned i = 0; i < 4096; ++i) {
+    noise.append((char)(rand() & 0xff));
+  }
+
+  auto m = ceph::make_message<MOSDMap>(uuid_d(), CEPH_FEATURES_ALL);
+  MOSDMap::compress_map(compressor, orig, m->compressed_maps[10]);
+  // incompressible maps are sent as is
+  MOSDMap::compress_map(compressor, noise, m->compressed_incremental_maps[11]);
+  ASSERT_LT(m->compressed_maps[10].length(), orig.length());
+  ASSERT_EQ(10u, m->get_first());
+  ASSERT_EQ(11u, m->get_last());
+  m->encode_payload(CEPH_FEATURES_ALL);
+
+  auto d = ceph::make_message<MOSDMap>();
+  d->set_header(m->get_header());
+  d->set_payload(m->get_payload());
+  d->decode_payload();
+  d->decompress(g_ceph_context);
+  ASSERT_TRUE(d->compressed_maps.empty());
+  ASSERT_TRUE(d->compressed_incremental_maps.empty());
+  ASSERT_TRUE(d->maps[10].contents_equal(orig));
+  ASSERT_TRUE(d->incremental_maps[11].contents_equal(noise));
+
+  // a truncated map is rejected
+  bufferlist bad, out;
+  bad.substr_of(m->compressed_maps[10], 0, m->compressed_maps[10].length() / 2);
+  ASSERT_THROW(MOSDMap::decompress_map(g_ceph_context, bad, out),
+	       ceph::buffer::error);
+}
+
 TEST_P(CompressorTest, compress_decompress)
 {
   const char* test = "This is test text";
@@ -97,3 +97,78 @@ TEST(LibCephFS, MulticlientHoleEOF) {
   ceph_shutdown(ca);
   ceph_shutdown(cb);
 }
+
+static void readdirplus_revoked(int batch)
+{
+  struct ceph_mount_info *ca, *cb;
+  ASSERT_EQ(ceph_create(&ca, NULL), 0);
+  ASSERT_EQ(ceph_conf_read_file(ca, NULL), 0);
+  ASSERT_EQ(0, ceph_conf_parse_env(ca, NULL));
+  char val[16];
+  snprintf(val, sizeof(val), "%d", batch);
+  ASSERT_EQ(0, ceph_conf_set(ca, "client_readdir_getattr_batch", val));
+  ASSERT_EQ(ceph_mount(ca, NULL), 0);
+
+  ASSERT_EQ(ceph_create(&cb, NULL), 0);
+  ASSERT_EQ(ceph_conf_read_file(cb, NULL), 0);
+  ASSERT_EQ(0, ceph_conf_parse_env(cb, NULL));
+  ASSERT_EQ(ceph_mount(cb, NULL), 0);
+
+  const int num = 2000;
+  char dir[64];
+  snprintf(dir, sizeof(dir), "readdir_batch.%d.%d", getpid(), batch);
+  ASSERT_EQ(0, ceph_mkdir(ca, dir, 0755));
+  for (int i = 0; i < num; i++) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s/f%d", dir, i);
+    int fd = ceph_open(ca, name, O_CREAT|O_RDWR, 0644);
+    ASSERT_LE(0, fd);
+    ceph_close(ca, fd);
+  }
+
+  // the other client resizes every file, revoking our caps on them
+  for (int i = 0; i < num; i++) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s/f%d", dir, i);
+    ASSERT_EQ(0, ceph_truncate(cb, name, i));
+  }
+
+  struct ceph_dir_result *dirp;
+  ASSERT_EQ(0, ceph_opendir(ca, dir, &dirp));
+  int found = 0;
+  while (true) {
+    struct dirent de;
+    struct ceph_statx stx;
+    int r = ceph_readdirplus_r(ca, dirp, &de, &stx, CEPH_STATX_SIZE, 0, NULL);
+    ASSERT_LE(0, r);
+    if (r == 0)
+      break;
+    if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, ".."))
+      continue;
+    int i;
+    ASSERT_EQ(1, sscanf(de.d_name, "f%d", &i));
+    ASSERT_TRUE(stx.stx_mask & CEPH_STATX_SIZE);
+    ASSERT_EQ((uint64_t)i, stx.stx_size);
+    found++;
+  }
+  ASSERT_EQ(num, found);
+  ASSERT_EQ(0, ceph_closedir(ca, dirp));
+
+  for (int i = 0; i < num; i++) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s/f%d", dir, i);
+    ASSERT_EQ(0, ceph_unlink(ca, name));
+  }
+  ASSERT_EQ(0, ceph_rmdir(ca, dir));
+
+  ceph_shutdown(ca);
+  ceph_shutdown(cb);
+}
+
+TEST(LibCephFS, MulticlientReaddirplusRevoked) {
+  // one getattr per entry, one batch spanning many readdir chunks, and
+  // many small batches
+  readdirplus_revoked(0);
+  readdirplus_revoked(256);
+  readdirplus_revoked(7);
+}
@@ -3616,6 +3616,86 @@ TEST_F(LibRadosTwoPoolsPP, ManifestFlushRead) {
   cluster.wait_for_latest_osdmap();
 }
 
+TEST_F(LibRadosTwoPoolsPP, ManifestEvict) {
+  // skip test if not yet octopus 
+  if (_get_required_osd_release(cluster) < "octopus") {
+    GTEST_SKIP() << "cluster is not yet octopus, skipping test";
+  }
+
+  // create object
+  {
+    bufferlist bl;
+    bl.append("ABCD");
+    ObjectWriteOperation op;
+    op.write_full(bl);
+    ASSERT_EQ(0, ioctx.operate("foo-chunk", &op));
+  }
+  {
+    bufferlist bl;
+    bl.append("ABCD");
+    ObjectWriteOperation op;
+    op.write_full(bl);
+    ASSERT_EQ(0, cache_ioctx.operate("bar-chunk", &op));
+  }
+
+  // configure tier
+  bufferlist inbl;
+  ASSERT_EQ(0, cluster.mon_command(
+    "{\"prefix\": \"osd tier add\", \"pool\": \"" + pool_name +
+    "\", \"tierpool\": \"" + cache_pool_name +
+    "\", \"force_nonempty\": \"--force-nonempty\" }",
+    inbl, NULL, NULL));
+
+  // wait for maps to settle
+  cluster.wait_for_latest_osdmap();
+
+  // not a manifest object
+  {
+    ObjectWriteOperation op;
+    op.tier_evict();
+    ASSERT_EQ(-EINVAL, ioctx.operate("foo-chunk", &op));
+  }
+  // chunks only cover part of the object
+  {
+    ObjectWriteOperation op;
+    op.set_chunk(0, 2, cache_ioctx, "bar-chunk", 0);
+    op.tier_evict();
+    ASSERT_EQ(-EINVAL, ioctx.operate("foo-chunk", &op));
+  }
+  // set-chunk and evict at once
+  {
+    ObjectWriteOperation op;
+    op.set_chunk(0, 2, cache_ioctx, "bar-chunk", 0);
+    op.set_chunk(2, 2, cache_ioctx, "bar-chunk", 2);
+    op.tier_evict();
+    ASSERT_EQ(0, ioctx.operate("foo-chunk", &op));
+  }
+  // the size is kept, and evicting again does nothing
+  {
+    uint64_t size;
+    ASSERT_EQ(0, ioctx.stat("foo-chunk", &size, nullptr));
+    ASSERT_EQ(4u, size);
+    ObjectWriteOperation op;
+    op.tier_evict();
+    ASSERT_EQ(0, ioctx.operate("foo-chunk", &op));
+  }
+  // the data is read from the chunks
+  {
+    bufferlist bl;
+    ASSERT_EQ(4, ioctx.read("foo-chunk", bl, 4, 0));
+    ASSERT_EQ('A', bl[0]);
+    ASSERT_EQ('D', bl[3]);
+  }
+
+  ASSERT_EQ(0, cluster.mon_command(
+    "{\"prefix\": \"osd tier remove\", \"pool\": \"" + pool_name +
+    "\", \"tierpool\": \"" + cache_pool_name + "\"}",
+    inbl, NULL, NULL));
+
+  // wait for maps to settle before next test
+  cluster.wait_for_latest_osdmap();
+}
+
 class LibRadosTwoPoolsECPP : public RadosTestECPP
 {
 public:
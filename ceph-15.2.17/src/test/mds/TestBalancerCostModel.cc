@@ -0,0 +1,234 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <map>
+#include <vector>
+
+#include "mds/BalancerCostModel.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+dirfrag_t df(inodeno_t ino)
+{
+  return dirfrag_t(ino, frag_t());
+}
+
+BalancerCostModel::config_t default_config()
+{
+  BalancerCostModel::config_t c;
+  c.item_cost = .001;
+  c.base_cost = 1.0;
+  c.min_benefit = 1.0;
+  c.max_items_per_round = 0;
+  c.cooldown = 0;
+  return c;
+}
+
+/*
+ * A tiny balancer simulation.  Each tick of the trace gives the load of
+ * every dirfrag; all dirfrags start on rank 0.  On every tick each rank
+ * above the mean load exports its hottest dirfrags to the least loaded rank
+ * until it is back at the mean, asking the cost model before each export.
+ */
+struct trace_sample_t {
+  dirfrag_t dirfrag;
+  double load;
+  uint64_t items;
+};
+typedef std::vector<std::vector<trace_sample_t>> trace_t;
+
+struct sim_result_t {
+  unsigned migrations = 0;
+  uint64_t items_migrated = 0;
+  unsigned ping_pongs = 0;  // exported back to the rank it came from
+  double imbalance = 0;     // sum over ticks of (max - min) rank load
+};
+
+sim_result_t replay(const trace_t& trace, int num_ranks,
+		    const BalancerCostModel::config_t& conf)
+{
+  std::vector<BalancerCostModel> models(num_ranks, BalancerCostModel(conf));
+  std::map<dirfrag_t, int> owner;
+  std::map<dirfrag_t, int> prev_owner;
+  sim_result_t r;
+
+  double now = 0;
+  for (const auto& tick : trace) {
+    now += 10;
+    std::vector<double> load(num_ranks, 0);
+    for (const auto& s : tick)
+      load[owner[s.dirfrag]] += s.load;
+
+    double mean = 0;
+    for (auto l : load)
+      mean += l;
+    mean /= num_ranks;
+
+    for (int rank = 0; rank < num_ranks; ++rank) {
+      models[rank].start_round(now);
+      if (load[rank] <= mean)
+	continue;
+
+      // hottest first
+      std::multimap<double, const trace_sample_t*> mine;
+      for (const auto& s : tick) {
+	if (owner[s.dirfrag] == rank)
+	  mine.emplace(s.load, &s);
+      }
+      for (auto p = mine.rbegin(); p != mine.rend(); ++p) {
+	const trace_sample_t& s = *p->second;
+	if (load[rank] - s.load < mean * .9)
+	  continue;  // would overshoot
+	int target = 0;
+	for (int t = 1; t < num_ranks; ++t) {
+	  if (load[t] < load[target])
+	    target = t;
+	}
+	if (target == rank)
+	  break;
+	if (models[rank].admit(s.dirfrag, s.load, s.items) !=
+	    BalancerCostModel::ADMIT)
+	  continue;
+
+	if (prev_owner.count(s.dirfrag) && prev_owner[s.dirfrag] == target)
+	  r.ping_pongs++;
+	prev_owner[s.dirfrag] = rank;
+	owner[s.dirfrag] = target;
+	models[target].note_import(s.dirfrag, now);
+	load[rank] -= s.load;
+	load[target] += s.load;
+	r.migrations++;
+	r.items_migrated += s.items;
+	if (load[rank] <= mean)
+	  break;
+      }
+    }
+
+    double lo = load[0], hi = load[0];
+    for (auto l : load) {
+      lo = std::min(lo, l);
+      hi = std::max(hi, l);
+    }
+    r.imbalance += hi - lo;
+  }
+  return r;
+}
+
+/*
+ * Two hot spots that take turns: whichever is hot carries most of the
+ * load, so a load-only balancer keeps moving them back and forth.  A big,
+ * lukewarm tree sits next to them.
+ */
+trace_t flapping_trace(unsigned ticks)
+{
+  trace_t trace;
+  for (unsigned i = 0; i < ticks; ++i) {
+    bool a_hot = (i % 2) == 0;
+    trace.push_back({
+      {df(0x1000), a_hot ? 900.0 : 100.0, 2000},
+      {df(0x1001), a_hot ? 100.0 : 900.0, 2000},
+      {df(0x1002), 300.0, 5000000},
+      {df(0x1003), 200.0, 1000},
+    });
+  }
+  return trace;
+}
+
+} // anonymous namespace
+
+TEST(BalancerCostModel, Cost)
+{
+  BalancerCostModel m(default_config());
+  ASSERT_DOUBLE_EQ(1.0, m.migration_cost(0));
+  ASSERT_DOUBLE_EQ(11.0, m.migration_cost(10000));
+
+  // mds_bal_cost_base: small subtrees are cheap to move when it is low
+  auto c = default_config();
+  c.base_cost = 0.1;
+  m.set_config(c);
+  m.start_round(0);
+  ASSERT_DOUBLE_EQ(0.2, m.migration_cost(100));
+  ASSERT_EQ(BalancerCostModel::ADMIT, m.admit(df(1), 0.5, 100));
+}
+
+TEST(BalancerCostModel, Benefit)
+{
+  BalancerCostModel m(default_config());
+  m.start_round(0);
+  // 1000 items cost 2; load 5 is worth it, load 1 is not.
+  ASSERT_EQ(BalancerCostModel::ADMIT, m.admit(df(1), 5, 1000));
+  ASSERT_EQ(BalancerCostModel::REJECT_BENEFIT, m.admit(df(2), 1, 1000));
+  ASSERT_EQ(1u, m.get_num_admitted());
+  ASSERT_EQ(1u, m.get_num_rejected(BalancerCostModel::REJECT_BENEFIT));
+}
+
+TEST(BalancerCostModel, Cooldown)
+{
+  auto c = default_config();
+  c.cooldown = 60;
+  BalancerCostModel m(c);
+
+  m.note_import(df(1), 100);
+  m.start_round(130);
+  ASSERT_EQ(BalancerCostModel::REJECT_COOLDOWN, m.admit(df(1), 1000, 10));
+  ASSERT_EQ(BalancerCostModel::ADMIT, m.admit(df(2), 1000, 10));
+
+  m.start_round(161);
+  ASSERT_EQ(BalancerCostModel::ADMIT, m.admit(df(1), 1000, 10));
+}
+
+TEST(BalancerCostModel, Budget)
+{
+  auto c = default_config();
+  c.max_items_per_round = 1000;
+  BalancerCostModel m(c);
+
+  m.start_round(0);
+  // the first candidate always passes, even if it is over budget
+  ASSERT_EQ(BalancerCostModel::ADMIT, m.admit(df(1), 1e6, 5000));
+  ASSERT_EQ(BalancerCostModel::REJECT_BUDGET, m.admit(df(2), 1e6, 10));
+
+  m.start_round(10);
+  ASSERT_EQ(BalancerCostModel::ADMIT, m.admit(df(2), 1e6, 600));
+  ASSERT_EQ(BalancerCostModel::ADMIT, m.admit(df(3), 1e6, 400));
+  ASSERT_EQ(BalancerCostModel::REJECT_BUDGET, m.admit(df(4), 1e6, 1));
+}
+
+TEST(BalancerCostModel, ReplayFlappingTrace)
+{
+  auto trace = flapping_trace(100);
+
+  // load-only policy: every candidate is admitted
+  auto naive = default_config();
+  naive.item_cost = 0;
+  naive.base_cost = 0;
+  naive.min_benefit = 0;
+  sim_result_t base = replay(trace, 2, naive);
+
+  auto tuned = default_config();
+  tuned.cooldown = 300;
+  tuned.max_items_per_round = 1000000;
+  sim_result_t cost = replay(trace, 2, tuned);
+
+  std::cout << "load-only: " << base.migrations << " migrations, "
+	    << base.items_migrated << " items, " << base.ping_pongs
+	    << " ping-pongs, imbalance " << base.imbalance << std::endl;
+  std::cout << "cost model: " << cost.migrations << " migrations, "
+	    << cost.items_migrated << " items, " << cost.ping_pongs
+	    << " ping-pongs, imbalance " << cost.imbalance << std::endl;
+
+  ASSERT_GT(base.ping_pongs, 0u);
+  ASSERT_LT(cost.ping_pongs, base.ping_pongs);
+  ASSERT_LT(cost.migrations, base.migrations);
+  ASSERT_LT(cost.items_migrated, base.items_migrated);
+}
@@ -0,0 +1,72 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "mds/MDLog.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+typedef MDLog::PendingEvent PendingEvent;
+
+// tag events through their flush flag and the order they were queued in
+std::list<PendingEvent> make_queue(unsigned n)
+{
+  std::list<PendingEvent> q;
+  for (unsigned i = 0; i < n; ++i)
+    q.emplace_back(nullptr, nullptr, i % 3 == 2);
+  return q;
+}
+
+}
+
+TEST(MDLogSubmitBatch, TakesUpToMaxInOrder)
+{
+  auto q = make_queue(10);
+  std::vector<ceph::mono_time> stamps;
+  for (auto& e : q)
+    stamps.push_back(e.stamp);
+
+  std::list<PendingEvent> batch;
+  EXPECT_EQ(4u, MDLog::take_submit_batch(&q, &batch, 4));
+  EXPECT_EQ(4u, batch.size());
+  EXPECT_EQ(6u, q.size());
+  unsigned i = 0;
+  for (auto& e : batch) {
+    EXPECT_EQ(stamps[i], e.stamp);
+    EXPECT_EQ(i % 3 == 2, e.flush);
+    ++i;
+  }
+  // the rest stays queued, still in order
+  EXPECT_EQ(stamps[4], q.front().stamp);
+}
+
+TEST(MDLogSubmitBatch, AppendsToBatch)
+{
+  auto q = make_queue(5);
+  std::list<PendingEvent> batch;
+  EXPECT_EQ(2u, MDLog::take_submit_batch(&q, &batch, 2));
+  EXPECT_EQ(3u, MDLog::take_submit_batch(&q, &batch, 100));
+  EXPECT_EQ(5u, batch.size());
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(0u, MDLog::take_submit_batch(&q, &batch, 100));
+  EXPECT_EQ(5u, batch.size());
+}
+
+TEST(MDLogSubmitBatch, AtLeastOne)
+{
+  // mds_log_submit_batch_max = 0 behaves as unbatched submission
+  auto q = make_queue(3);
+  std::list<PendingEvent> batch;
+  EXPECT_EQ(1u, MDLog::take_submit_batch(&q, &batch, 0));
+  EXPECT_EQ(1u, batch.size());
+  EXPECT_EQ(2u, q.size());
+}
@@ -0,0 +1,204 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "mds/OpenFileTable.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+typedef OFTLoadQueue::page_t page_t;
+
+page_t make_page(bool first, bool more, std::initializer_list<const char*> keys,
+		 int op_r = 0)
+{
+  page_t page;
+  page.op_r = op_r;
+  page.first = first;
+  page.more = more;
+  for (auto k : keys)
+    page.values[k];
+  return page;
+}
+
+// the keys of the pages handed out, in the order they were
+std::vector<std::string> pop_all(OFTLoadQueue& q, unsigned num_objs)
+{
+  std::vector<std::string> keys;
+  unsigned idx;
+  page_t page;
+  while (q.pop(num_objs, &idx, &page)) {
+    for (auto& [k, v] : page.values)
+      keys.push_back(std::to_string(idx) + "/" + k);
+  }
+  return keys;
+}
+
+}
+
+TEST(OFTLoadQueue, ReadsObjectsInParallel)
+{
+  OFTLoadQueue q;
+  q.start();
+  std::vector<unsigned> idxs;
+  // how many objects there are is only known from object 0's header
+  q.take_reads(1, 3, &idxs);
+  EXPECT_TRUE(idxs.empty());
+  EXPECT_FALSE(q.read_done(0, make_page(true, false, {"a"})));
+  EXPECT_EQ(std::vector<std::string>{"0/a"}, pop_all(q, 5));
+
+  q.take_reads(5, 3, &idxs);
+  EXPECT_EQ(std::vector<unsigned>({1, 2, 3}), idxs);
+  EXPECT_EQ(3u, q.num_in_flight());
+  idxs.clear();
+  q.take_reads(5, 3, &idxs);
+  EXPECT_TRUE(idxs.empty());
+}
+
+TEST(OFTLoadQueue, AppliesInObjectOrder)
+{
+  OFTLoadQueue q;
+  q.start();
+  EXPECT_FALSE(q.read_done(0, make_page(true, false, {"a"})));
+  EXPECT_EQ(std::vector<std::string>{"0/a"}, pop_all(q, 4));
+  std::vector<unsigned> idxs;
+  q.take_reads(4, 2, &idxs);
+  ASSERT_EQ(std::vector<unsigned>({1, 2}), idxs);
+
+  // object 2 completes first, and is held until object 1 is applied
+  EXPECT_FALSE(q.read_done(2, make_page(true, false, {"c"})));
+  EXPECT_TRUE(pop_all(q, 4).empty());
+  idxs.clear();
+  q.take_reads(4, 2, &idxs);
+  ASSERT_EQ(std::vector<unsigned>{3}, idxs);
+
+  // object 1 has a second page; the first one is applied meanwhile
+  EXPECT_TRUE(q.read_done(1, make_page(true, true, {"b1"})));
+  EXPECT_EQ(std::vector<std::string>{"1/b1"}, pop_all(q, 4));
+  EXPECT_FALSE(q.read_done(3, make_page(true, false, {"d"})));
+  EXPECT_TRUE(pop_all(q, 4).empty());
+  EXPECT_FALSE(q.read_done(1, make_page(false, false, {"b2"})));
+  EXPECT_EQ(std::vector<std::string>({"1/b2", "2/c", "3/d"}), pop_all(q, 4));
+
+  EXPECT_TRUE(q.is_done(4));
+  EXPECT_EQ(0u, q.num_in_flight());
+  EXPECT_EQ(0, q.get_error());
+}
+
+TEST(OFTLoadQueue, NoPastTheLastObject)
+{
+  OFTLoadQueue q;
+  q.start();
+  EXPECT_FALSE(q.read_done(0, make_page(true, false, {"a"})));
+  EXPECT_EQ(std::vector<std::string>{"0/a"}, pop_all(q, 1));
+  EXPECT_TRUE(q.is_done(1));
+  std::vector<unsigned> idxs;
+  q.take_reads(1, 8, &idxs);
+  EXPECT_TRUE(idxs.empty());
+}
+
+TEST(OFTLoadQueue, EmptyPageEndsTheObject)
+{
+  // a page claiming more without any key cannot be continued from
+  OFTLoadQueue q;
+  q.start();
+  EXPECT_FALSE(q.read_done(0, make_page(true, true, {})));
+  unsigned idx;
+  page_t page;
+  ASSERT_TRUE(q.pop(2, &idx, &page));
+  EXPECT_FALSE(page.more);
+  EXPECT_FALSE(q.is_done(2));
+}
+
+TEST(OFTLoadQueue, FailedReadWaitsForReadsInFlight)
+{
+  OFTLoadQueue q;
+  q.start();
+  EXPECT_FALSE(q.read_done(0, make_page(true, false, {"a"})));
+  EXPECT_EQ(std::vector<std::string>{"0/a"}, pop_all(q, 4));
+  std::vector<unsigned> idxs;
+  q.take_reads(4, 2, &idxs);
+  ASSERT_EQ(std::vector<unsigned>({1, 2}), idxs);
+
+  EXPECT_FALSE(q.read_done(1, make_page(true, false, {}, -EIO)));
+  unsigned idx;
+  page_t page;
+  ASSERT_TRUE(q.pop(4, &idx, &page));
+  EXPECT_EQ(1u, idx);
+  EXPECT_EQ(-EIO, page.op_r);
+  q.fail(page.op_r);
+  EXPECT_TRUE(q.is_done(4));
+
+  // nothing more is read or handed out, but object 2 is still in flight
+  idxs.clear();
+  q.take_reads(4, 2, &idxs);
+  EXPECT_TRUE(idxs.empty());
+  EXPECT_EQ(1u, q.num_in_flight());
+  EXPECT_FALSE(q.read_done(2, make_page(true, true, {"c"})));
+  EXPECT_EQ(0u, q.num_in_flight());
+  EXPECT_FALSE(q.pop(4, &idx, &page));
+  EXPECT_EQ(-EIO, q.get_error());
+}
+
+TEST(OFTLoadQueue, FirstErrorSticks)
+{
+  OFTLoadQueue q;
+  q.start();
+  q.fail(-EINVAL);
+  q.fail(-EIO);
+  EXPECT_EQ(-EINVAL, q.get_error());
+}
+
+TEST(OFTWriteQueue, IssuesInQueueOrder)
+{
+  OFTWriteQueue q;
+  ObjectOperation op;
+  // two commits, each writing to objects 0 and 1
+  for (unsigned idx : {0, 1, 0, 1, 2})
+    q.push(idx, op, nullptr);
+
+  std::list<OFTWriteQueue::write_t> issued;
+  q.take(2, &issued);
+  EXPECT_EQ(2u, issued.size());
+  EXPECT_EQ(3u, q.num_queued());
+  q.take(2, &issued);
+  EXPECT_EQ(2u, issued.size());
+
+  // completions free slots in any order; writes still go out in order
+  q.finish();
+  q.take(2, &issued);
+  EXPECT_EQ(3u, issued.size());
+  q.finish();
+  q.take(2, &issued);
+  EXPECT_EQ(4u, issued.size());
+  q.finish();
+  q.take(2, &issued);
+  ASSERT_EQ(5u, issued.size());
+  EXPECT_EQ(0u, q.num_queued());
+  EXPECT_EQ(2u, q.num_in_flight());
+
+  std::vector<unsigned> order;
+  for (auto& w : issued)
+    order.push_back(w.idx);
+  EXPECT_EQ(std::vector<unsigned>({0, 1, 0, 1, 2}), order);
+}
+
+TEST(OFTWriteQueue, ZeroIsUnbounded)
+{
+  OFTWriteQueue q;
+  ObjectOperation op;
+  for (unsigned idx = 0; idx < 100; ++idx)
+    q.push(idx, op, nullptr);
+  std::list<OFTWriteQueue::write_t> issued;
+  q.take(0, &issued);
+  EXPECT_EQ(100u, issued.size());
+  EXPECT_EQ(100u, q.num_in_flight());
+}
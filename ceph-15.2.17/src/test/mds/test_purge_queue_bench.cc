@@ -0,0 +1,311 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Measure how fast a purge queue drains a backlog of deleted files.
+ *
+ * Writes --files files of --objects objects each into --data-pool, pushes
+ * a purge item for every file into a purge queue journaled in
+ * --metadata-pool, and reports the files and objects purged per second.
+ * Neither pool needs to belong to a file system. Compare purge settings
+ * by passing them on the command line, e.g.
+ * --mds_max_purge_files_adaptive=1024.
+ */
+
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "include/rados/librados.hpp"
+#include "mds/PurgeQueue.h"
+#include "mon/MonClient.h"
+#include "msg/Messenger.h"
+#include "osdc/Objecter.h"
+
+#define dout_subsys ceph_subsys_mds
+
+namespace {
+
+void usage()
+{
+  std::cout << "usage: ceph_test_mds_purge_queue_bench [options]\n"
+            << "  --data-pool <name>      pool of the files (default purge-bench-data)\n"
+            << "  --metadata-pool <name>  pool of the purge queue (default purge-bench-meta)\n"
+            << "  --files <n>             number of files to purge (default 10000)\n"
+            << "  --objects <n>           objects per file (default 1)\n"
+            << "  --max-writes <n>        concurrent writes while filling (default 64)\n";
+  generic_client_usage();
+}
+
+const inodeno_t first_ino = 0x10000000000ull;
+
+std::string object_name(inodeno_t ino, uint64_t objectno)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%llx.%08llx", (long long unsigned)ino,
+	   (long long unsigned)objectno);
+  return buf;
+}
+
+int write_objects(librados::IoCtx& ioctx, int num_files, int num_objects,
+		  size_t max_writes)
+{
+  std::deque<librados::AioCompletion*> pending;
+  int ret = 0;
+  auto reap = [&]() {
+    auto c = pending.front();
+    c->wait_for_complete();
+    if (c->get_return_value() < 0) {
+      ret = c->get_return_value();
+    }
+    c->release();
+    pending.pop_front();
+  };
+  for (int f = 0; f < num_files && ret == 0; ++f) {
+    for (int o = 0; o < num_objects; ++o) {
+      if (pending.size() >= max_writes) {
+	reap();
+      }
+      librados::ObjectWriteOperation op;
+      op.create(false);
+      auto c = librados::Rados::aio_create_completion(nullptr, nullptr);
+      int r = ioctx.aio_operate(object_name(first_ino + f, o), c, &op);
+      if (r < 0) {
+	c->release();
+	ret = r;
+	break;
+      }
+      pending.push_back(c);
+    }
+  }
+  while (!pending.empty()) {
+    reap();
+  }
+  return ret;
+}
+
+int open_pool(librados::Rados& rados, const std::string& pool,
+	      librados::IoCtx& ioctx)
+{
+  int r = rados.pool_create(pool.c_str());
+  if (r < 0 && r != -EEXIST) {
+    std::cerr << "failed to create pool " << pool << ": " << cpp_strerror(r) << std::endl;
+    return r;
+  }
+  r = rados.ioctx_create(pool.c_str(), ioctx);
+  if (r < 0) {
+    std::cerr << "failed to open pool " << pool << ": " << cpp_strerror(r) << std::endl;
+  }
+  return r;
+}
+
+// an Objecter of our own, as the purge queue of an MDS uses its MDS's
+class ObjecterClient {
+public:
+  ObjecterClient()
+    : monc(g_ceph_context),
+      messenger(Messenger::create_client_messenger(g_ceph_context,
+						   "purge_bench")),
+      objecter(g_ceph_context, messenger, &monc, nullptr) {}
+  ~ObjecterClient() {
+    if (started) {
+      objecter.shutdown();
+      monc.shutdown();
+      messenger->shutdown();
+      messenger->wait();
+    }
+    delete messenger;
+  }
+
+  int init() {
+    messenger->start();
+    objecter.set_client_incarnation(0);
+    objecter.init();
+    messenger->add_dispatcher_tail(&objecter);
+    started = true;
+
+    int r = monc.build_initial_monmap();
+    if (r < 0) {
+      return r;
+    }
+    monc.set_want_keys(CEPH_ENTITY_TYPE_MON|CEPH_ENTITY_TYPE_OSD);
+    monc.set_messenger(messenger);
+    monc.init();
+    r = monc.authenticate();
+    if (r < 0) {
+      return r;
+    }
+    messenger->set_myname(entity_name_t::CLIENT(monc.get_global_id()));
+    objecter.start();
+    objecter.wait_for_osd_map();
+    return 0;
+  }
+
+  Objecter *get() {
+    return &objecter;
+  }
+
+private:
+  MonClient monc;
+  Messenger *messenger;
+  Objecter objecter;
+  bool started = false;
+};
+
+} // anonymous namespace
+
+int main(int argc, const char **argv)
+{
+  std::vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY, 0);
+
+  std::string data_pool = "purge-bench-data";
+  std::string metadata_pool = "purge-bench-meta";
+  int num_files = 10000;
+  int num_objects = 1;
+  int max_writes = 64;
+  std::string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--data-pool", (char*)NULL)) {
+      data_pool = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--metadata-pool", (char*)NULL)) {
+      metadata_pool = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--files", (char*)NULL)) {
+      num_files = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--objects", (char*)NULL)) {
+      num_objects = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--max-writes", (char*)NULL)) {
+      max_writes = atoi(val.c_str());
+    } else {
+      std::cerr << "unrecognized arg " << *i << std::endl;
+      usage();
+      exit(1);
+    }
+  }
+  if (num_files <= 0 || num_objects <= 0 || max_writes <= 0) {
+    std::cerr << "--files, --objects and --max-writes must be positive" << std::endl;
+    exit(1);
+  }
+
+  common_init_finish(g_ceph_context);
+
+  librados::Rados rados;
+  int r = rados.init_with_context(g_ceph_context);
+  if (r == 0) {
+    r = rados.connect();
+  }
+  if (r < 0) {
+    std::cerr << "failed to connect: " << cpp_strerror(r) << std::endl;
+    return -r;
+  }
+  librados::IoCtx data_ioctx, meta_ioctx;
+  r = open_pool(rados, data_pool, data_ioctx);
+  if (r == 0) {
+    r = open_pool(rados, metadata_pool, meta_ioctx);
+  }
+  if (r < 0) {
+    return -r;
+  }
+
+  auto start = ceph::mono_clock::now();
+  r = write_objects(data_ioctx, num_files, num_objects, max_writes);
+  if (r < 0) {
+    std::cerr << "failed to write objects: " << cpp_strerror(r) << std::endl;
+    return -r;
+  }
+  double fill_secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+  std::cout << "backlog: " << num_files << " files of " << num_objects
+            << " objects, " << fill_secs << " s" << std::endl;
+
+  ObjecterClient client;
+  r = client.init();
+  if (r < 0) {
+    std::cerr << "failed to start objecter: " << cpp_strerror(r) << std::endl;
+    return -r;
+  }
+
+  std::atomic<int> error = 0;
+  PurgeQueue pq(g_ceph_context, 0, meta_ioctx.get_id(), client.get(),
+		new LambdaContext([&error](int r) { error = r; }));
+  pq.create_logger();
+  pq.init();
+  {
+    C_SaferCond cond;
+    pq.create(&cond);
+    r = cond.wait();
+    if (r < 0) {
+      std::cerr << "failed to create purge queue: " << cpp_strerror(r) << std::endl;
+      pq.shutdown();
+      return -r;
+    }
+  }
+  // the op limit follows the PG count of the data pools
+  MDSMap mds_map;
+  mds_map.add_data_pool(data_ioctx.get_id());
+  mds_map.set_max_mds(1);
+  pq.update_op_limit(mds_map);
+
+  file_layout_t layout = file_layout_t::get_default();
+  layout.pool_id = data_ioctx.get_id();
+
+  start = ceph::mono_clock::now();
+  C_GatherBuilder pushed(g_ceph_context);
+  for (int f = 0; f < num_files; ++f) {
+    PurgeItem item;
+    item.action = PurgeItem::PURGE_FILE;
+    item.ino = first_ino + f;
+    item.size = uint64_t(num_objects) * layout.object_size;
+    item.layout = layout;
+    item.stamp = ceph_clock_now();
+    pq.push(item, pushed.new_sub());
+  }
+  C_SaferCond pushed_cond;
+  pushed.set_finisher(&pushed_cond);
+  pushed.activate();
+  r = pushed_cond.wait();
+  if (r < 0) {
+    std::cerr << "failed to push purge items: " << cpp_strerror(r) << std::endl;
+    pq.shutdown();
+    return -r;
+  }
+  while (!pq.is_idle() && error == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  double purge_secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+  pq.shutdown();
+  if (error < 0) {
+    std::cerr << "purge queue failed: " << cpp_strerror(error) << std::endl;
+    return -error;
+  }
+
+  std::cout << "purged " << num_files << " files in " << purge_secs << " s: "
+            << num_files / purge_secs << " files/s, "
+            << uint64_t(num_files) * num_objects / purge_secs << " objects/s"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,249 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "global/global_context.h"
+#include "mgr/MetricsExporter.h"
+
+#include "gtest/gtest.h"
+
+static void add_counter(PerfCounterTypes& types, DaemonPerfCounters& counters,
+			const std::string& path, perfcounter_type_d type,
+			uint64_t v, uint64_t c = 0)
+{
+  PerfCounterType t;
+  t.path = path;
+  t.description = path + " desc";
+  t.type = type;
+  t.unit = UNIT_NONE;
+  types[path] = t;
+  auto i = counters.instances.emplace(path, type).first;
+  if (type & PERFCOUNTER_LONGRUNAVG) {
+    i->second.push_avg(utime_t(), v, c);
+  } else {
+    i->second.push(utime_t(), v);
+  }
+}
+
+// a loopback port that is free right now
+static int free_port()
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -errno;
+  }
+  struct sockaddr_in sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(sa);
+  int r = 0;
+  if (::bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 ||
+      ::getsockname(fd, (struct sockaddr*)&sa, &len) < 0) {
+    r = -errno;
+  }
+  ::close(fd);
+  return r < 0 ? r : ntohs(sa.sin_port);
+}
+
+// update() only renders samples while the exporter is serving
+static int start_serving(MetricsExporter& exporter)
+{
+  int port = free_port();
+  if (port < 0) {
+    return port;
+  }
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("mgr_metrics_exporter_addr", "127.0.0.1");
+  conf.set_val_or_die("mgr_metrics_exporter_port", std::to_string(port));
+  return exporter.init();
+}
+
+TEST(MetricsExporter, metric_name)
+{
+  EXPECT_EQ("ceph_osd_op_r", MetricsExporter::metric_name("osd.op_r"));
+  EXPECT_EQ("ceph_rocksdb_submit_latency",
+	    MetricsExporter::metric_name("rocksdb.submit-latency"));
+  EXPECT_EQ("ceph_throttle_msgr_dispatch_throttler_get",
+	    MetricsExporter::metric_name("throttle-msgr_dispatch_throttler.get"));
+  EXPECT_EQ("ceph_finisher_commit_queue_len",
+	    MetricsExporter::metric_name("finisher::commit/queue_len"));
+  EXPECT_EQ("ceph_paxos_sync_plus_minus",
+	    MetricsExporter::metric_name("paxos.sync+-"));
+}
+
+TEST(MetricsExporter, groups_families)
+{
+  MetricsExporter exporter(g_ceph_context);
+  ASSERT_EQ(0, start_serving(exporter));
+  PerfCounterTypes types;
+  for (int osd = 0; osd < 2; ++osd) {
+    DaemonPerfCounters counters(types);
+    add_counter(types, counters, "osd.op_r",
+		perfcounter_type_d(PERFCOUNTER_U64 | PERFCOUNTER_COUNTER),
+		10 + osd);
+    add_counter(types, counters, "osd.numpg", PERFCOUNTER_U64, 100);
+    add_counter(types, counters, "osd.op_r_latency",
+		perfcounter_type_d(PERFCOUNTER_TIME | PERFCOUNTER_LONGRUNAVG),
+		1500000000, 3);
+    exporter.update(DaemonKey{"osd", std::to_string(osd)}, counters);
+  }
+
+  std::string out;
+  exporter.dump(&out);
+  EXPECT_EQ(
+    "# HELP ceph_osd_numpg osd.numpg desc\n"
+    "# TYPE ceph_osd_numpg gauge\n"
+    "ceph_osd_numpg{ceph_daemon=\"osd.0\"} 100\n"
+    "ceph_osd_numpg{ceph_daemon=\"osd.1\"} 100\n"
+    "# HELP ceph_osd_op_r osd.op_r desc\n"
+    "# TYPE ceph_osd_op_r counter\n"
+    "ceph_osd_op_r{ceph_daemon=\"osd.0\"} 10\n"
+    "ceph_osd_op_r{ceph_daemon=\"osd.1\"} 11\n"
+    "# HELP ceph_osd_op_r_latency_sum osd.op_r_latency desc Total\n"
+    "# TYPE ceph_osd_op_r_latency_sum counter\n"
+    "ceph_osd_op_r_latency_sum{ceph_daemon=\"osd.0\"} 1.500000000\n"
+    "ceph_osd_op_r_latency_sum{ceph_daemon=\"osd.1\"} 1.500000000\n"
+    "# HELP ceph_osd_op_r_latency_count osd.op_r_latency desc Count\n"
+    "# TYPE ceph_osd_op_r_latency_count counter\n"
+    "ceph_osd_op_r_latency_count{ceph_daemon=\"osd.0\"} 3\n"
+    "ceph_osd_op_r_latency_count{ceph_daemon=\"osd.1\"} 3\n",
+    out);
+
+  exporter.remove(DaemonKey{"osd", "0"});
+  out.clear();
+  exporter.dump(&out);
+  EXPECT_EQ(std::string::npos, out.find("osd.0"));
+  EXPECT_NE(std::string::npos, out.find("osd.1"));
+}
+
+TEST(MetricsExporter, skips_low_priority_and_histograms)
+{
+  MetricsExporter exporter(g_ceph_context);
+  ASSERT_EQ(0, start_serving(exporter));
+  PerfCounterTypes types;
+  DaemonPerfCounters counters(types);
+  add_counter(types, counters, "osd.hist",
+	      perfcounter_type_d(PERFCOUNTER_U64 | PERFCOUNTER_HISTOGRAM), 1);
+  add_counter(types, counters, "osd.debug", PERFCOUNTER_U64, 1);
+  types["osd.debug"].priority = PerfCountersBuilder::PRIO_DEBUGONLY;
+  exporter.update(DaemonKey{"osd", "0"}, counters);
+
+  std::string out;
+  exporter.dump(&out);
+  EXPECT_EQ("", out);
+}
+
+TEST(MetricsExporter, idle_unless_serving)
+{
+  MetricsExporter exporter(g_ceph_context);
+  PerfCounterTypes types;
+  DaemonPerfCounters counters(types);
+  add_counter(types, counters, "osd.numpg", PERFCOUNTER_U64, 100);
+  exporter.update(DaemonKey{"osd", "0"}, counters);
+
+  std::string out;
+  exporter.dump(&out);
+  EXPECT_EQ("", out);
+}
+
+TEST(MetricsExporter, exports_the_services_the_module_does)
+{
+  MetricsExporter exporter(g_ceph_context);
+  ASSERT_EQ(0, start_serving(exporter));
+  PerfCounterTypes types;
+  DaemonPerfCounters counters(types);
+  add_counter(types, counters, "objecter.op", PERFCOUNTER_U64, 1);
+  for (auto type : {"mds", "mon", "osd", "rbd-mirror", "rgw", "tcmu-runner",
+		    "mgr", "client"}) {
+    exporter.update(DaemonKey{type, "a"}, counters);
+  }
+
+  std::string out;
+  exporter.dump(&out);
+  EXPECT_EQ(
+    "# HELP ceph_objecter_op objecter.op desc\n"
+    "# TYPE ceph_objecter_op gauge\n"
+    "ceph_objecter_op{ceph_daemon=\"mds.a\"} 1\n"
+    "ceph_objecter_op{ceph_daemon=\"mon.a\"} 1\n"
+    "ceph_objecter_op{ceph_daemon=\"osd.a\"} 1\n"
+    "ceph_objecter_op{ceph_daemon=\"rbd-mirror.a\"} 1\n"
+    "ceph_objecter_op{ceph_daemon=\"rgw.a\"} 1\n"
+    "ceph_objecter_op{ceph_daemon=\"tcmu-runner.a\"} 1\n",
+    out);
+}
+
+TEST(MetricsExporter, path_labels)
+{
+  std::string path, labels;
+  MetricsExporter::path_labels("osd.0", "osd.op_r", &path, &labels);
+  EXPECT_EQ("osd.op_r", path);
+  EXPECT_EQ("{ceph_daemon=\"osd.0\"}", labels);
+
+  // as _perfpath_to_path_labels() in mgr_module.py
+  MetricsExporter::path_labels("rbd-mirror.a",
+			       "rbd_mirror_image_rbd/img.replay_bytes",
+			       &path, &labels);
+  EXPECT_EQ("rbd_mirror_image_replay_bytes", path);
+  EXPECT_EQ("{ceph_daemon=\"rbd-mirror.a\",pool=\"rbd\",namespace=\"\","
+	    "image=\"img\"}", labels);
+  MetricsExporter::path_labels("rbd-mirror.a",
+			       "rbd_mirror_image_rbd/ns/img.v2.replay",
+			       &path, &labels);
+  EXPECT_EQ("rbd_mirror_image_replay", path);
+  EXPECT_EQ("{ceph_daemon=\"rbd-mirror.a\",pool=\"rbd\",namespace=\"ns\","
+	    "image=\"img.v2\"}", labels);
+  MetricsExporter::path_labels("rbd-mirror.a",
+			       "rbd_mirror_image_rbd/ns/sub/img.replay_latency",
+			       &path, &labels);
+  EXPECT_EQ("rbd_mirror_image_replay_latency", path);
+  EXPECT_EQ("{ceph_daemon=\"rbd-mirror.a\",pool=\"rbd\",namespace=\"ns\","
+	    "image=\"sub/img\"}", labels);
+
+  // other counters, and other daemons, keep their path
+  for (auto [daemon, counter] : {
+	 std::pair{"rbd-mirror.a", "rbd_mirror_image_rbd/img.other"},
+	 std::pair{"rbd-mirror.a", "rbd_mirror_image_noslash.replay"},
+	 std::pair{"osd.0", "rbd_mirror_image_rbd/img.replay"}}) {
+    MetricsExporter::path_labels(daemon, counter, &path, &labels);
+    EXPECT_EQ(counter, path);
+    EXPECT_EQ(std::string("{ceph_daemon=\"") + daemon + "\"}", labels);
+  }
+}
+
+TEST(MetricsExporter, rbd_mirror_images_share_a_family)
+{
+  MetricsExporter exporter(g_ceph_context);
+  ASSERT_EQ(0, start_serving(exporter));
+  PerfCounterTypes types;
+  DaemonPerfCounters counters(types);
+  add_counter(types, counters, "rbd_mirror_image_rbd/a.replay",
+	      perfcounter_type_d(PERFCOUNTER_U64 | PERFCOUNTER_COUNTER), 1);
+  add_counter(types, counters, "rbd_mirror_image_rbd/ns/b.replay",
+	      perfcounter_type_d(PERFCOUNTER_U64 | PERFCOUNTER_COUNTER), 2);
+  exporter.update(DaemonKey{"rbd-mirror", "x"}, counters);
+
+  std::string out;
+  exporter.dump(&out);
+  EXPECT_EQ(
+    "# HELP ceph_rbd_mirror_image_replay rbd_mirror_image_rbd/a.replay desc\n"
+    "# TYPE ceph_rbd_mirror_image_replay counter\n"
+    "ceph_rbd_mirror_image_replay{ceph_daemon=\"rbd-mirror.x\",pool=\"rbd\","
+    "namespace=\"\",image=\"a\"} 1\n"
+    "ceph_rbd_mirror_image_replay{ceph_daemon=\"rbd-mirror.x\",pool=\"rbd\","
+    "namespace=\"ns\",image=\"b\"} 2\n",
+    out);
+}
@@ -0,0 +1,164 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Feed MetricsExporter with synthetic reports from many daemons and time
+ * what a stats period of reports and a scrape cost.
+ */
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "common/ceph_argparse.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "mgr/MetricsExporter.h"
+
+using std::cout;
+using std::string;
+using std::vector;
+
+// a loopback port that is free right now
+static int free_port()
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -errno;
+  }
+  struct sockaddr_in sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(sa);
+  int r = 0;
+  if (::bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 ||
+      ::getsockname(fd, (struct sockaddr*)&sa, &len) < 0) {
+    r = -errno;
+  }
+  ::close(fd);
+  return r < 0 ? r : ntohs(sa.sin_port);
+}
+
+// update() only renders samples while the exporter is serving
+static int start_serving(MetricsExporter& exporter)
+{
+  int port = free_port();
+  if (port < 0) {
+    return port;
+  }
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("mgr_metrics_exporter_addr", "127.0.0.1");
+  conf.set_val_or_die("mgr_metrics_exporter_port", std::to_string(port));
+  return exporter.init();
+}
+
+static void usage()
+{
+  cout << "usage: ceph_test_mgr_metrics_exporter_bench [flags]\n"
+      "	 --daemons <n>\n"
+      "	       number of reporting daemons\n"
+      "	 --counters <n>\n"
+      "	       perf counters per daemon\n"
+      "	 --rounds <n>\n"
+      "	       stats periods to run; every daemon reports once in each\n"
+      << std::endl;
+  generic_client_usage();
+}
+
+int main(int argc, const char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  unsigned daemons = 3000, num_counters = 400, rounds = 5;
+  string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--daemons", (char*)nullptr)) {
+      daemons = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--counters", (char*)nullptr)) {
+      num_counters = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--rounds", (char*)nullptr)) {
+      rounds = std::max(1, atoi(val.c_str()));
+    } else {
+      std::cerr << "unrecognized argument: " << *i << std::endl;
+      exit(1);
+    }
+  }
+  common_init_finish(g_ceph_context);
+
+  // one schema shared by all daemons, mixing the counter types osds use
+  PerfCounterTypes types;
+  const perfcounter_type_d kinds[] = {
+    perfcounter_type_d(PERFCOUNTER_U64 | PERFCOUNTER_COUNTER),
+    PERFCOUNTER_U64,
+    perfcounter_type_d(PERFCOUNTER_TIME | PERFCOUNTER_LONGRUNAVG),
+    perfcounter_type_d(PERFCOUNTER_U64 | PERFCOUNTER_LONGRUNAVG),
+  };
+  for (unsigned c = 0; c < num_counters; ++c) {
+    PerfCounterType t;
+    t.path = "bench.counter_" + std::to_string(c);
+    t.description = "synthetic counter " + std::to_string(c);
+    t.type = kinds[c % std::size(kinds)];
+    t.unit = UNIT_NONE;
+    types[t.path] = t;
+  }
+  vector<DaemonPerfCounters> counters(daemons, DaemonPerfCounters(types));
+
+  MetricsExporter exporter(g_ceph_context);
+  int r = start_serving(exporter);
+  if (r < 0) {
+    std::cerr << "unable to start serving: " << cpp_strerror(r) << std::endl;
+    return 1;
+  }
+  std::mt19937_64 gen(1);
+  std::string out;
+  for (unsigned r = 0; r < rounds; ++r) {
+    std::chrono::duration<double> report_time{};
+    for (unsigned d = 0; d < daemons; ++d) {
+      auto& dc = counters[d];
+      const auto now = ceph_clock_now();
+      for (auto& [path, t] : types) {
+	auto i = dc.instances.emplace(path, t.type).first;
+	if (t.type & PERFCOUNTER_LONGRUNAVG) {
+	  i->second.push_avg(now, gen() >> 20, gen() >> 40);
+	} else {
+	  i->second.push(now, gen() >> 20);
+	}
+      }
+      auto start = ceph::mono_clock::now();
+      exporter.update(DaemonKey{"osd", std::to_string(d)}, dc);
+      report_time += ceph::mono_clock::now() - start;
+    }
+
+    out.clear();
+    auto start = ceph::mono_clock::now();
+    exporter.dump(&out);
+    std::chrono::duration<double> scrape_time = ceph::mono_clock::now() - start;
+    cout << "round " << r << ": " << report_time.count() * 1000000 / daemons
+	 << " us per report, scrape " << scrape_time.count() * 1000
+	 << " ms for " << out.size() << " bytes" << std::endl;
+  }
+  return 0;
+}
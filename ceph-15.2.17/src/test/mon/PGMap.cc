@@ -14,6 +14,8 @@
 #include "mon/PGMap.h"
 #include "gtest/gtest.h"
 
+#include "common/Formatter.h"
+#include "global/global_context.h"
 #include "include/stringify.h"
 
 
@@ -166,3 +168,98 @@ TEST(pgmap, dump_object_stat_sum_2)
   ASSERT_EQ(percentify(0), tbl.get(0, col++));
   ASSERT_EQ(stringify(byte_u_t(avail/pool.size)), tbl.get(0, col++));
 }
+
+namespace {
+  pg_stat_t random_pg_stat(unsigned seed)
+  {
+    pg_stat_t s;
+    s.state = (seed % 3) ? (PG_STATE_ACTIVE | PG_STATE_CLEAN) : PG_STATE_PEERING;
+    s.stats.sum.num_objects = seed % 1000;
+    s.stats.sum.num_bytes = (seed % 1000) << 22;
+    s.stats.sum.num_rd = seed;
+    s.stats.sum.num_wr = seed * 2;
+    s.log_size = seed % 3000;
+    s.ondisk_log_size = s.log_size;
+    for (int i = 0; i < 3; i++) {
+      s.up.push_back((seed + i) % 16);
+      s.acting.push_back((seed + i + (seed % 5 == 0)) % 16);
+    }
+    s.up_primary = s.acting_primary = s.acting[0];
+    return s;
+  }
+
+  std::string dump_sums(const PGMap& pg_map, const std::set<int64_t>& pools)
+  {
+    JSONFormatter f;
+    f.open_object_section("sums");
+    f.open_object_section("pg_sum");
+    pg_map.pg_sum.dump(&f);
+    f.close_section();
+    for (auto pool : pools) {
+      f.open_object_section(stringify(pool).c_str());
+      pg_map.get_pg_pool_sum_stat(pool).dump(&f);
+      f.close_section();
+    }
+    f.close_section();
+    std::ostringstream ss;
+    f.flush(ss);
+    return ss.str();
+  }
+}
+
+TEST(pgmap, apply_incremental_parallel)
+{
+  auto& conf = g_ceph_context->_conf;
+  PGMap serial, parallel;
+  std::set<int64_t> pools;
+  for (unsigned round = 0; round < 4; round++) {
+    PGMap::Incremental inc;
+    inc.version = serial.version + 1;
+    inc.stamp = utime_t(round + 1, 0);
+    for (unsigned pool = 1; pool <= 5; pool++) {
+      pools.insert(pool);
+      // later rounds update a subset of the existing pgs and add new ones
+      for (unsigned ps = round * 16; ps < 64 * pool; ps += round + 1) {
+	pg_t pgid(ps, pool);
+	pg_stat_t& s = inc.pg_stat_updates[pgid] = random_pg_stat(ps * 7 + round);
+	if (ps % 11 == 0) {
+	  s.state |= PG_STATE_CREATING;
+	}
+	// most pgs stay on their osds and only change state
+	if (auto p = serial.pg_stat.find(pgid);
+	    p != serial.pg_stat.end() && ps % 4 != 0) {
+	  s.up = p->second.up;
+	  s.acting = p->second.acting;
+	  s.up_primary = p->second.up_primary;
+	  s.acting_primary = p->second.acting_primary;
+	}
+      }
+    }
+    if (round == 3) {
+      inc.pg_remove.insert(pg_t(0, 1));
+      inc.pg_remove.insert(pg_t(1, 2));
+    }
+
+    conf.set_val("mgr_pgmap_apply_threads", "1");
+    serial.apply_incremental(g_ceph_context, inc);
+    conf.set_val("mgr_pgmap_apply_threads", "7");
+    conf.set_val("mgr_pgmap_apply_parallel_min", "1");
+    parallel.apply_incremental(g_ceph_context, inc);
+
+    ASSERT_EQ(dump_sums(serial, pools), dump_sums(parallel, pools));
+    ASSERT_EQ(serial.num_pg, parallel.num_pg);
+    ASSERT_EQ(serial.num_pg_by_state, parallel.num_pg_by_state);
+    ASSERT_EQ(serial.num_pg_by_pool_state, parallel.num_pg_by_pool_state);
+    ASSERT_EQ(serial.num_pg_active, parallel.num_pg_active);
+    ASSERT_EQ(serial.num_pg_unknown, parallel.num_pg_unknown);
+    ASSERT_EQ(serial.pg_by_osd, parallel.pg_by_osd);
+    ASSERT_EQ(serial.creating_pgs, parallel.creating_pgs);
+    for (int osd = 0; osd < 16; osd++) {
+      ASSERT_EQ(serial.get_num_pg_by_osd(osd), parallel.get_num_pg_by_osd(osd));
+      ASSERT_EQ(serial.get_num_primary_pg_by_osd(osd),
+		parallel.get_num_primary_pg_by_osd(osd));
+    }
+  }
+  conf.rm_val("mgr_pgmap_apply_threads");
+  conf.rm_val("mgr_pgmap_apply_parallel_min");
+}
@@ -0,0 +1,244 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "include/Context.h"
+#include "mon/PaxosPipeline.h"
+
+#include "gtest/gtest.h"
+
+using std::set;
+
+namespace {
+
+const int leader = 0;
+const set<int> quorum = {0, 1, 2};
+
+struct C_Count : public Context {
+  int *count;
+  explicit C_Count(int *c) : count(c) {}
+  void finish(int r) override {
+    ++*count;
+  }
+};
+
+// Drives the Leader's side of the pipeline the way Paxos does, with
+// paxos_pipeline_depth = 3: the head is in new_value/accepted, the rest in
+// the pipeline.
+struct Leader {
+  PaxosPipeline pipeline;
+  version_t last_committed = 10;
+  set<int> accepted;	// of the head
+  bool committing = false;
+
+  // the Peons tagged their accepts of the head with a version, and with
+  // the last_committed they had then
+  void begin_head() {
+    accepted = {leader};
+    for (int peon : {1, 2}) {
+      pipeline.note_peer(peon, last_committed);
+      accepted.insert(peon);
+    }
+  }
+  version_t begin_pipelined() {
+    version_t v = pipeline.next_version(last_committed);
+    pipeline.add(v, leader);
+    return v;
+  }
+  void maybe_commit() {
+    if (!committing &&
+	pipeline.head_committable(accepted, quorum, last_committed)) {
+      committing = true;
+      pipeline.head_committing();
+    }
+  }
+  // commit_finish(): the head is committed, the next one takes its place
+  void commit_finish() {
+    ASSERT_TRUE(committing);
+    committing = false;
+    ++last_committed;
+    if (!pipeline.empty()) {
+      auto pv = pipeline.pop_head(last_committed);
+      accepted.swap(pv.accepted);
+      maybe_commit();
+    }
+  }
+};
+
+} // anonymous namespace
+
+TEST(PaxosPipeline, versions_follow_the_head)
+{
+  PaxosPipeline p;
+  ASSERT_TRUE(p.empty());
+  EXPECT_EQ(12u, p.next_version(10));
+  p.add(12, leader);
+  EXPECT_EQ(13u, p.next_version(10));
+  p.add(13, leader);
+  EXPECT_EQ(2u, p.size());
+  EXPECT_EQ(set<int>{leader}, p.get_accepted(12));
+  EXPECT_TRUE(p.accept(13, 1));
+  EXPECT_EQ(set<int>({leader, 1}), p.get_accepted(13));
+  // not in flight behind the head
+  EXPECT_FALSE(p.accept(11, 1));
+  EXPECT_FALSE(p.accept(14, 1));
+}
+
+TEST(PaxosPipeline, peers_ready)
+{
+  PaxosPipeline p;
+  EXPECT_FALSE(p.peers_ready(quorum, leader));
+  p.note_peer(1, 10);
+  EXPECT_FALSE(p.peers_ready(quorum, leader));
+  // a lease ack does not tell us the Peon handles pipelined begins
+  p.note_lease_ack(2, 10);
+  EXPECT_FALSE(p.peers_ready(quorum, leader));
+  p.note_peer(2, 10);
+  EXPECT_TRUE(p.peers_ready(quorum, leader));
+  EXPECT_TRUE(p.peers_ready({leader}, leader));
+}
+
+TEST(PaxosPipeline, unpipelined_head_commits_once_accepted)
+{
+  PaxosPipeline p;
+  p.note_peer(1, 5);
+  p.note_peer(2, 5);
+  // the peers being behind only matters for a pipelined head
+  EXPECT_FALSE(p.head_committable({0, 1}, quorum, 10));
+  EXPECT_TRUE(p.head_committable(quorum, quorum, 10));
+}
+
+TEST(PaxosPipeline, pipelined_head_waits_for_peers_to_commit)
+{
+  PaxosPipeline p;
+  p.note_peer(1, 10);
+  p.note_peer(2, 10);
+  p.add(12, leader);
+  ASSERT_TRUE(p.accept(12, 1));
+  ASSERT_TRUE(p.accept(12, 2));
+
+  // 11 committed; 12 becomes the head
+  auto pv = p.pop_head(11);
+  EXPECT_TRUE(p.is_head_pipelined());
+  EXPECT_EQ(quorum, pv.accepted);
+  EXPECT_FALSE(p.head_committable(pv.accepted, quorum, 11));
+
+  p.note_lease_ack(1, 11);
+  EXPECT_FALSE(p.head_committable(pv.accepted, quorum, 11));
+  // a stale report does not move a peer backwards
+  p.note_peer(1, 9);
+  p.note_lease_ack(2, 11);
+  EXPECT_TRUE(p.head_committable(pv.accepted, quorum, 11));
+
+  // a peer that left the quorum does not hold the head back
+  p.note_peer(3, 1);
+  EXPECT_TRUE(p.head_committable(pv.accepted, quorum, 11));
+
+  p.head_committing();
+  EXPECT_FALSE(p.is_head_pipelined());
+}
+
+TEST(PaxosPipeline, steady_state_commits_through_lease_acks)
+{
+  Leader l;
+  l.begin_head();
+  version_t v12 = l.begin_pipelined();
+  version_t v13 = l.begin_pipelined();
+  ASSERT_EQ(12u, v12);
+  ASSERT_EQ(13u, v13);
+  l.maybe_commit();
+  ASSERT_TRUE(l.committing);
+
+  // the Peons accept the pipelined values before they see 11 commit, so
+  // their accepts carry last_committed = 10
+  for (int peon : {1, 2}) {
+    l.pipeline.note_peer(peon, 10);
+    ASSERT_TRUE(l.pipeline.accept(v12, peon));
+    ASSERT_TRUE(l.pipeline.accept(v13, peon));
+  }
+
+  // 11 commits; 12 is accepted by everyone but waits for the Peons to
+  // commit 11, which no further accept will tell us
+  l.commit_finish();
+  ASSERT_EQ(11u, l.last_committed);
+  EXPECT_FALSE(l.committing);
+  EXPECT_TRUE(l.pipeline.is_head_pipelined());
+  EXPECT_EQ(1u, l.pipeline.size());
+
+  // the lease that went out with the commit is acked with their new lc
+  l.pipeline.note_lease_ack(1, 11);
+  l.maybe_commit();
+  EXPECT_FALSE(l.committing);
+  l.pipeline.note_lease_ack(2, 11);
+  l.maybe_commit();
+  ASSERT_TRUE(l.committing);
+
+  l.commit_finish();
+  ASSERT_EQ(12u, l.last_committed);
+  EXPECT_TRUE(l.pipeline.empty());
+  EXPECT_FALSE(l.committing);
+  for (int peon : {1, 2}) {
+    l.pipeline.note_lease_ack(peon, 12);
+  }
+  l.maybe_commit();
+  ASSERT_TRUE(l.committing);
+
+  l.commit_finish();
+  EXPECT_EQ(13u, l.last_committed);
+  EXPECT_TRUE(l.pipeline.empty());
+  EXPECT_FALSE(l.pipeline.is_head_pipelined());
+}
+
+TEST(PaxosPipeline, accept_of_a_later_value_commits_the_head)
+{
+  Leader l;
+  l.begin_head();
+  l.begin_pipelined();
+  l.maybe_commit();
+  for (int peon : {1, 2}) {
+    l.pipeline.note_peer(peon, 10);
+    ASSERT_TRUE(l.pipeline.accept(12, peon));
+  }
+  l.commit_finish();
+  ASSERT_FALSE(l.committing);
+
+  // a value begun now is accepted by Peons that have committed 11
+  version_t v13 = l.begin_pipelined();
+  for (int peon : {1, 2}) {
+    l.pipeline.note_peer(peon, 11);
+    ASSERT_TRUE(l.pipeline.accept(v13, peon));
+  }
+  l.maybe_commit();
+  EXPECT_TRUE(l.committing);
+}
+
+TEST(PaxosPipeline, take_finishers_and_clear)
+{
+  PaxosPipeline p;
+  int count = 0;
+  p.add(12, leader).finishers.push_back(new C_Count(&count));
+  p.add(13, leader).finishers.push_back(new C_Count(&count));
+  p.note_peer(1, 10);
+  auto pv = p.pop_head(11);
+  EXPECT_EQ(1u, pv.finishers.size());
+
+  std::list<Context*> ls;
+  p.take_finishers(ls);
+  EXPECT_EQ(1u, ls.size());
+  ls.splice(ls.end(), pv.finishers);
+  finish_contexts(nullptr, ls, 0);
+  EXPECT_EQ(2, count);
+
+  p.clear();
+  EXPECT_TRUE(p.empty());
+  EXPECT_FALSE(p.is_head_pipelined());
+  EXPECT_FALSE(p.peers_ready({leader, 1}, leader));
+}
@@ -0,0 +1,215 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Replay PGMap updates against a captured PGMap to measure how long the
+ * manager spends applying them.  Capture a map with
+ *
+ *   ceph pg getmap -o pgmap.bin
+ *
+ * or let the benchmark build a synthetic one.  Every round re-reports the
+ * stats of a fraction of the PGs, as the OSDs do between mgr ticks, and
+ * the same rounds are applied once per thread count.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "common/ceph_argparse.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "include/str_list.h"
+#include "include/stringify.h"
+#include "mon/PGMap.h"
+
+using ceph::bufferlist;
+using std::cerr;
+using std::cout;
+using std::string;
+using std::vector;
+
+static void usage()
+{
+  cout << "usage: ceph_test_pgmap_apply_bench [flags]\n"
+      "	 --pgmap <file>\n"
+      "	       encoded PGMap, as written by 'ceph pg getmap -o <file>'\n"
+      "	 --pools <n> --pgs <n> --osds <n>\n"
+      "	       shape of the synthetic PGMap used without --pgmap\n"
+      "	 --rounds <n>\n"
+      "	       number of updates to apply\n"
+      "	 --fraction <f>\n"
+      "	       fraction of the PGs reported in each update\n"
+      "	 --threads <n>[,<n>...]\n"
+      "	       values of mgr_pgmap_apply_threads to compare\n" << std::endl;
+  generic_client_usage();
+}
+
+static void build_pgmap(unsigned pools, unsigned pgs, unsigned osds,
+			PGMap *pg_map)
+{
+  std::mt19937 gen(1);
+  PGMap::Incremental inc;
+  inc.version = 1;
+  inc.stamp = ceph_clock_now();
+  for (unsigned pool = 1; pool <= pools; ++pool) {
+    for (unsigned ps = 0; ps < pgs / pools; ++ps) {
+      pg_stat_t& s = inc.pg_stat_updates[pg_t(ps, pool)];
+      s.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+      s.stats.sum.num_objects = gen() % 10000;
+      s.stats.sum.num_bytes = s.stats.sum.num_objects << 22;
+      s.stats.sum.num_object_copies = s.stats.sum.num_objects * 3;
+      s.log_size = s.ondisk_log_size = 3000;
+      for (unsigned i = 0; i < 3; ++i) {
+	s.up.push_back((ps + pool + i * 7) % osds);
+      }
+      s.acting = s.up;
+      s.up_primary = s.acting_primary = s.up[0];
+    }
+  }
+  pg_map->apply_incremental(nullptr, inc);
+}
+
+// what the OSDs would report for a fraction of the pgs since the last tick
+static void build_updates(const PGMap& pg_map, double fraction,
+			  unsigned rounds, vector<PGMap::Incremental> *incs)
+{
+  std::mt19937 gen(2);
+  std::uniform_real_distribution<> pick(0, 1);
+  utime_t stamp = pg_map.get_stamp();
+  for (unsigned r = 0; r < rounds; ++r) {
+    PGMap::Incremental& inc = incs->emplace_back();
+    inc.version = pg_map.version + r + 1;
+    stamp += 5.0;
+    inc.stamp = stamp;
+    for (auto& [pgid, stat] : pg_map.pg_stat) {
+      if (pick(gen) >= fraction) {
+	continue;
+      }
+      pg_stat_t& s = inc.pg_stat_updates[pgid] = stat;
+      s.reported_seq += r + 1;
+      s.stats.sum.num_rd += gen() % 1000;
+      s.stats.sum.num_wr += gen() % 1000;
+      s.stats.sum.num_wr_kb += gen() % 100000;
+      s.stats.sum.num_objects += gen() % 3;
+      s.stats.sum.num_bytes += gen() % (4 << 20);
+    }
+  }
+}
+
+int main(int argc, const char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  string pgmap_file;
+  unsigned pools = 8, pgs = 200000, osds = 1000, rounds = 20;
+  double fraction = 0.5;
+  vector<unsigned> threads = {1, 2, 4, 8};
+  string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--pgmap", (char*)nullptr)) {
+      pgmap_file = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--pools", (char*)nullptr)) {
+      pools = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--pgs", (char*)nullptr)) {
+      pgs = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--osds", (char*)nullptr)) {
+      osds = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--rounds", (char*)nullptr)) {
+      rounds = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--fraction", (char*)nullptr)) {
+      fraction = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--threads", (char*)nullptr)) {
+      threads.clear();
+      vector<string> v;
+      get_str_vec(val, ",", v);
+      for (auto& t : v) {
+	threads.push_back(std::max(1, atoi(t.c_str())));
+      }
+    } else {
+      cerr << "unrecognized argument: " << *i << std::endl;
+      exit(1);
+    }
+  }
+  common_init_finish(g_ceph_context);
+
+  PGMap base;
+  if (!pgmap_file.empty()) {
+    bufferlist bl;
+    string err;
+    int r = bl.read_file(pgmap_file.c_str(), &err);
+    if (r < 0) {
+      cerr << "error reading " << pgmap_file << ": " << err << std::endl;
+      exit(1);
+    }
+    try {
+      auto p = bl.cbegin();
+      base.decode(p);
+    } catch (ceph::buffer::error& e) {
+      cerr << "error decoding " << pgmap_file << ": " << e.what() << std::endl;
+      exit(1);
+    }
+  } else {
+    build_pgmap(pools, pgs, osds, &base);
+  }
+  vector<PGMap::Incremental> incs;
+  build_updates(base, fraction, rounds, &incs);
+  cout << "pgmap v" << base.version << " with " << base.pg_stat.size()
+       << " pgs in " << base.num_pg_by_pool.size() << " pools, "
+       << rounds << " updates of ~" << incs.front().pg_stat_updates.size()
+       << " pgs" << std::endl;
+
+  bufferlist encoded;
+  base.encode(encoded);
+  double first_elapsed = 0;
+  for (auto t : threads) {
+    g_conf().set_val("mgr_pgmap_apply_threads", stringify(t));
+    g_conf().set_val("mgr_pgmap_apply_parallel_min", "1");
+    // the apply threads are started by the first update that needs them,
+    // which is not what we are timing
+    {
+      PGMap warmup;
+      auto p = encoded.cbegin();
+      warmup.decode(p);
+      warmup.apply_incremental(g_ceph_context, incs.front());
+    }
+    PGMap pg_map;
+    auto p = encoded.cbegin();
+    pg_map.decode(p);
+
+    auto start = ceph::mono_clock::now();
+    for (auto& inc : incs) {
+      pg_map.apply_incremental(g_ceph_context, inc);
+    }
+    std::chrono::duration<double> elapsed = ceph::mono_clock::now() - start;
+    if (first_elapsed == 0) {
+      first_elapsed = elapsed.count();
+    }
+    cout << "threads " << t << ": " << elapsed.count() / rounds * 1000
+	 << " ms per update, " << (rounds * incs.front().pg_stat_updates.size()) /
+	    elapsed.count() << " pg stats/s, "
+	 << first_elapsed / elapsed.count() << "x threads " << threads.front()
+	 << ", " << pg_map.pg_sum.stats.sum.num_objects << " objects" << std::endl;
+  }
+  return 0;
+}
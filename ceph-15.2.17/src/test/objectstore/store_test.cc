@@ -7242,6 +7242,157 @@ TEST_P(StoreTestSpecificAUSize, SmallWriteOnShardedExtents) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, BluestoreReadWithCrc32c) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  StartDeferred(0x1000);
+  SetVal(g_conf(), "bluestore_csum_type", "crc32c");
+  SetVal(g_conf(), "bluestore_compression_mode", "none");
+  g_conf().apply_changes(nullptr);
+
+  int r;
+  coll_t cid;
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  const PerfCounters* logger = store->get_perf_counters();
+
+  // object size 0x32123: data at 0~0x10000, a hole up to 0x20000, then
+  // data up to an unaligned end
+  const uint64_t obj_size = 0x32123;
+  auto write_obj = [&](const ghobject_t& hoid, bool compressible,
+		       uint32_t expected_write_size, uint32_t flags) {
+    bufferlist bl1, bl2;
+    for (unsigned i = 0; i < 0x10000; ++i) {
+      bl1.append(compressible ? 'a' + i / 0x1000 : (char)rand());
+    }
+    for (unsigned i = 0; i < obj_size - 0x20000; ++i) {
+      bl2.append(compressible ? 'z' - i / 0x1000 : (char)rand());
+    }
+    ObjectStore::Transaction t;
+    t.touch(cid, hoid);
+    t.set_alloc_hint(cid, hoid, 4*1024*1024, expected_write_size, flags);
+    t.write(cid, hoid, 0, bl1.length(), bl1);
+    t.write(cid, hoid, 0x20000, bl2.length(), bl2);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  };
+
+  // offset, length: whole and partial csum chunks, holes and the tail
+  const std::vector<std::pair<uint64_t, uint64_t>> ranges = {
+    {0, 0},
+    {0, obj_size},
+    {0, 0x1000},
+    {1, 0xfff},
+    {0xfff, 0x2002},
+    {0x1001, 0xe000},
+    {0x8000, 0x10000},
+    {0xf123, 0x12000},
+    {0x10000, 0x10000},
+    {0x12345, 0x20000},
+    {0x20000, obj_size - 0x20000},
+    {0x31fff, 0x124},
+    {0x30000, 0x10000},
+  };
+  // compare against hashing what read() returns, and count the bytes
+  // that were folded in from the blob csums
+  auto check = [&](const ghobject_t& hoid, uint64_t *reused) {
+    *reused = 0;
+    for (auto [offset, length] : ranges) {
+      for (uint32_t seed : {-1u, 0u, 0x12345678u}) {
+	bufferlist expected;
+	r = store->read(ch, hoid, offset, length, expected);
+	ASSERT_GE(r, 0);
+	uint32_t expected_crc = expected.crc32c(seed);
+
+	uint64_t before = logger->get(l_bluestore_read_csum_reused_bytes);
+	bufferlist bl;
+	uint32_t crc = seed;
+	r = store->read_with_crc32c(ch, hoid, offset, length, bl, &crc);
+	ASSERT_EQ((int)expected.length(), r);
+	ASSERT_TRUE(bl_eq(expected, bl));
+	ASSERT_EQ(expected_crc, crc)
+	  << hoid << " 0x" << std::hex << offset << "~" << length
+	  << " seed 0x" << seed;
+	*reused += logger->get(l_bluestore_read_csum_reused_bytes) - before;
+      }
+    }
+    {
+      // a crc extended over consecutive reads is that of the whole range
+      bufferlist whole;
+      r = store->read(ch, hoid, 0, obj_size, whole);
+      ASSERT_EQ((int)obj_size, r);
+      uint32_t crc = -1;
+      for (uint64_t offset = 0; offset < obj_size; offset += 0x3333) {
+	bufferlist bl;
+	r = store->read_with_crc32c(ch, hoid, offset, 0x3333, bl, &crc);
+	ASSERT_GE(r, 0);
+      }
+      ASSERT_EQ(whole.crc32c(-1), crc) << hoid;
+    }
+  };
+
+  uint64_t reused;
+  {
+    // crc32c csums of 4K chunks
+    ghobject_t hoid(hobject_t(sobject_t("Object crc32c", CEPH_NOSNAP)));
+    write_obj(hoid, false, 0, 0);
+    ch.reset();
+    store->umount();
+    store->mount();
+    ch = store->open_collection(cid);
+    check(hoid, &reused);
+    ASSERT_GT(reused, 0u);
+  }
+  {
+    // csum chunks of 64K, for sequentially read immutable objects
+    ghobject_t hoid(hobject_t(sobject_t("Object crc32c 64K", CEPH_NOSNAP)));
+    write_obj(hoid, false, 0x10000,
+	      CEPH_OSD_ALLOC_HINT_FLAG_SEQUENTIAL_READ |
+	      CEPH_OSD_ALLOC_HINT_FLAG_IMMUTABLE);
+    check(hoid, &reused);
+    ASSERT_GT(reused, 0u);
+  }
+  for (auto csum_type : {"crc32c_16", "crc32c_8", "xxhash32", "xxhash64",
+			 "none"}) {
+    // other checksums are of no use, the data is hashed
+    SetVal(g_conf(), "bluestore_csum_type", csum_type);
+    g_conf().apply_changes(nullptr);
+    ghobject_t hoid(hobject_t(sobject_t(string("Object ") + csum_type,
+					CEPH_NOSNAP)));
+    write_obj(hoid, false, 0, 0);
+    check(hoid, &reused);
+    ASSERT_EQ(0u, reused) << csum_type;
+  }
+  {
+    // compressed blobs keep csums of the compressed data
+    SetVal(g_conf(), "bluestore_csum_type", "crc32c");
+    SetVal(g_conf(), "bluestore_compression_mode", "force");
+    g_conf().apply_changes(nullptr);
+    ghobject_t hoid(hobject_t(sobject_t("Object compressed", CEPH_NOSNAP)));
+    write_obj(hoid, true, 0, 0);
+    check(hoid, &reused);
+    ASSERT_EQ(0u, reused);
+  }
+  {
+    vector<ghobject_t> objects;
+    r = store->collection_list(ch, ghobject_t(), ghobject_t::get_max(),
+			       INT_MAX, &objects, nullptr);
+    ASSERT_EQ(r, 0);
+    ObjectStore::Transaction rm;
+    for (auto& o : objects) {
+      rm.remove(cid, o);
+    }
+    rm.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(rm));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 #endif //#if defined(WITH_BLUESTORE)
 
 TEST_P(StoreTest, KVDBHistogramTest) {
@@ -0,0 +1,62 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+
+#include "gtest/gtest.h"
+
+#include "osd/scheduler/CapacityEstimator.h"
+
+using namespace ceph::osd::scheduler;
+
+TEST(CapacityEstimator, Uncalibrated) {
+  CapacityEstimator c;
+  ASSERT_FALSE(c.is_calibrated());
+  ASSERT_FALSE(c.sample(100, 0.01, 0.5));
+  ASSERT_EQ(0, c.get_iops());
+}
+
+TEST(CapacityEstimator, IdleSamplesIgnored) {
+  CapacityEstimator c;
+  c.set_benchmark(1000, 65536);
+  ASSERT_TRUE(c.is_calibrated());
+  ASSERT_EQ(1000, c.get_iops());
+  ASSERT_EQ(65536, c.get_bytes_per_io());
+
+  // the first sample only sets the base latency
+  ASSERT_FALSE(c.sample(100, 0.001, 0.5));
+  ASSERT_EQ(0.001, c.get_base_latency());
+  // barely above the base, the device was mostly idle
+  ASSERT_FALSE(c.sample(100, 0.0015, 0.5));
+  ASSERT_FALSE(c.sample(0, 0.004, 0.5));
+  ASSERT_EQ(1000, c.get_iops());
+}
+
+TEST(CapacityEstimator, Converges) {
+  CapacityEstimator c;
+  c.set_benchmark(1000, 65536);
+  c.sample(100, 0.001, 0.5);
+
+  // 600 IOPS at four times the base latency: 3/4 busy, 800 sustainable
+  for (int i = 0; i < 50; ++i) {
+    ASSERT_TRUE(c.sample(600, 0.004, 0.5));
+  }
+  const double expected = 600 / (1 - c.get_base_latency() / 0.004);
+  ASSERT_NEAR(expected, c.get_iops(), 5);
+  ASSERT_LT(c.get_iops(), 850);
+
+  // a quicker sample resets the base
+  c.sample(100, 0.0005, 0.5);
+  ASSERT_EQ(0.0005, c.get_base_latency());
+}
+
+TEST(CapacityEstimator, Bounded) {
+  CapacityEstimator c;
+  c.set_benchmark(1000, 65536);
+  c.sample(100, 0.001, 0.5);
+  for (int i = 0; i < 100; ++i) {
+    c.sample(100000, 0.01, 0.5);
+  }
+  ASSERT_EQ(1000 * CapacityEstimator::max_bench_ratio, c.get_iops());
+  for (int i = 0; i < 100; ++i) {
+    c.sample(1, 0.01, 0.5);
+  }
+  ASSERT_EQ(1000 * CapacityEstimator::min_bench_ratio, c.get_iops());
+}
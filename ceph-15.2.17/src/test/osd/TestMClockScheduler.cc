@@ -154,3 +154,26 @@ TEST_F(mClockSchedulerTest, TestMultiClientOrderedEnqueueDequeue) {
   }
   ASSERT_TRUE(q.empty());
 }
+
+TEST_F(mClockSchedulerTest, TestCapacityCost) {
+  q.enqueue(create_item(100, client1, op_scheduler_class::client));
+  q.dequeue();
+  // every op costs one until the capacity is known
+  ASSERT_EQ(1u, q.get_dispatched_cost());
+
+  q.update_capacity(100, 4096);
+  q.enqueue(create_item(101, client1, op_scheduler_class::client));
+  q.enqueue(OpSchedulerItem(
+    std::make_unique<MockDmclockItem>(op_scheduler_class::client),
+    8192, 12, utime_t(), client1, 102));
+  q.enqueue(OpSchedulerItem(
+    std::make_unique<MockDmclockItem>(op_scheduler_class::client),
+    4 << 20, 12, utime_t(), client1, 103));
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_FALSE(q.empty());
+    q.dequeue();
+  }
+  ASSERT_TRUE(q.empty());
+  // 1 + 1 + 3 for the 8K op + 100, the most a single op may cost
+  ASSERT_EQ(105u, q.get_dispatched_cost());
+}
@@ -0,0 +1,273 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "global/global_context.h"
+#include "common/perf_counters.h"
+#include "messages/MOSDPeeringOp.h"
+#include "osd/PGPeeringEvent.h"
+#include "messages/MOSDPGLease.h"
+#include "messages/MOSDPGLeaseAck.h"
+#include "messages/MOSDPGPeeringBatch.h"
+#include "messages/MOSDPGQuery2.h"
+#include "messages/MPing.h"
+#include "osd/PeeringBatcher.h"
+#include "osd/osd_perf_counters.h"
+
+static MessageRef make_lease(epoch_t e)
+{
+  return ceph::make_message<MOSDPGLease>(
+    e, spg_t(pg_t(e, 1)), pg_lease_t());
+}
+
+static epoch_t lease_epoch(const MessageRef& m)
+{
+  EXPECT_EQ(MSG_OSD_PG_LEASE, m->get_type());
+  return static_cast<const MOSDPGLease*>(m.get())->get_map_epoch();
+}
+
+static Message *encode_decode(Message *m)
+{
+  bufferlist bl;
+  encode_message(m, CEPH_FEATURES_ALL, bl);
+  auto p = bl.cbegin();
+  return decode_message(nullptr, 0, p);
+}
+
+TEST(MOSDPGPeeringBatch, EncodeDecode)
+{
+  std::vector<MessageRef> msgs;
+  msgs.push_back(make_lease(10));
+  msgs.push_back(ceph::make_message<MOSDPGLeaseAck>(
+    11, spg_t(pg_t(11, 1)), pg_lease_ack_t()));
+  msgs.push_back(ceph::make_message<MOSDPGQuery2>(
+    spg_t(pg_t(12, 1)),
+    pg_query_t(pg_query_t::INFO, shard_id_t::NO_SHARD,
+	       shard_id_t::NO_SHARD, pg_history_t(), 12)));
+  auto batch = ceph::make_message<MOSDPGPeeringBatch>(std::move(msgs));
+
+  Message *m = encode_decode(batch.get());
+  ASSERT_TRUE(m);
+  ASSERT_EQ(MSG_OSD_PG_PEERING_BATCH, m->get_type());
+  auto decoded = static_cast<MOSDPGPeeringBatch*>(m);
+  ASSERT_EQ(3u, decoded->msgs.size());
+
+  EXPECT_EQ(10u, lease_epoch(decoded->msgs[0]));
+  EXPECT_EQ(spg_t(pg_t(10, 1)),
+	    static_cast<MOSDPGLease*>(decoded->msgs[0].get())->get_spg());
+
+  ASSERT_EQ(MSG_OSD_PG_LEASE_ACK, decoded->msgs[1]->get_type());
+  auto ack = static_cast<MOSDPGLeaseAck*>(decoded->msgs[1].get());
+  EXPECT_EQ(11u, ack->get_map_epoch());
+  EXPECT_EQ(spg_t(pg_t(11, 1)), ack->get_spg());
+
+  ASSERT_EQ(MSG_OSD_PG_QUERY2, decoded->msgs[2]->get_type());
+  auto query = static_cast<MOSDPGQuery2*>(decoded->msgs[2].get());
+  EXPECT_EQ(spg_t(pg_t(12, 1)), query->spgid);
+  EXPECT_EQ(pg_query_t::INFO, query->query.type);
+  EXPECT_EQ(12u, query->query.epoch_sent);
+  m->put();
+}
+
+TEST(MOSDPGPeeringBatch, RejectsUnexpectedType)
+{
+  {
+    std::vector<MessageRef> msgs;
+    msgs.push_back(make_lease(10));
+    msgs.push_back(ceph::make_message<MPing>());
+    auto batch = ceph::make_message<MOSDPGPeeringBatch>(std::move(msgs));
+    ASSERT_EQ(nullptr, encode_decode(batch.get()));
+  }
+  {
+    // nor may batches nest
+    std::vector<MessageRef> inner;
+    inner.push_back(make_lease(10));
+    std::vector<MessageRef> msgs;
+    msgs.push_back(ceph::make_message<MOSDPGPeeringBatch>(std::move(inner)));
+    auto batch = ceph::make_message<MOSDPGPeeringBatch>(std::move(msgs));
+    ASSERT_EQ(nullptr, encode_decode(batch.get()));
+  }
+}
+
+/// a connection that keeps what is sent on it
+class RecordingConnection : public Connection {
+public:
+  std::vector<MessageRef> get_sent() {
+    std::lock_guard l{sent_lock};
+    return sent;
+  }
+  /// wait until @p n messages were sent, for up to 10s
+  bool wait_for(size_t n) {
+    for (int i = 0; i < 1000; ++i) {
+      if (get_sent().size() >= n) {
+	return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  int send_message(Message *m) override {
+    std::lock_guard l{sent_lock};
+    sent.emplace_back(m, false);
+    return 0;
+  }
+  void send_keepalive() override {}
+  void mark_down() override {}
+  void mark_disposable() override {}
+  bool is_connected() override { return true; }
+  entity_addr_t get_peer_socket_addr() const override {
+    return entity_addr_t();
+  }
+
+private:
+  ceph::mutex sent_lock = ceph::make_mutex("RecordingConnection::sent_lock");
+  std::vector<MessageRef> sent;
+
+  FRIEND_MAKE_REF(RecordingConnection);
+  RecordingConnection(CephContext *cct, uint64_t features)
+    : Connection(cct, nullptr) {
+    set_features(features);
+  }
+};
+
+class PeeringBatcherTest : public ::testing::Test {
+protected:
+  PeeringBatcher batcher{g_ceph_context};
+  PerfCounters *logger = nullptr;
+
+  void SetUp() override {
+    logger = build_osd_logger(g_ceph_context);
+    batcher.init(logger);
+    set_conf(60, 3);
+  }
+  void TearDown() override {
+    batcher.shutdown();
+    delete logger;
+    g_ceph_context->_conf.rm_val("osd_peering_batch_delay");
+    g_ceph_context->_conf.rm_val("osd_peering_batch_max_messages");
+  }
+
+  static void set_conf(double delay, unsigned max_messages) {
+    auto& conf = g_ceph_context->_conf;
+    conf.set_val_or_die("osd_peering_batch_delay", std::to_string(delay));
+    conf.set_val_or_die("osd_peering_batch_max_messages",
+			std::to_string(max_messages));
+  }
+
+  static ceph::ref_t<RecordingConnection> make_con(
+    uint64_t features = CEPH_FEATURES_ALL) {
+    return ceph::make_ref<RecordingConnection>(g_ceph_context, features);
+  }
+
+  void queue(const ceph::ref_t<RecordingConnection>& con,
+	     std::initializer_list<epoch_t> epochs) {
+    std::vector<MessageRef> ls;
+    for (auto e : epochs) {
+      ls.push_back(make_lease(e));
+    }
+    batcher.queue(con, std::move(ls));
+  }
+
+  static std::vector<epoch_t> batch_epochs(const MessageRef& m) {
+    EXPECT_EQ(MSG_OSD_PG_PEERING_BATCH, m->get_type());
+    std::vector<epoch_t> epochs;
+    for (auto& sub : static_cast<MOSDPGPeeringBatch*>(m.get())->msgs) {
+      epochs.push_back(lease_epoch(sub));
+    }
+    return epochs;
+  }
+};
+
+TEST_F(PeeringBatcherTest, FlushOnMaxMessages)
+{
+  auto con = make_con();
+  queue(con, {1, 2});
+  ASSERT_TRUE(con->get_sent().empty());
+  queue(con, {3, 4});
+  auto sent = con->get_sent();
+  ASSERT_EQ(1u, sent.size());
+  ASSERT_EQ(std::vector<epoch_t>({1, 2, 3}), batch_epochs(sent[0]));
+  ASSERT_EQ(1u, logger->get(l_osd_peering_batch));
+  ASSERT_EQ(3u, logger->get(l_osd_peering_batch_msgs));
+}
+
+TEST_F(PeeringBatcherTest, FlushOnTimer)
+{
+  set_conf(0.01, 128);
+  auto con = make_con();
+  queue(con, {1, 2});
+  ASSERT_TRUE(con->wait_for(1));
+  auto sent = con->get_sent();
+  ASSERT_EQ(1u, sent.size());
+  ASSERT_EQ(std::vector<epoch_t>({1, 2}), batch_epochs(sent[0]));
+
+  // a lone message goes out as is
+  queue(con, {3});
+  ASSERT_TRUE(con->wait_for(2));
+  sent = con->get_sent();
+  ASSERT_EQ(2u, sent.size());
+  ASSERT_EQ(3u, lease_epoch(sent[1]));
+}
+
+TEST_F(PeeringBatcherTest, PerConnectionOrdering)
+{
+  set_conf(60, 4);
+  auto a = make_con();
+  auto b = make_con();
+  queue(a, {1});
+  queue(b, {101, 102});
+  queue(a, {2, 3});
+  queue(b, {103});
+  queue(a, {4, 5});
+  queue(b, {104});
+
+  auto sent_a = a->get_sent();
+  ASSERT_EQ(1u, sent_a.size());
+  ASSERT_EQ(std::vector<epoch_t>({1, 2, 3, 4}), batch_epochs(sent_a[0]));
+  auto sent_b = b->get_sent();
+  ASSERT_EQ(1u, sent_b.size());
+  ASSERT_EQ(std::vector<epoch_t>({101, 102, 103, 104}),
+	    batch_epochs(sent_b[0]));
+
+  // anything that cannot be batched follows what is pending
+  std::vector<MessageRef> ls;
+  ls.push_back(ceph::make_message<MPing>());
+  ls.push_back(make_lease(6));
+  batcher.queue(a, std::move(ls));
+  sent_a = a->get_sent();
+  ASSERT_EQ(3u, sent_a.size());
+  ASSERT_EQ(5u, lease_epoch(sent_a[1]));
+  ASSERT_EQ(CEPH_MSG_PING, sent_a[2]->get_type());
+}
+
+TEST_F(PeeringBatcherTest, NoBatchingWithoutPeerFeature)
+{
+  auto con = make_con(CEPH_FEATURES_ALL & ~CEPH_FEATURE_OSD_PEERING_BATCH);
+  queue(con, {1, 2});
+  auto sent = con->get_sent();
+  ASSERT_EQ(2u, sent.size());
+  ASSERT_EQ(1u, lease_epoch(sent[0]));
+  ASSERT_EQ(2u, lease_epoch(sent[1]));
+  ASSERT_EQ(0u, logger->get(l_osd_peering_batch));
+}
+
+TEST_F(PeeringBatcherTest, NoBatchingWithoutDelay)
+{
+  set_conf(0, 3);
+  auto con = make_con();
+  queue(con, {1, 2});
+  ASSERT_EQ(2u, con->get_sent().size());
+}
@@ -0,0 +1,97 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "global/global_context.h"
+#include "osd/ReplicatedBackend.h"
+
+class PushMessageLenTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    auto& conf = g_ceph_context->_conf;
+    conf.set_val_or_die("osd_max_push_objects", "10");
+    conf.set_val_or_die("osd_backfill_bulk_max_objects", "64");
+    conf.set_val_or_die("osd_max_push_cost", "8388608");
+    conf.set_val_or_die("osd_push_per_object_cost", "1000");
+  }
+  void TearDown() override {
+    auto& conf = g_ceph_context->_conf;
+    for (auto key : {"osd_max_push_objects",
+		     "osd_backfill_bulk_max_objects",
+		     "osd_max_push_cost",
+		     "osd_push_per_object_cost"}) {
+      conf.rm_val(key);
+    }
+  }
+
+  static vector<PushOp> make_pushes(unsigned n, uint64_t len) {
+    vector<PushOp> pushes(n);
+    for (auto& p : pushes) {
+      if (len) {
+	p.data_included.insert(0, len);
+      }
+    }
+    return pushes;
+  }
+
+  static size_t len(const vector<PushOp>& pushes, bool bulk_backfill,
+		    size_t from = 0) {
+    return ReplicatedBackend::get_push_message_len(
+      g_ceph_context, pushes.begin() + from, pushes.end(), bulk_backfill);
+  }
+};
+
+TEST_F(PushMessageLenTest, Empty)
+{
+  vector<PushOp> pushes;
+  ASSERT_EQ(0u, len(pushes, false));
+  ASSERT_EQ(0u, len(pushes, true));
+}
+
+TEST_F(PushMessageLenTest, RegularPushesStayAtMaxPushObjects)
+{
+  auto pushes = make_pushes(64, 4096);
+  ASSERT_EQ(10u, len(pushes, false));
+  ASSERT_EQ(10u, len(pushes, false, 50));
+  ASSERT_EQ(4u, len(pushes, false, 60));
+}
+
+TEST_F(PushMessageLenTest, BulkBackfillFillsOneMessage)
+{
+  auto pushes = make_pushes(100, 4096);
+  ASSERT_EQ(64u, len(pushes, true));
+  ASSERT_EQ(36u, len(pushes, true, 64));
+}
+
+TEST_F(PushMessageLenTest, BulkBackfillNeverBelowMaxPushObjects)
+{
+  g_ceph_context->_conf.set_val_or_die("osd_backfill_bulk_max_objects", "4");
+  auto pushes = make_pushes(20, 4096);
+  ASSERT_EQ(10u, len(pushes, true));
+}
+
+TEST_F(PushMessageLenTest, CostBoundsBothKinds)
+{
+  // each push costs 1M + 1000; the message closes once 4M is reached
+  g_ceph_context->_conf.set_val_or_die("osd_max_push_cost", "4194304");
+  auto pushes = make_pushes(64, 1 << 20);
+  ASSERT_EQ(4u, len(pushes, false));
+  ASSERT_EQ(4u, len(pushes, true));
+}
+
+TEST_F(PushMessageLenTest, AlwaysAtLeastOne)
+{
+  g_ceph_context->_conf.set_val_or_die("osd_max_push_cost", "1");
+  auto pushes = make_pushes(3, 1 << 20);
+  ASSERT_EQ(1u, len(pushes, false));
+  ASSERT_EQ(1u, len(pushes, true));
+}
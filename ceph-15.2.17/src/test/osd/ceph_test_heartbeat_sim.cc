@@ -0,0 +1,487 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Simulate OSD failure detection among thousands of virtual OSDs.
+ *
+ * Every OSD pings the other OSDs of its PGs, placed at random, and
+ * reports the peers that stop replying to the monitor the way the OSD
+ * does, once with the classic heartbeats and once with
+ * osd_heartbeat_gossip, where the suspicions travel on the pings through
+ * HeartbeatGossip.  The monitor marks an OSD down as OSDMonitor does,
+ * without the subtree and laggy adjustments.  Prints how long it took to
+ * mark the killed OSDs down, how many failure reports the monitor got and
+ * the ping rate per OSD.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <queue>
+#include <random>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_context.h"
+#include "global/global_context.h"
+#include "global/global_init.h"
+#include "osd/HeartbeatGossip.h"
+
+using std::cout;
+using std::string;
+using std::vector;
+
+static void usage()
+{
+  cout << "usage: ceph_test_heartbeat_sim [flags]\n"
+      "	 --osds <n>\n"
+      "	       number of virtual OSDs (default 2000)\n"
+      "	 --pgs-per-osd <n> --size <n>\n"
+      "	       PG shards per OSD and PG size, which make up the peers\n"
+      "	 --fail <n>\n"
+      "	       OSDs killed at once (default 1)\n"
+      "	 --latency <ms>\n"
+      "	       one-way network latency (default 0.2)\n"
+      "	 --seed <n>\n"
+      "\n"
+      "The heartbeat settings are taken from the osd_heartbeat_* and\n"
+      "mon_osd_min_down_reporters options.\n" << std::endl;
+  generic_client_usage();
+}
+
+namespace {
+
+struct params_t {
+  bool gossip = false;
+  double interval;          // classic ping interval
+  double grace;             // classic grace
+  double gossip_interval;
+  double gossip_grace;
+  unsigned gossip_min_reporters;
+  unsigned gossip_max_suspects;
+  double max_ping_rate;
+  double mon_report_interval;
+  unsigned min_down_reporters;
+  double latency;
+  double kill_at = 10;
+  double duration = 120;
+};
+
+utime_t to_utime(double t)
+{
+  utime_t u;
+  u.set_from_double(t);
+  return u;
+}
+
+class Sim {
+public:
+  Sim(const params_t& p, const vector<vector<int>>& peers,
+      const vector<int>& victims, unsigned seed)
+    : p(p), victims(victims), rng(seed), osds(peers.size()),
+      down(peers.size(), -1) {
+    for (size_t i = 0; i < osds.size(); ++i) {
+      auto& o = osds[i];
+      o.peers = peers[i];
+      o.gossip = std::make_unique<HeartbeatGossip>(i);
+      for (int peer : o.peers) {
+	o.last_rx[peer] = 0;
+      }
+      std::uniform_real_distribution<double> phase(0, 1);
+      at(phase(rng) * interval(o), ROUND, i);
+      at(phase(rng), TICK, i);
+    }
+    at(p.kill_at, KILL, -1);
+    at(p.kill_at, MON_TICK, -1);
+  }
+
+  void run() {
+    while (!events.empty()) {
+      auto& top = events.top();
+      now = top.t;
+      if (now > p.duration || (killed && remaining == 0)) {
+	break;
+      }
+      event_t e = std::move(const_cast<event_t&>(top));
+      events.pop();
+      handle(e);
+    }
+  }
+
+  void report(const string& name) const {
+    vector<double> t;
+    for (int v : victims) {
+      if (down[v] >= 0) {
+	t.push_back(down[v] - p.kill_at);
+      }
+    }
+    std::sort(t.begin(), t.end());
+    cout << name << ": " << t.size() << "/" << victims.size()
+	 << " osds marked down";
+    if (!t.empty()) {
+      cout << " after " << t.front() << " - " << t.back() << " s";
+    }
+    cout << ", " << failure_reports << " failure reports ("
+	 << confirmations << " confirmations), "
+	 << (double)pings / now / osds.size()
+	 << " heartbeat messages/s per osd" << std::endl;
+  }
+
+private:
+  enum { ROUND, TICK, PING, REPLY, FAILURE, KILL, MON_TICK };
+  struct event_t {
+    double t;
+    uint64_t seq;
+    int type;
+    int from;
+    int to = -1;
+    double stamp = 0;
+    vector<int32_t> list;
+    bool operator<(const event_t& o) const {
+      return t > o.t || (t == o.t && seq > o.seq);
+    }
+  };
+  struct osd_t {
+    vector<int> peers;
+    std::map<int, double> last_rx;
+    std::map<int, double> failure_queue;
+    std::set<int> failure_pending;
+    double last_mon_report = 0;
+    std::unique_ptr<HeartbeatGossip> gossip;
+    bool dead = false;
+  };
+  struct failure_t {
+    std::set<int> reporters;
+    double failed_since = 0;
+    bool confirmed = false;
+  };
+
+  void at(double t, int type, int from, int to = -1, double stamp = 0,
+	  vector<int32_t> list = {}) {
+    events.push(event_t{t, seq++, type, from, to, stamp, std::move(list)});
+  }
+
+  double interval(const osd_t& o) const {
+    if (!p.gossip) {
+      return p.interval;
+    }
+    return std::max(p.gossip_interval,
+		    o.peers.size() * 2 / p.max_ping_rate);
+  }
+  double grace(const osd_t& o) const {
+    return p.gossip ? std::max(p.gossip_grace, 3 * interval(o)) : p.grace;
+  }
+  vector<int32_t> gossip(osd_t& o) {
+    return p.gossip ? o.gossip->get_gossip(p.gossip_max_suspects) :
+      vector<int32_t>();
+  }
+
+  void handle(event_t& e) {
+    switch (e.type) {
+    case ROUND:
+      round(e.from);
+      break;
+    case TICK:
+      tick(e.from);
+      break;
+    case PING:
+      {
+	auto& o = osds[e.to];
+	if (o.dead) {
+	  break;
+	}
+	if (p.gossip && o.last_rx.count(e.from)) {
+	  o.gossip->handle_gossip(e.from, e.list, to_utime(now));
+	}
+	pings += 2;
+	at(now + p.latency, REPLY, e.to, e.from, 0, gossip(o));
+      }
+      break;
+    case REPLY:
+      {
+	auto& o = osds[e.to];
+	if (o.dead) {
+	  break;
+	}
+	if (p.gossip) {
+	  o.gossip->handle_gossip(e.from, e.list, to_utime(now));
+	}
+	o.last_rx[e.from] = now;
+	o.gossip->clear(e.from);
+	o.failure_queue.erase(e.from);
+	if (o.failure_pending.erase(e.from)) {
+	  mon_cancel(e.from, e.to, o.gossip->take_reported(e.from));
+	}
+      }
+      break;
+    case FAILURE:
+      mon_failure(e.from, e.to, e.stamp, e.list);
+      break;
+    case KILL:
+      for (int v : victims) {
+	osds[v].dead = true;
+      }
+      killed = true;
+      remaining = victims.size();
+      break;
+    case MON_TICK:
+      for (auto& [target, f] : failures) {
+	mon_check(target, f);
+      }
+      at(now + 5, MON_TICK, -1);
+      break;
+    }
+  }
+
+  void round(int i) {
+    auto& o = osds[i];
+    if (o.dead) {
+      return;
+    }
+    if (p.gossip) {
+      check(i);
+    }
+    auto list = gossip(o);
+    for (int peer : o.peers) {
+      if (down[peer] < 0) {
+	pings += 2;	// front and back
+	at(now + p.latency, PING, i, peer, 0, list);
+      }
+    }
+    std::uniform_int_distribution<int> r(0, 9);
+    double wait = p.gossip ? (.75 + r(rng) / 20.0) * interval(o) :
+      .5 + r(rng) / 10.0 * interval(o);
+    at(now + wait, ROUND, i);
+  }
+
+  void check(int i) {
+    auto& o = osds[i];
+    for (auto& [peer, last] : o.last_rx) {
+      if (down[peer] < 0 && now - last > grace(o)) {
+	o.failure_queue[peer] = last;
+	o.gossip->suspect(peer, to_utime(last));
+      }
+    }
+  }
+
+  void tick(int i) {
+    auto& o = osds[i];
+    if (o.dead) {
+      return;
+    }
+    check(i);
+    if (now - o.last_mon_report > p.mon_report_interval) {
+      o.last_mon_report = now;
+      send_failures(i);
+    } else if (p.gossip && !o.failure_queue.empty()) {
+      send_failures(i);
+    }
+    at(now + 1, TICK, i);
+  }
+
+  void send_failures(int i) {
+    auto& o = osds[i];
+    for (auto q = o.failure_queue.begin(); q != o.failure_queue.end(); ) {
+      int target = q->first;
+      if (down[target] >= 0) {
+	q = o.failure_queue.erase(q);
+	continue;
+      }
+      if (!o.failure_pending.count(target)) {
+	vector<int32_t> confirmed_by;
+	if (p.gossip &&
+	    !o.gossip->should_report(target, to_utime(now), grace(o),
+				     p.gossip_min_reporters, p.grace,
+				     &confirmed_by)) {
+	  ++q;
+	  continue;
+	}
+	confirmed_by.erase(
+	  std::remove_if(confirmed_by.begin(), confirmed_by.end(),
+			 [this](int32_t peer) { return down[peer] >= 0; }),
+	  confirmed_by.end());
+	if (!confirmed_by.empty()) {
+	  o.gossip->reported(target, confirmed_by);
+	}
+	++failure_reports;
+	confirmations += confirmed_by.size();
+	// failed_for is sent in whole seconds
+	at(now + p.latency, FAILURE, i, target,
+	   now - std::floor(now - q->second), std::move(confirmed_by));
+	o.failure_pending.insert(target);
+      }
+      q = o.failure_queue.erase(q);
+    }
+  }
+
+  void mon_failure(int reporter, int target, double failed_since,
+		   const vector<int32_t>& confirmed_by) {
+    if (down[target] >= 0) {
+      return;
+    }
+    auto& f = failures[target];
+    f.reporters.insert(reporter);
+    f.failed_since = std::max(f.failed_since, failed_since);
+    for (int peer : confirmed_by) {
+      if (peer != target && down[peer] < 0 && f.reporters.insert(peer).second) {
+	f.confirmed = true;
+      }
+    }
+    mon_check(target, f);
+  }
+
+  void mon_cancel(int target, int reporter, const vector<int32_t>& confirmed_by) {
+    auto f = failures.find(target);
+    if (f == failures.end()) {
+      return;
+    }
+    f->second.reporters.erase(reporter);
+    for (int peer : confirmed_by) {
+      f->second.reporters.erase(peer);
+    }
+    if (f->second.reporters.empty()) {
+      failures.erase(f);
+    }
+  }
+
+  void mon_check(int target, failure_t& f) {
+    if (down[target] >= 0 || f.reporters.size() < p.min_down_reporters) {
+      return;
+    }
+    double g = f.confirmed ? p.gossip_grace : p.grace;
+    if (now - f.failed_since >= g) {
+      down[target] = now;
+      if (osds[target].dead) {
+	--remaining;
+      }
+    }
+  }
+
+  const params_t p;
+  const vector<int> victims;
+  std::mt19937 rng;
+  vector<osd_t> osds;
+  vector<double> down;	// when marked down, or -1
+  std::map<int, failure_t> failures;
+  std::priority_queue<event_t> events;
+  uint64_t seq = 0;
+  double now = 0;
+  bool killed = false;
+  unsigned remaining = 0;
+  uint64_t pings = 0;
+  uint64_t failure_reports = 0;
+  uint64_t confirmations = 0;
+};
+
+} // anonymous namespace
+
+int main(int argc, const char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  unsigned num_osds = 2000, pgs_per_osd = 50, size = 3, fail = 1, seed = 0;
+  double latency = 0.2;
+  string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--osds", (char*)nullptr)) {
+      num_osds = std::max(2, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--pgs-per-osd", (char*)nullptr)) {
+      pgs_per_osd = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--size", (char*)nullptr)) {
+      size = std::max(2, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--fail", (char*)nullptr)) {
+      fail = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--latency", (char*)nullptr)) {
+      latency = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--seed", (char*)nullptr)) {
+      seed = atoi(val.c_str());
+    } else {
+      std::cerr << "unrecognized argument: " << *i << std::endl;
+      exit(1);
+    }
+  }
+  common_init_finish(g_ceph_context);
+  size = std::min(size, num_osds);
+  fail = std::min(fail, num_osds - 1);
+
+  auto& conf = g_ceph_context->_conf;
+  params_t params;
+  params.interval = conf->osd_heartbeat_interval;
+  params.grace = conf->osd_heartbeat_grace;
+  params.gossip_interval = conf.get_val<double>("osd_heartbeat_gossip_interval");
+  params.gossip_grace = conf.get_val<double>("osd_heartbeat_gossip_grace");
+  params.gossip_min_reporters =
+    conf.get_val<uint64_t>("osd_heartbeat_gossip_min_reporters");
+  params.gossip_max_suspects =
+    conf.get_val<uint64_t>("osd_heartbeat_gossip_max_suspects");
+  params.max_ping_rate =
+    conf.get_val<uint64_t>("osd_heartbeat_gossip_max_ping_rate");
+  params.mon_report_interval = conf->osd_mon_report_interval;
+  params.min_down_reporters =
+    conf.get_val<uint64_t>("mon_osd_min_down_reporters");
+  params.latency = latency / 1000;
+
+  // the other shards of every pg are heartbeat peers, and then some
+  // neighbours up to osd_heartbeat_min_peers, as OSD does
+  std::mt19937 rng(seed);
+  vector<std::set<int>> peer_sets(num_osds);
+  std::uniform_int_distribution<unsigned> pick(0, num_osds - 1);
+  for (unsigned pg = 0; pg < num_osds * pgs_per_osd / size; ++pg) {
+    std::set<int> acting;
+    while (acting.size() < size) {
+      acting.insert(pick(rng));
+    }
+    for (int a : acting) {
+      for (int b : acting) {
+	if (a != b) {
+	  peer_sets[a].insert(b);
+	}
+      }
+    }
+  }
+  const unsigned min_peers = conf->osd_heartbeat_min_peers;
+  for (unsigned o = 0; o < num_osds; ++o) {
+    for (unsigned n = 1; peer_sets[o].size() < min_peers && n < num_osds; ++n) {
+      peer_sets[o].insert((o + n) % num_osds);
+    }
+  }
+  vector<vector<int>> peers;
+  size_t total = 0;
+  for (auto& s : peer_sets) {
+    peers.emplace_back(s.begin(), s.end());
+    total += s.size();
+  }
+  std::set<int> victim_set;
+  while (victim_set.size() < fail) {
+    victim_set.insert(pick(rng));
+  }
+  vector<int> victims(victim_set.begin(), victim_set.end());
+  cout << num_osds << " osds with " << (double)total / num_osds
+       << " heartbeat peers on average, killing " << victims.size()
+       << std::endl;
+
+  for (bool gossip : {false, true}) {
+    params.gossip = gossip;
+    Sim sim(params, peers, victims, seed);
+    sim.run();
+    sim.report(gossip ? "gossip" : "classic");
+  }
+  return 0;
+}
@@ -0,0 +1,413 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Offline model of the peering that follows OSDs coming back up.
+ *
+ * The PG mappings come from a real OSDMap (captured with 'ceph osd
+ * getmap -o osdmap.bin', or built here).  The restarted OSDs are marked
+ * down and up again, and every PG they serve goes through the peering
+ * round trips of the primary:
+ *
+ *   GetInfo     query every other shard, wait for all notifies
+ *   GetLog      if the primary restarted, fetch the log from a peer
+ *   GetMissing  if a replica restarted, fetch its log and missing
+ *   Activate    send activation to every shard, wait for all acks
+ *
+ * Each OSD has a messenger dispatch thread and osd_op_num_shards PG
+ * shards, all modelled as FIFO servers with fixed costs, joined by a
+ * network with a fixed one-way latency.  With --batch-delay the messages
+ * between two OSDs are coalesced as the OSD does with
+ * osd_peering_batch_delay.  The output is the time until every PG is
+ * active and the number of messages on the wire.
+ */
+
+#include <functional>
+#include <iostream>
+#include <queue>
+
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include "include/str_list.h"
+#include "osd/OSDMap.h"
+
+using std::cerr;
+using std::cout;
+using std::string;
+using std::vector;
+
+static void usage()
+{
+  cout << "usage: ceph_test_peering_sim [flags]\n"
+      "	 --osdmap <file>\n"
+      "	       OSDMap as written by 'ceph osd getmap -o <file>'\n"
+      "	 --osds <n> --pgs <n> --size <n>\n"
+      "	       shape of the synthetic OSDMap used without --osdmap\n"
+      "	 --restart <osd>[,<osd>...]\n"
+      "	       OSDs that come back up (default 0)\n"
+      "	 --shards <n>\n"
+      "	       PG shards per OSD (default 8)\n"
+      "	 --latency <us> --msg-cost <us> --sub-cost <us> --event-cost <us>\n"
+      "	       one-way network latency, messenger cost per wire message,\n"
+      "	       decode cost per peering message, PG cost per peering event\n"
+      "	 --batch-delay <us> --batch-max <n>\n"
+      "	       coalesce messages between two OSDs; the run is done once\n"
+      "	       without and once with batching\n" << std::endl;
+  generic_client_usage();
+}
+
+namespace {
+
+struct params_t {
+  unsigned shards = 8;
+  double latency = 100;     // all times in microseconds
+  double msg_cost = 30;
+  double sub_cost = 5;
+  double event_cost = 60;
+  double batch_delay = 0;
+  unsigned batch_max = 128;
+};
+
+struct pg_state_t {
+  int primary;
+  vector<int> peers;        // other shards
+  bool primary_restarted;
+  vector<int> restarted_peers;
+  unsigned waiting = 0;     // replies outstanding in the current phase
+  double active = 0;
+};
+
+class Sim {
+public:
+  Sim(const params_t& p, int num_osds)
+    : p(p),
+      dispatch_free(num_osds, 0.0),
+      shard_free(num_osds, vector<double>(p.shards, 0.0)) {}
+
+  void add_pg(pg_state_t pg) {
+    pgs.push_back(std::move(pg));
+  }
+
+  void run() {
+    for (size_t i = 0; i < pgs.size(); ++i) {
+      // every acting OSD advances the PG to the new map; the primary
+      // starts GetInfo when done
+      for (int osd : pgs[i].peers) {
+	pg_event(osd, i, 0, [](double) {});
+      }
+      pg_event(pgs[i].primary, i, 0, [this, i](double t) {
+	get_info(i, t);
+      });
+    }
+    while (!events.empty()) {
+      auto e = events.top();
+      events.pop();
+      now = e.t;
+      e.fn();
+    }
+  }
+
+  void report(const string& name) const {
+    vector<double> t;
+    for (auto& pg : pgs) {
+      t.push_back(pg.active);
+    }
+    std::sort(t.begin(), t.end());
+    auto pct = [&t](double q) {
+      return t.empty() ? 0 : t[std::min(t.size() - 1, size_t(q * t.size()))];
+    };
+    cout << name << ": " << pgs.size() << " pgs active after "
+	 << pct(1.0) / 1000 << " ms (p50 " << pct(0.5) / 1000
+	 << " ms, p99 " << pct(0.99) / 1000 << " ms), "
+	 << peering_msgs << " peering messages in " << wire_msgs
+	 << " wire messages" << std::endl;
+  }
+
+private:
+  struct event_t {
+    double t;
+    uint64_t seq;
+    std::function<void()> fn;
+    bool operator<(const event_t& o) const {
+      return t > o.t || (t == o.t && seq > o.seq);
+    }
+  };
+  using done_fn = std::function<void(double)>;
+
+  void at(double t, std::function<void()> fn) {
+    events.push(event_t{t, seq++, std::move(fn)});
+  }
+
+  /// run a peering event of pg on osd, arriving at t
+  void pg_event(int osd, size_t pg, double t, done_fn fn) {
+    double& free = shard_free[osd][pg % p.shards];
+    const double done = std::max(free, t) + p.event_cost;
+    free = done;
+    at(done, [fn = std::move(fn), done] { fn(done); });
+  }
+
+  /// one wire message carrying n peering messages arrives at osd
+  void deliver(int to, double t, vector<std::pair<size_t, done_fn>> subs) {
+    ++wire_msgs;
+    double& free = dispatch_free[to];
+    const double done =
+      std::max(free, t) + p.msg_cost + p.sub_cost * subs.size();
+    free = done;
+    at(done, [this, to, done, subs = std::move(subs)] {
+      for (auto& [pg, fn] : subs) {
+	pg_event(to, pg, done, fn);
+      }
+    });
+  }
+
+  /// send a peering message about pg; fn runs once the target handled it
+  void send(int from, int to, size_t pg, double t, done_fn fn) {
+    ++peering_msgs;
+    if (p.batch_delay <= 0) {
+      deliver(to, t + p.latency, {{pg, std::move(fn)}});
+      return;
+    }
+    auto& q = pending[{from, to}];
+    q.emplace_back(pg, std::move(fn));
+    if (q.size() >= p.batch_max) {
+      flush(from, to, t);
+    } else if (q.size() == 1) {
+      at(t + p.batch_delay, [this, from, to] { flush(from, to, now); });
+    }
+  }
+
+  void flush(int from, int to, double t) {
+    auto q = std::move(pending[{from, to}]);
+    pending.erase({from, to});
+    if (!q.empty()) {
+      deliver(to, t + p.latency, std::move(q));
+    }
+  }
+
+  /// send a request to each osd; next runs when all replies are handled
+  void round_trip(size_t i, double t, const vector<int>& osds,
+		  std::function<void(double)> next) {
+    auto& pg = pgs[i];
+    if (osds.empty()) {
+      next(t);
+      return;
+    }
+    pg.waiting = osds.size();
+    for (int osd : osds) {
+      send(pg.primary, osd, i, t, [this, i, osd, next](double t) {
+	send(osd, pgs[i].primary, i, t, [this, i, next](double t) {
+	  if (--pgs[i].waiting == 0) {
+	    next(t);
+	  }
+	});
+      });
+    }
+  }
+
+  void get_info(size_t i, double t) {
+    round_trip(i, t, pgs[i].peers, [this, i](double t) { get_log(i, t); });
+  }
+  void get_log(size_t i, double t) {
+    auto& pg = pgs[i];
+    vector<int> from;
+    if (pg.primary_restarted && !pg.peers.empty()) {
+      from.push_back(pg.peers.front());
+    }
+    round_trip(i, t, from, [this, i](double t) { get_missing(i, t); });
+  }
+  void get_missing(size_t i, double t) {
+    round_trip(i, t, pgs[i].restarted_peers,
+	       [this, i](double t) { activate(i, t); });
+  }
+  void activate(size_t i, double t) {
+    round_trip(i, t, pgs[i].peers,
+	       [this, i](double t) { pgs[i].active = t; });
+  }
+
+  const params_t p;
+  vector<pg_state_t> pgs;
+  vector<double> dispatch_free;
+  vector<vector<double>> shard_free;
+  std::map<std::pair<int, int>, vector<std::pair<size_t, done_fn>>> pending;
+  std::priority_queue<event_t> events;
+  uint64_t seq = 0;
+  double now = 0;
+  uint64_t peering_msgs = 0;
+  uint64_t wire_msgs = 0;
+};
+
+void build_osdmap(unsigned osds, unsigned pgs, unsigned size, OSDMap *osdmap)
+{
+  uuid_d fsid;
+  osdmap->build_simple(g_ceph_context, 0, fsid, osds);
+  OSDMap::Incremental inc(osdmap->get_epoch() + 1);
+  inc.fsid = osdmap->get_fsid();
+  entity_addrvec_t addrs;
+  addrs.v.push_back(entity_addr_t());
+  for (unsigned i = 0; i < osds; ++i) {
+    uuid_d uuid;
+    uuid.generate_random();
+    addrs.v[0].nonce = i;
+    inc.new_state[i] = CEPH_OSD_EXISTS | CEPH_OSD_NEW;
+    inc.new_up_client[i] = addrs;
+    inc.new_up_cluster[i] = addrs;
+    inc.new_hb_back_up[i] = addrs;
+    inc.new_hb_front_up[i] = addrs;
+    inc.new_weight[i] = CEPH_OSD_IN;
+    inc.new_uuid[i] = uuid;
+  }
+  osdmap->apply_incremental(inc);
+
+  OSDMap::Incremental pool_inc(osdmap->get_epoch() + 1);
+  pool_inc.fsid = osdmap->get_fsid();
+  pool_inc.new_pool_max = osdmap->get_pool_max() + 1;
+  pg_pool_t empty;
+  pg_pool_t *p = pool_inc.get_new_pool(pool_inc.new_pool_max, &empty);
+  p->size = size;
+  p->set_pg_num(pgs);
+  p->set_pgp_num(pgs);
+  p->type = pg_pool_t::TYPE_REPLICATED;
+  p->crush_rule = 0;
+  p->set_flag(pg_pool_t::FLAG_HASHPSPOOL);
+  pool_inc.new_pool_names[pool_inc.new_pool_max] = "sim";
+  osdmap->apply_incremental(pool_inc);
+}
+
+} // anonymous namespace
+
+int main(int argc, const char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  string osdmap_file;
+  unsigned osds = 100, pgs = 8192, size = 3;
+  std::set<int> restart = {0};
+  params_t params;
+  double batch_delay = 1000;
+  string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--osdmap", (char*)nullptr)) {
+      osdmap_file = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--osds", (char*)nullptr)) {
+      osds = std::max(2, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--pgs", (char*)nullptr)) {
+      pgs = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--size", (char*)nullptr)) {
+      size = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--restart", (char*)nullptr)) {
+      restart.clear();
+      vector<string> v;
+      get_str_vec(val, ",", v);
+      for (auto& o : v) {
+	restart.insert(atoi(o.c_str()));
+      }
+    } else if (ceph_argparse_witharg(args, i, &val, "--shards", (char*)nullptr)) {
+      params.shards = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--latency", (char*)nullptr)) {
+      params.latency = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--msg-cost", (char*)nullptr)) {
+      params.msg_cost = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--sub-cost", (char*)nullptr)) {
+      params.sub_cost = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--event-cost", (char*)nullptr)) {
+      params.event_cost = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--batch-delay", (char*)nullptr)) {
+      batch_delay = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--batch-max", (char*)nullptr)) {
+      params.batch_max = std::max(1, atoi(val.c_str()));
+    } else {
+      cerr << "unrecognized argument: " << *i << std::endl;
+      exit(1);
+    }
+  }
+  common_init_finish(g_ceph_context);
+
+  OSDMap osdmap;
+  if (!osdmap_file.empty()) {
+    bufferlist bl;
+    string err;
+    if (bl.read_file(osdmap_file.c_str(), &err) < 0) {
+      cerr << "error reading " << osdmap_file << ": " << err << std::endl;
+      exit(1);
+    }
+    try {
+      osdmap.decode(bl);
+    } catch (ceph::buffer::error& e) {
+      cerr << "error decoding " << osdmap_file << ": " << e.what() << std::endl;
+      exit(1);
+    }
+  } else {
+    build_osdmap(osds, pgs, size, &osdmap);
+  }
+
+  // the restarted osds come back with the mappings they had before going
+  // down, so the current map tells which pgs have to peer
+  vector<pg_state_t> affected;
+  for (auto& [pool, pi] : osdmap.get_pools()) {
+    for (ps_t ps = 0; ps < pi.get_pg_num(); ++ps) {
+      vector<int> acting;
+      int primary;
+      osdmap.pg_to_acting_osds(pg_t(ps, pool), &acting, &primary);
+      bool hit = false;
+      for (int o : acting) {
+	hit |= restart.count(o) > 0;
+      }
+      if (!hit || primary < 0) {
+	continue;
+      }
+      pg_state_t pg;
+      pg.primary = primary;
+      pg.primary_restarted = restart.count(primary);
+      for (int o : acting) {
+	if (o != primary && o != CRUSH_ITEM_NONE) {
+	  pg.peers.push_back(o);
+	  if (restart.count(o)) {
+	    pg.restarted_peers.push_back(o);
+	  }
+	}
+      }
+      affected.push_back(pg);
+    }
+  }
+  cout << "osdmap e" << osdmap.get_epoch() << " with "
+       << osdmap.get_num_osds() << " osds, " << affected.size()
+       << " pgs peer after restarting osds " << restart << std::endl;
+
+  {
+    Sim sim(params, osdmap.get_max_osd());
+    for (auto& pg : affected) {
+      sim.add_pg(pg);
+    }
+    sim.run();
+    sim.report("unbatched");
+  }
+  if (batch_delay > 0) {
+    params.batch_delay = batch_delay;
+    Sim sim(params, osdmap.get_max_osd());
+    for (auto& pg : affected) {
+      sim.add_pg(pg);
+    }
+    sim.run();
+    sim.report("batched");
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "osd/HeartbeatGossip.h"
+
+using std::vector;
+
+static const double ttl = 2, fallback = 20;
+
+TEST(HeartbeatGossip, lowest_reports)
+{
+  HeartbeatGossip g1(1), g2(2);
+  utime_t since(100, 0), now(103, 0);
+  g1.suspect(7, since);
+  g2.suspect(7, since);
+  vector<int32_t> confirmed_by;
+  // alone, nobody reports before the fallback
+  EXPECT_FALSE(g1.should_report(7, now, ttl, 2, fallback, &confirmed_by));
+
+  g1.handle_gossip(2, g2.get_gossip(16), now);
+  g2.handle_gossip(1, g1.get_gossip(16), now);
+  EXPECT_TRUE(g1.should_report(7, now, ttl, 2, fallback, &confirmed_by));
+  EXPECT_EQ(vector<int32_t>{2}, confirmed_by);
+  EXPECT_FALSE(g2.should_report(7, now, ttl, 2, fallback, &confirmed_by));
+  EXPECT_TRUE(confirmed_by.empty());
+
+  // osd.2 steps in if osd.1 did not get it marked down in time
+  EXPECT_TRUE(g2.should_report(7, since + utime_t(fallback, 0), ttl, 2,
+			       fallback, &confirmed_by));
+}
+
+TEST(HeartbeatGossip, expires)
+{
+  HeartbeatGossip g(1);
+  utime_t now(100, 0);
+  g.suspect(7, now);
+  g.handle_gossip(2, {7}, now);
+  vector<int32_t> confirmed_by;
+  EXPECT_TRUE(g.should_report(7, now + utime_t(1, 0), ttl, 2, fallback,
+			      &confirmed_by));
+  EXPECT_FALSE(g.should_report(7, now + utime_t(3, 0), ttl, 2, fallback,
+			       &confirmed_by));
+
+  g.handle_gossip(2, {7}, now);
+  g.forget(2);
+  EXPECT_FALSE(g.should_report(7, now, ttl, 2, fallback, &confirmed_by));
+
+  // not suspected by us, reported as before
+  EXPECT_TRUE(g.should_report(8, now, ttl, 2, fallback, &confirmed_by));
+}
+
+TEST(HeartbeatGossip, rotates)
+{
+  HeartbeatGossip g(0);
+  for (int osd = 1; osd <= 5; ++osd) {
+    g.suspect(osd, utime_t(1, 0));
+  }
+  EXPECT_EQ((vector<int32_t>{1, 2}), g.get_gossip(2));
+  EXPECT_EQ((vector<int32_t>{3, 4}), g.get_gossip(2));
+  EXPECT_EQ((vector<int32_t>{5, 1}), g.get_gossip(2));
+  g.clear(2);
+  EXPECT_EQ((vector<int32_t>{3, 4, 5}), g.get_gossip(3));
+  EXPECT_EQ((vector<int32_t>{1, 3, 4, 5}), g.get_gossip(4));
+}
+
+TEST(HeartbeatGossip, reported)
+{
+  HeartbeatGossip g(0);
+  g.reported(7, {2, 3});
+  EXPECT_EQ((vector<int32_t>{2, 3}), g.take_reported(7));
+  EXPECT_TRUE(g.take_reported(7).empty());
+}
@@ -1183,6 +1183,54 @@ TEST(pg_missing_t, add_next_event)
   }
 }
 
+TEST(pg_missing_t, add_next_event_dirty_regions)
+{
+  hobject_t oid(object_t("objname"), "key", 123, 456, 0, "");
+  const uint64_t object_size = 4 << 20;
+  pg_log_entry_t e(pg_log_entry_t::MODIFY, oid, eversion_t(10, 5),
+		   eversion_t(3, 4), 0,
+		   osd_reqid_t(entity_name_t::CLIENT(777), 8, 999),
+		   utime_t(8, 9), 0);
+  auto dirty_bytes = [&](const pg_missing_t& missing) {
+    interval_set<uint64_t> dirty;
+    dirty.insert(0, object_size);
+    dirty.intersection_of(
+      missing.get_items().at(oid).clean_regions.get_dirty_regions());
+    return dirty.size();
+  };
+
+  // a 4K overwrite leaves the rest of the object to be kept in place
+  pg_missing_t missing;
+  e.clean_regions.mark_data_region_dirty(4096, 4096);
+  missing.add_next_event(e);
+  EXPECT_EQ(4096U, dirty_bytes(missing));
+  EXPECT_FALSE(missing.get_items().at(oid).clean_regions.omap_is_dirty());
+
+  // later writes accumulate
+  e.version = eversion_t(10, 6);
+  e.prior_version = eversion_t(10, 5);
+  e.clean_regions = ObjectCleanRegions();
+  e.clean_regions.mark_data_region_dirty(1 << 20, 4096);
+  missing.add_next_event(e);
+  EXPECT_EQ(8192U, dirty_bytes(missing));
+  EXPECT_TRUE(missing.get_items().at(oid).clean_regions.object_is_exist());
+
+  // a reverted object has nothing to reuse
+  e.version = eversion_t(10, 7);
+  e.prior_version = eversion_t(10, 6);
+  e.op = pg_log_entry_t::LOST_REVERT;
+  missing.add_next_event(e);
+  EXPECT_EQ(object_size, dirty_bytes(missing));
+
+  // nor has a new one
+  pg_missing_t created;
+  e.op = pg_log_entry_t::MODIFY;
+  e.prior_version = eversion_t();
+  created.add_next_event(e);
+  EXPECT_EQ(object_size, dirty_bytes(created));
+  EXPECT_FALSE(created.get_items().at(oid).clean_regions.object_is_exist());
+}
+
 TEST(pg_missing_t, revise_need)
 {
   hobject_t oid(object_t("objname"), "key", 123, 456, 0, "");
@@ -38,6 +38,10 @@ class Config:
         # allow some time for realm reconfiguration after changing master zone
         self.reconfigure_delay = kwargs.get('reconfigure_delay', 5)
         self.tenant = kwargs.get('tenant', '')
+        # number and size of the objects written by the sync benchmark,
+        # which is skipped unless sync_bench_objects is set
+        self.sync_bench_objects = kwargs.get('sync_bench_objects', 0)
+        self.sync_bench_object_size = kwargs.get('sync_bench_object_size', 4096)
 
 # rgw multisite tests, written against the interfaces provided in rgw_multi.
 # these tests must be initialized and run by another module that provides
@@ -1325,3 +1329,72 @@ def test_bucket_creation_time():
         for a, b in zip(z1, z2):
             eq(a.name, b.name)
             eq(a.creation_date, b.creation_date)
+
+def bucket_num_objects(zone, bucket_name):
+    cmd = ['bucket', 'stats', '--bucket', bucket_name] + zone.zone_args()
+    cmd += ['--tenant', config.tenant, '--uid', user.name] if config.tenant else []
+    stats_json, _ = zone.cluster.admin(cmd, read_only=True)
+    usage = json.loads(stats_json).get('usage', {})
+    return usage.get('rgw.main', {}).get('num_objects', 0)
+
+def wait_for_bucket_objects(zone, bucket_name, num_objects):
+    """ poll the bucket stats until the bucket holds num_objects objects """
+    deadline = time.time() + config.checkpoint_retries * config.checkpoint_delay
+    while bucket_num_objects(zone, bucket_name) < num_objects:
+        assert time.time() < deadline, \
+            'bucket %s did not sync to zone %s' % (bucket_name, zone.name)
+        time.sleep(0.5)
+
+def log_sync_throughput(kind, zone, num_objects, obj_size, secs):
+    log.info('sync bench: %s sync of %d objects to zone=%s took %.2fs, '
+             '%.1f objects/s, %.1f bytes/s', kind, num_objects, zone.name, secs,
+             num_objects / secs, num_objects * obj_size / secs)
+
+@attr('sync_bench')
+def test_bucket_sync_throughput():
+    """ measure full and incremental sync throughput of a single bucket """
+    if not config.sync_bench_objects:
+        raise SkipTest('sync_bench_objects is not set')
+
+    zonegroup = realm.master_zonegroup()
+    zonegroup_conns = ZonegroupConns(zonegroup)
+    source = zonegroup_conns.rw_zones[0]
+    targets = [conn.zone for conn in zonegroup_conns.zones
+               if conn.zone != source.zone and conn.zone.has_buckets()
+               and conn.zone.syncs_from(source.zone.name)]
+    if not targets:
+        raise SkipTest('no zone syncs from %s' % source.zone.name)
+
+    num_objects = config.sync_bench_objects
+    obj_size = config.sync_bench_object_size
+    content = 'x' * obj_size
+
+    # full sync: fill the bucket while its sync is disabled, then time how
+    # long the other zones take to catch up once it is enabled again
+    bucket_name = gen_bucket_name()
+    bucket = source.create_bucket(bucket_name)
+    disable_bucket_sync(realm.meta_master_zone(), bucket_name)
+    zonegroup_meta_checkpoint(zonegroup)
+
+    for i in range(num_objects):
+        bucket.new_key('obj%d' % i).set_contents_from_string(content)
+
+    enable_bucket_sync(realm.meta_master_zone(), bucket_name)
+    start = time.time()
+    for zone in targets:
+        wait_for_bucket_objects(zone, bucket_name, num_objects)
+        log_sync_throughput('full', zone, num_objects, obj_size, time.time() - start)
+
+    # incremental sync: time from the first write until the other zones
+    # hold every object
+    bucket_name = gen_bucket_name()
+    bucket = source.create_bucket(bucket_name)
+    zonegroup_meta_checkpoint(zonegroup)
+
+    start = time.time()
+    for i in range(num_objects):
+        bucket.new_key('obj%d' % i).set_contents_from_string(content)
+
+    for zone in targets:
+        wait_for_bucket_objects(zone, bucket_name, num_objects)
+        log_sync_throughput('incremental', zone, num_objects, obj_size, time.time() - start)
@@ -184,6 +184,8 @@ def init(parse_args):
                                          'checkpoint_delay': 5,
                                          'reconfigure_delay': 5,
                                          'use_ssl': 'false',
+                                         'sync_bench_objects': 0,
+                                         'sync_bench_object_size': 4096,
                                          })
     try:
         path = os.environ['RGW_MULTI_TEST_CONF']
@@ -215,6 +217,8 @@ def init(parse_args):
     parser.add_argument('--reconfigure-delay', type=int, default=cfg.getint(section, 'reconfigure_delay'))
     parser.add_argument('--num-ps-zones', type=int, default=cfg.getint(section, 'num_ps_zones'))
     parser.add_argument('--use-ssl', type=bool, default=cfg.getboolean(section, 'use_ssl'))
+    parser.add_argument('--sync-bench-objects', type=int, default=cfg.getint(section, 'sync_bench_objects'))
+    parser.add_argument('--sync-bench-object-size', type=int, default=cfg.getint(section, 'sync_bench_object_size'))
 
 
     es_cfg = []
@@ -419,7 +423,9 @@ def init(parse_args):
     config = Config(checkpoint_retries=args.checkpoint_retries,
                     checkpoint_delay=args.checkpoint_delay,
                     reconfigure_delay=args.reconfigure_delay,
-                    tenant=args.tenant)
+                    tenant=args.tenant,
+                    sync_bench_objects=args.sync_bench_objects,
+                    sync_bench_object_size=args.sync_bench_object_size)
     init_multi(realm, user, config)
 
 def setup_module():
@@ -0,0 +1,290 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw/rgw_bucket_list_merge.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <gtest/gtest.h>
+
+namespace {
+
+/*
+ * An in-memory bucket index that lists like cls_rgw's bucket_list: up to
+ * num_entries keys after the marker, with is_truncated and the marker to
+ * continue from.  It counts the requests and entries it serves.
+ */
+struct SimIndex {
+  std::vector<std::map<std::string, rgw_bucket_dir_entry>> shards;
+  uint64_t round_trips = 0;  // batches of parallel requests
+  uint64_t requests = 0;
+  uint64_t entries_read = 0;
+
+  explicit SimIndex(int num_shards) : shards(num_shards) {}
+
+  void add(int shard, const std::string& name) {
+    rgw_bucket_dir_entry e;
+    e.key = cls_rgw_obj_key(name);
+    e.exists = true;
+    shards[shard][name] = e;
+  }
+
+  rgw_cls_list_ret list(int shard, const cls_rgw_obj_key& marker,
+			uint32_t num_entries) {
+    rgw_cls_list_ret ret;
+    ret.cls_filtered = true;
+    auto& m = shards[shard];
+    auto i = m.upper_bound(marker.name);
+    for (; i != m.end() && ret.dir.m.size() < num_entries; ++i) {
+      ret.dir.m.emplace(i->first, i->second);
+    }
+    ret.is_truncated = (i != m.end());
+    if (ret.is_truncated) {
+      ret.marker = ret.dir.m.rbegin()->second.key;
+    }
+    ++requests;
+    entries_read += ret.dir.m.size();
+    return ret;
+  }
+
+  RGWBucketListMerger::fetch_func_t fetcher() {
+    return [this](const std::map<int, cls_rgw_obj_key>& markers,
+		  uint32_t num_entries,
+		  std::map<int, rgw_cls_list_ret>& results) {
+      ++round_trips;
+      for (auto& [shard, marker] : markers)
+	results[shard] = list(shard, marker, num_entries);
+      return 0;
+    };
+  }
+
+  std::vector<int> shard_ids() const {
+    std::vector<int> ids;
+    for (size_t i = 0; i < shards.size(); ++i)
+      ids.push_back(i);
+    return ids;
+  }
+};
+
+std::string obj_name(int i)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "obj%08d", i);
+  return buf;
+}
+
+void fill_random(SimIndex& index, int num_objs, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> shard(0, index.shards.size() - 1);
+  for (int i = 0; i < num_objs; ++i)
+    index.add(shard(gen), obj_name(i));
+}
+
+// one listing call with the merger; returns the names, sets the marker
+std::vector<std::string> merged_page(SimIndex& index,
+				     cls_rgw_obj_key& marker,
+				     uint32_t num_entries,
+				     bool *truncated)
+{
+  RGWBucketListMerger merger(index.fetcher(), num_entries);
+  int r = merger.init(index.shard_ids(), marker);
+  EXPECT_EQ(0, r);
+  std::vector<std::string> names;
+  RGWBucketListMerger::entry_ref_t next;
+  while (names.size() < num_entries && merger.peek(&next) == 0) {
+    names.push_back(*next.name);
+    marker = next.entry->key;
+    merger.pop();
+  }
+  *truncated = merger.is_truncated();
+  return names;
+}
+
+/*
+ * The listing as it was before the merger: every call lists all shards
+ * after the marker and stops merging as soon as one truncated shard runs
+ * out, and the caller retries with growing batches until it has at least
+ * half a page.
+ */
+std::vector<std::string> legacy_page(SimIndex& index,
+				     cls_rgw_obj_key& marker,
+				     uint32_t num_entries,
+				     bool *truncated)
+{
+  std::vector<std::string> names;
+  const uint32_t nshards = index.shards.size();
+  for (uint32_t attempt = 1; ; ++attempt) {
+    uint32_t want = num_entries - names.size();
+    uint32_t batch = std::min(want, (1u << std::min(attempt - 1, 10u)) *
+			      RGWBucketListMerger::calc_first_batch(want, nshards));
+    std::vector<rgw_cls_list_ret> results;
+    ++index.round_trips;
+    for (uint32_t s = 0; s < nshards; ++s)
+      results.push_back(index.list(s, marker, batch));
+
+    std::vector<decltype(results[0].dir.m.begin())> cursors;
+    for (auto& r : results)
+      cursors.push_back(r.dir.m.begin());
+    while (names.size() < num_entries) {
+      int best = -1;
+      for (uint32_t s = 0; s < nshards; ++s) {
+	if (cursors[s] != results[s].dir.m.end() &&
+	    (best < 0 || cursors[s]->first < cursors[best]->first))
+	  best = s;
+      }
+      if (best < 0)
+	break;
+      names.push_back(cursors[best]->first);
+      marker = cursors[best]->second.key;
+      if (++cursors[best] == results[best].dir.m.end() &&
+	  results[best].is_truncated)
+	break;
+    }
+    *truncated = false;
+    for (uint32_t s = 0; s < nshards; ++s) {
+      if (cursors[s] != results[s].dir.m.end() || results[s].is_truncated)
+	*truncated = true;
+    }
+    if (!*truncated || names.size() >= (num_entries + 1) / 2 || attempt > 8)
+      break;
+  }
+  return names;
+}
+
+template <typename PageFunc>
+std::vector<std::string> list_all(SimIndex& index, uint32_t page_size,
+				  PageFunc page)
+{
+  std::vector<std::string> all;
+  cls_rgw_obj_key marker;
+  bool truncated = true;
+  while (truncated) {
+    auto names = page(index, marker, page_size, &truncated);
+    all.insert(all.end(), names.begin(), names.end());
+  }
+  return all;
+}
+
+} // anonymous namespace
+
+TEST(RGWBucketListMerger, Ordered)
+{
+  SimIndex index(17);
+  fill_random(index, 5000, 1);
+
+  auto all = list_all(index, 100, merged_page);
+  ASSERT_EQ(5000u, all.size());
+  for (int i = 0; i < 5000; ++i)
+    ASSERT_EQ(obj_name(i), all[i]);
+}
+
+TEST(RGWBucketListMerger, RefillOnlyExhaustedShard)
+{
+  // one shard holds almost everything
+  SimIndex index(8);
+  for (int i = 0; i < 1000; ++i)
+    index.add(i % 100 == 0 ? i / 100 % 8 : 3, obj_name(i));
+
+  cls_rgw_obj_key marker;
+  bool truncated;
+  auto names = merged_page(index, marker, 1000, &truncated);
+  ASSERT_EQ(1000u, names.size());
+  ASSERT_FALSE(truncated);
+  // 8 shards on the first round, then doubling batches of shard 3 only
+  ASSERT_LT(index.requests, 8u + 10u);
+}
+
+TEST(RGWBucketListMerger, RefillShardsRunningLowTogether)
+{
+  // the first half of the keys alternates between shards 0 and 1, the
+  // second half between shards 2 and 3
+  SimIndex index(4);
+  for (int i = 0; i < 2000; ++i)
+    index.add((i < 1000 ? 0 : 2) + i % 2, obj_name(i));
+
+  cls_rgw_obj_key marker;
+  bool truncated;
+  auto names = merged_page(index, marker, 1000, &truncated);
+  ASSERT_EQ(1000u, names.size());
+  ASSERT_EQ(obj_name(999), names.back());
+  ASSERT_TRUE(truncated);
+  // shards 0 and 1 run out one entry apart, and are refilled in the same
+  // round trip
+  ASSERT_EQ(2u, index.round_trips);
+  ASSERT_EQ(6u, index.requests);
+}
+
+TEST(RGWBucketListMerger, CommonPrefixesOnce)
+{
+  SimIndex index(4);
+  // every shard returns the same common prefix
+  for (int s = 0; s < 4; ++s)
+    index.add(s, "dir/");
+  index.add(0, "a");
+  index.add(2, "z");
+
+  cls_rgw_obj_key marker;
+  bool truncated;
+  auto names = merged_page(index, marker, 10, &truncated);
+  ASSERT_EQ((std::vector<std::string>{"a", "dir/", "z"}), names);
+}
+
+TEST(RGWBucketListMerger, Stalled)
+{
+  // a shard that claims more entries but does not advance its marker
+  auto fetch = [](const std::map<int, cls_rgw_obj_key>& markers,
+		  uint32_t num_entries,
+		  std::map<int, rgw_cls_list_ret>& results) {
+    for (auto& [shard, marker] : markers) {
+      rgw_cls_list_ret& ret = results[shard];
+      ret.is_truncated = true;
+      ret.marker = cls_rgw_obj_key("m");
+    }
+    return 0;
+  };
+  RGWBucketListMerger merger(fetch, 100);
+  ASSERT_EQ(0, merger.init({0, 1}, cls_rgw_obj_key(), 10));
+  RGWBucketListMerger::entry_ref_t next;
+  ASSERT_EQ(-ENOENT, merger.peek(&next));
+  ASSERT_TRUE(merger.is_truncated());
+}
+
+TEST(RGWBucketListMerger, Benchmark)
+{
+  const int num_objs = 50000;
+  const uint32_t page_size = 1000;
+
+  for (int num_shards : {16, 128, 512}) {
+    SimIndex legacy(num_shards), merged(num_shards);
+    fill_random(legacy, num_objs, 2);
+    fill_random(merged, num_objs, 2);
+
+    auto l = list_all(legacy, page_size, legacy_page);
+    auto m = list_all(merged, page_size, merged_page);
+    ASSERT_EQ(l, m);
+    ASSERT_EQ(size_t(num_objs), m.size());
+
+    std::cout << num_shards << " shards, " << num_objs << " objects, pages of "
+	      << page_size << ":" << std::endl
+	      << "  legacy: " << legacy.round_trips << " round trips, "
+	      << legacy.requests << " requests, "
+	      << legacy.entries_read << " entries read ("
+	      << double(legacy.entries_read) / num_objs << "x)" << std::endl
+	      << "  merged: " << merged.round_trips << " round trips, "
+	      << merged.requests << " requests, "
+	      << merged.entries_read << " entries read ("
+	      << double(merged.entries_read) / num_objs << "x)" << std::endl;
+    EXPECT_LE(merged.entries_read, legacy.entries_read);
+  }
+}
@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw/rgw_frequency_sketch.h"
+#include <functional>
+#include <string>
+#include <gtest/gtest.h>
+
+static uint64_t h(const std::string& s)
+{
+  return std::hash<std::string>()(s);
+}
+
+TEST(RGWFrequencySketch, Estimate)
+{
+  RGWFrequencySketch sketch(1000);
+  ASSERT_EQ(0u, sketch.estimate(h("a")));
+  for (int i = 0; i < 5; ++i)
+    sketch.increment(h("a"));
+  sketch.increment(h("b"));
+  // count-min never underestimates
+  ASSERT_GE(sketch.estimate(h("a")), 5u);
+  ASSERT_GE(sketch.estimate(h("b")), 1u);
+  ASSERT_GT(sketch.estimate(h("a")), sketch.estimate(h("b")));
+}
+
+TEST(RGWFrequencySketch, Saturate)
+{
+  RGWFrequencySketch sketch(1000);
+  for (int i = 0; i < 100; ++i)
+    sketch.increment(h("a"));
+  ASSERT_EQ(15u, sketch.estimate(h("a")));
+}
+
+TEST(RGWFrequencySketch, Aging)
+{
+  RGWFrequencySketch sketch(10);
+  for (int i = 0; i < 8; ++i)
+    sketch.increment(h("hot"));
+  ASSERT_FALSE(sketch.needs_aging());
+  for (int i = 0; i < 100; ++i)
+    sketch.increment(h("key" + std::to_string(i)));
+  ASSERT_TRUE(sketch.needs_aging());
+
+  unsigned before = sketch.estimate(h("hot"));
+  sketch.age();
+  ASSERT_FALSE(sketch.needs_aging());
+  ASSERT_EQ(before / 2, sketch.estimate(h("hot")));
+}
+
+TEST(RGWFrequencySketch, HotKeysStandOut)
+{
+  // a small set of hot keys among a scan of one-off keys
+  RGWFrequencySketch sketch(100);
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 10; ++i)
+      sketch.increment(h("hot" + std::to_string(i)));
+    for (int i = 0; i < 50; ++i)
+      sketch.increment(h("scan" + std::to_string(round * 50 + i)));
+  }
+  unsigned hot_min = 15;
+  for (int i = 0; i < 10; ++i)
+    hot_min = std::min(hot_min, sketch.estimate(h("hot" + std::to_string(i))));
+  unsigned cold = 0;
+  for (int i = 0; i < 500; ++i) {
+    if (sketch.estimate(h("scan" + std::to_string(i))) >= hot_min)
+      ++cold;
+  }
+  ASSERT_GE(hot_min, 5u);
+  ASSERT_LT(cold, 25);
+}
@@ -0,0 +1,148 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Runs the garbage collector of the configured zone against chains it is
+ * handed here, so run it against a test cluster only.
+ */
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include "include/rados/librados.hpp"
+#include "rgw/rgw_rados.h"
+#include "rgw/rgw_sal.h"
+#include "test/librados/test_cxx.h"
+#include "gtest/gtest.h"
+
+static rgw::sal::RGWRadosStore *store = nullptr;
+
+class rgw_gc : public ::testing::Test {
+ protected:
+  std::string pool_name;
+  librados::IoCtx ioctx;
+  // tags of this test's chains, so that other gc entries are left alone
+  std::string tag_prefix;
+
+  void SetUp() override {
+    auto rados = store->getRados()->get_rados_handle();
+    pool_name = get_temp_pool_name();
+    ASSERT_EQ("", create_one_pool_pp(pool_name, *rados));
+    ASSERT_EQ(0, rados->ioctx_create(pool_name.c_str(), ioctx));
+    tag_prefix = pool_name + "." +
+      ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".";
+  }
+  void TearDown() override {
+    g_ceph_context->_conf.rm_val("rgw_gc_obj_min_wait");
+    g_ceph_context->_conf.apply_changes(nullptr);
+    ioctx.close();
+    ASSERT_EQ(0, destroy_one_pool_pp(pool_name,
+				     *store->getRados()->get_rados_handle()));
+  }
+
+  static void set_min_wait(const char *secs) {
+    g_ceph_context->_conf.set_val_or_die("rgw_gc_obj_min_wait", secs);
+    g_ceph_context->_conf.apply_changes(nullptr);
+  }
+
+  // write one object per chain and hand the chains to gc
+  void send_chains(const std::string& name, int n) {
+    for (int i = 0; i < n; ++i) {
+      const std::string oid = name + "." + std::to_string(i);
+      ASSERT_EQ(0, ioctx.create(oid, false));
+      cls_rgw_obj_chain chain;
+      chain.push_obj(pool_name, cls_rgw_obj_key(oid), "");
+      ASSERT_EQ(0, store->getRados()->send_chain_to_gc(chain, tag_prefix + oid));
+    }
+  }
+
+  // the tags of this test's chains that gc still has
+  std::set<std::string> list_tags() {
+    std::set<std::string> tags;
+    int index = 0;
+    std::string marker;
+    bool truncated;
+    bool processing_queue = false;
+    do {
+      std::list<cls_rgw_gc_obj_info> result;
+      int ret = store->getRados()->list_gc_objs(&index, marker, 1000, false,
+						result, &truncated,
+						processing_queue);
+      EXPECT_EQ(0, ret);
+      if (ret < 0) {
+	break;
+      }
+      for (auto& info : result) {
+	if (info.tag.compare(0, tag_prefix.size(), tag_prefix) == 0) {
+	  tags.insert(info.tag.substr(tag_prefix.size()));
+	}
+      }
+    } while (truncated);
+    return tags;
+  }
+
+  std::set<std::string> list_objects() {
+    std::set<std::string> oids;
+    for (auto i = ioctx.nobjects_begin(); i != ioctx.nobjects_end(); ++i) {
+      oids.insert(i->get_oid());
+    }
+    return oids;
+  }
+};
+
+TEST_F(rgw_gc, trims_processed_entries_followed_by_unexpired)
+{
+  // fewer entries than rgw_gc_max_queue_trim_entries, so only the end of
+  // each shard's listing can trim them
+  const int n = 20;
+  set_min_wait("0");
+  send_chains("expired", n);
+  set_min_wait("7200");
+  send_chains("unexpired", n);
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+
+  std::set<std::string> unexpired;
+  for (int i = 0; i < n; ++i) {
+    unexpired.insert("unexpired." + std::to_string(i));
+  }
+
+  ASSERT_EQ(0, store->getRados()->process_gc(true));
+  EXPECT_EQ(unexpired, list_objects());
+  EXPECT_EQ(unexpired, list_tags());
+
+  // a second pass has nothing left to do
+  ASSERT_EQ(0, store->getRados()->process_gc(true));
+  EXPECT_EQ(unexpired, list_objects());
+  EXPECT_EQ(unexpired, list_tags());
+
+  // clean up after ourselves
+  ASSERT_EQ(0, store->getRados()->process_gc(false));
+  EXPECT_TRUE(list_tags().empty());
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  store = RGWStoreManager::get_storage(g_ceph_context, false, false, false,
+				       false, false);
+  if (!store) {
+    std::cerr << "couldn't init storage provider" << std::endl;
+    return EIO;
+  }
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int r = RUN_ALL_TESTS();
+  RGWStoreManager::close_storage(store);
+  return r;
+}
@@ -0,0 +1,212 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Measure how fast the garbage collector drains a synthetic backlog.
+ *
+ * Writes --objects tail objects into --pool, hands them to gc in chains of
+ * --chain-size objects, then runs one gc pass over every shard (ignoring the
+ * expiration time) and reports the number of objects removed per second.
+ *
+ * This uses the gc queues of the configured zone, so run it against a test
+ * cluster only. Compare gc settings by passing them on the command line,
+ * e.g. --rgw_gc_max_concurrent_io_adaptive=128.
+ */
+
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "include/rados/librados.hpp"
+#include "rgw/rgw_rados.h"
+#include "rgw/rgw_sal.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+namespace {
+
+class StoreDestructor {
+  rgw::sal::RGWRadosStore *store;
+public:
+  explicit StoreDestructor(rgw::sal::RGWRadosStore *_s) : store(_s) {}
+  ~StoreDestructor() {
+    if (store) {
+      RGWStoreManager::close_storage(store);
+    }
+  }
+};
+
+void usage()
+{
+  std::cout << "usage: ceph_test_rgw_gc_bench [options]\n"
+            << "  --pool <name>        pool for the synthetic tail objects (default gc-bench)\n"
+            << "  --objects <n>        number of objects to collect (default 10000)\n"
+            << "  --chain-size <n>     objects per gc chain (default 4)\n"
+            << "  --max-writes <n>     concurrent writes while filling (default 64)\n";
+  generic_client_usage();
+}
+
+uint64_t count_objects(librados::IoCtx& ioctx)
+{
+  uint64_t n = 0;
+  for (auto i = ioctx.nobjects_begin(); i != ioctx.nobjects_end(); ++i) {
+    ++n;
+  }
+  return n;
+}
+
+int write_objects(librados::IoCtx& ioctx, const std::vector<std::string>& oids,
+		  size_t max_writes)
+{
+  std::deque<librados::AioCompletion*> pending;
+  int ret = 0;
+  auto reap = [&]() {
+    auto c = pending.front();
+    c->wait_for_complete();
+    if (c->get_return_value() < 0) {
+      ret = c->get_return_value();
+    }
+    c->release();
+    pending.pop_front();
+  };
+  for (auto& oid : oids) {
+    if (pending.size() >= max_writes) {
+      reap();
+    }
+    librados::ObjectWriteOperation op;
+    op.create(false);
+    auto c = librados::Rados::aio_create_completion(nullptr, nullptr);
+    int r = ioctx.aio_operate(oid, c, &op);
+    if (r < 0) {
+      c->release();
+      ret = r;
+      break;
+    }
+    pending.push_back(c);
+  }
+  while (!pending.empty()) {
+    reap();
+  }
+  return ret;
+}
+
+} // anonymous namespace
+
+int main(int argc, const char **argv)
+{
+  std::vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY, 0);
+
+  std::string pool = "gc-bench";
+  int num_objects = 10000;
+  int chain_size = 4;
+  int max_writes = 64;
+  std::string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--pool", (char*)NULL)) {
+      pool = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--objects", (char*)NULL)) {
+      num_objects = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--chain-size", (char*)NULL)) {
+      chain_size = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--max-writes", (char*)NULL)) {
+      max_writes = atoi(val.c_str());
+    } else {
+      std::cerr << "unrecognized arg " << *i << std::endl;
+      usage();
+      exit(1);
+    }
+  }
+  if (num_objects <= 0 || chain_size <= 0 || max_writes <= 0) {
+    std::cerr << "--objects, --chain-size and --max-writes must be positive" << std::endl;
+    exit(1);
+  }
+
+  common_init_finish(g_ceph_context);
+
+  auto store = RGWStoreManager::get_storage(g_ceph_context, false, false,
+					     false, false, false);
+  if (!store) {
+    std::cerr << "couldn't init storage provider" << std::endl;
+    return EIO;
+  }
+  StoreDestructor store_dtor(store);
+  RGWRados *rados = store->getRados();
+
+  int r = rados->get_rados_handle()->pool_create(pool.c_str());
+  if (r < 0 && r != -EEXIST) {
+    std::cerr << "failed to create pool " << pool << ": " << cpp_strerror(r) << std::endl;
+    return -r;
+  }
+  librados::IoCtx ioctx;
+  r = rados->get_rados_handle()->ioctx_create(pool.c_str(), ioctx);
+  if (r < 0) {
+    std::cerr << "failed to open pool " << pool << ": " << cpp_strerror(r) << std::endl;
+    return -r;
+  }
+
+  const uint64_t before = count_objects(ioctx);
+
+  std::vector<std::string> oids;
+  oids.reserve(num_objects);
+  for (int i = 0; i < num_objects; ++i) {
+    oids.push_back("gc_bench." + std::to_string(i));
+  }
+
+  auto start = ceph::mono_clock::now();
+  r = write_objects(ioctx, oids, max_writes);
+  if (r < 0) {
+    std::cerr << "failed to write objects: " << cpp_strerror(r) << std::endl;
+    return -r;
+  }
+  for (int i = 0; i < num_objects; i += chain_size) {
+    cls_rgw_obj_chain chain;
+    for (int j = i; j < std::min(i + chain_size, num_objects); ++j) {
+      chain.push_obj(pool, cls_rgw_obj_key(oids[j]), "");
+    }
+    r = rados->send_chain_to_gc(chain, "gc_bench." + std::to_string(i));
+    if (r < 0) {
+      std::cerr << "failed to send chain to gc: " << cpp_strerror(r) << std::endl;
+      return -r;
+    }
+  }
+  double fill_secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+  std::cout << "backlog: " << num_objects << " objects in "
+            << (num_objects + chain_size - 1) / chain_size << " chains, "
+            << fill_secs << " s" << std::endl;
+
+  start = ceph::mono_clock::now();
+  r = rados->process_gc(false);
+  double gc_secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+  if (r < 0) {
+    std::cerr << "gc process failed: " << cpp_strerror(r) << std::endl;
+    return -r;
+  }
+
+  const uint64_t after = count_objects(ioctx);
+  const uint64_t removed = before + num_objects > after ?
+    before + num_objects - after : 0;
+  std::cout << "gc: removed " << removed << " objects in " << gc_secs << " s, "
+            << (gc_secs > 0 ? removed / gc_secs : 0) << " objects/sec" << std::endl;
+  std::cout << "gc: rgw_gc_max_concurrent_io=" << cct->_conf->rgw_gc_max_concurrent_io
+            << " rgw_gc_max_concurrent_io_adaptive="
+            << cct->_conf.get_val<uint64_t>("rgw_gc_max_concurrent_io_adaptive")
+            << " rgw_gc_max_queue_trim_entries="
+            << cct->_conf.get_val<uint64_t>("rgw_gc_max_queue_trim_entries") << std::endl;
+
+  return removed == (uint64_t)num_objects ? 0 : 1;
+}
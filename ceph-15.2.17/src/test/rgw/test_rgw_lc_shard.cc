@@ -0,0 +1,460 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <thread>
+
+#include "rgw/rgw_lc.h"
+#include "global/global_context.h"
+
+#include "test/librados/test_cxx.h"
+#include "gtest/gtest.h"
+
+// creates a rados client and temporary pool
+struct RadosEnv : public ::testing::Environment {
+  static std::optional<std::string> pool_name;
+ public:
+  static std::optional<librados::Rados> rados;
+
+  void SetUp() override {
+    rados.emplace();
+    // create pool
+    std::string name = get_temp_pool_name();
+    ASSERT_EQ("", create_one_pool_pp(name, *rados));
+    pool_name = name;
+  }
+  void TearDown() override {
+    if (pool_name) {
+      ASSERT_EQ(0, destroy_one_pool_pp(*pool_name, *rados));
+    }
+    rados.reset();
+  }
+
+  static int ioctx_create(librados::IoCtx& ioctx) {
+    return rados->ioctx_create(pool_name->c_str(), ioctx);
+  }
+};
+std::optional<std::string> RadosEnv::pool_name;
+std::optional<librados::Rados> RadosEnv::rados;
+
+auto *const rados_env = ::testing::AddGlobalTestEnvironment(new RadosEnv);
+
+class rgw_lc_shard : public ::testing::Test {
+ protected:
+  static librados::IoCtx ioctx;
+
+  static void SetUpTestSuite() {
+    ASSERT_EQ(0, RadosEnv::ioctx_create(ioctx));
+  }
+  static void TearDownTestSuite() {
+    ioctx.close();
+  }
+
+  // use the test's name as the oid so different tests don't conflict
+  std::string get_test_oid() const {
+    return ::testing::UnitTest::GetInstance()->current_test_info()->name();
+  }
+
+  static RGWLC::ShardLease make_lease(const std::string& oid, int shard,
+				      const std::string& cookie,
+				      int duration = 60) {
+    return RGWLC::ShardLease(ioctx, oid, shard, cookie, utime_t(duration, 0));
+  }
+
+  static rgw_lc_shard_round make_round(uint64_t round,
+				       const std::string& bucket_id = "id",
+				       uint32_t num_shards = 4) {
+    rgw_lc_shard_round r;
+    r.round = round;
+    r.bucket_id = bucket_id;
+    r.num_shards = num_shards;
+    return r;
+  }
+
+  // runs process_shard_round() with process_shard standing in for the
+  // lifecycle worker processing an index shard
+  static int process_round(
+    const std::string& oid, const rgw_lc_shard_round& round, bool helper,
+    std::function<int(RGWLC::ShardLease&)> process_shard,
+    std::function<bool()> should_stop = [] { return false; },
+    bool *worked = nullptr, const std::string& cookie = "worker") {
+    rgw::lc::shard_round_ops ops;
+    ops.should_stop = should_stop;
+    ops.wait = [](std::chrono::seconds) {};
+    ops.process_shard = process_shard;
+    NoDoutPrefix dpp(g_ceph_context, ceph_subsys_rgw);
+    return rgw::lc::process_shard_round(&dpp, ioctx, oid, round, helper,
+					cookie, utime_t(60, 0), ops, worked);
+  }
+
+  static int finish_shard(RGWLC::ShardLease& lease) {
+    return lease.checkpoint(1, rgw_obj_index_key(), true);
+  }
+};
+librados::IoCtx rgw_lc_shard::ioctx;
+
+
+TEST_F(rgw_lc_shard, no_round)
+{
+  const std::string oid = get_test_oid();
+  rgw_lc_shard_round round;
+  ASSERT_EQ(-ENOENT, rgw::lc::get_shard_round(ioctx, oid, &round));
+  // helpers cannot bring a round into existence
+  auto lease = make_lease(oid, 0, "helper");
+  ASSERT_EQ(-ENOENT, lease.acquire(make_round(1)));
+  ASSERT_EQ(-ENOENT, rgw::lc::start_shard_round(ioctx, oid, make_round(1),
+						false, &round));
+  ASSERT_EQ(-ENOENT, rgw::lc::get_shard_round(ioctx, oid, &round));
+}
+
+TEST_F(rgw_lc_shard, resume_interrupted_round)
+{
+  const std::string oid = get_test_oid();
+  const auto mtime = ceph::real_clock::now();
+  rgw_lc_shard_round round;
+  ASSERT_EQ(0, rgw::lc::start_shard_round(ioctx, oid, make_round(100), true,
+					  &round));
+  ASSERT_EQ(100u, round.round);
+  {
+    auto lease = make_lease(oid, 3, "a");
+    ASSERT_EQ(0, lease.acquire(round));
+    ASSERT_EQ(0u, lease.get_progress().rule);
+    ASSERT_EQ(0, lease.checkpoint(1, rgw_obj_index_key("foo"), false, mtime));
+    lease.release();
+  }
+  {
+    auto lease = make_lease(oid, 4, "a");
+    ASSERT_EQ(0, lease.acquire(round));
+    ASSERT_EQ(0, lease.checkpoint(2, rgw_obj_index_key(), true));
+    lease.release();
+  }
+
+  // the next cycle has a new start_time, but carries on where it stopped
+  ASSERT_EQ(0, rgw::lc::start_shard_round(ioctx, oid, make_round(200), true,
+					  &round));
+  ASSERT_EQ(100u, round.round);
+  rgw_lc_shard_round helper_round;
+  ASSERT_EQ(0, rgw::lc::get_shard_round(ioctx, oid, &helper_round));
+  ASSERT_EQ(100u, helper_round.round);
+
+  std::set<int> done;
+  ASSERT_EQ(0, rgw::lc::read_shards_done(ioctx, oid, round.round, &done));
+  ASSERT_EQ(std::set<int>({4}), done);
+
+  auto lease = make_lease(oid, 3, "b");
+  ASSERT_EQ(0, lease.acquire(round));
+  EXPECT_EQ(100u, lease.get_progress().round);
+  EXPECT_EQ(1u, lease.get_progress().rule);
+  EXPECT_EQ(rgw_obj_index_key("foo"), lease.get_progress().marker);
+  // what noncurrent versions listed after the marker expire from
+  EXPECT_EQ(mtime, lease.get_progress().marker_mtime);
+  EXPECT_FALSE(lease.get_progress().done);
+  lease.release();
+}
+
+TEST_F(rgw_lc_shard, lease_is_exclusive)
+{
+  const std::string oid = get_test_oid();
+  rgw_lc_shard_round round;
+  ASSERT_EQ(0, rgw::lc::start_shard_round(ioctx, oid, make_round(100), true,
+					  &round));
+
+  auto a = make_lease(oid, 0, "a");
+  auto b = make_lease(oid, 0, "b");
+  auto b1 = make_lease(oid, 1, "b");
+  ASSERT_EQ(0, a.acquire(round));
+  ASSERT_EQ(-EBUSY, b.acquire(round));
+  // other index shards are free to take
+  ASSERT_EQ(0, b1.acquire(round));
+  b1.release();
+
+  a.release();
+  ASSERT_EQ(0, b.acquire(round));
+  b.release();
+}
+
+TEST_F(rgw_lc_shard, checkpoint_fails_once_lease_is_lost)
+{
+  const std::string oid = get_test_oid();
+  rgw_lc_shard_round round;
+  ASSERT_EQ(0, rgw::lc::start_shard_round(ioctx, oid, make_round(100), true,
+					  &round));
+
+  auto a = make_lease(oid, 0, "a", 1);
+  ASSERT_EQ(0, a.acquire(round));
+  ASSERT_EQ(0, a.checkpoint(0, rgw_obj_index_key("foo"), false));
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+
+  // a's lease expired: b takes over the index shard from a's checkpoint
+  auto b = make_lease(oid, 0, "b");
+  ASSERT_EQ(0, b.acquire(round));
+  EXPECT_EQ(rgw_obj_index_key("foo"), b.get_progress().marker);
+  ASSERT_NE(0, a.checkpoint(0, rgw_obj_index_key("bar"), false));
+  ASSERT_EQ(0, b.checkpoint(0, rgw_obj_index_key("baz"), false));
+  b.release();
+}
+
+TEST_F(rgw_lc_shard, finished_round_is_removed)
+{
+  const std::string oid = get_test_oid();
+  const int num_shards = 3;
+  rgw_lc_shard_round round;
+  ASSERT_EQ(0, rgw::lc::start_shard_round(
+	      ioctx, oid, make_round(100, "id", num_shards), true, &round));
+  for (int shard = 0; shard < num_shards; ++shard) {
+    auto lease = make_lease(oid, shard, "a");
+    ASSERT_EQ(0, lease.acquire(round));
+    ASSERT_EQ(0, lease.checkpoint(1, rgw_obj_index_key(), true));
+    lease.release();
+  }
+  std::set<int> done;
+  ASSERT_EQ(0, rgw::lc::read_shards_done(ioctx, oid, round.round, &done));
+  ASSERT_EQ(std::set<int>({0, 1, 2}), done);
+
+  ASSERT_EQ(0, rgw::lc::finish_shard_round(ioctx, oid));
+  // a second worker seeing the round through finds nothing to remove
+  ASSERT_EQ(0, rgw::lc::finish_shard_round(ioctx, oid));
+  uint64_t size;
+  ASSERT_EQ(-ENOENT, ioctx.stat(oid, &size, nullptr));
+
+  // late helpers find the round over rather than recreating it
+  auto lease = make_lease(oid, 0, "b");
+  ASSERT_EQ(-ENOENT, lease.acquire(round));
+  ASSERT_EQ(-ENOENT, ioctx.stat(oid, &size, nullptr));
+
+  // and the next cycle starts afresh
+  ASSERT_EQ(0, rgw::lc::start_shard_round(
+	      ioctx, oid, make_round(200, "id", num_shards), true, &round));
+  ASSERT_EQ(200u, round.round);
+  done.clear();
+  ASSERT_EQ(0, rgw::lc::read_shards_done(ioctx, oid, round.round, &done));
+  ASSERT_TRUE(done.empty());
+}
+
+TEST_F(rgw_lc_shard, reshard_starts_the_round_over)
+{
+  const std::string oid = get_test_oid();
+  rgw_lc_shard_round old_round;
+  ASSERT_EQ(0, rgw::lc::start_shard_round(ioctx, oid, make_round(100, "old", 4),
+					  true, &old_round));
+  auto stale = make_lease(oid, 1, "a");
+  ASSERT_EQ(0, stale.acquire(old_round));
+  ASSERT_EQ(0, stale.checkpoint(0, rgw_obj_index_key("foo"), false));
+  {
+    auto lease = make_lease(oid, 2, "a");
+    ASSERT_EQ(0, lease.acquire(old_round));
+    ASSERT_EQ(0, finish_shard(lease));
+    lease.release();
+  }
+
+  // a helper that read the resharded bucket starts the round over
+  rgw_lc_shard_round round;
+  ASSERT_EQ(0, rgw::lc::start_shard_round(ioctx, oid, make_round(200, "new", 8),
+					  false, &round));
+  EXPECT_EQ(200u, round.round);
+  EXPECT_EQ("new", round.bucket_id);
+  EXPECT_EQ(8u, round.num_shards);
+  std::set<int> done;
+  ASSERT_EQ(0, rgw::lc::read_shards_done(ioctx, oid, round.round, &done));
+  EXPECT_TRUE(done.empty());
+
+  // the old index shards' checkpoints don't carry over
+  auto lease = make_lease(oid, 1, "b");
+  ASSERT_EQ(0, lease.acquire(round));
+  EXPECT_EQ(rgw_obj_index_key(), lease.get_progress().marker);
+  lease.release();
+
+  // workers still on the old round can't record anything in the new one
+  EXPECT_EQ(-ECANCELED, stale.checkpoint(0, rgw_obj_index_key("bar"), false));
+  auto late = make_lease(oid, 3, "c");
+  EXPECT_EQ(-ECANCELED, late.acquire(old_round));
+  // nor start the old layout over again once someone moved on
+  rgw_lc_shard_round cur;
+  EXPECT_EQ(0, rgw::lc::start_shard_round(ioctx, oid, make_round(300, "new", 8),
+					  true, &cur));
+  EXPECT_EQ(200u, cur.round);
+}
+
+TEST_F(rgw_lc_shard, process_round_resumes_after_interruption)
+{
+  const std::string oid = get_test_oid();
+  const auto round = make_round(100, "id", 4);
+
+  // the first worker is stopped after two index shards, with a third one
+  // checkpointed part way
+  std::vector<int> first;
+  ASSERT_EQ(-EAGAIN, process_round(
+	      oid, round, false,
+	      [&](RGWLC::ShardLease& lease) {
+		first.push_back(lease.get_shard());
+		if (first.size() == 3) {
+		  return lease.checkpoint(0, rgw_obj_index_key("foo"), false);
+		}
+		return finish_shard(lease);
+	      },
+	      [&] { return first.size() == 3; }));
+  ASSERT_EQ(3u, first.size());
+
+  // the next cycle only does what is left, from where it was left
+  std::vector<int> second;
+  bool worked = false;
+  ASSERT_EQ(0, process_round(
+	      oid, make_round(200, "id", 4), false,
+	      [&](RGWLC::ShardLease& lease) {
+		second.push_back(lease.get_shard());
+		if (lease.get_shard() == first[2]) {
+		  EXPECT_EQ(rgw_obj_index_key("foo"),
+			    lease.get_progress().marker);
+		} else {
+		  EXPECT_EQ(rgw_obj_index_key(), lease.get_progress().marker);
+		}
+		EXPECT_EQ(100u, lease.get_progress().round);
+		return finish_shard(lease);
+	      }, [] { return false; }, &worked));
+  EXPECT_TRUE(worked);
+  std::set<int> all(first.begin(), first.end());
+  all.insert(second.begin(), second.end());
+  EXPECT_EQ(std::set<int>({0, 1, 2, 3}), all);
+  EXPECT_EQ(2u, second.size());
+
+  // seen through: the progress is gone
+  uint64_t size;
+  ASSERT_EQ(-ENOENT, ioctx.stat(oid, &size, nullptr));
+}
+
+TEST_F(rgw_lc_shard, process_round_helper)
+{
+  const std::string oid = get_test_oid();
+  const auto round = make_round(100, "id", 2);
+  int calls = 0;
+  auto count = [&](RGWLC::ShardLease& lease) {
+    ++calls;
+    return finish_shard(lease);
+  };
+  // no round to help with
+  bool worked = false;
+  ASSERT_EQ(-EAGAIN, process_round(oid, round, true, count,
+				   [] { return false; }, &worked));
+  EXPECT_FALSE(worked);
+  EXPECT_EQ(0, calls);
+
+  // both index shards are held by others
+  rgw_lc_shard_round cur;
+  ASSERT_EQ(0, rgw::lc::start_shard_round(ioctx, oid, round, true, &cur));
+  auto a = make_lease(oid, 0, "a");
+  auto b = make_lease(oid, 1, "b");
+  ASSERT_EQ(0, a.acquire(cur));
+  ASSERT_EQ(0, b.acquire(cur));
+  ASSERT_EQ(-EAGAIN, process_round(oid, round, true, count,
+				   [] { return false; }, &worked));
+  EXPECT_FALSE(worked);
+
+  // one is let go of: the helper takes it, but the round isn't over
+  ASSERT_EQ(0, a.checkpoint(0, rgw_obj_index_key("foo"), false));
+  a.release();
+  ASSERT_EQ(-EAGAIN, process_round(oid, round, true, count,
+				   [] { return false; }, &worked));
+  EXPECT_TRUE(worked);
+  EXPECT_EQ(1, calls);
+
+  // the helper that finishes the last index shard sees the round through
+  ASSERT_EQ(0, finish_shard(b));
+  b.release();
+  ASSERT_EQ(0, process_round(oid, round, true, count));
+  EXPECT_EQ(1, calls);
+  uint64_t size;
+  ASSERT_EQ(-ENOENT, ioctx.stat(oid, &size, nullptr));
+}
+
+TEST_F(rgw_lc_shard, process_round_reshard_mid_round)
+{
+  const std::string oid = get_test_oid();
+  const auto old_round = make_round(100, "old", 2);
+  const auto new_round = make_round(100, "new", 3);
+
+  // the bucket is resharded while a worker is on one of its index shards;
+  // a helper that read the new bucket instance starts over, and takes
+  // every index shard but the one still held
+  std::vector<int> fresh;
+  auto process_fresh = [&](RGWLC::ShardLease& lease) {
+    fresh.push_back(lease.get_shard());
+    return finish_shard(lease);
+  };
+  int stale = 0;
+  ASSERT_EQ(-ECANCELED, process_round(
+	      oid, old_round, false,
+	      [&](RGWLC::ShardLease& lease) {
+		if (++stale > 1) {
+		  return finish_shard(lease);
+		}
+		EXPECT_EQ(-EAGAIN, process_round(
+			    oid, new_round, true, process_fresh,
+			    [] { return false; }, nullptr, "fresh"));
+		// the stale worker's next checkpoint finds out
+		return lease.checkpoint(0, rgw_obj_index_key("foo"), false);
+	      }, [] { return false; }, nullptr, "stale"));
+  EXPECT_EQ(1, stale);
+  EXPECT_EQ(2u, fresh.size());
+
+  // and the index shard it let go of is taken up in the new round
+  ASSERT_EQ(0, process_round(oid, new_round, true, process_fresh,
+			     [] { return false; }, nullptr, "fresh"));
+  EXPECT_EQ(3u, fresh.size());
+  EXPECT_EQ(std::set<int>({0, 1, 2}),
+	    std::set<int>(fresh.begin(), fresh.end()));
+  uint64_t size;
+  ASSERT_EQ(-ENOENT, ioctx.stat(oid, &size, nullptr));
+}
+
+TEST(rgw_lc_chunk_tracker, marker_follows_finished_chunks)
+{
+  const auto t0 = ceph::real_clock::zero();
+  const auto t1 = t0 + std::chrono::seconds(1);
+  const auto t2 = t0 + std::chrono::seconds(2);
+  rgw::lc::ChunkTracker chunks(rgw_obj_index_key("start"), t0);
+  rgw_obj_index_key marker;
+  ceph::real_time mtime;
+
+  const auto a = chunks.add();
+  const auto b = chunks.add();
+  chunks.end_chunk(rgw_obj_index_key("b"), t1);
+  const auto c = chunks.add();
+  chunks.end_chunk(rgw_obj_index_key("c"), t2);
+  const auto d = chunks.add();
+  EXPECT_EQ(a, b);
+  EXPECT_NE(b, c);
+  EXPECT_NE(c, d);
+
+  // nothing finished yet: a checkpoint would resume where we started
+  chunks.get_marker(&marker, &mtime);
+  EXPECT_EQ(rgw_obj_index_key("start"), marker);
+  EXPECT_EQ(t0, mtime);
+
+  // the second chunk finishing first doesn't move the marker past the
+  // first chunk's entries
+  chunks.complete(c);
+  chunks.complete(a);
+  chunks.get_marker(&marker, &mtime);
+  EXPECT_EQ(rgw_obj_index_key("start"), marker);
+
+  chunks.complete(b);
+  chunks.get_marker(&marker, &mtime);
+  EXPECT_EQ(rgw_obj_index_key("c"), marker);
+  EXPECT_EQ(t2, mtime);
+
+  // the chunk being listed never counts, finished or not
+  chunks.complete(d);
+  chunks.get_marker(&marker, &mtime);
+  EXPECT_EQ(rgw_obj_index_key("c"), marker);
+}
+
+TEST(rgw_lc_chunk_tracker, empty_chunks_end_finished)
+{
+  const auto t1 = ceph::real_clock::zero() + std::chrono::seconds(1);
+  rgw::lc::ChunkTracker chunks{rgw_obj_index_key(), ceph::real_time()};
+  chunks.end_chunk(rgw_obj_index_key("a"), t1);
+  rgw_obj_index_key marker;
+  ceph::real_time mtime;
+  chunks.get_marker(&marker, &mtime);
+  EXPECT_EQ(rgw_obj_index_key("a"), marker);
+  EXPECT_EQ(t1, mtime);
+}
@@ -0,0 +1,218 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Reads the part entries of multipart uploads written here, in a temporary
+ * pool, through the store of the configured zone.
+ */
+
+#include <string>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include "include/rados/librados.hpp"
+#include "rgw/rgw_multi.h"
+#include "rgw/rgw_rados.h"
+#include "rgw/rgw_sal.h"
+#include "test/librados/test_cxx.h"
+#include "gtest/gtest.h"
+
+static rgw::sal::RGWRadosStore *store = nullptr;
+
+class rgw_multipart_parts : public ::testing::Test {
+ protected:
+  std::string pool_name;
+  librados::IoCtx ioctx;
+  RGWBucketInfo bucket_info;
+  std::string meta_oid;
+  rgw_raw_obj raw_obj;
+  static constexpr const char *upload_id = MULTIPART_UPLOAD_ID_PREFIX "test";
+
+  void SetUp() override {
+    auto rados = store->getRados()->get_rados_handle();
+    pool_name = get_temp_pool_name();
+    ASSERT_EQ("", create_one_pool_pp(pool_name, *rados));
+    ASSERT_EQ(0, rados->ioctx_create(pool_name.c_str(), ioctx));
+
+    // the upload's meta object lands in our pool
+    bucket_info.bucket.name = "bucket";
+    bucket_info.bucket.marker = "marker";
+    bucket_info.bucket.bucket_id = "marker";
+    bucket_info.bucket.explicit_placement.data_pool = rgw_pool(pool_name);
+    bucket_info.bucket.explicit_placement.data_extra_pool = rgw_pool(pool_name);
+    meta_oid = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    meta_oid += ".meta";
+    rgw_obj obj;
+    obj.init_ns(bucket_info.bucket, meta_oid, RGW_OBJ_NS_MULTIPART);
+    obj.set_in_extra_data(true);
+    store->getRados()->obj_to_raw(bucket_info.placement_rule, obj, &raw_obj);
+    ASSERT_EQ(pool_name, raw_obj.pool.name);
+    ioctx.locator_set_key(raw_obj.loc);
+  }
+  void TearDown() override {
+    ioctx.close();
+    ASSERT_EQ(0, destroy_one_pool_pp(pool_name,
+				     *store->getRados()->get_rados_handle()));
+  }
+
+  static std::string part_key(uint32_t num) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "part.%08u", num);
+    return buf;
+  }
+
+  // write the entries of the parts @nums, as uploading them does
+  void upload_parts(const std::vector<uint32_t>& nums) {
+    std::map<std::string, bufferlist> vals;
+    for (auto num : nums) {
+      RGWUploadPartInfo info;
+      info.num = num;
+      info.size = num * 10;
+      info.etag = "etag" + std::to_string(num);
+      encode(info, vals[part_key(num)]);
+    }
+    librados::ObjectWriteOperation op;
+    op.omap_set(vals);
+    ASSERT_EQ(0, ioctx.operate(raw_obj.oid, &op));
+  }
+
+  // read @nums, collecting the part numbers of each range handed to cb
+  int read_parts(const std::vector<uint32_t>& nums, size_t chunk,
+		 std::vector<std::vector<uint32_t>> *ranges,
+		 int cb_r = 0) {
+    return read_multipart_parts(
+      store, bucket_info, g_ceph_context, upload_id, meta_oid, nums,
+      chunk, 2,
+      [&] (map<uint32_t, RGWUploadPartInfo>& parts) {
+	auto& range = ranges->emplace_back();
+	for (auto& [num, info] : parts) {
+	  EXPECT_EQ(num, info.num);
+	  EXPECT_EQ(num * 10, info.size);
+	  range.push_back(num);
+	}
+	return cb_r;
+      }, null_yield);
+  }
+
+  static std::vector<uint32_t> seq(uint32_t first, uint32_t last) {
+    std::vector<uint32_t> nums;
+    for (auto num = first; num <= last; ++num) {
+      nums.push_back(num);
+    }
+    return nums;
+  }
+};
+
+TEST_F(rgw_multipart_parts, reads_ranges_in_order)
+{
+  upload_parts(seq(1, 25));
+  std::vector<std::vector<uint32_t>> ranges;
+  ASSERT_EQ(0, read_parts(seq(1, 25), 10, &ranges));
+  EXPECT_EQ((std::vector<std::vector<uint32_t>>{
+	       seq(1, 10), seq(11, 20), seq(21, 25)}), ranges);
+}
+
+TEST_F(rgw_multipart_parts, reads_sparse_part_numbers)
+{
+  const std::vector<uint32_t> nums = {2, 3, 7, 100, 101};
+  upload_parts(nums);
+  std::vector<std::vector<uint32_t>> ranges;
+  ASSERT_EQ(0, read_parts(nums, 2, &ranges));
+  EXPECT_EQ((std::vector<std::vector<uint32_t>>{
+	       {2, 3}, {7, 100}, {101}}), ranges);
+}
+
+TEST_F(rgw_multipart_parts, unsorted_upload_is_not_supported)
+{
+  upload_parts(seq(1, 3));
+  int calls = 0;
+  // uploads started by older gateways don't have sorted entries
+  ASSERT_EQ(-ENOTSUP, read_multipart_parts(
+	      store, bucket_info, g_ceph_context, "legacy", meta_oid, seq(1, 3),
+	      10, 2,
+	      [&] (map<uint32_t, RGWUploadPartInfo>&) { ++calls; return 0; },
+	      null_yield));
+  EXPECT_EQ(0, calls);
+}
+
+TEST_F(rgw_multipart_parts, missing_part_is_not_supported)
+{
+  upload_parts({1, 2, 4});
+  std::vector<std::vector<uint32_t>> ranges;
+  ASSERT_EQ(-ENOTSUP, read_parts(seq(1, 4), 2, &ranges));
+  // the first range was fine and was handed out already
+  EXPECT_EQ((std::vector<std::vector<uint32_t>>{seq(1, 2)}), ranges);
+}
+
+TEST_F(rgw_multipart_parts, part_not_completed_is_detected)
+{
+  // part 3 was uploaded but is left out of the completion
+  upload_parts(seq(1, 5));
+  std::vector<std::vector<uint32_t>> ranges;
+  ASSERT_EQ(-ENOTSUP, read_parts({1, 2, 4, 5}, 2, &ranges));
+  EXPECT_EQ((std::vector<std::vector<uint32_t>>{seq(1, 2)}), ranges);
+}
+
+TEST_F(rgw_multipart_parts, extra_part_after_the_last_is_detected)
+{
+  upload_parts(seq(1, 5));
+  std::vector<std::vector<uint32_t>> ranges;
+  ASSERT_EQ(-ENOTSUP, read_parts(seq(1, 4), 2, &ranges));
+  EXPECT_EQ((std::vector<std::vector<uint32_t>>{seq(1, 2)}), ranges);
+
+  ranges.clear();
+  ASSERT_EQ(-ENOTSUP, read_parts(seq(1, 4), 10, &ranges));
+  EXPECT_TRUE(ranges.empty());
+}
+
+TEST_F(rgw_multipart_parts, callback_error_is_passed_through)
+{
+  upload_parts(seq(1, 5));
+  std::vector<std::vector<uint32_t>> ranges;
+  ASSERT_EQ(-EIO, read_parts(seq(1, 5), 2, &ranges, -EIO));
+  EXPECT_EQ(1u, ranges.size());
+}
+
+TEST_F(rgw_multipart_parts, fallback_lists_what_the_fast_path_rejects)
+{
+  // what CompleteMultipartUpload falls back to on -ENOTSUP
+  upload_parts({1, 2, 4});
+  std::vector<std::vector<uint32_t>> ranges;
+  ASSERT_EQ(-ENOTSUP, read_parts(seq(1, 3), 10, &ranges));
+
+  map<uint32_t, RGWUploadPartInfo> parts;
+  int next_marker = 0;
+  bool truncated = false;
+  ASSERT_EQ(0, list_multipart_parts(store, bucket_info, g_ceph_context,
+				    upload_id, meta_oid, 1000, 0, parts,
+				    &next_marker, &truncated));
+  EXPECT_FALSE(truncated);
+  std::vector<uint32_t> nums;
+  for (auto& [num, info] : parts) {
+    nums.push_back(num);
+  }
+  EXPECT_EQ((std::vector<uint32_t>{1, 2, 4}), nums);
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  store = RGWStoreManager::get_storage(g_ceph_context, false, false, false,
+				       false, false);
+  if (!store) {
+    std::cerr << "couldn't init storage provider" << std::endl;
+    return EIO;
+  }
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int r = RUN_ALL_TESTS();
+  RGWStoreManager::close_storage(store);
+  return r;
+}
@@ -0,0 +1,135 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw/rgw_cache.h"
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+// a single shard, so that LRU order and admission are predictable
+void init_cache(ObjectCache& cache, int lru_size, bool tinylfu)
+{
+  auto& conf = g_ceph_context->_conf;
+  // the cache options only take effect at startup
+  conf._clear_safe_to_start_threads();
+  conf.set_val_or_die("rgw_cache_shards", "1");
+  conf.set_val_or_die("rgw_cache_lru_size", std::to_string(lru_size));
+  conf.set_val_or_die("rgw_cache_tinylfu", tinylfu ? "true" : "false");
+  conf.set_val_or_die("rgw_cache_expiry_interval", "0");
+  conf.set_safe_to_start_threads();
+  conf.apply_changes(nullptr);
+  cache.set_ctx(g_ceph_context);
+  cache.set_enabled(true);
+}
+
+void put(ObjectCache& cache, const std::string& name)
+{
+  ObjectCacheInfo info;
+  info.flags = CACHE_FLAG_DATA;
+  info.data.append(name);
+  cache.put(name, info, nullptr);
+}
+
+bool cached(ObjectCache& cache, const std::string& name)
+{
+  auto info = cache.get(name);
+  return info && info->data.to_str() == name;
+}
+
+}
+
+TEST(ObjectCache, LRUEviction)
+{
+  ObjectCache cache;
+  init_cache(cache, 4, false);
+  for (int i = 0; i < 10; ++i) {
+    put(cache, "k" + std::to_string(i));
+  }
+  EXPECT_FALSE(cached(cache, "k0"));
+  EXPECT_FALSE(cached(cache, "k4"));
+  EXPECT_TRUE(cached(cache, "k8"));
+  EXPECT_TRUE(cached(cache, "k9"));
+}
+
+TEST(ObjectCache, NoAdmissionFilterByDefault)
+{
+  ObjectCache cache;
+  init_cache(cache, 4, false);
+  for (int i = 0; i < 4; ++i) {
+    const auto name = "hot" + std::to_string(i);
+    put(cache, name);
+    for (int j = 0; j < 3; ++j) {
+      ASSERT_TRUE(cached(cache, name));
+    }
+  }
+  // a full cache still takes in an entry nobody asked for before
+  put(cache, "cold");
+  EXPECT_TRUE(cached(cache, "cold"));
+}
+
+TEST(ObjectCache, TinyLFURejectsColdEntries)
+{
+  ObjectCache cache;
+  init_cache(cache, 4, true);
+  for (int i = 0; i < 4; ++i) {
+    const auto name = "hot" + std::to_string(i);
+    put(cache, name);
+    for (int j = 0; j < 3; ++j) {
+      ASSERT_TRUE(cached(cache, name));
+    }
+  }
+
+  // never requested before: would displace a hot entry, so it is dropped
+  put(cache, "cold");
+  EXPECT_FALSE(cached(cache, "cold"));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(cached(cache, "hot" + std::to_string(i)));
+  }
+
+  // requested more often than the victim: admitted
+  for (int j = 0; j < 8; ++j) {
+    EXPECT_FALSE(cached(cache, "warm"));
+  }
+  put(cache, "warm");
+  EXPECT_TRUE(cached(cache, "warm"));
+}
+
+TEST(ObjectCache, TinyLFUAdmitsAnyEntryWhileNotFull)
+{
+  ObjectCache cache;
+  init_cache(cache, 4, true);
+  // none of them was ever requested
+  for (int i = 0; i < 4; ++i) {
+    put(cache, "k" + std::to_string(i));
+  }
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(cached(cache, "k" + std::to_string(i)));
+  }
+}
+
+TEST(ObjectCache, TinyLFUUpdatesCachedEntriesWhenFull)
+{
+  ObjectCache cache;
+  init_cache(cache, 4, true);
+  for (int i = 0; i < 4; ++i) {
+    put(cache, "k" + std::to_string(i));
+  }
+  // an entry already cached is not subject to admission
+  ObjectCacheInfo info;
+  info.flags = CACHE_FLAG_DATA;
+  info.data.append("new");
+  cache.put("k0", info, nullptr);
+  auto got = cache.get("k0");
+  ASSERT_TRUE(got);
+  EXPECT_EQ("new", got->data.to_str());
+}
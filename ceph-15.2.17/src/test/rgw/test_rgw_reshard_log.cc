@@ -0,0 +1,250 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw/rgw_reshard.h"
+#include "cls/rgw/cls_rgw_client.h"
+#include "global/global_context.h"
+
+#include "test/librados/test_cxx.h"
+#include "gtest/gtest.h"
+
+// creates a rados client and temporary pool
+struct RadosEnv : public ::testing::Environment {
+  static std::optional<std::string> pool_name;
+ public:
+  static std::optional<librados::Rados> rados;
+
+  void SetUp() override {
+    rados.emplace();
+    // create pool
+    std::string name = get_temp_pool_name();
+    ASSERT_EQ("", create_one_pool_pp(name, *rados));
+    pool_name = name;
+  }
+  void TearDown() override {
+    if (pool_name) {
+      ASSERT_EQ(0, destroy_one_pool_pp(*pool_name, *rados));
+    }
+    rados.reset();
+  }
+
+  static int ioctx_create(librados::IoCtx& ioctx) {
+    return rados->ioctx_create(pool_name->c_str(), ioctx);
+  }
+};
+std::optional<std::string> RadosEnv::pool_name;
+std::optional<librados::Rados> RadosEnv::rados;
+
+auto *const rados_env = ::testing::AddGlobalTestEnvironment(new RadosEnv);
+
+class rgw_reshard_log : public ::testing::Test {
+ protected:
+  static librados::IoCtx ioctx;
+  // a shard of the index being resharded, and one it is resharded to
+  std::string src_oid;
+  std::string dst_oid;
+
+  static void SetUpTestSuite() {
+    ASSERT_EQ(0, RadosEnv::ioctx_create(ioctx));
+  }
+  static void TearDownTestSuite() {
+    ioctx.close();
+  }
+
+  // use the test's name in the oids so different tests don't conflict
+  void SetUp() override {
+    const std::string name =
+      ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    src_oid = name + ".src";
+    dst_oid = name + ".dst";
+    for (auto& oid : {src_oid, dst_oid}) {
+      librados::ObjectWriteOperation op;
+      cls_rgw_bucket_init_index(op);
+      ASSERT_EQ(0, ioctx.operate(oid, &op));
+    }
+  }
+
+  static void put_obj(const std::string& oid, const std::string& name,
+		      uint64_t size) {
+    std::string tag = name + ".tag";
+    std::string loc;
+    rgw_zone_set zones_trace;
+    cls_rgw_obj_key key(name);
+    {
+      librados::ObjectWriteOperation op;
+      cls_rgw_bucket_prepare_op(op, CLS_RGW_OP_ADD, tag, key, loc, true, 0,
+				zones_trace);
+      ASSERT_EQ(0, ioctx.operate(oid, &op));
+    }
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = RGWObjCategory::Main;
+    meta.size = size;
+    meta.accounted_size = size;
+    rgw_bucket_entry_ver ver;
+    ver.pool = ioctx.get_id();
+    ver.epoch = 1;
+    librados::ObjectWriteOperation op;
+    cls_rgw_bucket_complete_op(op, CLS_RGW_OP_ADD, tag, ver, key, meta,
+			       nullptr, true, 0, nullptr);
+    ASSERT_EQ(0, ioctx.operate(oid, &op));
+  }
+
+  static void remove_obj(const std::string& oid, const std::string& name) {
+    std::string tag = name + ".rmtag";
+    std::string loc;
+    rgw_zone_set zones_trace;
+    cls_rgw_obj_key key(name);
+    {
+      librados::ObjectWriteOperation op;
+      cls_rgw_bucket_prepare_op(op, CLS_RGW_OP_DEL, tag, key, loc, true, 0,
+				zones_trace);
+      ASSERT_EQ(0, ioctx.operate(oid, &op));
+    }
+    rgw_bucket_dir_entry_meta meta;
+    rgw_bucket_entry_ver ver;
+    ver.pool = ioctx.get_id();
+    ver.epoch = 2;
+    librados::ObjectWriteOperation op;
+    cls_rgw_bucket_complete_op(op, CLS_RGW_OP_DEL, tag, ver, key, meta,
+			       nullptr, true, 0, nullptr);
+    ASSERT_EQ(0, ioctx.operate(oid, &op));
+  }
+
+  // the sizes of the objects listed in an index object
+  static std::map<std::string, uint64_t> list_sizes(const std::string& oid) {
+    std::map<std::string, uint64_t> sizes;
+    std::list<rgw_cls_bi_entry> entries;
+    bool truncated = false;
+    EXPECT_EQ(0, cls_rgw_bi_list(ioctx, oid, "", "", 1000, &entries,
+				 &truncated));
+    EXPECT_FALSE(truncated);
+    for (auto& e : entries) {
+      rgw_bucket_dir_entry entry;
+      auto iter = e.data.cbegin();
+      decode(entry, iter);
+      if (entry.exists) {
+	sizes[entry.key.name] = entry.meta.size;
+      }
+    }
+    return sizes;
+  }
+
+  static rgw_bucket_category_stats get_stats(const std::string& oid) {
+    std::map<int, std::string> oids = {{0, oid}};
+    std::map<int, rgw_cls_list_ret> results;
+    EXPECT_EQ(0, CLSRGWIssueGetDirHeader(ioctx, oids, results, 1)());
+    return results[0].dir.header.stats[RGWObjCategory::Main];
+  }
+
+  void start_online_reshard() {
+    cls_rgw_bucket_instance_entry entry;
+    entry.set_status("new_id", 1, cls_rgw_reshard_status::IN_LOGRECORD);
+    ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, src_oid, entry));
+  }
+
+  int resync(const std::string& name) {
+    return rgw::reshard::resync_object_entries(g_ceph_context,
+					       ioctx, src_oid,
+					       ioctx, dst_oid, name);
+  }
+
+  int sync(std::map<std::string, uint64_t>& synced,
+	   std::vector<std::string> *resynced, uint64_t *count) {
+    return rgw::reshard::sync_reshard_log(
+      g_ceph_context, ioctx, src_oid, synced,
+      [&] (const std::string& name) {
+	resynced->push_back(name);
+	return resync(name);
+      }, count);
+  }
+};
+librados::IoCtx rgw_reshard_log::ioctx;
+
+
+TEST_F(rgw_reshard_log, resync_copies_the_entry)
+{
+  put_obj(src_oid, "a", 10);
+  ASSERT_EQ(0, resync("a"));
+  EXPECT_EQ((std::map<std::string, uint64_t>{{"a", 10}}), list_sizes(dst_oid));
+  EXPECT_EQ(1u, get_stats(dst_oid).num_entries);
+  EXPECT_EQ(10u, get_stats(dst_oid).total_size);
+}
+
+TEST_F(rgw_reshard_log, resync_replaces_stale_entry)
+{
+  // the bulk copy saw an older version of "a"; "b" is left alone
+  put_obj(dst_oid, "a", 10);
+  put_obj(dst_oid, "b", 5);
+  put_obj(src_oid, "a", 100);
+  ASSERT_EQ(0, resync("a"));
+  EXPECT_EQ((std::map<std::string, uint64_t>{{"a", 100}, {"b", 5}}),
+	    list_sizes(dst_oid));
+  EXPECT_EQ(2u, get_stats(dst_oid).num_entries);
+  EXPECT_EQ(105u, get_stats(dst_oid).total_size);
+}
+
+TEST_F(rgw_reshard_log, resync_removes_deleted_entry)
+{
+  put_obj(dst_oid, "a", 10);
+  put_obj(src_oid, "a", 10);
+  remove_obj(src_oid, "a");
+  ASSERT_EQ(0, resync("a"));
+  EXPECT_TRUE(list_sizes(dst_oid).empty());
+  EXPECT_EQ(0u, get_stats(dst_oid).num_entries);
+  EXPECT_EQ(0u, get_stats(dst_oid).total_size);
+}
+
+TEST_F(rgw_reshard_log, sync_resyncs_changed_objects_once)
+{
+  // written before the reshard: copied in bulk, not logged
+  put_obj(src_oid, "before", 1);
+  start_online_reshard();
+  put_obj(src_oid, "a", 10);
+  put_obj(src_oid, "b", 20);
+
+  std::map<std::string, uint64_t> synced;
+  std::vector<std::string> resynced;
+  uint64_t count = 0;
+  ASSERT_EQ(0, sync(synced, &resynced, &count));
+  EXPECT_EQ((std::vector<std::string>{"a", "b"}), resynced);
+  EXPECT_EQ(2u, count);
+  EXPECT_EQ((std::map<std::string, uint64_t>{{"a", 10}, {"b", 20}}),
+	    list_sizes(dst_oid));
+
+  // nothing changed since
+  resynced.clear();
+  ASSERT_EQ(0, sync(synced, &resynced, &count));
+  EXPECT_TRUE(resynced.empty());
+  EXPECT_EQ(2u, count);
+
+  // only what changed again is copied again
+  put_obj(src_oid, "a", 30);
+  remove_obj(src_oid, "b");
+  put_obj(src_oid, "c", 40);
+  resynced.clear();
+  ASSERT_EQ(0, sync(synced, &resynced, &count));
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}), resynced);
+  EXPECT_EQ(5u, count);
+  EXPECT_EQ((std::map<std::string, uint64_t>{{"a", 30}, {"c", 40}}),
+	    list_sizes(dst_oid));
+  EXPECT_EQ(2u, get_stats(dst_oid).num_entries);
+  EXPECT_EQ(70u, get_stats(dst_oid).total_size);
+}
+
+TEST_F(rgw_reshard_log, sync_stops_on_error)
+{
+  start_online_reshard();
+  put_obj(src_oid, "a", 10);
+  put_obj(src_oid, "b", 20);
+
+  std::map<std::string, uint64_t> synced;
+  uint64_t count = 0;
+  int calls = 0;
+  ASSERT_EQ(-EIO, rgw::reshard::sync_reshard_log(
+	      g_ceph_context, ioctx, src_oid, synced,
+	      [&] (const std::string&) { ++calls; return -EIO; }, &count));
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(0u, count);
+  // the failed object is tried again on the next pass
+  EXPECT_TRUE(synced.empty());
+}
@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw/rgw_sync_window.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+// feed one interval worth of completions at the given rate (per second)
+static void run_interval(RGWSyncWindow& w, ceph::mono_time& now, uint64_t rate)
+{
+  for (int i = 0; i < 10; ++i) {
+    now += 100ms;
+    w.complete(rate / 10, now);
+  }
+}
+
+TEST(RGWSyncWindow, Fixed)
+{
+  RGWSyncWindow w(20, 0, 1s);
+  EXPECT_FALSE(w.is_adaptive());
+  ceph::mono_time now = ceph::mono_clock::now();
+  for (int i = 0; i < 10; ++i) {
+    run_interval(w, now, 1000 * (i + 1));
+  }
+  EXPECT_EQ(20u, w.get());
+}
+
+TEST(RGWSyncWindow, GrowsWhileThroughputImproves)
+{
+  RGWSyncWindow w(8, 64, 1s);
+  ceph::mono_time now = ceph::mono_clock::now();
+  w.complete(0, now); // start the first interval
+  uint64_t last = w.get();
+  for (int i = 0; i < 100; ++i) {
+    // throughput proportional to the window
+    run_interval(w, now, w.get() * 100);
+    EXPECT_GE(w.get(), last);
+    last = w.get();
+  }
+  EXPECT_EQ(64u, w.get());
+}
+
+TEST(RGWSyncWindow, TurnsAroundPastThePeak)
+{
+  RGWSyncWindow w(4, 128, 1s);
+  ceph::mono_time now = ceph::mono_clock::now();
+  w.complete(0, now);
+  // throughput peaks at a window of 32 and degrades beyond it
+  auto rate = [] (uint64_t window) {
+    return window <= 32 ? window * 100 : 3200 - (window - 32) * 100;
+  };
+  for (int i = 0; i < 200; ++i) {
+    run_interval(w, now, rate(w.get()));
+  }
+  EXPECT_GE(w.get(), 20u);
+  EXPECT_LE(w.get(), 44u);
+}
+
+TEST(RGWSyncWindow, IgnoresIdleIntervals)
+{
+  RGWSyncWindow w(8, 64, 1s);
+  ceph::mono_time now = ceph::mono_clock::now();
+  w.complete(0, now);
+  run_interval(w, now, 1000);
+  const uint64_t window = w.get();
+  // nothing completed for a minute; no measurement is taken
+  now += 60s;
+  w.complete(1, now);
+  EXPECT_EQ(window, w.get());
+}
@@ -46,9 +46,12 @@
 #include "include/stringify.h"
 #include "global/signal_handler.h"
 #include "common/rabin.h"
+#include "common/fastcdc.h"
+#include "include/intarith.h"
 
 using namespace librados;
 unsigned default_op_size = 1 << 22;
+unsigned default_dedup_chunk_size = 1 << 16;
 unsigned default_max_thread = 2;
 int32_t default_report_period = 2;
 map< string, pair <uint64_t, uint64_t> > chunk_statistics; // < key, <count, chunk_size> >
@@ -56,10 +59,10 @@ ceph::mutex glock = ceph::make_mutex("chunk_statistics::Locker");
 
 void usage()
 {
-  cout << " usage: [--op <estimate|chunk_scrub|add_chunk_ref|get_chunk_ref>] [--pool <pool_name> ] " << std::endl;
+  cout << " usage: [--op <estimate|chunk_scrub|add_chunk_ref|get_chunk_ref|dedup>] [--pool <pool_name> ] " << std::endl;
   cout << "   --object <object_name> " << std::endl;
-  cout << "   --chunk-size <size> chunk-size (byte) " << std::endl;
-  cout << "   --chunk-algorithm <fixed|rabin> " << std::endl;
+  cout << "   --chunk-size <size> chunk-size (byte), average size for fastcdc " << std::endl;
+  cout << "   --chunk-algorithm <fixed|rabin|fastcdc> " << std::endl;
   cout << "   --fingerprint-algorithm <sha1|sha256|sha512> " << std::endl;
   cout << "   --chunk-pool <pool name> " << std::endl;
   cout << "   --max-thread <threads> " << std::endl;
@@ -82,6 +85,13 @@ void usage()
   cout << "   --window-size <uint32_t> " << std::endl;
   cout << "   --min-chunk <uint32_t> " << std::endl;
   cout << "   --max-chunk <uint64_t> " << std::endl;
+  cout << std::endl;
+  cout << "   ***these options are for dedup*** " << std::endl;
+  cout << "   **moves the data of --pool into --chunk-pool, storing each distinct chunk once** " << std::endl;
+  cout << "   **the pool needs fingerprint_algorithm set; chunks are named by that fingerprint** " << std::endl;
+  cout << "   **default chunk algorithm is fastcdc with a " << default_dedup_chunk_size << " byte average chunk ** " << std::endl;
+  cout << "   --min-age <seconds> leave objects modified more recently alone " << std::endl;
+  cout << "   --sleep <seconds> rescan the pool after this long, until interrupted " << std::endl;
   exit(1);
 }
 
@@ -105,6 +115,7 @@ static int rados_sistrtoll(I &i, T *val) {
 
 class EstimateDedupRatio;
 class ChunkScrub;
+class DedupAgent;
 class EstimateThread : public Thread 
 {
   IoCtx io_ctx;
@@ -140,6 +151,7 @@ public:
   uint64_t get_total_objects() { return total_objects; }
   friend class EstimateDedupRatio;
   friend class ChunkScrub;
+  friend class DedupAgent;
 };
 
 class EstimateDedupRatio : public EstimateThread
@@ -149,13 +161,15 @@ class EstimateDedupRatio : public EstimateThread
   uint64_t chunk_size;
   map< string, pair <uint64_t, uint64_t> > local_chunk_statistics; // < key, <count, chunk_size> >
   RabinChunk rabin;
+  FastCDC cdc;
 
 public:
   EstimateDedupRatio(IoCtx& io_ctx, int n, int m, ObjectCursor begin, ObjectCursor end, 
 		string chunk_algo, string fp_algo, uint64_t chunk_size, int32_t timeout,
 		uint64_t num_objects, uint64_t max_read_size):
     EstimateThread(io_ctx, n, m, begin, end, timeout, num_objects, max_read_size), 
-		chunk_algo(chunk_algo), fp_algo(fp_algo), chunk_size(chunk_size) { }
+		chunk_algo(chunk_algo), fp_algo(fp_algo), chunk_size(chunk_size),
+		cdc(cbits(chunk_size ? chunk_size : default_dedup_chunk_size) - 1) { }
 
   void* entry() {
     estimate_dedup_ratio();
@@ -166,6 +180,7 @@ public:
   map< string, pair <uint64_t, uint64_t> > &get_chunk_statistics() { return local_chunk_statistics; }
   uint64_t fixed_chunk(string oid, uint64_t offset);
   uint64_t rabin_chunk(string oid, uint64_t offset);
+  uint64_t fastcdc_chunk(string oid, uint64_t offset);
   void add_chunk_fp_to_stat(bufferlist &chunk);
   void set_rabin_options(uint64_t mod_prime, uint32_t rabin_prime, uint64_t pow, 
 			 uint64_t chunk_mask_bit, uint32_t window_size, uint32_t min_chunk, 
@@ -191,6 +206,66 @@ public:
   void print_status(Formatter *f, ostream &out);
 };
 
+/*
+ * Moves the data of base pool objects into the chunk pool.  Each object is
+ * read and chunked without holding anything on the OSD; references are
+ * taken on chunks that already exist and only new chunks are written.
+ * The manifest is then installed in a single write guarded by the version
+ * that was read, so a client write in between simply makes this object
+ * wait for the next pass.
+ */
+class DedupAgent : public EstimateThread
+{
+  IoCtx obj_io_ctx;
+  IoCtx chunk_io_ctx;
+  string chunk_algo;
+  string fp_algo;
+  uint64_t chunk_size;
+  uint32_t min_age;
+  uint32_t sleep_period;
+  FastCDC cdc;
+  RabinChunk rabin;
+  utime_t start_time;
+  uint64_t deduped_objects = 0;
+  uint64_t skipped_objects = 0;
+  uint64_t deduped_bytes = 0;  // logical size of the objects moved to chunks
+  uint64_t stored_bytes = 0;   // bytes newly written to the chunk pool
+
+public:
+  static constexpr const char* MARKER = "dedup.chunked";
+
+  DedupAgent(IoCtx& io_ctx, int n, int m, ObjectCursor begin, ObjectCursor end,
+	     IoCtx& chunk_io_ctx, string chunk_algo, string fp_algo,
+	     uint64_t chunk_size, uint32_t min_age, uint32_t sleep_period,
+	     int32_t timeout, uint64_t num_objects):
+    EstimateThread(io_ctx, n, m, begin, end, timeout, num_objects),
+    chunk_io_ctx(chunk_io_ctx), chunk_algo(chunk_algo), fp_algo(fp_algo),
+    chunk_size(chunk_size), min_age(min_age), sleep_period(sleep_period),
+    cdc(cbits(chunk_size) - 1), start_time(ceph_clock_now())
+  {
+    obj_io_ctx.dup(io_ctx);
+  }
+  void* entry() {
+    dedup_loop();
+    return NULL;
+  }
+  void dedup_loop();
+  bool dedup_pass();
+  int dedup_object(const ObjectItem& item);
+  void print_status(Formatter *f, ostream &out);
+  void set_rabin_options(uint32_t min_chunk, uint64_t max_chunk);
+  uint64_t get_deduped_objects() { return deduped_objects; }
+  uint64_t get_skipped_objects() { return skipped_objects; }
+  uint64_t get_deduped_bytes() { return deduped_bytes; }
+  uint64_t get_stored_bytes() { return stored_bytes; }
+  double get_elapsed() { return (double)(ceph_clock_now() - start_time); }
+
+private:
+  void calc_chunks(bufferlist& data, vector<pair<uint64_t, uint64_t>> *chunks);
+  string fingerprint(const bufferlist& chunk);
+  void put_refs(const set<string>& fps, const hobject_t& soid);
+};
+
 vector<std::unique_ptr<EstimateThread>> estimate_threads;
 
 static void print_dedup_estimate(bool debug = false)
@@ -315,6 +390,8 @@ void EstimateDedupRatio::estimate_dedup_ratio()
 	  next_offset = fixed_chunk(oid, offset);
 	} else if (chunk_algo == "rabin") {
 	  next_offset = rabin_chunk(oid, offset);
+	} else if (chunk_algo == "fastcdc") {
+	  next_offset = fastcdc_chunk(oid, offset);
 	} else {
 	  ceph_assert(0 == "no support chunk algorithm"); 
 	}
@@ -426,6 +503,30 @@ uint64_t EstimateDedupRatio::rabin_chunk(string oid, uint64_t offset)
   return outdata.length();
 }
 
+uint64_t EstimateDedupRatio::fastcdc_chunk(string oid, uint64_t offset)
+{
+  unsigned op_size = max_read_size;
+  int ret;
+  bufferlist outdata;
+  ret = io_ctx.read(oid, outdata, op_size, offset);
+  if (ret <= 0) {
+    return 0;
+  }
+
+  vector<pair<uint64_t, uint64_t>> chunks;
+  cdc.calc_chunks(outdata, &chunks);
+  for (auto p : chunks) {
+    bufferlist chunk;
+    chunk.substr_of(outdata, p.first, p.second);
+    add_chunk_fp_to_stat(chunk);
+  }
+
+  if (outdata.length() < op_size) {
+    return 0;
+  }
+  return outdata.length();
+}
+
 void EstimateDedupRatio::set_rabin_options(uint64_t mod_prime, uint32_t rabin_prime, uint64_t pow, 
 					  uint64_t chunk_mask_bit, uint32_t window_size, 
 					  uint32_t min_chunk, uint64_t max_chunk) 
@@ -559,6 +660,317 @@ void ChunkScrub::print_status(Formatter *f, ostream &out)
   }
 }
 
+void DedupAgent::set_rabin_options(uint32_t min_chunk, uint64_t max_chunk)
+{
+  if (chunk_size) {
+    int index = rabin.add_rabin_mask(cbits(chunk_size) - 1);
+    rabin.set_numbits(index);
+  }
+  if (min_chunk != 0) {
+    rabin.set_min_chunk(min_chunk);
+  }
+  if (max_chunk != 0) {
+    rabin.set_max_chunk(max_chunk);
+  }
+}
+
+void DedupAgent::dedup_loop()
+{
+  while (dedup_pass() && sleep_period) {
+    std::unique_lock l{m_lock};
+    if (m_cond.wait_for(l, std::chrono::seconds(sleep_period),
+			[this] { return m_stop; })) {
+      break;
+    }
+  }
+  Formatter *formatter = Formatter::create("json-pretty");
+  print_status(formatter, cout);
+  delete formatter;
+}
+
+bool DedupAgent::dedup_pass()
+{
+  ObjectCursor shard_start;
+  ObjectCursor shard_end;
+  utime_t cur_time = ceph_clock_now();
+
+  io_ctx.object_list_slice(
+    begin,
+    end,
+    n,
+    m,
+    &shard_start,
+    &shard_end);
+
+  ObjectCursor c(shard_start);
+  while (c < shard_end)
+  {
+    std::vector<ObjectItem> result;
+    int r = io_ctx.object_list(c, shard_end, 12, {}, &result, &c);
+    if (r < 0) {
+      cerr << "error object_list : " << cpp_strerror(r) << std::endl;
+      return false;
+    }
+
+    for (const auto & i : result) {
+      {
+	std::lock_guard l{m_lock};
+	if (m_stop) {
+	  return false;
+	}
+      }
+      r = dedup_object(i);
+      if (r < 0 && r != -ENOENT) {
+	cerr << "error dedup " << i.oid << " : " << cpp_strerror(r) << std::endl;
+      }
+      examined_objects++;
+      if (cur_time + utime_t(timeout, 0) < ceph_clock_now()) {
+	Formatter *formatter = Formatter::create("json-pretty");
+	print_status(formatter, cout);
+	delete formatter;
+	cur_time = ceph_clock_now();
+      }
+    }
+  }
+  return true;
+}
+
+void DedupAgent::calc_chunks(bufferlist& data, vector<pair<uint64_t, uint64_t>> *chunks)
+{
+  if (chunk_algo == "fastcdc") {
+    cdc.calc_chunks(data, chunks);
+  } else if (chunk_algo == "rabin") {
+    rabin.do_rabin_chunks(data, *chunks, 0, 0);
+  } else {
+    for (uint64_t off = 0; off < data.length(); off += chunk_size) {
+      chunks->emplace_back(off, std::min<uint64_t>(chunk_size, data.length() - off));
+    }
+  }
+}
+
+string DedupAgent::fingerprint(const bufferlist& chunk)
+{
+  // must match the name the OSD gives a chunk when it flushes it
+  if (fp_algo == "sha1") {
+    return crypto::digest<crypto::SHA1>(chunk).to_str();
+  } else if (fp_algo == "sha256") {
+    return crypto::digest<crypto::SHA256>(chunk).to_str();
+  } else {
+    return crypto::digest<crypto::SHA512>(chunk).to_str();
+  }
+}
+
+void DedupAgent::put_refs(const set<string>& fps, const hobject_t& soid)
+{
+  // best effort; chunk-scrub drops whatever is left behind
+  for (auto& fp : fps) {
+    ObjectWriteOperation op;
+    cls_chunk_refcount_put(op, soid);
+    chunk_io_ctx.operate(fp, &op);
+  }
+}
+
+int DedupAgent::dedup_object(const ObjectItem& item)
+{
+  const string& oid = item.oid;
+  obj_io_ctx.set_namespace(item.nspace);
+  obj_io_ctx.locator_set_key(item.locator);
+
+  // reading an xattr does not bring an evicted object back
+  bufferlist marker;
+  int r = obj_io_ctx.getxattr(oid, MARKER, marker);
+  if (r >= 0) {
+    // already chunked: write back whatever clients changed since, then
+    // drop the local copy again now that every chunk is clean
+    ObjectWriteOperation op;
+    op.tier_flush();
+    r = obj_io_ctx.operate(oid, &op);
+    if (r < 0) {
+      return r;
+    }
+    ObjectWriteOperation evict;
+    evict.tier_evict();
+    r = obj_io_ctx.operate(oid, &evict);
+    if (r == -EBUSY) {
+      // written again since the flush; the next pass gets it
+      return 0;
+    }
+    return r;
+  }
+  if (r != -ENODATA) {
+    return r;
+  }
+
+  uint64_t size = 0;
+  struct timespec mtime;
+  bufferlist data;
+  ObjectReadOperation rop;
+  rop.stat2(&size, &mtime, nullptr);
+  rop.read(0, 0, &data, nullptr);
+  r = obj_io_ctx.operate(oid, &rop, nullptr);
+  if (r < 0) {
+    return r;
+  }
+  const uint64_t version = obj_io_ctx.get_last_version();
+  total_bytes += data.length();
+  if (!size || data.length() != size ||
+      (min_age && utime_t(mtime) + utime_t(min_age, 0) > ceph_clock_now())) {
+    skipped_objects++;
+    return 0;
+  }
+
+  // the chunk pool keeps a single reference per source object, so a chunk
+  // may only appear once in an object; fold repeats into the chunk before.
+  // Folded chunks are told apart by a key made of the keys of what was
+  // folded, not by hashing the growing chunk over and over, and are only
+  // fingerprinted once folding is done.
+  struct piece_t {
+    uint64_t off;
+    uint64_t len;
+    string key;		// the fingerprint, unless folded
+    bool folded;
+  };
+  vector<pair<uint64_t, uint64_t>> cuts;
+  calc_chunks(data, &cuts);
+  vector<piece_t> pieces;
+  set<string> keys;
+  for (auto& c : cuts) {
+    bufferlist chunk;
+    chunk.substr_of(data, c.first, c.second);
+    piece_t piece{c.first, c.second, fingerprint(chunk), false};
+    while (keys.count(piece.key) && !pieces.empty()) {
+      auto& prev = pieces.back();
+      keys.erase(prev.key);
+      bufferlist both;
+      both.append(prev.key);
+      both.append(piece.key);
+      piece = piece_t{prev.off, prev.len + piece.len, fingerprint(both), true};
+      pieces.pop_back();
+    }
+    keys.insert(piece.key);
+    pieces.push_back(std::move(piece));
+  }
+  vector<pair<pair<uint64_t, uint64_t>, string>> chunks;
+  map<string, bufferlist> fp_data;
+  for (auto& piece : pieces) {
+    bufferlist chunk;
+    chunk.substr_of(data, piece.off, piece.len);
+    string fp = piece.folded ? fingerprint(chunk) : piece.key;
+    if (fp_data.count(fp)) {
+      // folded differently into the same data as another chunk; rare
+      // enough to leave the object alone
+      skipped_objects++;
+      return 0;
+    }
+    chunks.emplace_back(make_pair(piece.off, piece.len), fp);
+    fp_data[fp] = std::move(chunk);
+  }
+
+  uint32_t hash;
+  r = obj_io_ctx.get_object_hash_position2(
+    item.locator.empty() ? oid : item.locator, &hash);
+  if (r < 0) {
+    return r;
+  }
+  hobject_t soid(sobject_t(oid, CEPH_NOSNAP), item.locator, hash,
+		 obj_io_ctx.get_id(), item.nspace);
+
+  // reference the chunks that are already stored; only the ones that are
+  // not get sent with their data
+  map<string, AioCompletion*> gets;
+  for (auto& p : fp_data) {
+    ObjectWriteOperation op;
+    op.assert_exists();
+    cls_chunk_refcount_get(op, soid);
+    AioCompletion *completion = Rados::aio_create_completion();
+    chunk_io_ctx.aio_operate(p.first, completion, &op);
+    gets[p.first] = completion;
+  }
+  set<string> referenced;
+  map<string, AioCompletion*> creates;
+  int ret = 0;
+  for (auto& p : gets) {
+    p.second->wait_for_complete();
+    r = p.second->get_return_value();
+    p.second->release();
+    if (r == 0) {
+      referenced.insert(p.first);
+    } else if (r == -ENOENT) {
+      ObjectWriteOperation op;
+      cls_chunk_create_or_get_ref(op, soid, fp_data[p.first]);
+      AioCompletion *completion = Rados::aio_create_completion();
+      chunk_io_ctx.aio_operate(p.first, completion, &op);
+      creates[p.first] = completion;
+    } else if (!ret) {
+      ret = r;
+    }
+  }
+  uint64_t stored = 0;
+  for (auto& p : creates) {
+    p.second->wait_for_complete();
+    r = p.second->get_return_value();
+    p.second->release();
+    if (r == 0) {
+      referenced.insert(p.first);
+      stored += fp_data[p.first].length();
+    } else if (!ret) {
+      ret = r;
+    }
+  }
+  if (ret < 0) {
+    put_refs(referenced, soid);
+    return ret;
+  }
+
+  ObjectWriteOperation op;
+  op.assert_version(version);
+  for (auto& c : chunks) {
+    op.set_chunk(c.first.first, c.first.second, chunk_io_ctx, c.second, 0,
+		 CEPH_OSD_OP_FLAG_WITH_REFERENCE);
+  }
+  bufferlist bl;
+  bl.append(chunk_algo);
+  op.setxattr(MARKER, bl);
+  op.tier_evict();
+  r = obj_io_ctx.operate(oid, &op);
+  if (r < 0) {
+    put_refs(referenced, soid);
+    if (r == -ERANGE || r == -EOVERFLOW) {
+      // written since it was read; try again on the next pass
+      skipped_objects++;
+      return 0;
+    }
+    return r;
+  }
+
+  deduped_objects++;
+  deduped_bytes += size;
+  stored_bytes += stored;
+  return 0;
+}
+
+void DedupAgent::print_status(Formatter *f, ostream &out)
+{
+  if (f) {
+    const double elapsed = std::max(get_elapsed(), 0.001);
+    f->open_array_section("dedup");
+    f->dump_string("PID", stringify(get_pid()));
+    f->open_object_section("Status");
+    f->dump_string("Examined objects", stringify(examined_objects));
+    f->dump_string("Deduped objects", stringify(deduped_objects));
+    f->dump_string("Skipped objects", stringify(skipped_objects));
+    f->dump_string("Scanned bytes", stringify(total_bytes));
+    f->dump_string("Deduped bytes", stringify(deduped_bytes));
+    f->dump_string("Stored bytes", stringify(stored_bytes));
+    f->dump_float("Objects per second", examined_objects / elapsed);
+    f->dump_float("MB per second", total_bytes / elapsed / (1 << 20));
+    f->close_section();
+    f->close_section();
+    f->flush(out);
+    cout << std::endl;
+  }
+}
+
 int estimate_dedup_ratio(const std::map < std::string, std::string > &opts,
 			  std::vector<const char*> &nargs)
 {
@@ -589,7 +1001,7 @@ int estimate_dedup_ratio(const std::map < std::string, std::string > &opts,
   i = opts.find("chunk-algorithm");
   if (i != opts.end()) {
     chunk_algo = i->second.c_str();
-    if (chunk_algo != "fixed" && chunk_algo != "rabin") {
+    if (chunk_algo != "fixed" && chunk_algo != "rabin" && chunk_algo != "fastcdc") {
       usage_exit();
     }
   } else {
@@ -613,7 +1025,7 @@ int estimate_dedup_ratio(const std::map < std::string, std::string > &opts,
       return -EINVAL;
     }
   } else {
-    if (chunk_algo != "rabin") {
+    if (chunk_algo == "fixed") {
       usage_exit();
     }
   }
@@ -939,6 +1351,256 @@ out:
   return (ret < 0) ? 1 : 0;
 }
 
+static void print_dedup_status()
+{
+  uint64_t examined_objects = 0;
+  uint64_t deduped_objects = 0;
+  uint64_t skipped_objects = 0;
+  uint64_t total_bytes = 0;
+  uint64_t deduped_bytes = 0;
+  uint64_t stored_bytes = 0;
+  double elapsed = 0.001;
+
+  for (auto &et : estimate_threads) {
+    DedupAgent *agent = static_cast<DedupAgent*>(et.get());
+    examined_objects += agent->get_examined_objects();
+    deduped_objects += agent->get_deduped_objects();
+    skipped_objects += agent->get_skipped_objects();
+    total_bytes += agent->get_total_bytes();
+    deduped_bytes += agent->get_deduped_bytes();
+    stored_bytes += agent->get_stored_bytes();
+    elapsed = std::max(elapsed, agent->get_elapsed());
+  }
+
+  cout << " Examined objects: " << examined_objects << std::endl;
+  cout << " Deduped objects: " << deduped_objects << std::endl;
+  cout << " Skipped objects: " << skipped_objects << std::endl;
+  cout << " result: " << deduped_bytes << " | " << stored_bytes
+       << " (deduped size | newly stored chunk size) " << std::endl;
+  if (deduped_bytes) {
+    cout << " Dedup ratio: " << (100 - (double)(stored_bytes)/deduped_bytes*100)
+	 << " % " << std::endl;
+  }
+  cout << " Throughput: " << examined_objects / elapsed << " objects/s, "
+       << total_bytes / elapsed / (1 << 20) << " MB/s" << std::endl;
+}
+
+static int get_pool_fingerprint_algorithm(Rados& rados, const string& pool_name,
+					  string *fp_algo)
+{
+  bufferlist inbl, outbl;
+  string outs;
+  string cmd = "{\"prefix\": \"osd pool get\", \"pool\": \"" + pool_name +
+    "\", \"var\": \"fingerprint_algorithm\"}";
+  int ret = rados.mon_command(cmd, inbl, &outbl, &outs);
+  if (ret < 0) {
+    return ret;
+  }
+  // "fingerprint_algorithm: sha1"
+  string out = outbl.to_str();
+  auto pos = out.find(": ");
+  if (pos == string::npos) {
+    return -EINVAL;
+  }
+  *fp_algo = out.substr(pos + 2);
+  while (!fp_algo->empty() && isspace(fp_algo->back())) {
+    fp_algo->pop_back();
+  }
+  return 0;
+}
+
+int dedup_pool(const std::map < std::string, std::string > &opts,
+	       std::vector<const char*> &nargs)
+{
+  Rados rados;
+  IoCtx io_ctx, chunk_io_ctx;
+  string pool_name, chunk_pool_name, object_name;
+  string chunk_algo = "fastcdc";
+  string fp_algo, pool_fp_algo;
+  uint64_t chunk_size = default_dedup_chunk_size;
+  uint64_t max_chunk = 0;
+  uint32_t min_chunk = 0, min_age = 0, sleep_period = 0;
+  unsigned max_thread = default_max_thread;
+  uint32_t report_period = default_report_period;
+  int ret;
+  std::map<std::string, std::string>::const_iterator i;
+  ObjectCursor begin;
+  ObjectCursor end;
+  librados::pool_stat_t s; 
+  list<string> pool_names;
+  map<string, librados::pool_stat_t> stats;
+
+  i = opts.find("pool");
+  if (i != opts.end()) {
+    pool_name = i->second.c_str();
+  } else {
+    usage_exit();
+  }
+  i = opts.find("chunk-pool");
+  if (i != opts.end()) {
+    chunk_pool_name = i->second.c_str();
+  } else {
+    usage_exit();
+  }
+  i = opts.find("object");
+  if (i != opts.end()) {
+    object_name = i->second.c_str();
+  }
+  i = opts.find("chunk-algorithm");
+  if (i != opts.end()) {
+    chunk_algo = i->second.c_str();
+    if (chunk_algo != "fixed" && chunk_algo != "rabin" && chunk_algo != "fastcdc") {
+      usage_exit();
+    }
+  }
+  i = opts.find("fingerprint-algorithm");
+  if (i != opts.end()) {
+    fp_algo = i->second.c_str();
+  }
+  i = opts.find("chunk-size");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &chunk_size)) {
+      return -EINVAL;
+    }
+    if (!chunk_size) {
+      usage_exit();
+    }
+  }
+  i = opts.find("min-chunk");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &min_chunk)) {
+      return -EINVAL;
+    }
+  } 
+  i = opts.find("max-chunk");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &max_chunk)) {
+      return -EINVAL;
+    }
+  } 
+  i = opts.find("min-age");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &min_age)) {
+      return -EINVAL;
+    }
+  } 
+  i = opts.find("sleep");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &sleep_period)) {
+      return -EINVAL;
+    }
+  } 
+  i = opts.find("max-thread");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &max_thread)) {
+      return -EINVAL;
+    }
+  } 
+  i = opts.find("report-period");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &report_period)) {
+      return -EINVAL;
+    }
+  } 
+
+  ret = rados.init_with_context(g_ceph_context);
+  if (ret < 0) {
+     cerr << "couldn't initialize rados: " << cpp_strerror(ret) << std::endl;
+     goto out;
+  }
+  ret = rados.connect();
+  if (ret) {
+     cerr << "couldn't connect to cluster: " << cpp_strerror(ret) << std::endl;
+     ret = -1;
+     goto out;
+  }
+  ret = rados.ioctx_create(pool_name.c_str(), io_ctx);
+  if (ret < 0) {
+    cerr << "error opening pool "
+	 << pool_name << ": "
+	 << cpp_strerror(ret) << std::endl;
+    goto out;
+  }
+  ret = rados.ioctx_create(chunk_pool_name.c_str(), chunk_io_ctx);
+  if (ret < 0) {
+    cerr << "error opening pool "
+	 << chunk_pool_name << ": "
+	 << cpp_strerror(ret) << std::endl;
+    goto out;
+  }
+
+  // the OSD names chunks it writes back after a client overwrite by the
+  // pool's fingerprint, so ours have to be named the same way
+  ret = get_pool_fingerprint_algorithm(rados, pool_name, &pool_fp_algo);
+  if (ret < 0 || pool_fp_algo == "none") {
+    cerr << "pool " << pool_name << " has no fingerprint_algorithm set" << std::endl;
+    ret = -EINVAL;
+    goto out;
+  }
+  if (!fp_algo.empty() && fp_algo != pool_fp_algo) {
+    cerr << "--fingerprint-algorithm " << fp_algo << " does not match the "
+	 << pool_fp_algo << " set on pool " << pool_name << std::endl;
+    ret = -EINVAL;
+    goto out;
+  }
+  fp_algo = pool_fp_algo;
+
+  if (!object_name.empty()) {
+    DedupAgent agent(io_ctx, 0, 1, begin, end, chunk_io_ctx, chunk_algo,
+		     fp_algo, chunk_size, min_age, 0, report_period, 1);
+    if (chunk_algo == "rabin") {
+      agent.set_rabin_options(min_chunk, max_chunk);
+    }
+    ObjectItem item;
+    item.oid = object_name;
+    ret = agent.dedup_object(item);
+    if (ret < 0) {
+      cerr << "error dedup " << object_name << " : " << cpp_strerror(ret) << std::endl;
+    }
+    goto out;
+  }
+
+  io_ctx.set_namespace(all_nspaces);
+  glock.lock();
+  begin = io_ctx.object_list_begin();
+  end = io_ctx.object_list_end();
+  pool_names.push_back(pool_name);
+  ret = rados.get_pool_stats(pool_names, stats);
+  if (ret < 0) {
+    cerr << "error fetching pool stats: " << cpp_strerror(ret) << std::endl;
+    glock.unlock();
+    return ret;
+  }
+  if (stats.find(pool_name) == stats.end()) {
+    cerr << "stats can not find pool name: " << pool_name << std::endl;
+    glock.unlock();
+    return ret;
+  }
+  s = stats[pool_name];
+
+  for (unsigned i = 0; i < max_thread; i++) {
+    std::unique_ptr<EstimateThread> ptr (new DedupAgent(io_ctx, i, max_thread, begin, end,
+							chunk_io_ctx, chunk_algo, fp_algo,
+							chunk_size, min_age, sleep_period,
+							report_period, s.num_objects));
+    if (chunk_algo == "rabin") {
+      static_cast<DedupAgent*>(ptr.get())->set_rabin_options(min_chunk, max_chunk);
+    }
+    ptr->create("dedup_thread");
+    estimate_threads.push_back(move(ptr));
+  }
+  glock.unlock();
+
+  for (auto &p : estimate_threads) {
+    p->join();
+  }
+
+  print_dedup_status();
+
+out:
+  return (ret < 0) ? 1 : 0;
+}
+
 int main(int argc, const char **argv)
 {
   vector<const char*> args;
@@ -1006,6 +1668,10 @@ int main(int argc, const char **argv)
       opts["min-chunk"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--max-chunk", (char*)NULL)) {
       opts["max-chunk"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--min-age", (char*)NULL)) {
+      opts["min-age"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--sleep", (char*)NULL)) {
+      opts["sleep"] = val;
     } else if (ceph_argparse_flag(args, i, "--debug", (char*)NULL)) {
       opts["debug"] = "true";
     } else {
@@ -1023,6 +1689,8 @@ int main(int argc, const char **argv)
     return chunk_scrub_common(opts, args);
   } else if (op_name == "get-chunk-ref") {
     return chunk_scrub_common(opts, args);
+  } else if (op_name == "dedup") {
+    return dedup_pool(opts, args);
   } else {
     usage();
     exit(0);